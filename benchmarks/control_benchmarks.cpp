@@ -0,0 +1,188 @@
+// Control-path benchmarks: logging, board state updates, register
+// configuration against a stand-in backend and configuration files
+
+#include <iostream>
+#include <streambuf>
+#include "nalu_benchmark.h"
+#include "nalu_board_backend.h"
+#include "nalu_board_configurator.h"
+#include "nalu_board_controller_logger.h"
+#include "nalu_board_state.h"
+#include "nalu_config_file.h"
+#include "nalu_scan_engine.h"
+
+namespace {
+
+// Backend that only counts, so the configurator's own cost is what is timed
+class CountingBackend : public NaluBoardBackend {
+public:
+    void InitializeBoard() override { calls++; }
+    void StartCapture() override { calls++; }
+    void StopCapture() override { calls++; }
+    void WriteTriggerValues(const std::vector<int>& values) override { calls += values.empty() ? 0 : 1; }
+    void WriteTriggerReferences(int, int) override { calls++; }
+    void WriteTriggerEdge(bool) override { calls++; }
+    void WriteDacValue(int, int) override { calls++; }
+    void WriteReadoutChannels(const std::vector<int>& channels) override { calls += channels.empty() ? 0 : 1; }
+    void WriteReadWindow(int, int, int) override { calls++; }
+    void ConfigureEthernet(const IPAddressInfo&) override { calls++; }
+
+    uint64_t calls = 0;
+};
+
+// Swallows whatever the logger prints while it is being timed
+class NullBuffer : public std::streambuf {
+protected:
+    int overflow(int c) override { return c; }
+    std::streamsize xsputn(const char*, std::streamsize count) override { return count; }
+};
+
+NaluBoardParams BenchmarkBoardParams() {
+    NaluBoardParams params;
+    params.model = "hdsocv1_evalr2";
+    return params;
+}
+
+// Self-triggered capture with every channel enabled and DACs assigned, the
+// most register traffic a capture start causes
+NaluCaptureParams BenchmarkCaptureParams(int channels) {
+    NaluCaptureParams params;
+    params.target_ip_port = "127.0.0.1:12345";
+    params.windows = 4;
+    params.lookback = 4;
+    params.trigger_mode = "self";
+    params.assign_dac_values = true;
+    for (int channel = 0; channel < channels; ++channel) {
+        params.channels[channel] = NaluChannelInfo{true, 100 + channel, 1800 + channel};
+    }
+    params.receiver.mode = "socket";
+    params.receiver.queues = 2;
+    params.merge.enabled = true;
+    params.merge.clock_offsets = {{0, 0}, {1, -1250}};
+    params.filter.enabled = true;
+    params.filter.rules = {NaluFilterRule{"mult3", {}, 3}, NaluFilterRule{"pair", {0, 1, 2, 3}, 1, 2, 40}};
+    params.monitor.enabled = true;
+    return params;
+}
+
+}  // namespace
+
+NALU_BENCHMARK(logger) {
+    using Logger = NaluBoardControllerLogger;
+
+    // Below the level: what a debug line in a hot path costs when disabled
+    context.Run("logger/debug_suppressed_literal", [](uint64_t iterations) {
+        for (uint64_t i = 0; i < iterations; ++i) {
+            Logger::debug("Trigger values written to board.");
+        }
+    });
+    context.Run("logger/debug_suppressed_concatenated", [](uint64_t iterations) {
+        for (uint64_t i = 0; i < iterations; ++i) {
+            Logger::debug("Setting DAC for channel " + std::to_string(i & 63) + " to " + std::to_string(1804));
+        }
+    });
+
+    // Emitted, with stdout swallowed so only the logger's own work is timed
+    NullBuffer null_buffer;
+    Logger::set_level(Logger::LogLevel::DEBUG);
+    context.Run("logger/info_emitted", [&](uint64_t iterations) {
+        std::streambuf* stdout_buffer = std::cout.rdbuf(&null_buffer);
+        for (uint64_t i = 0; i < iterations; ++i) {
+            Logger::info("Receive queue " + std::to_string(i & 7) + " started");
+        }
+        std::cout.rdbuf(stdout_buffer);
+    });
+    Logger::set_level(Logger::LogLevel::WARNING);
+}
+
+NALU_BENCHMARK(board_state) {
+    NaluBoardState state(BenchmarkBoardParams());
+    for (int channels : {1, state.ChannelCount()}) {
+        NaluCaptureParams params = BenchmarkCaptureParams(channels);
+        context.Run("board_state/update_from_capture_params/" + std::to_string(channels) + "ch",
+                    [&](uint64_t iterations) {
+                        for (uint64_t i = 0; i < iterations; ++i) {
+                            state.UpdateFromCaptureParams(params);
+                            NaluDoNotOptimize(state.EnabledChannelMask());
+                        }
+                    });
+    }
+}
+
+NALU_BENCHMARK(configurator) {
+    NaluBoardState state(BenchmarkBoardParams());
+    state.UpdateFromCaptureParams(BenchmarkCaptureParams(state.ChannelCount()));
+    CountingBackend backend;
+    NaluBoardConfigurator configurator(&state, &backend);
+
+    configurator.ConfigureForCapture();
+    double writes = static_cast<double>(backend.calls);
+    context.Run("configurator/configure_for_capture", [&](uint64_t iterations) {
+        for (uint64_t i = 0; i < iterations; ++i) {
+            configurator.ConfigureForCapture();
+        }
+    }, {}, {{"backend_calls", writes}});
+
+    // One threshold moving back and forth, written live
+    NaluHotUpdate update;
+    context.Run("configurator/hot_update_one_threshold", [&](uint64_t iterations) {
+        for (uint64_t i = 0; i < iterations; ++i) {
+            update.channels[3].trigger_value = 200 + static_cast<int>(i & 1);
+            NaluDoNotOptimize(configurator.ApplyHotUpdate(update).trigger_values_changed);
+        }
+    });
+}
+
+// Step switching of NaluScanEngine with no dwell or settle time, so what is
+// timed is preparing, writing and tallying each step
+NALU_BENCHMARK(scan) {
+    NaluBoardState state(BenchmarkBoardParams());
+    state.UpdateFromCaptureParams(BenchmarkCaptureParams(state.ChannelCount()));
+    state.SetCapturing(true);
+    CountingBackend backend;
+    NaluBoardConfigurator configurator(&state, &backend);
+    NaluCaptureCounters counters;
+    NaluScanEngine engine(&state, &configurator, &counters);
+
+    constexpr int kSteps = 100;
+    for (NaluScanMode mode : {NaluScanMode::PARALLEL, NaluScanMode::SEQUENTIAL}) {
+        NaluScanPlan plan;
+        plan.mode = mode;
+        plan.dwell_ms = 0;
+        plan.restore_values = false;
+        // Sequential scans step each channel through the range in turn
+        int channels = mode == NaluScanMode::PARALLEL ? state.ChannelCount() : 4;
+        for (int channel = 0; channel < channels; ++channel) {
+            plan.channels.push_back(channel);
+        }
+        plan.start = 100;
+        plan.stop = plan.start + kSteps / (mode == NaluScanMode::PARALLEL ? 1 : channels) - 1;
+
+        std::string name = mode == NaluScanMode::PARALLEL ? "parallel_" : "sequential_";
+        context.Run("scan/steps_per_second/" + name + std::to_string(channels) + "ch", [&](uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; ++i) {
+                NaluDoNotOptimize(engine.Run(plan).steps);
+            }
+        }, {static_cast<double>(kSteps)});
+    }
+}
+
+NALU_BENCHMARK(config_file) {
+    NaluBoardState state(BenchmarkBoardParams());
+    NaluCaptureParams params = BenchmarkCaptureParams(state.ChannelCount());
+
+    for (NaluConfigFormat format : {NaluConfigFormat::YAML, NaluConfigFormat::JSON}) {
+        std::string suffix = format == NaluConfigFormat::YAML ? "yaml" : "json";
+        std::string text = NaluConfigFile::ToString(params, format);
+        context.Run("config_file/parse_capture_params/" + suffix, [&](uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; ++i) {
+                NaluDoNotOptimize(NaluConfigFile::ParseCaptureParams(text, format).channels.size());
+            }
+        }, {1.0, static_cast<double>(text.size())});
+        context.Run("config_file/emit_capture_params/" + suffix, [&](uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; ++i) {
+                NaluDoNotOptimize(NaluConfigFile::ToString(params, format).size());
+            }
+        }, {1.0, static_cast<double>(text.size())});
+    }
+}
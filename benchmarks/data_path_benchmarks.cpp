@@ -0,0 +1,421 @@
+// Data-path microbenchmarks on one thread (or one producer/consumer pair):
+// packet parsing, window unpacking, event building, hit features, the SPSC
+// ring, the capture recorder, the heap allocations of the event path, the
+// cost of latency instrumentation and waveform assembly
+
+#include <array>
+#include <chrono>
+#include <thread>
+#include "nalu_benchmark.h"
+#include "nalu_benchmark_stream.h"
+#include "nalu_capture_recorder.h"
+#include "nalu_event_builder.h"
+#include "nalu_event_filter.h"
+#include "nalu_event_merger.h"
+#include "nalu_event_queue.h"
+#include "nalu_hit_features.h"
+#include "nalu_latency.h"
+#include "nalu_monitor.h"
+#include "nalu_packet_format.h"
+#include "nalu_receiver.h"
+#include "nalu_spsc_ring.h"
+#include "nalu_waveform_assembler.h"
+
+NALU_BENCHMARK(packet) {
+    NaluBenchmarkStream stream(0, 8, 4);
+    const auto& packets = stream.Next();
+    const double packet_count = static_cast<double>(packets.size());
+    const double bytes = static_cast<double>(stream.BytesPerEvent());
+
+    context.Run("packet/parse_header", [&](uint64_t iterations) {
+        NaluPacketHeader header;
+        for (uint64_t i = 0; i < iterations; ++i) {
+            for (const auto& packet : packets) {
+                NaluParsePacketHeader(packet.data(), packet.size(), header);
+                NaluDoNotOptimize(header);
+            }
+        }
+    }, {packet_count});
+
+    // Walk every window block and copy its samples out, as the builder does
+    std::vector<uint16_t> samples(stream.BytesPerEvent() / 2);
+    context.Run("packet/unpack_windows", [&](uint64_t iterations) {
+        for (uint64_t i = 0; i < iterations; ++i) {
+            size_t offset = 0;
+            for (const auto& packet : packets) {
+                NaluWindowBlockReader reader(packet.data(), packet.size());
+                NaluWindowBlock block;
+                while (reader.Next(block)) {
+                    for (uint16_t sample = 0; sample < block.sample_count; ++sample) {
+                        samples[offset++] = NaluLoadU16(block.samples + sample * 2);
+                    }
+                }
+            }
+            NaluDoNotOptimize(samples.data());
+        }
+    }, {packet_count, bytes});
+}
+
+NALU_BENCHMARK(event_builder) {
+    // Small events fit one packet, large ones span several
+    for (auto [channels, windows] : {std::pair<int, int>{8, 1}, {32, 4}, {64, 8}}) {
+        NaluBenchmarkStream stream(0, channels, windows);
+        NaluEventLayout layout;
+        layout.channel_mask = channels == 64 ? ~uint64_t{0} : (uint64_t{1} << channels) - 1;
+        layout.windows = windows;
+        NaluCaptureCounters counters;
+        uint64_t complete = 0;
+        NaluEventBuilder builder(NaluEventBuilderParams{}, layout, &counters,
+                                 [&](NaluEvent&& event) { complete += event.complete; });
+
+        uint64_t rx_ns = NaluMonotonicNs();
+        std::string name = "event_builder/build/" + std::to_string(channels) + "ch_" + std::to_string(windows) + "w";
+        context.Run(name, [&](uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; ++i) {
+                for (const auto& packet : stream.Next()) {
+                    builder.HandlePacket(packet.data(), packet.size(), rx_ns);
+                }
+                rx_ns += 1000;
+            }
+        }, {1.0, static_cast<double>(stream.BytesPerEvent())},
+           {{"packets_per_event", static_cast<double>(stream.PacketsPerEvent())}});
+        builder.Flush();
+    }
+}
+
+NALU_BENCHMARK(hit_features) {
+    for (int channels : {8, 64}) {
+        NaluEvent event = NaluBenchmarkStream(0, channels, 4).Event();
+        NaluHitFeatures features;
+        context.Run("hit_features/extract/" + std::to_string(channels) + "ch_4w", [&](uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; ++i) {
+                NaluExtractHitFeatures(event, 4, 50, features);
+                NaluDoNotOptimize(features.hit_mask);
+            }
+        }, {1.0, static_cast<double>(event.samples.size() * sizeof(uint16_t))});
+    }
+}
+
+NALU_BENCHMARK(spsc_ring) {
+    NaluSpscRing<uint64_t> ring(4096);
+    context.Run("spsc_ring/push_pop_same_thread", [&](uint64_t iterations) {
+        uint64_t value = 0;
+        for (uint64_t i = 0; i < iterations; ++i) {
+            ring.TryPush(uint64_t(i));
+            ring.TryPop(value);
+        }
+        NaluDoNotOptimize(value);
+    }, {1.0});
+
+    // Producer here, consumer on a second thread; the figure is the rate
+    // the consumer keeps up with. Both yield when they cannot proceed, so
+    // the numbers stay meaningful on machines with fewer cores than threads.
+    for (size_t capacity : {size_t{256}, size_t{4096}}) {
+        NaluSpscRing<uint64_t> shared(capacity);
+        context.Run("spsc_ring/two_threads/capacity_" + std::to_string(capacity), [&](uint64_t iterations) {
+            std::thread consumer([&] {
+                uint64_t value = 0;
+                for (uint64_t received = 0; received < iterations;) {
+                    if (shared.TryPop(value)) {
+                        received++;
+                    } else {
+                        std::this_thread::yield();
+                    }
+                }
+                NaluDoNotOptimize(value);
+            });
+            for (uint64_t i = 0; i < iterations; ++i) {
+                while (!shared.TryPush(uint64_t(i))) {
+                    std::this_thread::yield();
+                }
+            }
+            consumer.join();
+        }, {1.0});
+    }
+
+    // Moving whole events, as the merger does
+    NaluSpscRing<NaluEvent> events(1024);
+    NaluEvent event = NaluBenchmarkStream(0, 8, 4).Event();
+    context.Run("spsc_ring/event_move_same_thread", [&](uint64_t iterations) {
+        NaluEvent popped;
+        for (uint64_t i = 0; i < iterations; ++i) {
+            events.TryPush(std::move(event));
+            events.TryPop(popped);
+            event = std::move(popped);
+        }
+    }, {1.0});
+}
+
+NALU_BENCHMARK(recorder) {
+    // To /dev/null: the receive thread's share of recording, without the disk
+    NaluRecordParams params;
+    params.path = "/dev/null";
+    NaluBenchmarkStream stream(0, 8, 4);
+    NaluCaptureRecorder recorder(params, 1);
+    recorder.Start();
+    uint64_t rx_ns = NaluMonotonicNs();
+    context.Run("recorder/record_to_dev_null", [&](uint64_t iterations) {
+        for (uint64_t i = 0; i < iterations; ++i) {
+            for (const auto& packet : stream.Next()) {
+                recorder.Record(0, packet.data(), packet.size(), rx_ns++);
+            }
+        }
+    }, {static_cast<double>(stream.PacketsPerEvent()), static_cast<double>(stream.BytesPerEvent())});
+    recorder.Stop();
+}
+
+NALU_BENCHMARK(allocations) {
+    // Two boards through builder -> monitor -> [merger] -> cross-board filter
+    // -> slot queue, drained by a consumer that keeps its last events leased,
+    // as a Python caller would. Heap allocations are counted, on every
+    // thread, after a warm-up; steady capture should make none. Storage is
+    // allocated the first time the backlog gets this deep, so the warm-up
+    // first lets the slot queue fill past anything the measured run reaches
+    // (the merger's 256 events in flight and the consumer's leases).
+    constexpr int kBoards = 2;
+    constexpr int kHeld = 16;
+    constexpr uint64_t kFillSteps = 512;
+    const uint64_t events = context.Quick() ? 20000 : 100000;
+
+    for (bool merged : {false, true}) {
+        NaluEventLayout layout;
+        layout.channel_mask = (uint64_t{1} << 8) - 1;
+        layout.windows = 4;
+        layout.samples_per_window = 32;
+
+        NaluEventSlotQueue queue(2048);
+        NaluFilterParams filter_params;
+        filter_params.enabled = true;
+        filter_params.rules = {NaluFilterRule{"pair", {}, 1, kBoards, 2000}};
+        NaluEventFilter filter(filter_params, {}, [&queue](NaluEvent&& event) { queue.Push(std::move(event)); });
+        NaluMergeParams merge_params;
+        merge_params.enabled = true;
+        NaluEventMerger merger(merge_params, [&filter](NaluEvent&& event) { filter.HandleEvent(std::move(event)); });
+        NaluMonitorParams monitor_params;
+        monitor_params.enabled = true;
+        NaluMonitor monitor(monitor_params, kBoards);
+
+        std::vector<std::unique_ptr<NaluBenchmarkStream>> streams;
+        std::vector<std::unique_ptr<NaluEventBuilder>> builders;
+        for (int board = 0; board < kBoards; ++board) {
+            streams.push_back(std::make_unique<NaluBenchmarkStream>(board, 8, 4));
+            builders.push_back(std::make_unique<NaluEventBuilder>(
+                NaluEventBuilderParams{}, layout, nullptr, [&, board, merged](NaluEvent&& event) {
+                    monitor.Observe(board, event);
+                    if (merged) {
+                        merger.Push(std::move(event));
+                    } else {
+                        filter.HandleEvent(std::move(event));
+                    }
+                }));
+        }
+        if (merged) {
+            merger.Start();
+        }
+
+        std::array<int, kHeld> held;
+        held.fill(-1);
+        size_t next_held = 0;
+        auto consume = [&](int timeout_ms) {
+            for (int index = queue.Pop(timeout_ms); index >= 0; index = queue.Pop(0)) {
+                NaluDoNotOptimize(queue.Slot(index).samples.data());
+                queue.Release(held[next_held]);
+                held[next_held] = index;
+                next_held = (next_held + 1) % kHeld;
+            }
+        };
+        uint64_t rx_ns = NaluMonotonicNs();
+        auto feed = [&](uint64_t count, bool drain) {
+            for (uint64_t i = 0; i < count; ++i) {
+                for (int board = 0; board < kBoards; ++board) {
+                    for (const auto& packet : streams[board]->Next()) {
+                        builders[board]->HandlePacket(packet.data(), packet.size(), rx_ns);
+                    }
+                }
+                rx_ns += 1000;
+                if (merged) {
+                    // Leave the merge thread room on machines with few cores
+                    while (merger.Stats().events_in - merger.Stats().events_out > 256) {
+                        std::this_thread::yield();
+                        if (drain) {
+                            consume(0);
+                        }
+                    }
+                }
+                if (drain) {
+                    consume(0);
+                }
+            }
+        };
+
+        // Warm: the deepest backlog has been reached and every merger ring
+        // slot has been through once, so each slot in use holds storage
+        feed(kFillSteps, false);
+        feed(static_cast<uint64_t>(merge_params.queue_capacity) + 1000, true);
+        auto pool_stats = [&] {
+            NaluDataPathStats stats;
+            for (const auto& builder : builders) {
+                builder->Flush();   // publishes the stats; no event is open between steps
+                stats.Add(builder->Stats());
+            }
+            return stats.event_pool;
+        };
+        NaluEventPoolStats pool_before = pool_stats();
+        uint64_t before = NaluAllocationCount();
+        uint64_t pushed_before = queue.Stats().pushed;
+        auto start = std::chrono::steady_clock::now();
+        feed(events, true);
+        uint64_t allocations = NaluAllocationCount() - before;
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        NaluEventPoolStats pool = pool_stats();
+
+        if (merged) {
+            merger.Stop();
+        }
+        filter.Flush();
+        consume(0);
+        uint64_t delivered = queue.Stats().pushed - pushed_before;
+
+        // Pool figures of the measured run only: the warm-up discards the
+        // empty events that merger ring slots hand back on their first use
+        NaluBenchmarkResult result;
+        result.name = std::string("allocations/steady_capture/") + (merged ? "merged" : "direct");
+        result.items_per_second = events * kBoards / seconds;
+        result.metrics = {{"events", static_cast<double>(events * kBoards)},
+                          {"delivered_events", static_cast<double>(delivered)},
+                          {"queue_dropped_events", static_cast<double>(queue.Stats().dropped)},
+                          {"allocations", static_cast<double>(allocations)},
+                          {"allocations_per_event", static_cast<double>(allocations) / (events * kBoards)},
+                          {"pool_allocated", static_cast<double>(pool.allocated - pool_before.allocated)},
+                          {"pool_discarded", static_cast<double>(pool.discarded - pool_before.discarded)}};
+        context.Report(std::move(result));
+    }
+}
+
+NALU_BENCHMARK(latency) {
+    context.Run("latency/clock_read", [&](uint64_t iterations) {
+        uint64_t now = 0;
+        for (uint64_t i = 0; i < iterations; ++i) {
+            now += NaluMonotonicNs();
+        }
+        NaluDoNotOptimize(now);
+    }, {1.0});
+
+    NaluLatencyTracker tracker(1);
+    context.Run("latency/record", [&](uint64_t iterations) {
+        uint64_t first_rx_ns = 1000000;
+        for (uint64_t i = 0; i < iterations; ++i) {
+            // Spread over many buckets, as real latencies are
+            uint64_t spread = (i * 2654435761u) & 0xfffff;
+            tracker.Record(0, first_rx_ns, first_rx_ns + spread, first_rx_ns + 2 * spread, first_rx_ns + 3 * spread);
+        }
+    }, {1.0});
+
+    NaluLatencyStats stats;
+    context.Run("latency/stats", [&](uint64_t iterations) {
+        for (uint64_t i = 0; i < iterations; ++i) {
+            stats = tracker.Stats();
+            NaluDoNotOptimize(stats.total.p99_ns);
+        }
+    }, {1.0});
+
+    // Building 8-channel events with and without the pipeline's sink-side
+    // instrumentation (two clock reads and Record() per event)
+    NaluBenchmarkStream stream(0, 8, 4);
+    NaluEventLayout layout;
+    layout.channel_mask = (uint64_t{1} << 8) - 1;
+    layout.windows = 4;
+    double build_ns[2] = {0.0, 0.0};
+    for (bool instrumented : {false, true}) {
+        uint64_t complete = 0;
+        NaluEventSink sink = [&](NaluEvent&& event) { complete += event.complete; };
+        if (instrumented) {
+            sink = [&tracker, next = sink](NaluEvent&& event) {
+                event.processed_ns = NaluMonotonicNs();
+                const uint64_t first_rx_ns = event.first_rx_ns;
+                const uint64_t built_ns = event.built_ns;
+                const uint64_t processed_ns = event.processed_ns;
+                next(std::move(event));
+                tracker.Record(0, first_rx_ns, built_ns, processed_ns, NaluMonotonicNs());
+            };
+        }
+        NaluEventBuilder builder(NaluEventBuilderParams{}, layout, nullptr, sink);
+        uint64_t rx_ns = NaluMonotonicNs();
+        std::string name = std::string("latency/build_8ch_4w/") + (instrumented ? "instrumented" : "plain");
+        context.Run(name, [&](uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; ++i) {
+                for (const auto& packet : stream.Next()) {
+                    builder.HandlePacket(packet.data(), packet.size(), rx_ns);
+                }
+                rx_ns += 1000;
+            }
+        }, {1.0});
+        build_ns[instrumented] = context.Results().back().ns_per_op;
+        builder.Flush();
+    }
+    NaluBenchmarkResult overhead;
+    overhead.name = "latency/overhead";
+    overhead.metrics = {{"plain_ns_per_event", build_ns[0]},
+                        {"instrumented_ns_per_event", build_ns[1]},
+                        {"overhead_fraction", build_ns[0] > 0 ? (build_ns[1] - build_ns[0]) / build_ns[0] : 0.0}};
+    context.Report(std::move(overhead));
+}
+
+NALU_BENCHMARK(waveform) {
+    // Events built from packets, with and without time-ordering them on a
+    // 64-window buffer; the assembler's share is the difference. "wrapped"
+    // readouts cross the end of the buffer, so every window moves.
+    constexpr int kBufferWindows = 64;
+    for (auto [channels, windows] : {std::pair<int, int>{8, 4}, {32, 8}}) {
+        for (bool wrapped : {false, true}) {
+            NaluBenchmarkStream stream(0, channels, windows);
+            stream.SetReadoutStart(kBufferWindows, wrapped ? kBufferWindows - windows / 2 : 0);
+            NaluEventLayout layout;
+            layout.channel_mask = (uint64_t{1} << channels) - 1;
+            layout.windows = windows;
+            layout.samples_per_window = 32;
+            layout.buffer_windows = kBufferWindows;
+
+            const std::string shape = std::to_string(channels) + "ch_" + std::to_string(windows) + "w/" +
+                                      (wrapped ? "wrapped" : "in_order");
+            const double bytes = static_cast<double>(channels) * windows * 32 * sizeof(uint16_t);
+            double ns_per_event[2] = {0.0, 0.0};
+            NaluWaveformStats stats;
+            for (bool assemble : {false, true}) {
+                NaluWaveformAssembler assembler(layout);
+                uint64_t samples = 0;
+                NaluEventBuilder builder(NaluEventBuilderParams{}, layout, nullptr, [&](NaluEvent&& event) {
+                    if (assemble) {
+                        assembler.Assemble(event);
+                    }
+                    samples += event.samples[samples % event.samples.size()];
+                });
+                uint64_t rx_ns = NaluMonotonicNs();
+                context.Run(std::string("waveform/") + (assemble ? "build_and_assemble/" : "build_only/") + shape,
+                            [&](uint64_t iterations) {
+                    for (uint64_t i = 0; i < iterations; ++i) {
+                        for (const auto& packet : stream.Next()) {
+                            builder.HandlePacket(packet.data(), packet.size(), rx_ns);
+                        }
+                        rx_ns += 1000;
+                    }
+                }, {1.0, bytes});
+                builder.Flush();
+                NaluDoNotOptimize(samples);
+                ns_per_event[assemble] = context.Results().back().ns_per_op;
+                stats = assembler.Stats();
+            }
+            double assemble_ns = std::max(ns_per_event[1] - ns_per_event[0], 0.0);
+            NaluBenchmarkResult result;
+            result.name = "waveform/assemble/" + shape;
+            result.ns_per_op = assemble_ns;
+            if (assemble_ns > 0.0) {
+                result.items_per_second = 1e9 / assemble_ns;
+                result.bytes_per_second = bytes * 1e9 / assemble_ns;
+            }
+            result.metrics = {{"reordered_fraction",
+                               stats.events > 0 ? static_cast<double>(stats.reordered_events) / stats.events : 0.0}};
+            context.Report(std::move(result));
+        }
+    }
+}
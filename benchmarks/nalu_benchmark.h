@@ -0,0 +1,86 @@
+#ifndef NALU_BENCHMARK_H
+#define NALU_BENCHMARK_H
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+// Minimal benchmark harness behind the nalu_benchmarks executable. Suites
+// register themselves with NALU_BENCHMARK and receive a NaluBenchmarkContext,
+// through which they either time a body (Run) or report numbers they measured
+// themselves (Report). Every result ends up in the JSON written by --json.
+
+struct NaluBenchmarkResult {
+    std::string name;
+    std::string skipped;                // reason, empty when the benchmark ran
+    uint64_t iterations = 0;            // per repetition
+    int repetitions = 0;
+    double ns_per_op = 0.0;             // median over the repetitions
+    double ns_per_op_min = 0.0;
+    double ns_per_op_max = 0.0;
+    double items_per_second = 0.0;      // 0 when not applicable
+    double bytes_per_second = 0.0;
+    std::map<std::string, double> metrics;   // anything else worth tracking
+};
+
+// Work done by one iteration of a timed body, for the throughput figures
+struct NaluBenchmarkWork {
+    double items = 0.0;
+    double bytes = 0.0;
+};
+
+class NaluBenchmarkContext {
+public:
+    NaluBenchmarkContext(double min_time_s, int repetitions, bool quick)
+        : min_time_s_(min_time_s), repetitions_(repetitions), quick_(quick) {}
+
+    // Time body(iterations): the count grows until one call takes min_time,
+    // then the call is repeated and the median time per iteration reported
+    void Run(const std::string& name, const std::function<void(uint64_t iterations)>& body,
+             NaluBenchmarkWork work = {}, std::map<std::string, double> metrics = {});
+
+    // Record a result measured by the benchmark itself
+    void Report(NaluBenchmarkResult result);
+    void Skip(const std::string& name, const std::string& reason);
+
+    // Duration for benchmarks that run for a fixed time (seconds)
+    double RunTime(double full_s) const { return quick_ ? full_s / 4 : full_s; }
+    bool Quick() const { return quick_; }
+
+    const std::vector<NaluBenchmarkResult>& Results() const { return results_; }
+
+private:
+    double min_time_s_;
+    int repetitions_;
+    bool quick_;
+    std::vector<NaluBenchmarkResult> results_;
+};
+
+using NaluBenchmarkFunction = void (*)(NaluBenchmarkContext& context);
+
+struct NaluBenchmarkRegistration {
+    NaluBenchmarkRegistration(const char* suite, NaluBenchmarkFunction function);
+};
+
+// Suites in registration order; each suite names its own results "suite/..."
+std::vector<std::pair<std::string, NaluBenchmarkFunction>>& NaluBenchmarkSuites();
+
+#define NALU_BENCHMARK(suite)                                                            \
+    static void NaluBenchmark_##suite(NaluBenchmarkContext& context);                    \
+    static NaluBenchmarkRegistration nalu_benchmark_registration_##suite(#suite,         \
+                                                                         NaluBenchmark_##suite); \
+    static void NaluBenchmark_##suite(NaluBenchmarkContext& context)
+
+// Heap allocations made so far by every thread (global operator new is
+// replaced in the benchmark executable)
+uint64_t NaluAllocationCount();
+
+// Keeps the compiler from optimizing away a value the benchmark computed
+template <typename T>
+inline void NaluDoNotOptimize(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+#endif // NALU_BENCHMARK_H
@@ -0,0 +1,134 @@
+#ifndef NALU_BENCHMARK_STREAM_H
+#define NALU_BENCHMARK_STREAM_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <vector>
+#include "nalu_event.h"
+#include "nalu_packet_format.h"
+
+// Deterministic board stream for the data-path benchmarks: packets of one
+// event are generated once as a template, and Next() patches the sequence
+// numbers and timestamp into them for every event, so feeding millions of
+// events costs no generation time. Waveforms are a flat baseline with noise
+// and a pulse on every pulse_every-th channel.
+class NaluBenchmarkStream {
+public:
+    NaluBenchmarkStream(int board_id, int channels, int windows, int samples_per_window = 32,
+                        size_t max_packet_bytes = 8192, int pulse_every = 4)
+        : board_id_(board_id), windows_(windows) {
+        std::mt19937 random(1234 + board_id);
+        std::normal_distribution<double> noise(0.0, 2.0);
+        const size_t block_bytes = kNaluWindowHeaderBytes + samples_per_window * sizeof(uint16_t);
+        block_bytes_ = block_bytes;
+        const size_t blocks_per_packet = std::max<size_t>(1, (max_packet_bytes - kNaluPacketHeaderBytes) / block_bytes);
+
+        std::vector<std::pair<int, int>> blocks;
+        for (int channel = 0; channel < channels; ++channel) {
+            for (int window = 0; window < windows; ++window) {
+                blocks.emplace_back(channel, window);
+            }
+        }
+        for (size_t first = 0; first < blocks.size(); first += blocks_per_packet) {
+            size_t count = std::min(blocks_per_packet, blocks.size() - first);
+            std::vector<uint8_t> packet(kNaluPacketHeaderBytes + count * block_bytes);
+            uint8_t* cursor = packet.data() + kNaluPacketHeaderBytes;
+            for (size_t i = first; i < first + count; ++i) {
+                auto [channel, window] = blocks[i];
+                cursor[0] = static_cast<uint8_t>(channel);
+                cursor[1] = static_cast<uint8_t>(window);
+                NaluStoreU16(cursor + 2, static_cast<uint16_t>(samples_per_window));
+                for (int sample = 0; sample < samples_per_window; ++sample) {
+                    double value = 1000.0 + noise(random);
+                    if (pulse_every > 0 && channel % pulse_every == 0 && window == 0 && sample >= 8) {
+                        value += 400.0 * std::exp(-(sample - 8) / 6.0);
+                    }
+                    NaluStoreU16(cursor + kNaluWindowHeaderBytes + sample * 2, static_cast<uint16_t>(value));
+                }
+                cursor += block_bytes;
+            }
+            packets_.push_back(std::move(packet));
+        }
+        for (size_t i = 0; i < packets_.size(); ++i) {
+            NaluPacketHeader header;
+            header.board_id = static_cast<uint8_t>(board_id);
+            header.flags = (i == 0 ? kNaluPacketFirst : 0) | (i + 1 == packets_.size() ? kNaluPacketLast : 0);
+            header.block_count = static_cast<uint16_t>(
+                std::min(blocks_per_packet, blocks.size() - i * blocks_per_packet));
+            header.packet_index = static_cast<uint16_t>(i);
+            NaluWritePacketHeader(packets_[i].data(), header);
+            bytes_per_event_ += packets_[i].size();
+        }
+    }
+
+    // Packets of the next event, ticks board clock ticks after the previous one
+    const std::vector<std::vector<uint8_t>>& Next(uint64_t ticks = 1000) {
+        timestamp_ += ticks;
+        for (auto& packet : packets_) {
+            NaluStoreU32(packet.data() + 4, packet_seq_++);
+            NaluStoreU32(packet.data() + 8, event_number_);
+            NaluStoreU64(packet.data() + 16, timestamp_);
+        }
+        event_number_++;
+        return packets_;
+    }
+
+    // Number the windows as a readout of a circular buffer of buffer_windows
+    // starting at first_window, sent in buffer order as the board does: a
+    // readout crossing the end of the buffer sends its newest windows first
+    void SetReadoutStart(int buffer_windows, int first_window) {
+        const int wrapped = std::max(0, first_window + windows_ - buffer_windows);
+        int block = 0;
+        for (auto& packet : packets_) {
+            uint8_t* cursor = packet.data() + kNaluPacketHeaderBytes;
+            for (uint16_t i = 0; i < NaluLoadU16(packet.data() + 12); ++i, ++block, cursor += block_bytes_) {
+                int position = block % windows_;
+                int window = (position + windows_ - wrapped) % windows_;   // in time
+                cursor[1] = static_cast<uint8_t>((first_window + window) % buffer_windows);
+            }
+        }
+    }
+
+    size_t PacketsPerEvent() const { return packets_.size(); }
+    size_t BytesPerEvent() const { return bytes_per_event_; }
+    int BoardId() const { return board_id_; }
+
+    // A built event with the stream's waveforms, for the stages after the builder
+    NaluEvent Event() const {
+        NaluEvent event;
+        event.board_id = board_id_;
+        event.complete = true;
+        event.packets_expected = event.packets_received = static_cast<uint16_t>(packets_.size());
+        for (const auto& packet : packets_) {
+            NaluWindowBlockReader reader(packet.data(), packet.size());
+            NaluWindowBlock block;
+            while (reader.Next(block)) {
+                NaluEventWindow window;
+                window.channel = block.channel;
+                window.window = block.window;
+                window.sample_count = block.sample_count;
+                window.offset = static_cast<uint32_t>(event.samples.size());
+                for (int sample = 0; sample < block.sample_count; ++sample) {
+                    event.samples.push_back(NaluLoadU16(block.samples + sample * 2));
+                }
+                event.windows.push_back(window);
+                event.channel_mask |= uint64_t{1} << block.channel;
+            }
+        }
+        return event;
+    }
+
+private:
+    int board_id_;
+    int windows_;
+    size_t block_bytes_ = 0;
+    std::vector<std::vector<uint8_t>> packets_;
+    size_t bytes_per_event_ = 0;
+    uint32_t packet_seq_ = 0;
+    uint32_t event_number_ = 0;
+    uint64_t timestamp_ = 0;
+};
+
+#endif // NALU_BENCHMARK_STREAM_H
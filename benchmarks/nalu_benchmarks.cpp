@@ -0,0 +1,318 @@
+// Benchmarks of the control and data paths. Results are printed as a table
+// and, with --json, written as JSON for comparing builds:
+//
+//   nalu_benchmarks --json before.json
+//   nalu_benchmarks --filter 'ring|merge' --repetitions 9
+//
+// Every benchmark uses fixed seeds and inputs, so two runs on the same
+// machine differ only by measurement noise.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <regex>
+#include <sstream>
+#include <thread>
+#include <unistd.h>
+#include "nalu_benchmark.h"
+#include "nalu_board_controller_logger.h"
+#include "nalu_cpu_placement.h"
+
+#ifndef NALU_BENCHMARK_REVISION
+#define NALU_BENCHMARK_REVISION "unknown"
+#endif
+
+std::vector<std::pair<std::string, NaluBenchmarkFunction>>& NaluBenchmarkSuites() {
+    static std::vector<std::pair<std::string, NaluBenchmarkFunction>> suites;
+    return suites;
+}
+
+NaluBenchmarkRegistration::NaluBenchmarkRegistration(const char* suite, NaluBenchmarkFunction function) {
+    NaluBenchmarkSuites().emplace_back(suite, function);
+}
+
+void NaluBenchmarkContext::Run(const std::string& name, const std::function<void(uint64_t)>& body,
+                               NaluBenchmarkWork work, std::map<std::string, double> metrics) {
+    using Clock = std::chrono::steady_clock;
+    auto time = [&](uint64_t iterations) {
+        auto start = Clock::now();
+        body(iterations);
+        return std::chrono::duration<double>(Clock::now() - start).count();
+    };
+
+    // Calibrate: grow the count until one call takes at least min_time
+    uint64_t iterations = 1;
+    double elapsed = time(iterations);
+    while (elapsed < min_time_s_ && iterations < (uint64_t{1} << 40)) {
+        double scale = elapsed > 0.0 ? std::min(10.0, 1.4 * min_time_s_ / elapsed) : 10.0;
+        iterations = std::max(iterations + 1, static_cast<uint64_t>(iterations * scale));
+        elapsed = time(iterations);
+    }
+
+    std::vector<double> ns_per_op;
+    for (int i = 0; i < repetitions_; ++i) {
+        ns_per_op.push_back(time(iterations) * 1e9 / iterations);
+    }
+    std::sort(ns_per_op.begin(), ns_per_op.end());
+
+    NaluBenchmarkResult result;
+    result.name = name;
+    result.iterations = iterations;
+    result.repetitions = repetitions_;
+    result.ns_per_op = ns_per_op[ns_per_op.size() / 2];
+    result.ns_per_op_min = ns_per_op.front();
+    result.ns_per_op_max = ns_per_op.back();
+    if (work.items > 0.0) {
+        result.items_per_second = work.items * 1e9 / result.ns_per_op;
+    }
+    if (work.bytes > 0.0) {
+        result.bytes_per_second = work.bytes * 1e9 / result.ns_per_op;
+    }
+    result.metrics = std::move(metrics);
+    Report(std::move(result));
+}
+
+void NaluBenchmarkContext::Report(NaluBenchmarkResult result) {
+    std::ostringstream line;
+    line << std::left << std::setw(52) << result.name << std::right;
+    if (result.ns_per_op > 0.0) {
+        line << std::setw(14) << std::fixed << std::setprecision(1) << result.ns_per_op << " ns/op";
+    } else {
+        line << std::setw(20) << "";
+    }
+    if (result.items_per_second > 0.0) {
+        line << std::setw(12) << std::setprecision(3) << result.items_per_second / 1e6 << " M/s";
+    }
+    if (result.bytes_per_second > 0.0) {
+        line << std::setw(10) << std::setprecision(1) << result.bytes_per_second / 1e6 << " MB/s";
+    }
+    for (const auto& [key, value] : result.metrics) {
+        line << "  " << key << "=" << std::defaultfloat << std::setprecision(6) << value;
+    }
+    std::cout << line.str() << std::endl;
+    results_.push_back(std::move(result));
+}
+
+void NaluBenchmarkContext::Skip(const std::string& name, const std::string& reason) {
+    std::cout << std::left << std::setw(52) << name << "skipped: " << reason << std::endl;
+    NaluBenchmarkResult result;
+    result.name = name;
+    result.skipped = reason;
+    results_.push_back(std::move(result));
+}
+
+namespace {
+
+void Usage() {
+    std::cerr << "usage: nalu_benchmarks [options]\n"
+                 "  --filter regex      run the suites whose name matches\n"
+                 "  --list              list the suites\n"
+                 "  --json file         write the results as JSON\n"
+                 "  --min-time s        shortest timed call (0.2)\n"
+                 "  --repetitions n     timed calls per benchmark, median reported (5)\n"
+                 "  --quick             shorter runs, for smoke testing\n"
+                 "  --cpu n             pin the benchmark thread\n";
+}
+
+std::string JsonString(const std::string& text) {
+    std::string out = "\"";
+    for (char c : text) {
+        switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    char escaped[8];
+                    std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                    out += escaped;
+                } else {
+                    out += c;
+                }
+        }
+    }
+    return out + "\"";
+}
+
+std::string JsonNumber(double value) {
+    if (!std::isfinite(value)) {
+        return "null";
+    }
+    std::ostringstream out;
+    out << std::setprecision(10) << value;
+    return out.str();
+}
+
+std::string CpuModel() {
+    std::ifstream cpuinfo("/proc/cpuinfo");
+    std::string line;
+    while (std::getline(cpuinfo, line)) {
+        if (line.rfind("model name", 0) == 0) {
+            size_t colon = line.find(':');
+            if (colon != std::string::npos) {
+                return line.substr(line.find_first_not_of(' ', colon + 1));
+            }
+        }
+    }
+    return "";
+}
+
+std::string UtcNow() {
+    std::time_t now = std::time(nullptr);
+    std::tm utc{};
+    gmtime_r(&now, &utc);
+    char text[32];
+    std::strftime(text, sizeof(text), "%Y-%m-%dT%H:%M:%SZ", &utc);
+    return text;
+}
+
+void WriteJson(std::ostream& out, const std::vector<NaluBenchmarkResult>& results, double min_time_s,
+               int repetitions, bool quick) {
+    char host[256] = {};
+    gethostname(host, sizeof(host) - 1);
+#ifdef __OPTIMIZE__
+    const bool optimized = true;
+#else
+    const bool optimized = false;
+#endif
+
+    out << "{\n  \"context\": {\n"
+        << "    \"revision\": " << JsonString(NALU_BENCHMARK_REVISION) << ",\n"
+        << "    \"date\": " << JsonString(UtcNow()) << ",\n"
+        << "    \"host\": " << JsonString(host) << ",\n"
+        << "    \"cpu_model\": " << JsonString(CpuModel()) << ",\n"
+        << "    \"cpus\": " << std::thread::hardware_concurrency() << ",\n"
+        << "    \"compiler\": " << JsonString(__VERSION__) << ",\n"
+        << "    \"optimized\": " << (optimized ? "true" : "false") << ",\n"
+        << "    \"min_time_s\": " << JsonNumber(min_time_s) << ",\n"
+        << "    \"repetitions\": " << repetitions << ",\n"
+        << "    \"quick\": " << (quick ? "true" : "false") << "\n"
+        << "  },\n  \"benchmarks\": [";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const NaluBenchmarkResult& result = results[i];
+        out << (i > 0 ? "," : "") << "\n    {\"name\": " << JsonString(result.name);
+        if (!result.skipped.empty()) {
+            out << ", \"skipped\": " << JsonString(result.skipped) << "}";
+            continue;
+        }
+        if (result.iterations > 0) {
+            out << ", \"iterations\": " << result.iterations << ", \"repetitions\": " << result.repetitions
+                << ", \"ns_per_op\": " << JsonNumber(result.ns_per_op)
+                << ", \"ns_per_op_min\": " << JsonNumber(result.ns_per_op_min)
+                << ", \"ns_per_op_max\": " << JsonNumber(result.ns_per_op_max);
+        }
+        if (result.items_per_second > 0.0) {
+            out << ", \"items_per_second\": " << JsonNumber(result.items_per_second);
+        }
+        if (result.bytes_per_second > 0.0) {
+            out << ", \"bytes_per_second\": " << JsonNumber(result.bytes_per_second);
+        }
+        out << ", \"metrics\": {";
+        bool first = true;
+        for (const auto& [key, value] : result.metrics) {
+            out << (first ? "" : ", ") << JsonString(key) << ": " << JsonNumber(value);
+            first = false;
+        }
+        out << "}}";
+    }
+    out << "\n  ]\n}\n";
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    std::string filter = ".*";
+    std::string json_path;
+    double min_time_s = 0.2;
+    int repetitions = 5;
+    bool quick = false;
+    bool list = false;
+    int cpu = -1;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto value = [&]() -> std::string {
+            if (i + 1 >= argc) {
+                throw std::invalid_argument(arg + " needs a value");
+            }
+            return argv[++i];
+        };
+        try {
+            if (arg == "--filter") filter = value();
+            else if (arg == "--json") json_path = value();
+            else if (arg == "--min-time") min_time_s = std::stod(value());
+            else if (arg == "--repetitions") repetitions = std::max(1, std::stoi(value()));
+            else if (arg == "--quick") quick = true;
+            else if (arg == "--list") list = true;
+            else if (arg == "--cpu") cpu = std::stoi(value());
+            else {
+                Usage();
+                return 2;
+            }
+        } catch (const std::exception& e) {
+            std::cerr << arg << ": " << e.what() << "\n";
+            return 2;
+        }
+    }
+    if (quick) {
+        min_time_s = std::min(min_time_s, 0.05);
+        repetitions = std::min(repetitions, 3);
+    }
+
+    std::regex pattern;
+    try {
+        pattern = std::regex(filter);
+    } catch (const std::regex_error& e) {
+        std::cerr << "--filter: " << e.what() << "\n";
+        return 2;
+    }
+
+    if (list) {
+        for (const auto& [suite, function] : NaluBenchmarkSuites()) {
+            std::cout << suite << "\n";
+        }
+        return 0;
+    }
+
+    if (cpu >= 0) {
+        try {
+            NaluCpuPlacement::PinCurrentThread(cpu);
+        } catch (const std::exception& e) {
+            std::cerr << "--cpu: " << e.what() << "\n";
+            return 2;
+        }
+    }
+    // Benchmarks start and stop receivers and the like; keep their chatter out
+    NaluBoardControllerLogger::set_level(NaluBoardControllerLogger::LogLevel::WARNING);
+#ifndef __OPTIMIZE__
+    std::cerr << "warning: nalu_benchmarks was built without optimization (use CMAKE_BUILD_TYPE=Release)\n";
+#endif
+
+    NaluBenchmarkContext context(min_time_s, repetitions, quick);
+    for (const auto& [suite, function] : NaluBenchmarkSuites()) {
+        if (!std::regex_search(suite, pattern)) {
+            continue;
+        }
+        try {
+            function(context);
+        } catch (const std::exception& e) {
+            context.Skip(suite, std::string("failed: ") + e.what());
+        }
+    }
+
+    if (!json_path.empty()) {
+        std::ofstream out(json_path);
+        if (!out) {
+            std::cerr << "Cannot write " << json_path << "\n";
+            return 1;
+        }
+        WriteJson(out, context.Results(), min_time_s, repetitions, quick);
+    }
+    return 0;
+}
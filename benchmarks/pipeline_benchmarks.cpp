@@ -0,0 +1,480 @@
+// Macrobenchmarks of the threaded pipeline: receivers fed by simulated boards
+// on loopback, the merger, the filter, the monitoring tap, and a whole
+// simulated capture that is recorded and replayed
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <thread>
+#include <unistd.h>
+#include "nalu_benchmark.h"
+#include "nalu_benchmark_stream.h"
+#include "nalu_board_controller_logger.h"
+#include "nalu_board_simulator.h"
+#include "nalu_capture_recorder.h"
+#include "nalu_event_builder.h"
+#include "nalu_event_filter.h"
+#include "nalu_event_merger.h"
+#include "nalu_monitor.h"
+#include "nalu_receiver.h"
+#include "nalu_replay_receiver.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr int kChannels = 8;
+constexpr int kWindows = 4;
+
+double Seconds(Clock::time_point since) {
+    return std::chrono::duration<double>(Clock::now() - since).count();
+}
+
+// One builder per receive queue, each counting what it delivers on its own
+// receive thread; `next` optionally continues the chain per queue
+class BuildingSink {
+public:
+    BuildingSink(int queues, std::function<NaluEventSink(int queue)> next = nullptr)
+        : events_(queues), complete_(queues) {
+        NaluEventLayout layout;
+        layout.channel_mask = (uint64_t{1} << kChannels) - 1;
+        layout.windows = kWindows;
+        for (int queue = 0; queue < queues; ++queue) {
+            NaluEventSink sink = next ? next(queue) : nullptr;
+            builders_.push_back(std::make_unique<NaluEventBuilder>(
+                NaluEventBuilderParams{}, layout, &counters_,
+                [this, queue, sink](NaluEvent&& event) {
+                    events_[queue]++;
+                    complete_[queue] += event.complete;
+                    if (sink) {
+                        sink(std::move(event));
+                    }
+                }));
+        }
+    }
+
+    NaluPacketSink PacketSink(NaluCaptureRecorder* recorder = nullptr) {
+        return [this, recorder](int queue, const uint8_t* data, size_t size, uint64_t rx_ns) {
+            if (recorder && size > 0) {
+                recorder->Record(queue, data, size, rx_ns);
+            }
+            builders_[queue]->HandlePacket(data, size, rx_ns);
+        };
+    }
+
+    void Flush() {
+        for (auto& builder : builders_) {
+            builder->Flush();
+        }
+    }
+
+    uint64_t Events() const { return Sum(events_); }
+    uint64_t CompleteEvents() const { return Sum(complete_); }
+    uint64_t LostPackets() const {
+        NaluDataPathStats stats;
+        for (const auto& builder : builders_) {
+            stats.Add(builder->Stats());
+        }
+        uint64_t lost = 0;
+        for (const auto& [board_id, board] : stats.boards) {
+            lost += board.lost_packets;
+        }
+        return lost;
+    }
+
+private:
+    static uint64_t Sum(const std::vector<uint64_t>& values) {
+        uint64_t sum = 0;
+        for (uint64_t value : values) {
+            sum += value;
+        }
+        return sum;
+    }
+
+    NaluCaptureCounters counters_;
+    std::vector<uint64_t> events_;       // one writer per entry, read after the threads stop
+    std::vector<uint64_t> complete_;
+    std::vector<std::unique_ptr<NaluEventBuilder>> builders_;
+};
+
+struct StreamTotals {
+    double seconds = 0.0;
+    uint64_t sent_packets = 0;
+    uint64_t received_packets = 0;
+    uint64_t busiest_queue_packets = 0;
+};
+
+// Stream from `boards` simulated boards for `seconds`, as fast as they go
+// unless rate_hz is given, into a started receiver
+StreamTotals StreamBoards(NaluReceiver& receiver, const std::string& target, int boards, double seconds,
+                          double rate_hz = 1e7) {
+    std::vector<std::unique_ptr<NaluBoardSimulator>> simulators;
+    for (int board = 0; board < boards; ++board) {
+        NaluSimulatorParams params;
+        params.board_id = board;
+        params.target_ip_port = target;
+        params.trigger_rate_hz = rate_hz;
+        params.poisson = rate_hz < 1e7;
+        params.seed = static_cast<uint32_t>(board + 1);
+        simulators.push_back(std::make_unique<NaluBoardSimulator>(params));
+        std::vector<int> channels(kChannels);
+        for (int channel = 0; channel < kChannels; ++channel) {
+            channels[channel] = channel;
+        }
+        simulators.back()->WriteReadoutChannels(channels);
+        simulators.back()->WriteReadWindow(kWindows, kWindows, 1);
+        simulators.back()->InitializeBoard();
+    }
+
+    auto start = Clock::now();
+    for (auto& simulator : simulators) {
+        simulator->StartCapture();
+    }
+    std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+    for (auto& simulator : simulators) {
+        simulator->StopCapture();
+    }
+    StreamTotals totals;
+    totals.seconds = Seconds(start);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));  // let the receiver drain
+    for (auto& simulator : simulators) {
+        NaluSimulatorStats stats = simulator->Stats();
+        totals.sent_packets += stats.packets - stats.send_errors;
+    }
+    for (const auto& queue : receiver.Stats()) {
+        totals.received_packets += queue.packets;
+        totals.busiest_queue_packets = std::max(totals.busiest_queue_packets, queue.packets);
+    }
+    return totals;
+}
+
+void ReportStream(NaluBenchmarkContext& context, const std::string& name, const StreamTotals& totals,
+                  const BuildingSink& sink) {
+    NaluBenchmarkResult result;
+    result.name = name;
+    result.items_per_second = totals.received_packets / totals.seconds;
+    result.metrics = {
+        {"events_per_second", sink.Events() / totals.seconds},
+        {"complete_fraction", sink.Events() > 0 ? static_cast<double>(sink.CompleteEvents()) / sink.Events() : 0.0},
+        {"sent_packets", static_cast<double>(totals.sent_packets)},
+        {"sent_packets_per_second", totals.sent_packets / totals.seconds},
+        {"received_packets", static_cast<double>(totals.received_packets)},
+        {"lost_packets", static_cast<double>(sink.LostPackets())},
+        {"loss_fraction", totals.sent_packets > 0
+                              ? 1.0 - static_cast<double>(totals.received_packets) / totals.sent_packets
+                              : 0.0},
+        {"busiest_queue_share", totals.received_packets > 0
+                                    ? static_cast<double>(totals.busiest_queue_packets) / totals.received_packets
+                                    : 0.0},
+    };
+    context.Report(std::move(result));
+}
+
+void RunReceiver(NaluBenchmarkContext& context, const std::string& name, const std::string& mode, int queues,
+                 int boards, int port) {
+    std::string target = "127.0.0.1:" + std::to_string(port);
+    NaluReceiverParams params;
+    params.mode = mode;
+    params.queues = queues;
+    params.socket_buffer_bytes = 16 << 20;
+
+    std::unique_ptr<NaluReceiver> receiver;
+    BuildingSink sink(queues);
+    try {
+        receiver = NaluReceiver::Create(params, target, nullptr);
+        receiver->Start(sink.PacketSink());
+    } catch (const std::exception& e) {
+        context.Skip(name, e.what());
+        return;
+    }
+    StreamTotals totals = StreamBoards(*receiver, target, boards, context.RunTime(2.0));
+    receiver->Stop();
+    sink.Flush();
+    ReportStream(context, name, totals, sink);
+}
+
+}  // namespace
+
+NALU_BENCHMARK(receiver) {
+    // Queue scaling: SO_REUSEPORT spreads boards over the queues by address
+    // hash, so there are more boards than queues. Each simulated board sends
+    // from a thread of its own on this host, so the receive queues only scale
+    // with CPUs to spare for the senders; with fewer, senders and queues share
+    // the CPUs and the result follows sent_packets_per_second.
+    unsigned cpus = std::thread::hardware_concurrency();
+    int port = 24100;
+    for (int queues : {1, 2, 4}) {
+        int boards = std::max(queues * 2, 2);
+        std::string name = "receiver/socket/queues_" + std::to_string(queues) + "_boards_" + std::to_string(boards);
+        if (cpus < static_cast<unsigned>(queues + boards)) {
+            NaluBoardControllerLogger::warning(name + ": " + std::to_string(cpus) + " CPUs for " +
+                                               std::to_string(boards) + " senders and " + std::to_string(queues) +
+                                               " queues, the result is sender-bound");
+        }
+        RunReceiver(context, name, "socket", queues, boards, port++);
+    }
+    // Same load through both receivers, back to back
+    for (std::string mode : {"socket", "packet_mmap"}) {
+        RunReceiver(context, "receiver/compare/" + mode + "/queues_2_boards_4", mode, 2, 4, port++);
+    }
+}
+
+NALU_BENCHMARK(merge) {
+    const uint64_t events_per_board = context.Quick() ? 50000 : 250000;
+    for (int boards : {2, 4, 8, 16}) {
+        NaluMergeParams params;
+        params.enabled = true;
+        uint64_t out = 0;
+        NaluEventMerger merger(params, [&](NaluEvent&&) { out++; });
+
+        // One producer per board, like one receive queue per board, all let
+        // go at once so no board shows up after the merger's warm-up. Events
+        // carry no samples: the merge itself is what is timed.
+        std::vector<std::thread> producers;
+        std::atomic<uint64_t> retries{0};
+        std::atomic<int> ready{0};
+        std::atomic<bool> go{false};
+        for (int board = 0; board < boards; ++board) {
+            producers.emplace_back([&, board] {
+                ready.fetch_add(1);
+                while (!go.load()) {
+                    std::this_thread::yield();
+                }
+                uint64_t full = 0;
+                for (uint64_t i = 0; i < events_per_board; ++i) {
+                    NaluEvent event;
+                    event.board_id = board;
+                    event.timestamp = i * 1000 + board * 7;
+                    while (!merger.Push(std::move(event))) {
+                        full++;
+                        std::this_thread::yield();
+                    }
+                }
+                retries.fetch_add(full);
+            });
+        }
+        while (ready.load() < boards) {
+            std::this_thread::yield();
+        }
+        auto start = Clock::now();
+        merger.Start();
+        go.store(true);
+        for (auto& producer : producers) {
+            producer.join();
+        }
+        merger.Stop();
+        // Nothing is released during the warm-up, which is not merge work
+        double seconds = Seconds(start) - params.max_latency_ms / 1000.0;
+
+        NaluMergeStats stats = merger.Stats();
+        NaluBenchmarkResult result;
+        result.name = "merge/boards_" + std::to_string(boards);
+        result.items_per_second = out / seconds;
+        result.metrics = {{"events", static_cast<double>(out)},
+                          {"late_events", static_cast<double>(stats.late_events)},
+                          {"watermark_releases", static_cast<double>(stats.watermark_releases)},
+                          {"max_queue_depth", static_cast<double>(stats.max_queue_depth)},
+                          {"full_queue_retries", static_cast<double>(retries.load())}};
+        context.Report(std::move(result));
+    }
+}
+
+NALU_BENCHMARK(filter) {
+    NaluEvent event = NaluBenchmarkStream(0, kChannels, kWindows).Event();
+    const double bytes = static_cast<double>(event.samples.size() * sizeof(uint16_t));
+
+    // Every event is copied in; this is what the copy alone costs
+    context.Run("filter/event_copy_baseline", [&](uint64_t iterations) {
+        for (uint64_t i = 0; i < iterations; ++i) {
+            NaluEvent copy = event;
+            NaluDoNotOptimize(copy.samples.data());
+        }
+    }, {1.0, bytes});
+
+    NaluFilterParams params;
+    params.enabled = true;
+    params.rules = {NaluFilterRule{"mult2", {}, 2}};
+    uint64_t accepted = 0;
+    NaluEventFilter multiplicity(params, {}, [&](NaluEvent&&) { accepted++; });
+    context.Run("filter/multiplicity", [&](uint64_t iterations) {
+        for (uint64_t i = 0; i < iterations; ++i) {
+            NaluEvent copy = event;
+            multiplicity.HandleEvent(std::move(copy));
+        }
+    }, {1.0, bytes});
+
+    // Two boards alternating, every pair within the coincidence window
+    params.rules = {NaluFilterRule{"pair", {}, 1, 2, 40}};
+    NaluEventFilter coincidence(params, {}, [&](NaluEvent&&) { accepted++; });
+    uint64_t timestamp = 0;
+    context.Run("filter/two_board_coincidence", [&](uint64_t iterations) {
+        for (uint64_t i = 0; i < iterations; ++i) {
+            NaluEvent copy = event;
+            copy.board_id = static_cast<int>(i & 1);
+            timestamp += (i & 1) ? 10 : 1000;
+            copy.timestamp = timestamp;
+            coincidence.HandleEvent(std::move(copy));
+        }
+    }, {1.0, bytes});
+    coincidence.Flush();
+    NaluDoNotOptimize(accepted);
+}
+
+NALU_BENCHMARK(monitor) {
+    // The tap must not slow the path it watches: build events with and
+    // without it, and with a second thread taking snapshots at 100 Hz, far
+    // more often than any display polls
+    NaluMonitorParams params;
+    params.enabled = true;
+
+    for (std::string variant : {"without_tap", "with_tap", "with_tap_and_snapshots_100hz", "with_tap_every_event"}) {
+        NaluBenchmarkStream stream(0, kChannels, kWindows);
+        std::unique_ptr<NaluMonitor> monitor;
+        if (variant != "without_tap") {
+            NaluMonitorParams tap = params;
+            if (variant == "with_tap_every_event") {
+                tap.prescale = 1;
+                tap.max_events_per_second = 0;
+            }
+            monitor = std::make_unique<NaluMonitor>(tap, 1);
+        }
+        BuildingSink sink(1, [&](int queue) -> NaluEventSink {
+            if (!monitor) {
+                return nullptr;
+            }
+            return [&monitor, queue](NaluEvent&& event) { monitor->Observe(queue, event); };
+        });
+        NaluPacketSink packets = sink.PacketSink();
+
+        std::atomic<bool> reading{variant == "with_tap_and_snapshots_100hz"};
+        std::thread reader([&] {
+            while (reading.load()) {
+                NaluDoNotOptimize(monitor->Snapshot().events_seen);
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            }
+        });
+        uint64_t rx_ns = NaluMonotonicNs();
+        context.Run("monitor/build_" + variant, [&](uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; ++i) {
+                for (const auto& packet : stream.Next()) {
+                    packets(0, packet.data(), packet.size(), rx_ns);
+                }
+                rx_ns += 1000;
+            }
+        }, {1.0, static_cast<double>(stream.BytesPerEvent())});
+        reading.store(false);
+        reader.join();
+        sink.Flush();
+    }
+}
+
+NALU_BENCHMARK(end_to_end) {
+    char path[] = "/tmp/nalu_benchmark_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        context.Skip("end_to_end/simulated_capture", "cannot create a temporary file");
+        return;
+    }
+    close(fd);
+
+    // simulator -> socket receiver -> builder -> monitor -> filter, recorded
+    NaluFilterParams filter_params;
+    filter_params.enabled = true;
+    filter_params.rules = {NaluFilterRule{"mult2", {}, 2}};
+    NaluMonitorParams monitor_params;
+    monitor_params.enabled = true;
+    auto chain = [&](NaluMonitor& monitor, std::vector<std::unique_ptr<NaluEventFilter>>& filters,
+                     uint64_t& accepted) {
+        return [&](int queue) -> NaluEventSink {
+            filters.push_back(std::make_unique<NaluEventFilter>(filter_params, std::map<int, long long>{},
+                                                                [&accepted](NaluEvent&&) { accepted++; }));
+            return [&monitor, queue, filter = filters.back().get()](NaluEvent&& event) {
+                monitor.Observe(queue, event);
+                filter->HandleEvent(std::move(event));
+            };
+        };
+    };
+
+    const std::string target = "127.0.0.1:24200";
+    const double rate_hz = 20000;
+    NaluReceiverParams params;
+    params.mode = "socket";
+    params.socket_buffer_bytes = 16 << 20;
+    {
+        NaluMonitor monitor(monitor_params, 1);
+        std::vector<std::unique_ptr<NaluEventFilter>> filters;
+        uint64_t accepted = 0;
+        BuildingSink sink(1, chain(monitor, filters, accepted));
+        NaluRecordParams record;
+        record.path = path;
+        std::unique_ptr<NaluReceiver> receiver;
+        std::unique_ptr<NaluCaptureRecorder> recorder;
+        try {
+            receiver = NaluReceiver::Create(params, target, nullptr);
+            recorder = std::make_unique<NaluCaptureRecorder>(record, receiver->QueueCount());
+            recorder->Start();
+            receiver->Start(sink.PacketSink(recorder.get()));
+        } catch (const std::exception& e) {
+            context.Skip("end_to_end/simulated_capture", e.what());
+            std::remove(path);
+            return;
+        }
+        StreamTotals totals = StreamBoards(*receiver, target, 1, context.RunTime(2.0), rate_hz);
+        receiver->Stop();
+        recorder->Stop();
+        sink.Flush();
+        for (auto& filter : filters) {
+            filter->Flush();
+        }
+        ReportStream(context, "end_to_end/simulated_capture", totals, sink);
+        NaluRecorderStats recorded = recorder->Stats();
+        NaluBenchmarkResult stages;
+        stages.name = "end_to_end/simulated_capture_stages";
+        stages.metrics = {{"accepted_events", static_cast<double>(accepted)},
+                          {"monitored_events", static_cast<double>(monitor.Snapshot().events_sampled)},
+                          {"recorded_packets", static_cast<double>(recorded.packets)},
+                          {"recording_dropped_packets", static_cast<double>(recorded.dropped_packets)}};
+        context.Report(std::move(stages));
+    }
+
+    // The recording again, as fast as the same chain takes it
+    {
+        NaluMonitor monitor(monitor_params, 1);
+        std::vector<std::unique_ptr<NaluEventFilter>> filters;
+        uint64_t accepted = 0;
+        BuildingSink sink(1, chain(monitor, filters, accepted));
+        NaluReceiverParams replay;
+        replay.mode = "replay";
+        replay.replay_file = path;
+        replay.replay_speed = 0.0;
+        replay.replay_loops = context.Quick() ? 1 : 5;
+        try {
+            NaluReplayReceiver receiver(replay, nullptr);
+            auto start = Clock::now();
+            receiver.Start(sink.PacketSink());
+            while (!receiver.Finished()) {
+                std::this_thread::sleep_for(std::chrono::microseconds(200));
+            }
+            double seconds = Seconds(start);
+            receiver.Stop();
+            uint64_t packets = 0;
+            for (const auto& queue : receiver.Stats()) {
+                packets += queue.packets;
+            }
+            sink.Flush();
+            NaluBenchmarkResult result;
+            result.name = "end_to_end/replay_as_fast_as_possible";
+            result.items_per_second = packets / seconds;
+            result.metrics = {{"events_per_second", sink.Events() / seconds},
+                              {"packets", static_cast<double>(packets)},
+                              {"accepted_events", static_cast<double>(accepted)}};
+            context.Report(std::move(result));
+        } catch (const std::exception& e) {
+            context.Skip("end_to_end/replay_as_fast_as_possible", e.what());
+        }
+    }
+    std::remove(path);
+}
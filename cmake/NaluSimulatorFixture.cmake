@@ -0,0 +1,20 @@
+# CTest fixture running nalu_board_simulator in the background.
+#
+#   nalu_add_simulator_fixture(<name> [ARGS <simulator options>...])
+#
+# adds the tests <name>_setup and <name>_cleanup as the setup and cleanup of
+# fixture <name>. A test declaring FIXTURES_REQUIRED <name> runs with the
+# simulator listening on its --control address (127.0.0.1:4660 unless given
+# in ARGS), and can stream from it with --start or the "start" command.
+function(nalu_add_simulator_fixture name)
+    cmake_parse_arguments(FIXTURE "" "" "ARGS" ${ARGN})
+    set(pid_file ${CMAKE_CURRENT_BINARY_DIR}/${name}.simulator.pid)
+
+    add_test(NAME ${name}_setup
+             COMMAND nalu_board_simulator --daemon --pid-file ${pid_file} ${FIXTURE_ARGS})
+    set_tests_properties(${name}_setup PROPERTIES FIXTURES_SETUP ${name})
+
+    add_test(NAME ${name}_cleanup
+             COMMAND nalu_board_simulator --stop --pid-file ${pid_file})
+    set_tests_properties(${name}_cleanup PROPERTIES FIXTURES_CLEANUP ${name})
+endfunction()
@@ -0,0 +1,67 @@
+#ifndef NALU_BASELINE_EQUALIZER_H
+#define NALU_BASELINE_EQUALIZER_H
+
+#include <chrono>
+#include <map>
+#include <vector>
+#include "nalu_board_configurator.h"
+#include "nalu_board_controller_params.h"
+#include "nalu_board_state.h"
+
+// Measures the baseline (mean ADC counts) of the given channels from a short
+// capture with the DACs as currently written. Implemented on top of the data
+// path for real boards, or by a simulated channel response.
+class NaluBaselineSource {
+public:
+    virtual ~NaluBaselineSource() = default;
+    virtual std::map<int, double> MeasureBaselines(const std::vector<int>& channels) = 0;
+};
+
+struct NaluChannelEqualization {
+    int channel = 0;
+    int dac_value = 0;
+    double baseline = 0.0;
+    int iterations = 0;
+    bool converged = false;
+    bool saturated = false;   // hit dac_min/dac_max before reaching the target
+};
+
+struct NaluEqualizerResult {
+    std::vector<NaluChannelEqualization> channels;
+    int iterations = 0;
+    bool converged = false;   // every channel within tolerance
+    std::chrono::nanoseconds total_time{0};
+    std::chrono::nanoseconds measure_time{0};
+    std::chrono::nanoseconds write_time{0};
+};
+
+// Closed-loop DAC tuning. All channels are tuned together: each iteration
+// writes every channel's new DAC in one hot update and measures every
+// baseline from the same capture, so the iteration count does not grow with
+// the number of channels. Each channel steps with a secant estimate of its own
+// baseline-vs-DAC slope.
+class NaluBaselineEqualizer {
+public:
+    NaluBaselineEqualizer(NaluBoardState* state, NaluBoardConfigurator* configurator,
+                          NaluBaselineSource* source);
+
+    // Tunes the enabled channels of `capture_params` and writes the resulting
+    // DACs back into it (assign_dac_values is switched on).
+    NaluEqualizerResult Run(NaluCaptureParams& capture_params, const NaluEqualizerParams& params);
+
+private:
+    struct ChannelLoop {
+        NaluChannelEqualization status;
+        double gain = 1.0;
+        bool has_previous = false;
+        int previous_dac = 0;
+        double previous_baseline = 0.0;
+        bool done = false;
+    };
+
+    NaluBoardState* state_;
+    NaluBoardConfigurator* configurator_;
+    NaluBaselineSource* source_;
+};
+
+#endif // NALU_BASELINE_EQUALIZER_H
@@ -0,0 +1,31 @@
+#ifndef NALU_BOARD_BACKEND_H
+#define NALU_BOARD_BACKEND_H
+
+#include <vector>
+#include "ip_address_info.h"
+
+// Board operations used by the controller, the configurator and the capture
+// watchdog. NaluBoardPythonWrapper implements them on top of naludaq;
+// NaluBoardSimulator (in process) and NaluSimulatorClient (a
+// nalu_board_simulator process) stand in for a board without hardware.
+class NaluBoardBackend {
+public:
+    virtual ~NaluBoardBackend() = default;
+
+    // Board lifecycle
+    virtual void InitializeBoard() = 0;
+    virtual void StartCapture() = 0;
+    virtual void StopCapture() = 0;
+
+    // Register writes
+    virtual void WriteTriggerValues(const std::vector<int>& values) = 0;
+    virtual void WriteTriggerReferences(int low_reference, int high_reference) = 0;
+    virtual void WriteTriggerEdge(bool rising_edge) = 0;
+    virtual void WriteDacValue(int channel, int value) = 0;
+    virtual void WriteReadoutChannels(const std::vector<int>& channels) = 0;
+    virtual void WriteReadWindow(int windows, int lookback, int write_after_trig) = 0;
+    // Stream readout data to `target` over Ethernet
+    virtual void ConfigureEthernet(const IPAddressInfo& target) = 0;
+};
+
+#endif // NALU_BOARD_BACKEND_H
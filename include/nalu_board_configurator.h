@@ -1,23 +1,46 @@
 #ifndef NALU_BOARD_CONFIGURATOR_H
 #define NALU_BOARD_CONFIGURATOR_H
 
+#include <chrono>
 #include "nalu_board_state.h"
-#include "nalu_board_python_wrapper.h"
+#include "nalu_board_backend.h"
+#include "nalu_board_controller_params.h"
+
+// Outcome of NaluBoardConfigurator::ApplyHotUpdate
+struct NaluHotUpdateResult {
+    bool readout_paused = false;
+    std::chrono::nanoseconds pause_time{0};   // readout stopped -> restarted
+    std::chrono::nanoseconds total_time{0};
+    int trigger_values_changed = 0;
+    int dac_values_written = 0;
+    bool references_written = false;
+};
 
 class NaluBoardConfigurator {
 public:
-    NaluBoardConfigurator(NaluBoardState* state, NaluBoardPythonWrapper* python_wrapper);
+    NaluBoardConfigurator(NaluBoardState* state, NaluBoardBackend* backend);
     
     void ConfigureForCapture();
 
+    // Write only what changed in `update` to the board. Thresholds and DACs go
+    // out while readout keeps running; reference changes retune every trigger
+    // comparator at once, so those are written with readout stopped.
+    // Values outside the board model's limits, and DACs that
+    // ConfigureForCapture() would not write (assign_dac_values off, channel
+    // not enabled), throw std::invalid_argument before anything changes. If a board write fails, the previous values
+    // are restored (and rewritten where they had already been written),
+    // paused readout is restarted, and the error is rethrown.
+    NaluHotUpdateResult ApplyHotUpdate(const NaluHotUpdate& update);
+
 private:
     void ConfigureTriggers();
     void ConfigureDacValues();
     void ConfigureReadoutController();
     void ConfigureConnection();
+    std::vector<int> TriggerValueList() const;  // one value per board channel
 
     NaluBoardState* state_;
-    NaluBoardPythonWrapper* python_wrapper_;
+    NaluBoardBackend* backend_;
 };
 
 #endif // NALU_BOARD_CONFIGURATOR_H
\ No newline at end of file
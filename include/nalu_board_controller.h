@@ -2,16 +2,27 @@
 #define NALU_BOARD_CONTROLLER_H
 
 #include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 #include "nalu_board_controller_params.h"
 #include "nalu_board_state.h"
 #include "nalu_board_python_wrapper.h"
 #include "nalu_board_configurator.h"
+#include "nalu_capture_counters.h"
+#include "nalu_capture_watchdog.h"
+#include "nalu_scan_engine.h"
+#include "nalu_baseline_equalizer.h"
+#include "nalu_capture_pipeline.h"
 
 class NaluBoardController {
 public:
+    // Board driven by naludaq through the embedded Python interpreter
     explicit NaluBoardController(const NaluBoardParams& params);
+    // Any other board, e.g. NaluBoardSimulator or NaluSimulatorClient to run
+    // without hardware. setup_logger() and enable_serial() need naludaq and do
+    // nothing / throw with these.
+    NaluBoardController(const NaluBoardParams& params, std::unique_ptr<NaluBoardBackend> backend);
     ~NaluBoardController();
 
     void setup_logger(int level = 20);  // Default to INFO level
@@ -29,15 +40,96 @@ public:
                      bool rising_edge);
     void stop_capture();
 
+    // Apply per-channel trigger/DAC and reference changes to the running
+    // capture without a stop/start cycle. Safe to call from any thread.
+    NaluHotUpdateResult update_capture(const NaluHotUpdate& update);
+
+    // Run a threshold/DAC scan on the running capture (blocks until done).
+    // The watchdog is paused for the duration. The controller is only busy
+    // while switching steps, so other calls (stats, update_capture(), ...) get
+    // through while a step counts; stop_capture() cancels the scan, as does
+    // cancel_scan(). Both may be called from any thread.
+    NaluScanResult run_scan(const NaluScanPlan& plan);
+    void cancel_scan();
+
+    // Tune the DACs of the enabled channels in `params` until their baselines
+    // (as measured by `source` on the running capture) reach the target, and
+    // write the result back into `params`.
+    NaluEqualizerResult equalize_baselines(NaluCaptureParams& params, NaluBaselineSource& source,
+                                           const NaluEqualizerParams& equalizer_params = NaluEqualizerParams());
+
     void enable_ethernet();
     void enable_serial();
 
+    // Data-flow monitoring. Whatever receives the board's stream reports into
+    // capture_counters(); service_watchdog() must be called periodically from
+    // the thread that owns the board (e.g. the main loop).
+    NaluCaptureCounters& capture_counters() { return counters_; }
+    bool service_watchdog();
+    NaluWatchdogStats watchdog_stats() const;
+
+    // In-library receiver (NaluCaptureParams::receiver). Each receive queue
+    // builds events from its packets; the sinks are called on the receive
+    // threads (the packet sink sees every raw datagram before the builder) and
+    // must be set before start_capture().
+    void set_packet_sink(NaluPacketSink sink);
+    void set_event_sink(NaluEventSink sink);
+    // Decoder of the board's wire format (see nalu_packet_decoder.h); the
+    // default decodes only the simulator's placeholder framing
+    void set_packet_decoder(std::shared_ptr<const NaluPacketDecoder> decoder);
+    std::vector<NaluReceiverQueueStats> receiver_stats() const;
+
+    // Packet loss, duplicates, reordering and event completeness per board,
+    // summed over the receive queues. Refreshed every few milliseconds.
+    NaluDataPathStats data_path_stats() const;
+
+    // With NaluCaptureParams::merge enabled, the event sink is called on one
+    // merge thread instead, with all boards' events in timestamp order
+    NaluMergeStats merge_stats() const;
+
+    // Accept/reject counts of NaluCaptureParams::filter, overall and per rule
+    NaluFilterStats filter_stats() const;
+
+    // Histograms of NaluCaptureParams::monitor. Does not wait for other
+    // controller calls, so NaluMonitorBaselineSource can use it during
+    // equalize_baselines().
+    NaluMonitorSnapshot monitor_snapshot() const;
+
+    // Events rearranged by NaluCaptureParams::waveform; zeros when disabled
+    NaluWaveformStats waveform_stats() const;
+
+    // Progress of NaluCaptureParams::record; zeros when not recording
+    NaluRecorderStats recorder_stats() const;
+
+    // Percentiles of each event's time from its first packet through the
+    // builder, the merger and filter, and the event sink, since the receiver
+    // started. stop_capture() logs them.
+    NaluLatencyStats latency_stats() const;
+
 private:
     void init_capture(const NaluCaptureParams& params);
+    void arm_watchdog(const NaluWatchdogParams& params);
+    void start_receiver(const NaluCaptureParams& params);
+    void stop_receiver();
+    void begin_capture(const NaluCaptureParams& params);
+
+    void create_controllers();
 
     std::unique_ptr<NaluBoardState> state_;
-    std::unique_ptr<NaluBoardPythonWrapper> python_wrapper_;
+    std::unique_ptr<NaluBoardBackend> backend_;
+    NaluBoardPythonWrapper* python_wrapper_ = nullptr;  // backend_ when it is the naludaq board
     std::unique_ptr<NaluBoardConfigurator> configurator_;
+
+    NaluCaptureCounters counters_;
+    std::unique_ptr<NaluCaptureWatchdog> watchdog_;
+    std::unique_ptr<NaluScanEngine> scan_engine_;
+
+    // After counters_, which it reports into
+    NaluCapturePipeline pipeline_;
+
+    // Serializes everything that talks to the board or changes its state
+    mutable std::mutex control_mutex_;
+    bool scan_running_ = false;  // run_scan() in progress, possibly with control_mutex_ released
 };
 
 #endif // NALU_BOARD_CONTROLLER_H
\ No newline at end of file
@@ -4,6 +4,7 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <optional>
 
 // Define NaluChannelInfo with default values
 struct NaluChannelInfo {
@@ -21,6 +22,124 @@ struct NaluBoardParams {
     std::string clock_file = "";
 };
 
+// NaluWatchdogParams definition
+// A rate threshold of 0 disables that check. Rates are measured over rate_window_ms.
+struct NaluWatchdogParams {
+    bool enabled = false;
+    double min_packet_rate = 1.0;      // packets per second
+    double min_event_rate = 0.0;       // events per second
+    int rate_window_ms = 1000;
+    int stall_timeout_ms = 5000;       // how long rates must stay low before recovering
+    int recovery_grace_ms = 5000;      // time each recovery step gets to bring data back
+    int max_recovery_attempts = 3;     // re-initialization attempts before giving up
+};
+
+// NaluReceiverParams definition
+// The in-library receiver for the board's UDP stream. With mode "socket" it
+// opens `queues` SO_REUSEPORT sockets on the target port, or one socket per
+// entry of `ports` when that is set, each served by its own thread; mode
+// "packet_mmap" does the same with AF_PACKET TPACKET_V3 rings (CAP_NET_RAW).
+// Queue i runs on cpus[i] when given (-1 or a missing entry leaves it unpinned).
+struct NaluReceiverParams {
+    std::string mode = "none";         // none (stream read elsewhere), socket, packet_mmap, replay
+    int queues = 1;
+    std::vector<int> ports;
+    std::vector<int> cpus;
+    int batch_size = 64;               // datagrams per recvmmsg call
+    int max_packet_bytes = 9000;       // larger datagrams are counted as truncated
+    int socket_buffer_bytes = 16 * 1024 * 1024;  // socket buffer, or ring size for packet_mmap
+    bool huge_pages = false;           // back packet buffers with huge pages
+
+    // Mode "replay": feed a recording (NaluRecordParams) back through the
+    // pipeline at replay_speed times the original pace, 0 for as fast as
+    // possible, replay_loops times (0: until stopped)
+    std::string replay_file;
+    double replay_speed = 1.0;
+    int replay_loops = 1;
+};
+
+// NaluEventBuilderParams definition
+// Events still missing packets are delivered as partial after
+// event_timeout_ms, or earlier when max_open_events are already open.
+struct NaluEventBuilderParams {
+    int event_timeout_ms = 100;
+    int max_open_events = 64;          // per receive queue
+};
+
+// NaluMergeParams definition
+// Merges the boards' events into one stream ordered by board timestamp plus
+// clock_offsets[board_id] (timestamp ticks). An event waits at most
+// max_latency_ms for slower boards before it is released anyway.
+struct NaluMergeParams {
+    bool enabled = false;
+    int max_latency_ms = 50;
+    int queue_capacity = 4096;         // events buffered per board
+    bool drop_late = false;            // drop events older than ones already released instead of passing them on
+    std::map<int, long long> clock_offsets;
+};
+
+// NaluFilterRule definition
+// Accepts an event with at least min_channels hit channels (among `channels`,
+// or all when empty) if at least min_boards boards, the event's own included,
+// have such an event within coincidence_window timestamp ticks of it.
+struct NaluFilterRule {
+    std::string name;
+    std::vector<int> channels;
+    int min_channels = 1;
+    int min_boards = 1;                // above 1 needs merge.enabled
+    long long coincidence_window = 0;
+};
+
+// NaluFilterParams definition
+// Software trigger on the built (and merged) events: only events accepted by
+// at least one rule reach the event sink. A channel is hit when a window
+// strays hit_threshold ADC counts from its baseline, the mean of the window's
+// first baseline_samples samples.
+struct NaluFilterParams {
+    bool enabled = false;
+    int hit_threshold = 50;
+    int baseline_samples = 4;
+    std::vector<NaluFilterRule> rules;
+};
+
+// NaluMonitorParams definition
+// Online monitoring: every prescale-th built event, at most
+// max_events_per_second per receive queue (0: no limit), is filled into
+// per-channel amplitude and baseline histograms of `bins` bins spanning
+// [0, amplitude_max) and [0, baseline_max) ADC counts.
+struct NaluMonitorParams {
+    bool enabled = false;
+    int prescale = 100;
+    int max_events_per_second = 1000;
+    int bins = 256;
+    int amplitude_max = 4096;
+    int baseline_max = 4096;
+    int hit_threshold = 50;            // amplitude that counts towards the hit rate
+    int baseline_samples = 4;
+};
+
+// NaluWaveformParams definition
+// Rearranges each built event into one contiguous time-ordered waveform per
+// channel (NaluWaveformAssembler). Window numbers wrap around the board's
+// circular buffer of buffer_windows windows; 0 takes the board model's, which
+// a pipeline without a board (a replay through nalu_capture) cannot. The
+// readout must be shorter than the buffer.
+struct NaluWaveformParams {
+    bool enabled = false;
+    int buffer_windows = 0;
+};
+
+// NaluRecordParams definition
+// Records every received datagram with its receive time to `path` (empty:
+// no recording). Each receive queue fills chunk_bytes buffers that a writer
+// thread saves; when max_chunks are waiting the newest is dropped instead of
+// stalling reception.
+struct NaluRecordParams {
+    std::string path;
+    int chunk_bytes = 1 << 20;
+    int max_chunks = 64;               // per receive queue
+};
+
 // NaluCaptureParams definition with map for channels
 struct NaluCaptureParams {
     std::string target_ip_port = "192.168.1.1:12345";
@@ -36,6 +155,63 @@ struct NaluCaptureParams {
 
     // Map to store NaluChannelInfo for each channel
     std::map<int, NaluChannelInfo> channels;
+
+    // Data-stall watchdog, serviced by NaluBoardController::service_watchdog()
+    NaluWatchdogParams watchdog;
+
+    NaluReceiverParams receiver;
+    NaluEventBuilderParams event_builder;
+    NaluMergeParams merge;
+    NaluFilterParams filter;
+    NaluMonitorParams monitor;
+    NaluWaveformParams waveform;
+    NaluRecordParams record;
+};
+
+// NaluChannelUpdate definition: unset fields keep their current value
+struct NaluChannelUpdate {
+    std::optional<int> trigger_value;
+    std::optional<int> dac_value;
+};
+
+// NaluHotUpdate definition: changes applied to a running capture
+struct NaluHotUpdate {
+    std::map<int, NaluChannelUpdate> channels;
+    std::optional<int> low_reference;
+    std::optional<int> high_reference;
+    bool force_pause = false;  // pause readout even if the changes could be written live
+    bool write_unchanged = false;  // write requested values even if they match the stored ones
+};
+
+// NaluScanPlan definition: step one parameter of the listed channels from start
+// to stop (inclusive) and count for dwell_ms at every step. In parallel mode all
+// channels move together and are measured at once from their own hit counters;
+// in sequential mode one channel moves while the others keep their values.
+enum class NaluScanParameter { TRIGGER_VALUE, DAC_VALUE };
+enum class NaluScanMode { PARALLEL, SEQUENTIAL };
+
+struct NaluScanPlan {
+    std::vector<int> channels;
+    NaluScanParameter parameter = NaluScanParameter::TRIGGER_VALUE;
+    NaluScanMode mode = NaluScanMode::PARALLEL;
+    int start = 0;
+    int stop = 0;
+    int step = 1;
+    int dwell_ms = 100;
+    int settle_ms = 0;              // wait after each change before counting starts
+    bool restore_values = true;     // put the original values back when done
+};
+
+// NaluEqualizerParams definition: drive every enabled channel's baseline to
+// target_baseline (ADC counts) by adjusting its DAC.
+struct NaluEqualizerParams {
+    double target_baseline = 2048.0;
+    double tolerance = 2.0;           // ADC counts
+    int max_iterations = 12;
+    int dac_min = 0;
+    int dac_max = 4095;
+    double initial_gain = 1.0;        // ADC counts per DAC count, used until two points are measured
+    int settle_ms = 50;               // wait after writing DACs before measuring
 };
 
 // NaluCaptureParamsWrapper that initializes the map
@@ -0,0 +1,67 @@
+#ifndef NALU_BOARD_MODEL_H
+#define NALU_BOARD_MODEL_H
+
+#include <cstddef>
+#include <string_view>
+
+// Largest channel count of any supported board; sizes the fixed channel arrays
+// and the 64-bit enabled-channel mask.
+constexpr int kNaluMaxChannels = 64;
+
+// Geometry and register limits of one board model
+struct NaluBoardModel {
+    std::string_view name;        // naludaq model name, lowercase
+    int channels;
+    int windows;                  // windows in each channel's circular sample buffer
+    int samples_per_window;
+    int sample_bits;
+    int max_trigger_value;
+    int max_dac_value;
+    int max_reference;            // trigger low/high reference
+};
+
+constexpr NaluBoardModel kNaluBoardModels[] = {
+    // name               ch  win  samp bits trig  dac   ref
+    {"hdsocv1",           32, 64,  32,  12,  4095, 4095, 15},
+    {"hdsocv1_evalr1",    32, 64,  32,  12,  4095, 4095, 15},
+    {"hdsocv1_evalr2",    32, 64,  32,  12,  4095, 4095, 15},
+    {"aardvarcv3",         4, 64,  64,  12,  4095, 4095, 15},
+    {"aardvarcv4",         4, 64,  64,  12,  4095, 4095, 15},
+    {"asocv3",             4, 32,  64,  12,  4095, 4095, 15},
+};
+
+// Fallback for models naludaq knows but this table does not: only the
+// board-independent limits are enforced.
+constexpr NaluBoardModel kNaluGenericBoardModel =
+    {"generic",           kNaluMaxChannels, 1024, 64, 16, 65535, 65535, 15};
+
+// Case-insensitive lookup, nullptr when the model is not in the table
+constexpr const NaluBoardModel* NaluFindBoardModel(std::string_view name) {
+    for (const NaluBoardModel& model : kNaluBoardModels) {
+        if (model.name.size() != name.size()) {
+            continue;
+        }
+        bool match = true;
+        for (size_t i = 0; i < name.size() && match; ++i) {
+            char c = name[i];
+            if (c >= 'A' && c <= 'Z') {
+                c = static_cast<char>(c - 'A' + 'a');
+            }
+            match = c == model.name[i];
+        }
+        if (match) {
+            return &model;
+        }
+    }
+    return nullptr;
+}
+
+static_assert(NaluFindBoardModel("HDSoCv1_evalr2") != nullptr, "model lookup must be case-insensitive");
+static_assert([] {
+    for (const NaluBoardModel& model : kNaluBoardModels) {
+        if (model.channels > kNaluMaxChannels) return false;
+    }
+    return true;
+}(), "kNaluMaxChannels must cover every model");
+
+#endif // NALU_BOARD_MODEL_H
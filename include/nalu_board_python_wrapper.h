@@ -1,24 +1,35 @@
 #ifndef NALU_BOARD_PYTHON_WRAPPER_H
 #define NALU_BOARD_PYTHON_WRAPPER_H
 
+#include <memory>
 #include <pybind11/embed.h>
+#include "nalu_board_backend.h"
 #include "nalu_board_state.h"
 
 namespace py = pybind11;
 
-class NaluBoardPythonWrapper {
+class NaluBoardPythonWrapper : public NaluBoardBackend {
 public:
     explicit NaluBoardPythonWrapper(NaluBoardState* state);
-    ~NaluBoardPythonWrapper();
+    ~NaluBoardPythonWrapper() override;
 
     void SetupLogger(int level);
-    void InitializeBoard();
-    void StartCapture();
-    void StopCapture();
+    void InitializeBoard() override;
+    void StartCapture() override;
+    void StopCapture() override;
     void EnableEthernet();
     void EnableSerial();
 
-    // Controller accessors
+    // Register writes (NaluBoardBackend)
+    void WriteTriggerValues(const std::vector<int>& values) override;
+    void WriteTriggerReferences(int low_reference, int high_reference) override;
+    void WriteTriggerEdge(bool rising_edge) override;
+    void WriteDacValue(int channel, int value) override;
+    void WriteReadoutChannels(const std::vector<int>& channels) override;
+    void WriteReadWindow(int windows, int lookback, int write_after_trig) override;
+    void ConfigureEthernet(const IPAddressInfo& target) override;
+
+    // Controller accessors (hold a py::gil_scoped_acquire while using them)
     py::object& Board() { return board_; }
     py::object& BoardController() { return board_controller_; }
     py::object& TriggerController() { return trigger_controller_; }
@@ -46,6 +57,10 @@ private:
     py::object control_registers_;
     py::object analog_registers_;
     py::object logger_;
+
+    // Set when we started the interpreter ourselves; holds the GIL released
+    // between calls.
+    std::unique_ptr<py::gil_scoped_release> gil_release_;
 };
 
 #endif // NALU_BOARD_PYTHON_WRAPPER_H
\ No newline at end of file
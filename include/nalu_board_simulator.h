@@ -0,0 +1,166 @@
+#ifndef NALU_BOARD_SIMULATOR_H
+#define NALU_BOARD_SIMULATOR_H
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "nalu_baseline_equalizer.h"
+#include "nalu_board_backend.h"
+#include "nalu_board_model.h"
+
+// NaluSimulatorParams definition
+// Waveforms are a baseline with Gaussian noise; each streamed channel carries
+// a pulse (rise/decay time constants in samples) with pulse_probability per
+// event. Trigger times are Poisson distributed, or evenly spaced.
+struct NaluSimulatorParams {
+    std::string model = "hdsocv1_evalr2";
+    int board_id = 0;
+    std::string target_ip_port = "127.0.0.1:12345";
+    double trigger_rate_hz = 1000.0;
+    bool poisson = true;
+    double timestamp_hz = 1e8;         // board clock behind the packet timestamps
+    int max_packet_bytes = 8192;
+
+    int baseline = 1000;
+    double noise_rms = 2.0;
+    int pulse_amplitude = 400;
+    double pulse_rise = 1.5;
+    double pulse_decay = 6.0;
+    double pulse_probability = 0.3;
+    std::vector<int> pulse_channels;   // channels that may pulse, empty: all streamed ones
+
+    // Fault injection
+    double drop_probability = 0.0;     // per packet
+    double duplicate_probability = 0.0;
+    double reorder_probability = 0.0;  // swapped with the packet after it
+    int silence_every_ms = 0;          // the last silence_ms of every period send nothing
+    int silence_ms = 0;
+
+    uint32_t seed = 1;
+};
+
+struct NaluSimulatorStats {
+    uint64_t events = 0;
+    uint64_t packets = 0;              // handed to the socket, duplicates included
+    uint64_t bytes = 0;
+    uint64_t dropped = 0;              // injected drops
+    uint64_t duplicated = 0;
+    uint64_t reordered = 0;
+    uint64_t silenced = 0;             // packets not sent because of a silence period
+    uint64_t send_errors = 0;
+};
+
+// Stand-in for a board: takes the controller's register writes like
+// NaluBoardPythonWrapper does, and between StartCapture() and StopCapture()
+// streams events in the placeholder nalu_packet_format.h framing (which
+// NaluSimulatorPacketDecoder decodes) to target_ip_port from a thread of its
+// own. The target, readout channels and window come from the register writes
+// (target_ip_port, all channels and one window until written).
+class NaluBoardSimulator : public NaluBoardBackend {
+public:
+    // What the controller wrote, as the board would hold it
+    struct Registers {
+        bool initialized = false;
+        bool capturing = false;
+        bool ethernet = false;
+        std::vector<int> channels;
+        int windows = 1;
+        int lookback = 1;
+        int write_after_trig = 1;
+        std::vector<int> trigger_values;
+        int low_reference = 0;
+        int high_reference = 15;
+        bool rising_edge = true;
+        std::vector<int> dac_values;
+    };
+
+    explicit NaluBoardSimulator(const NaluSimulatorParams& params);
+    ~NaluBoardSimulator() override;
+
+    void InitializeBoard() override;
+    void StartCapture() override;
+    void StopCapture() override;
+
+    void WriteTriggerValues(const std::vector<int>& values) override;
+    void WriteTriggerReferences(int low_reference, int high_reference) override;
+    void WriteTriggerEdge(bool rising_edge) override;
+    void WriteDacValue(int channel, int value) override;
+    void WriteReadoutChannels(const std::vector<int>& channels) override;
+    void WriteReadWindow(int windows, int lookback, int write_after_trig) override;
+    void ConfigureEthernet(const IPAddressInfo& target) override;
+
+    // Like ConfigureEthernet(); takes effect at the next StartCapture()
+    void SetTarget(const std::string& target_ip_port);
+
+    Registers CurrentRegisters() const;
+    NaluSimulatorStats Stats() const;
+    const NaluBoardModel& Model() const { return model_; }
+    bool IsCapturing() const { return running_.load(); }
+
+private:
+    void StreamLoop(int fd, std::vector<int> channels, int windows);
+
+    NaluSimulatorParams params_;
+    const NaluBoardModel& model_;
+
+    mutable std::mutex mutex_;
+    Registers registers_;
+
+    std::atomic<bool> running_{false};
+    std::thread thread_;
+
+    std::atomic<uint64_t> events_{0};
+    std::atomic<uint64_t> packets_{0};
+    std::atomic<uint64_t> bytes_{0};
+    std::atomic<uint64_t> dropped_{0};
+    std::atomic<uint64_t> duplicated_{0};
+    std::atomic<uint64_t> reordered_{0};
+    std::atomic<uint64_t> silenced_{0};
+    std::atomic<uint64_t> send_errors_{0};
+
+    // Sequence counters carry on across captures, like the board's
+    uint32_t packet_seq_ = 0;
+    uint32_t event_number_ = 0;
+};
+
+// How a simulated channel's baseline follows its DAC: offset + gain * dac,
+// or with saturation > 0 a curve with that slope at DAC 0 that levels off
+// saturation counts above offset. gain 0 is a channel that does not respond.
+// Every measurement adds Gaussian noise of noise_rms and is clipped to the
+// ADC range.
+struct NaluSimulatedChannelResponse {
+    double offset = 0.0;
+    double gain = 1.0;                 // ADC counts per DAC count
+    double saturation = 0.0;
+    double noise_rms = 0.5;
+};
+
+// NaluBaselineSource for a NaluBoardSimulator: baselines follow the DAC
+// values written to the simulator, through each channel's response (the
+// default response for channels not listed). Lets the baseline equalizer run
+// without hardware.
+class NaluSimulatedBaselineSource : public NaluBaselineSource {
+public:
+    NaluSimulatedBaselineSource(const NaluBoardSimulator* board,
+                                std::map<int, NaluSimulatedChannelResponse> responses,
+                                uint32_t seed = 1);
+
+    std::map<int, double> MeasureBaselines(const std::vector<int>& channels) override;
+
+    // Noise-free baseline of `channel` at `dac`
+    double Response(int channel, int dac) const;
+    int Measurements() const { return measurements_; }
+
+private:
+    const NaluBoardSimulator* board_;
+    std::map<int, NaluSimulatedChannelResponse> responses_;
+    std::mt19937 generator_;
+    int measurements_ = 0;
+};
+
+#endif // NALU_BOARD_SIMULATOR_H
@@ -1,11 +1,14 @@
 #ifndef NALU_BOARD_STATE_H
 #define NALU_BOARD_STATE_H
 
+#include <array>
+#include <cstdint>
 #include <string>
 #include <vector>
 #include <tuple>
 #include "ip_address_info.h"
 #include "nalu_board_controller_params.h"
+#include "nalu_board_model.h"
 
 class NaluBoardState {
 public:
@@ -14,6 +17,8 @@ public:
     // Board initialization
     bool IsInitialized() const { return is_initialized_; }
     void SetInitialized(bool initialized) { is_initialized_ = initialized; }
+    bool IsCapturing() const { return is_capturing_; }
+    void SetCapturing(bool capturing) { is_capturing_ = capturing; }
 
     // Board configuration
     const std::string& Model() const { return model_; }
@@ -21,15 +26,23 @@ public:
     const IPAddressInfo& HostIp() const { return host_ip_; }
     const std::string& ConfigFile() const { return config_file_; }
     const std::string& ClockFile() const { return clock_file_; }
+    const NaluBoardModel& BoardModel() const { return *board_model_; }
+    int ChannelCount() const { return board_model_->channels; }
 
     // Capture configuration
     const IPAddressInfo& TargetIp() const { return target_ip_; }
     const std::tuple<int, int, int>& ReadoutWindow() const { return readout_window_; }
     const std::string& TriggerMode() const { return trigger_mode_; }
     const std::string& LookbackMode() const { return lookback_mode_; }
-    const std::vector<int>& Channels() const { return channels_; }
-    const std::vector<int>& TriggerValues() const { return trigger_values_; }
-    const std::vector<int>& DacValues() const { return dac_values_; }
+    // Per-channel values are indexed by channel number; the first ChannelCount() entries are used
+    uint64_t EnabledChannelMask() const { return enabled_mask_; }
+    bool IsChannelEnabled(int channel) const {
+        return channel >= 0 && channel < kNaluMaxChannels && (enabled_mask_ >> channel) & 1u;
+    }
+    int EnabledChannelCount() const { return __builtin_popcountll(enabled_mask_); }
+    std::vector<int> Channels() const;  // enabled channel numbers, ascending (a new vector each call)
+    const std::array<int, kNaluMaxChannels>& TriggerValues() const { return trigger_values_; }
+    const std::array<int, kNaluMaxChannels>& DacValues() const { return dac_values_; }
     int HighReference() const { return high_reference_; }
     int LowReference() const { return low_reference_; }
     bool RisingEdge() const { return rising_edge_; }
@@ -46,30 +59,37 @@ public:
     void SetLowReference(int value) { low_reference_ = value; }
     void SetRisingEdge(bool rising_edge) { rising_edge_ = rising_edge; }
     void SetAssignDacValues(bool assign) { assign_dac_values_ = assign; }
+    void SetTriggerValue(int channel, int value);
+    void SetDacValue(int channel, int value);
 
-    // Bulk update from capture params
+    // Bulk update from capture params. Throws std::invalid_argument for
+    // channels the board model does not have, leaving the state untouched.
+    // Per-channel values go into the fixed arrays; the target address and
+    // the mode strings are copied (and may allocate).
     void UpdateFromCaptureParams(const NaluCaptureParams& params);
 
 private:
     bool is_initialized_ = false;
+    bool is_capturing_ = false;
     std::string model_;
     IPAddressInfo board_ip_;
     IPAddressInfo host_ip_;
     std::string config_file_;
     std::string clock_file_;
+    const NaluBoardModel* board_model_;
 
     // Capture-related state
     IPAddressInfo target_ip_;
-    std::tuple<int, int, int> readout_window_;
+    std::tuple<int, int, int> readout_window_{1, 1, 1};
     std::string trigger_mode_;
     std::string lookback_mode_;
-    std::vector<int> channels_;
-    std::vector<int> trigger_values_;
-    std::vector<int> dac_values_;
-    int high_reference_;
-    int low_reference_;
-    bool rising_edge_;
-    bool assign_dac_values_;
+    uint64_t enabled_mask_ = 0;
+    std::array<int, kNaluMaxChannels> trigger_values_{};
+    std::array<int, kNaluMaxChannels> dac_values_{};
+    int high_reference_ = 15;
+    int low_reference_ = 0;
+    bool rising_edge_ = true;
+    bool assign_dac_values_ = false;
 };
 
 #endif // NALU_BOARD_STATE_H
\ No newline at end of file
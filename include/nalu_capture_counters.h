@@ -0,0 +1,65 @@
+#ifndef NALU_CAPTURE_COUNTERS_H
+#define NALU_CAPTURE_COUNTERS_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include "nalu_board_model.h"
+
+// Point-in-time copy of NaluCaptureCounters
+struct NaluCaptureCountersSnapshot {
+    uint64_t packets = 0;
+    uint64_t bytes = 0;
+    uint64_t events = 0;
+    std::array<uint64_t, kNaluMaxChannels> channel_hits{};  // events with data on that channel
+};
+
+// Running totals of the data coming back from the board. Written by whatever
+// receives the board's stream (any thread), read by the watchdog and scans.
+class NaluCaptureCounters {
+public:
+    void RecordPackets(uint64_t packets, uint64_t bytes = 0) {
+        packets_.fetch_add(packets, std::memory_order_relaxed);
+        bytes_.fetch_add(bytes, std::memory_order_relaxed);
+    }
+
+    void RecordEvents(uint64_t events) {
+        events_.fetch_add(events, std::memory_order_relaxed);
+    }
+
+    void RecordChannelHits(int channel, uint64_t hits = 1) {
+        if (channel >= 0 && channel < kNaluMaxChannels) {
+            channel_hits_[channel].fetch_add(hits, std::memory_order_relaxed);
+        }
+    }
+
+    NaluCaptureCountersSnapshot Snapshot() const {
+        NaluCaptureCountersSnapshot snapshot;
+        snapshot.packets = packets_.load(std::memory_order_relaxed);
+        snapshot.bytes = bytes_.load(std::memory_order_relaxed);
+        snapshot.events = events_.load(std::memory_order_relaxed);
+        for (int i = 0; i < kNaluMaxChannels; ++i) {
+            snapshot.channel_hits[i] = channel_hits_[i].load(std::memory_order_relaxed);
+        }
+        return snapshot;
+    }
+
+    void Reset() {
+        packets_.store(0, std::memory_order_relaxed);
+        bytes_.store(0, std::memory_order_relaxed);
+        events_.store(0, std::memory_order_relaxed);
+        for (auto& hits : channel_hits_) {
+            hits.store(0, std::memory_order_relaxed);
+        }
+    }
+
+private:
+    // Packet and event counters are bumped from different threads, keep them
+    // on separate cache lines.
+    alignas(64) std::atomic<uint64_t> packets_{0};
+    std::atomic<uint64_t> bytes_{0};
+    alignas(64) std::atomic<uint64_t> events_{0};
+    alignas(64) std::array<std::atomic<uint64_t>, kNaluMaxChannels> channel_hits_{};
+};
+
+#endif // NALU_CAPTURE_COUNTERS_H
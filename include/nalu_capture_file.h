@@ -0,0 +1,65 @@
+#ifndef NALU_CAPTURE_FILE_H
+#define NALU_CAPTURE_FILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include "nalu_packet_format.h"
+
+// Recording of received datagrams, all fields little-endian:
+//
+//   file header (32 bytes)
+//     0  char[8] magic "NALUREC1"
+//     8  u32     version
+//    12  u32     queue count of the recording receiver
+//    16  u64     CLOCK_MONOTONIC ns when recording started
+//    24  u64     wall clock (Unix ns) when recording started
+//   records, one per datagram
+//     0  u64     rx_ns (CLOCK_MONOTONIC)
+//     8  u16     receive queue
+//    10  u16     reserved
+//    12  u32     datagram size, at most kNaluCaptureMaxRecordBytes
+//    16  ...     datagram bytes
+//
+// Records of one queue are in reception order; records of different queues
+// are interleaved in blocks, not strictly by time.
+constexpr char kNaluCaptureMagic[8] = {'N', 'A', 'L', 'U', 'R', 'E', 'C', '1'};
+constexpr uint32_t kNaluCaptureVersion = 1;
+constexpr size_t kNaluCaptureHeaderBytes = 32;
+constexpr size_t kNaluCaptureRecordHeaderBytes = 16;
+constexpr uint32_t kNaluCaptureMaxRecordBytes = 65535;  // largest UDP datagram
+
+struct NaluCaptureFileHeader {
+    uint32_t version = kNaluCaptureVersion;
+    uint32_t queues = 1;
+    uint64_t start_ns = 0;
+    uint64_t start_unix_ns = 0;
+};
+
+inline void NaluWriteCaptureHeader(uint8_t* data, const NaluCaptureFileHeader& header) {
+    std::memcpy(data, kNaluCaptureMagic, sizeof(kNaluCaptureMagic));
+    NaluStoreU32(data + 8, header.version);
+    NaluStoreU32(data + 12, header.queues);
+    NaluStoreU64(data + 16, header.start_ns);
+    NaluStoreU64(data + 24, header.start_unix_ns);
+}
+
+inline bool NaluParseCaptureHeader(const uint8_t* data, size_t size, NaluCaptureFileHeader& header) {
+    if (size < kNaluCaptureHeaderBytes || std::memcmp(data, kNaluCaptureMagic, sizeof(kNaluCaptureMagic)) != 0) {
+        return false;
+    }
+    header.version = NaluLoadU32(data + 8);
+    header.queues = NaluLoadU32(data + 12);
+    header.start_ns = NaluLoadU64(data + 16);
+    header.start_unix_ns = NaluLoadU64(data + 24);
+    return header.version == kNaluCaptureVersion && header.queues > 0;
+}
+
+inline void NaluWriteCaptureRecordHeader(uint8_t* data, uint64_t rx_ns, uint16_t queue, uint32_t size) {
+    NaluStoreU64(data, rx_ns);
+    NaluStoreU16(data + 8, queue);
+    NaluStoreU16(data + 10, 0);
+    NaluStoreU32(data + 12, size);
+}
+
+#endif // NALU_CAPTURE_FILE_H
@@ -0,0 +1,93 @@
+#ifndef NALU_CAPTURE_PIPELINE_H
+#define NALU_CAPTURE_PIPELINE_H
+
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "nalu_board_controller_params.h"
+#include "nalu_capture_counters.h"
+#include "nalu_capture_recorder.h"
+#include "nalu_event_builder.h"
+#include "nalu_event_filter.h"
+#include "nalu_event_merger.h"
+#include "nalu_latency.h"
+#include "nalu_monitor.h"
+#include "nalu_receiver.h"
+#include "nalu_waveform_assembler.h"
+
+// Host side of a capture, wired from NaluCaptureParams:
+//
+//   receiver -> [recorder] -> packet sink
+//            -> one builder per queue -> [waveform] -> [monitor] -> [merger] -> [filter] -> event sink
+//
+// Every event reaching the event sink is stamped processed_ns and its
+// latency recorded; Stop() logs the percentiles.
+//
+// NaluBoardController runs one alongside the board; it also runs on its own
+// when something else drives the board, or for a replay. Start(), Stop(),
+// the setters and the statistics must not be called concurrently, except
+// MonitorSnapshot(), which is safe from any thread at any time.
+class NaluCapturePipeline {
+public:
+    // Received packets and built events are recorded into `counters` when given
+    explicit NaluCapturePipeline(NaluCaptureCounters* counters);
+    ~NaluCapturePipeline();
+
+    // Called on the receive threads (the event sink on the merge thread when
+    // merging); throws std::runtime_error while running
+    void SetPacketSink(NaluPacketSink sink);
+    void SetEventSink(NaluEventSink sink);
+    // Wire format of the board's stream, shared by the builders of all
+    // queues; null (the default) is the simulator's placeholder framing.
+    // Throws std::runtime_error while running.
+    void SetPacketDecoder(std::shared_ptr<const NaluPacketDecoder> decoder);
+
+    // Replace whatever ran before with the stages of `params` and start
+    // receiving. Nothing runs for receiver mode "none". Throws when the
+    // receiver or the recording cannot be set up, or when waveform assembly
+    // lacks layout.buffer_windows; the stages already set up are torn down
+    // again first.
+    void Start(const NaluCaptureParams& params, const NaluEventLayout& layout);
+    // Stop receiving and drain every stage: open events are delivered as
+    // partial, the merger releases what it holds, filters decide the rest
+    void Stop();
+    bool IsRunning() const { return receiver_ && receiver_->IsRunning(); }
+
+    std::vector<NaluReceiverQueueStats> ReceiverStats() const;
+    NaluDataPathStats DataPathStats() const;
+    NaluMergeStats MergeStats() const;
+    NaluFilterStats FilterStats() const;
+    NaluWaveformStats WaveformStats() const;
+    NaluRecorderStats RecorderStats() const;
+    // Per-stage latency of the events delivered since Start()
+    NaluLatencyStats LatencyStats() const;
+    NaluMonitorSnapshot MonitorSnapshot() const;
+
+    // Layout of the events of `params` when nothing else knows better
+    static NaluEventLayout LayoutFor(const NaluCaptureParams& params);
+
+private:
+    // Every stage of `params`, with no thread started yet
+    void Build(const NaluCaptureParams& params, const NaluEventLayout& layout);
+    void Reset();
+
+    NaluCaptureCounters* counters_;
+    NaluPacketSink packet_sink_;
+    NaluEventSink event_sink_;
+    std::shared_ptr<const NaluPacketDecoder> packet_decoder_;
+
+    // Declared in data-flow order reversed, so each stage outlives the ones
+    // feeding it; the receiver goes first
+    std::unique_ptr<NaluLatencyTracker> latency_;
+    std::vector<std::unique_ptr<NaluEventFilter>> filters_;
+    std::unique_ptr<NaluEventMerger> merger_;
+    std::unique_ptr<NaluMonitor> monitor_;     // replaced under monitor_mutex_
+    std::vector<std::unique_ptr<NaluWaveformAssembler>> assemblers_;
+    std::vector<std::unique_ptr<NaluEventBuilder>> event_builders_;
+    std::unique_ptr<NaluCaptureRecorder> recorder_;
+    std::unique_ptr<NaluReceiver> receiver_;
+
+    mutable std::mutex monitor_mutex_;
+};
+
+#endif // NALU_CAPTURE_PIPELINE_H
@@ -0,0 +1,72 @@
+#ifndef NALU_CAPTURE_RECORDER_H
+#define NALU_CAPTURE_RECORDER_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "nalu_board_controller_params.h"
+#include "nalu_spsc_ring.h"
+
+struct NaluRecorderStats {
+    uint64_t packets = 0;              // written, or waiting to be
+    uint64_t bytes = 0;                // bytes written to the file, record headers included
+    uint64_t dropped_packets = 0;      // lost to a full chunk queue
+    uint64_t chunks_written = 0;       // written in full
+    uint64_t write_errors = 0;
+};
+
+// Writes received datagrams to a capture file (nalu_capture_file.h) without
+// ever blocking the receive threads: each queue appends to its own chunk and
+// hands full chunks to a writer thread through a lock-free ring, getting
+// emptied chunks back through a second one.
+class NaluCaptureRecorder {
+public:
+    // Creates the file and writes its header; throws std::runtime_error
+    NaluCaptureRecorder(const NaluRecordParams& params, int queues);
+    ~NaluCaptureRecorder();
+
+    void Start();
+    // Write everything recorded so far and close the file. Call once the
+    // receive threads are stopped.
+    void Stop();
+
+    // Called on `queue`'s receive thread
+    void Record(int queue, const uint8_t* data, size_t size, uint64_t rx_ns);
+
+    NaluRecorderStats Stats() const;
+
+private:
+    struct Chunk {
+        std::vector<uint8_t> bytes;
+        uint64_t packets = 0;
+    };
+
+    struct Queue {
+        explicit Queue(size_t chunks) : full(chunks), empty(chunks) {}
+        NaluSpscRing<Chunk> full;      // receive thread -> writer
+        NaluSpscRing<Chunk> empty;     // writer -> receive thread
+        Chunk current;
+        std::atomic<uint64_t> packets{0};
+        std::atomic<uint64_t> dropped{0};
+    };
+
+    void Submit(Queue& queue);
+    bool WriteAvailable();
+    void WriteLoop();
+
+    NaluRecordParams params_;
+    size_t chunk_bytes_;
+    std::FILE* file_ = nullptr;
+    std::vector<std::unique_ptr<Queue>> queues_;
+
+    std::atomic<uint64_t> bytes_{0};
+    std::atomic<uint64_t> chunks_written_{0};
+    std::atomic<uint64_t> write_errors_{0};
+    std::atomic<bool> running_{false};
+    std::thread thread_;
+};
+
+#endif // NALU_CAPTURE_RECORDER_H
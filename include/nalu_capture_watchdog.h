@@ -0,0 +1,96 @@
+#ifndef NALU_CAPTURE_WATCHDOG_H
+#define NALU_CAPTURE_WATCHDOG_H
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include "nalu_board_backend.h"
+#include "nalu_board_configurator.h"
+#include "nalu_board_controller_params.h"
+#include "nalu_capture_counters.h"
+
+// Recovery steps, in escalation order
+enum class NaluRecoveryLevel {
+    NONE = 0,
+    RESTART_READOUT = 1,   // stop/start readout
+    RECONFIGURE = 2,       // stop, ConfigureForCapture(), start
+    REINITIALIZE = 3       // stop, InitializeBoard(), ConfigureForCapture(), start
+};
+
+struct NaluRecoveryStepStats {
+    uint64_t attempts = 0;
+    uint64_t failures = 0;  // step threw before finishing
+    std::chrono::nanoseconds total_time{0};
+    std::chrono::nanoseconds last_time{0};
+};
+
+struct NaluWatchdogStats {
+    bool stalled = false;
+    NaluRecoveryLevel level = NaluRecoveryLevel::NONE;
+    uint64_t stalls_detected = 0;
+    uint64_t recoveries = 0;  // stalls that ended with data flowing again
+    uint64_t gave_up = 0;
+    // Deadtime runs from the last moment data was seen to the moment it is seen again
+    std::chrono::nanoseconds total_deadtime{0};
+    std::chrono::nanoseconds last_deadtime{0};
+    std::array<NaluRecoveryStepStats, 3> steps;  // indexed by level - 1
+
+    const NaluRecoveryStepStats& Step(NaluRecoveryLevel level) const {
+        return steps[static_cast<int>(level) - 1];
+    }
+};
+
+// Watches the packet/event rates in NaluCaptureCounters and walks the recovery
+// ladder when they stall. The watchdog has no thread of its own: Poll() is
+// called from the thread that owns the board (the one holding the GIL), so
+// recovery steps can talk to naludaq directly.
+class NaluCaptureWatchdog {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    NaluCaptureWatchdog(const NaluWatchdogParams& params,
+                        const NaluCaptureCounters* counters,
+                        NaluBoardBackend* backend,
+                        NaluBoardConfigurator* configurator);
+
+    // Start/stop watching, e.g. around a capture
+    void Arm();
+    void Arm(Clock::time_point now);
+    void Disarm();
+    bool IsArmed() const { return armed_; }
+
+    // Evaluate rates and run a recovery step if needed. Returns true if a step ran.
+    bool Poll();
+    bool Poll(Clock::time_point now);
+
+    const NaluWatchdogParams& Params() const { return params_; }
+    const NaluWatchdogStats& Stats() const { return stats_; }
+
+private:
+    bool RatesHealthy(const NaluCaptureCountersSnapshot& snapshot, Clock::time_point now) const;
+    void ResetRateWindow(Clock::time_point now);
+    void OnRecovered(Clock::time_point now);
+    void RunRecoveryStep(NaluRecoveryLevel level, Clock::time_point now);
+    void StopReadoutQuietly();
+
+    NaluWatchdogParams params_;
+    const NaluCaptureCounters* counters_;
+    NaluBoardBackend* backend_;
+    NaluBoardConfigurator* configurator_;
+
+    bool armed_ = false;
+    bool gave_up_ = false;
+    int attempts_at_last_level_ = 0;
+
+    // Rate window
+    Clock::time_point window_start_;
+    NaluCaptureCountersSnapshot window_snapshot_;
+
+    // Stall tracking
+    Clock::time_point last_activity_;  // end of the last healthy window
+    Clock::time_point grace_until_;
+
+    NaluWatchdogStats stats_;
+};
+
+#endif // NALU_CAPTURE_WATCHDOG_H
@@ -0,0 +1,41 @@
+#ifndef NALU_CONFIG_FILE_H
+#define NALU_CONFIG_FILE_H
+
+#include <string>
+#include "nalu_board_controller_params.h"
+
+enum class NaluConfigFormat {
+    AUTO,   // from the file extension (.json, .yaml/.yml)
+    JSON,
+    YAML
+};
+
+// Loading and saving of NaluBoardParams / NaluCaptureParams.
+//
+// A file either holds one struct at the top level or both under "board" and
+// "capture" sections. Keys are the struct field names, channels are a mapping
+// from channel number to {enabled, trigger_value, dac_value}, and unknown keys
+// are rejected. Everything is validated with NaluParamsValidator while
+// loading, so a bad file throws std::invalid_argument before any board call.
+// YAML support covers block mappings and sequences, flow collections and
+// plain/quoted scalars (no anchors, tags or multi-line strings).
+class NaluConfigFile {
+public:
+    // Loaded files are cached per path and reused while their size and
+    // modification time are unchanged.
+    static NaluBoardParams LoadBoardParams(const std::string& path, NaluConfigFormat format = NaluConfigFormat::AUTO);
+    static NaluCaptureParams LoadCaptureParams(const std::string& path, NaluConfigFormat format = NaluConfigFormat::AUTO);
+
+    static NaluBoardParams ParseBoardParams(const std::string& text, NaluConfigFormat format);
+    static NaluCaptureParams ParseCaptureParams(const std::string& text, NaluConfigFormat format);
+
+    static std::string ToString(const NaluBoardParams& params, NaluConfigFormat format);
+    static std::string ToString(const NaluCaptureParams& params, NaluConfigFormat format);
+
+    static void Save(const NaluBoardParams& params, const std::string& path, NaluConfigFormat format = NaluConfigFormat::AUTO);
+    static void Save(const NaluCaptureParams& params, const std::string& path, NaluConfigFormat format = NaluConfigFormat::AUTO);
+
+    static void ClearCache();
+};
+
+#endif // NALU_CONFIG_FILE_H
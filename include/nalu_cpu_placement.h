@@ -0,0 +1,54 @@
+#ifndef NALU_CPU_PLACEMENT_H
+#define NALU_CPU_PLACEMENT_H
+
+#include <cstddef>
+
+// Thread pinning and NUMA lookup for the data-path threads (Linux only;
+// NUMA topology comes from sysfs, so libnuma is not needed).
+class NaluCpuPlacement {
+public:
+    // Pin the calling thread to one core. Throws std::runtime_error.
+    static void PinCurrentThread(int cpu);
+
+    // NUMA node of a core, -1 when unknown
+    static int NumaNodeOfCpu(int cpu);
+
+    // Core the calling thread is running on, -1 when unknown
+    static int CurrentCpu();
+
+    static int CpuCount();
+};
+
+// Page-aligned anonymous mapping for packet buffers and rings. Pages are
+// placed on the NUMA node of the thread that first touches them, so create
+// and Touch() the buffer from the already-pinned thread that will use it.
+// With huge_pages the mapping uses MAP_HUGETLB when the system has huge
+// pages reserved and falls back to transparent huge pages otherwise.
+class NaluHostBuffer {
+public:
+    NaluHostBuffer() = default;
+    NaluHostBuffer(size_t bytes, bool huge_pages);
+    ~NaluHostBuffer();
+
+    NaluHostBuffer(const NaluHostBuffer&) = delete;
+    NaluHostBuffer& operator=(const NaluHostBuffer&) = delete;
+    NaluHostBuffer(NaluHostBuffer&& other) noexcept;
+    NaluHostBuffer& operator=(NaluHostBuffer&& other) noexcept;
+
+    // Fault every page in from the calling thread
+    void Touch();
+
+    unsigned char* Data() const { return data_; }
+    size_t Size() const { return size_; }
+    bool HugePages() const { return huge_pages_; }  // backed by MAP_HUGETLB pages
+
+private:
+    void Release();
+
+    unsigned char* data_ = nullptr;
+    size_t size_ = 0;
+    size_t mapped_size_ = 0;
+    bool huge_pages_ = false;
+};
+
+#endif // NALU_CPU_PLACEMENT_H
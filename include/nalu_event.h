@@ -0,0 +1,53 @@
+#ifndef NALU_EVENT_H
+#define NALU_EVENT_H
+
+#include <cstdint>
+#include <vector>
+
+// Where one window's samples sit in NaluEvent::samples
+struct NaluEventWindow {
+    uint8_t channel = 0;
+    uint8_t window = 0;
+    uint16_t sample_count = 0;
+    uint32_t offset = 0;
+};
+
+// One event assembled from the board's packets. Partial events (packets
+// lost, or not all arrived before the builder's timeout) are delivered too,
+// with complete == false and whatever windows did arrive.
+struct NaluEvent {
+    int board_id = 0;
+    uint32_t event_number = 0;
+    uint64_t timestamp = 0;              // board clock
+    uint64_t first_rx_ns = 0;            // CLOCK_MONOTONIC of the first and last packet
+    uint64_t last_rx_ns = 0;
+    uint64_t built_ns = 0;               // CLOCK_MONOTONIC when the builder delivered it
+    uint64_t processed_ns = 0;           // and when the pipeline handed it to the event sink
+    bool complete = false;
+    uint16_t packets_expected = 0;       // 0 when the last packet never arrived
+    uint16_t packets_received = 0;
+    uint64_t channel_mask = 0;           // channels with at least one window
+    uint32_t waveform_samples = 0;       // samples per channel once time ordered (NaluWaveformAssembler), else 0
+    std::vector<NaluEventWindow> windows;
+    std::vector<uint16_t> samples;
+
+    // Empty the event, keeping its storage for reuse
+    void Clear() {
+        board_id = 0;
+        event_number = 0;
+        timestamp = 0;
+        first_rx_ns = 0;
+        last_rx_ns = 0;
+        built_ns = 0;
+        processed_ns = 0;
+        complete = false;
+        packets_expected = 0;
+        packets_received = 0;
+        channel_mask = 0;
+        waveform_samples = 0;
+        windows.clear();
+        samples.clear();
+    }
+};
+
+#endif // NALU_EVENT_H
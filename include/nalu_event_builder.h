@@ -0,0 +1,144 @@
+#ifndef NALU_EVENT_BUILDER_H
+#define NALU_EVENT_BUILDER_H
+
+#include <array>
+#include <bitset>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "nalu_board_controller_params.h"
+#include "nalu_board_model.h"
+#include "nalu_capture_counters.h"
+#include "nalu_event.h"
+#include "nalu_event_pool.h"
+#include "nalu_packet_decoder.h"
+#include "nalu_sequence_window.h"
+
+// Called for every built event, complete or partial, on the thread that fed
+// the builder. The event may be moved from.
+using NaluEventSink = std::function<void(NaluEvent&& event)>;
+
+// What every event should contain, used to attribute lost windows to channels
+struct NaluEventLayout {
+    uint64_t channel_mask = 0;
+    int windows = 0;              // readout windows per channel
+    int samples_per_window = 0;   // sizes the event storage; 0: learned from the first events
+    int buffer_windows = 0;       // windows in each channel's circular sample buffer; 0: unknown
+};
+
+// Loss and completeness counters of one board
+struct NaluBoardLossStats {
+    uint64_t packets = 0;               // accepted packets, duplicates excluded
+    uint64_t lost_packets = 0;          // sequence gaps not (yet) filled by late packets
+    uint64_t duplicate_packets = 0;
+    uint64_t reordered_packets = 0;     // arrived after a later packet
+    uint64_t late_packets = 0;          // belonged to an event already delivered
+    uint64_t malformed_packets = 0;     // bad window blocks
+    uint64_t resyncs = 0;               // sequence counter restarts
+    uint64_t events_complete = 0;
+    uint64_t events_partial = 0;
+    uint64_t events_timed_out = 0;      // partial because of event_timeout_ms
+    uint64_t events_evicted = 0;        // partial because max_open_events were open
+    uint64_t events_lost = 0;           // event numbers never seen at all
+    std::array<uint64_t, kNaluMaxChannels> channel_windows_lost{};
+
+    void Add(const NaluBoardLossStats& other);
+    double PacketLossRate() const;
+};
+
+struct NaluDataPathStats {
+    std::map<int, NaluBoardLossStats> boards;
+    uint64_t unparsed_packets = 0;      // no valid packet header
+    uint64_t open_events = 0;
+    NaluEventPoolStats event_pool;
+
+    void Add(const NaluDataPathStats& other);
+};
+
+// Builds events from one receive queue's packets, decoded by a
+// NaluPacketDecoder (the simulator's placeholder framing by default),
+// tracking every board's packet and event counters for gaps, duplicates and
+// reordering. Open events live in a fixed table, so memory stays bounded
+// however much is lost. Event storage comes from a NaluEventPool sized from
+// the layout; whatever storage the sink leaves in a delivered event (all of
+// it, if the sink only reads the event or swaps in a spare) goes back to the
+// pool, so steady capture allocates nothing. Not thread-safe except for
+// Stats(): feed it from one thread (the queue's receive thread).
+class NaluEventBuilder {
+public:
+    static constexpr int kMaxPacketsPerEvent = 1024;
+
+    NaluEventBuilder(const NaluEventBuilderParams& params, const NaluEventLayout& layout,
+                     NaluCaptureCounters* counters, NaluEventSink sink,
+                     std::shared_ptr<const NaluPacketDecoder> decoder = nullptr);
+
+    // Feed one datagram; size 0 is an idle tick that only expires old events
+    void HandlePacket(const uint8_t* data, size_t size, uint64_t rx_ns);
+
+    // Deliver every open event as partial (end of capture)
+    void Flush();
+
+    // Snapshot, refreshed by the feeding thread every few milliseconds
+    NaluDataPathStats Stats() const;
+
+private:
+    struct BoardTrack {
+        NaluSequenceWindow packets;
+        NaluSequenceWindow events;
+        NaluBoardLossStats stats;
+    };
+
+    struct OpenEvent {
+        bool used = false;
+        uint64_t opened_ns = 0;
+        NaluEvent event;
+        std::bitset<kMaxPacketsPerEvent> packets;
+        std::array<uint16_t, kNaluMaxChannels> channel_windows{};
+    };
+
+    enum class Reason { COMPLETE, TIMEOUT, EVICTED, FLUSH };
+
+    // Appends the decoded window blocks of one packet to its open event
+    class BlockAdder final : public NaluWindowBlockVisitor {
+    public:
+        BlockAdder(OpenEvent& slot, BoardTrack& track) : slot_(slot), track_(track) {}
+        bool Visit(const NaluWindowBlock& block) override;
+
+    private:
+        OpenEvent& slot_;
+        BoardTrack& track_;
+    };
+
+    BoardTrack& Track(int board_id);
+    OpenEvent* FindEvent(int board_id, uint32_t event_number);
+    OpenEvent* OpenSlot(uint64_t rx_ns);
+    void AddBlocks(OpenEvent& slot, const uint8_t* data, size_t size, BoardTrack& track);
+    void Deliver(OpenEvent& slot, Reason reason);
+    void ExpireEvents(uint64_t now_ns);
+    void Publish();
+
+    NaluEventBuilderParams params_;
+    NaluEventLayout layout_;
+    NaluCaptureCounters* counters_;
+    NaluEventSink sink_;
+    std::shared_ptr<const NaluPacketDecoder> decoder_;
+    uint64_t timeout_ns_;
+    uint64_t scan_interval_ns_;
+    uint64_t last_scan_ns_ = 0;
+    uint64_t now_ns_ = 0;              // receive time of the packet being handled: events are built "now"
+
+    std::array<std::unique_ptr<BoardTrack>, 256> boards_;
+    NaluEventPool pool_;
+    std::vector<OpenEvent> slots_;
+    OpenEvent* last_slot_ = nullptr;   // packets of one event usually arrive together
+    size_t open_count_ = 0;
+    uint64_t unparsed_packets_ = 0;
+
+    mutable std::mutex stats_mutex_;
+    NaluDataPathStats published_;
+};
+
+#endif // NALU_EVENT_BUILDER_H
@@ -0,0 +1,101 @@
+#ifndef NALU_EVENT_FILTER_H
+#define NALU_EVENT_FILTER_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "nalu_board_controller_params.h"
+#include "nalu_event.h"
+#include "nalu_event_builder.h"
+#include "nalu_hit_features.h"
+
+struct NaluFilterRuleStats {
+    std::string name;
+    uint64_t accepted = 0;
+    uint64_t rejected = 0;
+};
+
+struct NaluFilterStats {
+    uint64_t events_in = 0;
+    uint64_t accepted = 0;             // passed by at least one rule
+    uint64_t rejected = 0;
+    uint64_t pending = 0;              // waiting for their coincidence window to close
+    std::vector<NaluFilterRuleStats> rules;
+
+    void Add(const NaluFilterStats& other);
+};
+
+// Applies the NaluFilterParams rules to a stream of events and forwards the
+// accepted ones to the sink, in arrival order. Rules spanning boards need a
+// time-ordered stream (the merger's output): each event is held until no
+// later event can fall into its coincidence window. Not thread-safe except
+// for Stats(): feed it from one thread.
+class NaluEventFilter {
+public:
+    static constexpr int kMaxRules = 64;
+
+    // clock_offsets are added to board timestamps, as in the merger
+    NaluEventFilter(const NaluFilterParams& params, const std::map<int, long long>& clock_offsets,
+                    NaluEventSink sink);
+
+    void HandleEvent(NaluEvent&& event);
+
+    // Decide every held event (end of capture)
+    void Flush();
+
+    NaluFilterStats Stats() const;
+
+private:
+    struct Rule {
+        uint64_t channel_mask = 0;
+        int min_channels = 1;
+        int min_boards = 1;
+        int64_t window = 0;
+    };
+
+    struct RuleCounters {
+        std::atomic<uint64_t> accepted{0};
+        std::atomic<uint64_t> rejected{0};
+    };
+
+    struct Entry {
+        NaluEvent event;
+        int board_id = 0;
+        int64_t time = 0;
+        uint64_t qualifies = 0;        // rules whose channel condition the event meets
+        bool decided = false;
+    };
+
+    void Decide(Entry& entry, size_t index);
+    bool Coincident(size_t index, int rule) const;
+    void GrowHold();
+    Entry& Held(size_t index) { return held_[(held_head_ + index) & (held_.size() - 1)]; }
+    const Entry& Held(size_t index) const { return held_[(held_head_ + index) & (held_.size() - 1)]; }
+
+    NaluFilterParams params_;
+    NaluEventSink sink_;
+    std::vector<Rule> rules_;
+    std::array<int64_t, 256> offsets_{};
+    bool cross_board_ = false;
+    int64_t max_window_ = 0;
+
+    NaluHitFeatures features_;
+    // Hold queue: a ring that grows to the longest hold seen; its entries keep
+    // their event storage, which HandleEvent() hands back to the caller
+    std::vector<Entry> held_;
+    size_t held_head_ = 0;
+    size_t held_count_ = 0;
+    size_t first_undecided_ = 0;
+    Entry current_;                    // the event being decided when nothing is held
+    int64_t latest_time_ = 0;
+
+    std::vector<RuleCounters> counters_;
+    std::atomic<uint64_t> events_in_{0};
+    std::atomic<uint64_t> accepted_{0};
+    std::atomic<uint64_t> rejected_{0};
+    std::atomic<uint64_t> pending_{0};
+};
+
+#endif // NALU_EVENT_FILTER_H
@@ -0,0 +1,98 @@
+#ifndef NALU_EVENT_MERGER_H
+#define NALU_EVENT_MERGER_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "nalu_board_controller_params.h"
+#include "nalu_event.h"
+#include "nalu_event_builder.h"
+#include "nalu_spsc_ring.h"
+
+struct NaluMergeStats {
+    uint64_t events_in = 0;
+    uint64_t events_out = 0;
+    uint64_t dropped_full = 0;         // a board's queue was full
+    uint64_t late_events = 0;          // older than an event already released
+    uint64_t watermark_releases = 0;   // released after max_latency_ms without every board present
+    uint64_t max_queue_depth = 0;
+    int boards = 0;
+};
+
+// Time-ordered k-way merge of per-board event streams. Push() is called by
+// the receive threads; every board must always arrive through the same
+// thread, which holds when each board has its own flow. A merge thread keeps
+// the head event of every board in a min-heap on corrected timestamp and
+// releases the smallest once every board has a head. A board whose queue has
+// been empty for max_latency_ms (the watermark) is no longer waited for, so a
+// quiet or stalled board delays the stream by at most that much. For the
+// first max_latency_ms after Start() nothing is released, giving every board
+// the chance to show up. Events of one board are expected in timestamp order.
+class NaluEventMerger {
+public:
+    NaluEventMerger(const NaluMergeParams& params, NaluEventSink sink);
+    ~NaluEventMerger();
+
+    void Start();
+    // Release everything still queued, in order, then stop the merge thread
+    void Stop();
+
+    // Producer side; false when the board's queue was full and the event
+    // dropped. Otherwise `event` is left holding storage to reuse.
+    bool Push(NaluEvent&& event);
+
+    NaluMergeStats Stats() const;
+
+private:
+    struct Input {
+        explicit Input(size_t capacity) : ring(capacity) {}
+        NaluSpscRing<NaluEvent> ring;
+        std::atomic<uint64_t> pushed{0};
+        std::atomic<uint64_t> dropped{0};
+    };
+
+    struct Head {
+        int64_t time = 0;
+        int board_id = 0;
+    };
+
+    void Run();
+    // One merge step: refill heads and release what may go. True when
+    // anything moved.
+    bool Step(uint64_t now_ns, bool draining);
+    int64_t MergeTime(const NaluEvent& event) const;
+
+    NaluMergeParams params_;
+    NaluEventSink sink_;
+    uint64_t max_latency_ns_;
+    std::array<int64_t, 256> offsets_{};
+
+    // Created by a board's producer on first use, then only read
+    std::array<std::atomic<Input*>, 256> inputs_{};
+    std::atomic<int> input_count_{0};
+    int known_inputs_ = 0;
+
+    // Merge-thread state
+    std::array<NaluEvent, 256> head_events_;
+    NaluEvent released_;                           // last event handed to the sink
+    std::array<bool, 256> has_head_{};
+    std::array<uint64_t, 256> empty_since_ns_{};   // 0 while the board's queue has events
+    uint64_t warm_until_ns_ = 0;
+    std::vector<Head> heap_;
+    std::vector<int> active_boards_;
+    bool released_any_ = false;
+    int64_t last_released_time_ = 0;
+
+    std::atomic<uint64_t> events_out_{0};
+    std::atomic<uint64_t> late_events_{0};
+    std::atomic<uint64_t> watermark_releases_{0};
+    std::atomic<uint64_t> max_queue_depth_{0};
+
+    std::atomic<bool> running_{false};
+    std::thread thread_;
+};
+
+#endif // NALU_EVENT_MERGER_H
@@ -0,0 +1,45 @@
+#ifndef NALU_EVENT_POOL_H
+#define NALU_EVENT_POOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "nalu_event.h"
+
+struct NaluEventPoolStats {
+    uint64_t acquired = 0;
+    uint64_t allocated = 0;        // acquired with fresh storage: the pool was empty
+    uint64_t released = 0;
+    uint64_t discarded = 0;        // released without storage (kept downstream), or pool full
+    uint64_t pooled = 0;           // events waiting for reuse
+    uint64_t pooled_bytes = 0;     // their reserved storage
+
+    void Add(const NaluEventPoolStats& other);
+};
+
+// Recycles the window and sample storage of events. Acquire() hands out an
+// empty event whose vectors already have room for a whole event of the
+// layout, so filling it does not allocate; Release() takes back whatever
+// storage an event still holds. Once the pool holds as many events as are in
+// flight, a steady stream of events allocates nothing. Not thread-safe: it
+// belongs to the thread that builds the events.
+class NaluEventPool {
+public:
+    // Room for `windows_per_event` windows and `samples_per_event` samples per
+    // event (0: grown by the first events); at most `max_pooled` are kept
+    NaluEventPool(size_t max_pooled, size_t windows_per_event, size_t samples_per_event);
+
+    NaluEvent Acquire();
+    void Release(NaluEvent&& event);
+
+    NaluEventPoolStats Stats() const;
+
+private:
+    size_t max_pooled_;
+    size_t windows_per_event_;
+    size_t samples_per_event_;
+    std::vector<NaluEvent> pooled_;
+    NaluEventPoolStats stats_;
+};
+
+#endif // NALU_EVENT_POOL_H
@@ -0,0 +1,64 @@
+#ifndef NALU_EVENT_QUEUE_H
+#define NALU_EVENT_QUEUE_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+#include "nalu_event.h"
+
+struct NaluEventQueueStats {
+    uint64_t pushed = 0;
+    uint64_t dropped = 0;          // no free slot: the consumer fell behind
+    uint64_t popped = 0;
+    uint64_t leased = 0;           // popped and not yet released
+    uint64_t queued = 0;
+};
+
+// Hands built events from the pipeline threads to a consumer that holds on to
+// them, e.g. a Python caller reading them as NumPy arrays. Events are stored
+// in a fixed number of slots: Pop() leases a slot, and its event stays put
+// (no copy, no move) until Release(). A producer never blocks; with every
+// slot queued or leased the event is dropped and counted. Any number of
+// producers, one consumer.
+class NaluEventSlotQueue {
+public:
+    explicit NaluEventSlotQueue(size_t slots);
+
+    // Producer side; false when the event was dropped. Otherwise `event` is
+    // left with the storage of an earlier, released event, or keeps its own
+    // when the slot is used for the first time.
+    bool Push(NaluEvent&& event);
+
+    // Consumer side: index of the oldest queued slot, waiting up to
+    // timeout_ms (negative: until Close()), or -1
+    int Pop(int timeout_ms);
+    NaluEvent& Slot(int index) { return slots_[index]; }
+    const NaluEvent& Slot(int index) const { return slots_[index]; }
+    // Any thread; the slot's storage is kept for the next event
+    void Release(int index);
+
+    // Wake the consumer; Pop() returns -1 once the queue is empty
+    void Close();
+    // Accept events again after Close(), e.g. for the next capture
+    void Reopen();
+    bool IsClosed() const;
+
+    size_t SlotCount() const { return slots_.size(); }
+    NaluEventQueueStats Stats() const;
+
+private:
+    std::vector<NaluEvent> slots_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable ready_;
+    std::vector<int> free_;
+    std::vector<int> queued_;          // ring of slot indices, oldest at queued_head_
+    size_t queued_head_ = 0;
+    size_t queued_count_ = 0;
+    bool closed_ = false;
+    bool waiting_ = false;
+    NaluEventQueueStats stats_;
+};
+
+#endif // NALU_EVENT_QUEUE_H
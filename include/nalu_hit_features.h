@@ -0,0 +1,60 @@
+#ifndef NALU_HIT_FEATURES_H
+#define NALU_HIT_FEATURES_H
+
+#include <array>
+#include <cstdint>
+#include "nalu_board_model.h"
+#include "nalu_event.h"
+
+// Per-channel pulse features of one event. A channel with several windows
+// reports the largest amplitude; its baseline comes from its first window.
+struct NaluHitFeatures {
+    uint64_t channel_mask = 0;           // channels with at least one window
+    uint64_t hit_mask = 0;               // channels whose amplitude reached the threshold
+    std::array<uint16_t, kNaluMaxChannels> baseline{};
+    std::array<uint16_t, kNaluMaxChannels> amplitude{};   // largest |sample - baseline|
+};
+
+// One pass over the samples; only the channels present in the event are written
+inline void NaluExtractHitFeatures(const NaluEvent& event, int baseline_samples, int hit_threshold,
+                                   NaluHitFeatures& features) {
+    features.channel_mask = 0;
+    features.hit_mask = 0;
+    for (const NaluEventWindow& window : event.windows) {
+        if (window.sample_count == 0 || window.channel >= kNaluMaxChannels) {
+            continue;
+        }
+        const uint16_t* samples = event.samples.data() + window.offset;
+        uint64_t bit = 1ULL << window.channel;
+
+        int lowest = samples[0];
+        int highest = samples[0];
+        for (uint16_t i = 1; i < window.sample_count; ++i) {
+            lowest = samples[i] < lowest ? samples[i] : lowest;
+            highest = samples[i] > highest ? samples[i] : highest;
+        }
+
+        if (!(features.channel_mask & bit)) {
+            int count = baseline_samples < window.sample_count ? baseline_samples : window.sample_count;
+            count = count > 0 ? count : 1;
+            int sum = 0;
+            for (int i = 0; i < count; ++i) {
+                sum += samples[i];
+            }
+            features.baseline[window.channel] = static_cast<uint16_t>(sum / count);
+            features.amplitude[window.channel] = 0;
+            features.channel_mask |= bit;
+        }
+
+        int baseline = features.baseline[window.channel];
+        int amplitude = highest - baseline > baseline - lowest ? highest - baseline : baseline - lowest;
+        if (amplitude > features.amplitude[window.channel]) {
+            features.amplitude[window.channel] = static_cast<uint16_t>(amplitude);
+        }
+        if (amplitude >= hit_threshold) {
+            features.hit_mask |= bit;
+        }
+    }
+}
+
+#endif // NALU_HIT_FEATURES_H
@@ -0,0 +1,77 @@
+#ifndef NALU_LATENCY_H
+#define NALU_LATENCY_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Percentiles of one latency, in nanoseconds. Values are resolved to within
+// 2 % (HDR-style log-linear buckets, 32 per power of two).
+struct NaluLatencySummary {
+    uint64_t count = 0;
+    double mean_ns = 0.0;
+    uint64_t min_ns = 0;
+    uint64_t p50_ns = 0;
+    uint64_t p99_ns = 0;
+    uint64_t p999_ns = 0;
+    uint64_t max_ns = 0;
+
+    std::string ToString() const;
+};
+
+// Where an event's time goes between its first packet arriving and the event
+// sink returning
+struct NaluLatencyStats {
+    NaluLatencySummary build;      // first packet -> event built (all packets in, or given up on)
+    NaluLatencySummary process;    // built -> handed to the sink (merge and filter queues)
+    NaluLatencySummary sink;       // in the event sink (export, e.g. into the Python queue)
+    NaluLatencySummary total;      // first packet -> sink returned
+};
+
+// Latency histograms for the events leaving a pipeline. Each producer (thread
+// calling the event sink) writes its own histograms with relaxed
+// single-writer stores, so Record() costs a few increments and takes no lock.
+// Stats() may be called from any thread at any time.
+class NaluLatencyTracker {
+public:
+    explicit NaluLatencyTracker(int producers);
+
+    // Monotonic times of one event; stages with a zero time are skipped
+    void Record(int producer, uint64_t first_rx_ns, uint64_t built_ns, uint64_t processed_ns, uint64_t done_ns);
+
+    NaluLatencyStats Stats() const;
+
+    static constexpr int kSubBucketBits = 5;
+    static constexpr int kMaxValueBits = 40;   // ~18 minutes; longer is clamped
+    static constexpr int kBuckets = (kMaxValueBits - kSubBucketBits + 1) << kSubBucketBits;
+
+    // Bucket of `value_ns`, and the value a bucket reports (its midpoint)
+    static int Bucket(uint64_t value_ns);
+    static uint64_t BucketValue(int bucket);
+
+private:
+    struct Histogram {
+        std::array<std::atomic<uint64_t>, kBuckets> counts{};
+        std::atomic<uint64_t> sum{0};
+        std::atomic<uint64_t> min{UINT64_MAX};
+        std::atomic<uint64_t> max{0};
+
+        void Record(uint64_t value_ns);
+    };
+
+    struct alignas(64) Producer {
+        Histogram build;
+        Histogram process;
+        Histogram sink;
+        Histogram total;
+    };
+
+    static NaluLatencySummary Summarize(const std::vector<const Histogram*>& histograms);
+
+    std::vector<std::unique_ptr<Producer>> producers_;
+};
+
+#endif // NALU_LATENCY_H
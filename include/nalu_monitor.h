@@ -0,0 +1,93 @@
+#ifndef NALU_MONITOR_H
+#define NALU_MONITOR_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <vector>
+#include "nalu_baseline_equalizer.h"
+#include "nalu_board_controller_params.h"
+#include "nalu_event.h"
+#include "nalu_hit_features.h"
+
+struct NaluChannelMonitor {
+    uint64_t events = 0;                 // sampled events with this channel
+    uint64_t hits = 0;                   // ... with amplitude >= hit_threshold
+    double hit_rate_hz = 0.0;            // estimated for all events, not just sampled ones
+    uint64_t baseline_sum = 0;
+    double baseline_mean = 0.0;
+    std::vector<uint64_t> amplitude;     // NaluMonitorSnapshot::bins each
+    std::vector<uint64_t> baseline;
+};
+
+struct NaluMonitorSnapshot {
+    uint64_t events_seen = 0;
+    uint64_t events_sampled = 0;
+    uint64_t events_over_budget = 0;     // prescaled in, but over max_events_per_second
+    double elapsed_s = 0.0;              // since the monitor started
+    int bins = 0;
+    int amplitude_max = 0;
+    int baseline_max = 0;
+    std::map<int, NaluChannelMonitor> channels;   // channels seen, all boards together
+};
+
+// Prescaled monitoring tap. Each producer (receive queue) fills its own
+// accumulator with relaxed single-writer stores, so Observe() takes no lock,
+// never waits and costs the data path one counter increment for events it
+// does not sample. Snapshot() merges the accumulators and may be called from
+// any thread at any time.
+class NaluMonitor {
+public:
+    NaluMonitor(const NaluMonitorParams& params, int producers);
+
+    // Called by `producer` for every event, before the event is passed on
+    void Observe(int producer, const NaluEvent& event);
+
+    NaluMonitorSnapshot Snapshot() const;
+
+private:
+    struct alignas(64) Accumulator {
+        // Producer-only
+        uint64_t countdown = 0;
+        uint64_t budget_window_ns = 0;
+        int budget_used = 0;
+        NaluHitFeatures features;
+
+        std::atomic<uint64_t> events_seen{0};
+        std::atomic<uint64_t> events_sampled{0};
+        std::atomic<uint64_t> events_over_budget{0};
+        std::array<std::atomic<uint64_t>, kNaluMaxChannels> channel_events{};
+        std::array<std::atomic<uint64_t>, kNaluMaxChannels> hits{};
+        std::array<std::atomic<uint64_t>, kNaluMaxChannels> baseline_sum{};
+        std::unique_ptr<std::atomic<uint32_t>[]> amplitude;   // [channel * bins + bin]
+        std::unique_ptr<std::atomic<uint32_t>[]> baseline;
+    };
+
+    int Bin(int value, int max) const;
+
+    NaluMonitorParams params_;
+    std::vector<std::unique_ptr<Accumulator>> accumulators_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+// NaluBaselineSource on top of a running monitor: waits for enough freshly
+// sampled events of every requested channel and averages their baselines.
+// `snapshot` is usually NaluBoardController::monitor_snapshot.
+class NaluMonitorBaselineSource : public NaluBaselineSource {
+public:
+    explicit NaluMonitorBaselineSource(std::function<NaluMonitorSnapshot()> snapshot, int min_events = 50,
+                                       std::chrono::milliseconds timeout = std::chrono::milliseconds(2000));
+
+    std::map<int, double> MeasureBaselines(const std::vector<int>& channels) override;
+
+private:
+    std::function<NaluMonitorSnapshot()> snapshot_;
+    int min_events_;
+    std::chrono::milliseconds timeout_;
+};
+
+#endif // NALU_MONITOR_H
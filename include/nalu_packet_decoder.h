@@ -0,0 +1,65 @@
+#ifndef NALU_PACKET_DECODER_H
+#define NALU_PACKET_DECODER_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Flags of a decoded packet header
+constexpr uint8_t kNaluPacketFirst = 0x01;
+constexpr uint8_t kNaluPacketLast = 0x02;
+
+// What the event builder needs from one datagram of the event stream,
+// whatever its wire format
+struct NaluPacketHeader {
+    uint8_t board_id = 0;
+    uint8_t flags = 0;
+    uint32_t packet_seq = 0;      // per-board counter, +1 for every packet sent
+    uint32_t event_number = 0;    // per-board counter, +1 for every event
+    uint16_t block_count = 0;     // window blocks in this packet
+    uint16_t packet_index = 0;    // position of this packet within its event
+    uint64_t timestamp = 0;       // board clock of the event's trigger
+
+    bool IsLast() const { return (flags & kNaluPacketLast) != 0; }
+};
+
+// One window block inside a packet. `samples` points into the packet, holds
+// sample_count little-endian u16 and is not aligned; read it with
+// NaluLoadU16 or memcpy.
+struct NaluWindowBlock {
+    uint8_t channel = 0;
+    uint8_t window = 0;
+    uint16_t sample_count = 0;
+    const uint8_t* samples = nullptr;
+};
+
+// Receives the window blocks of one packet from NaluPacketDecoder
+class NaluWindowBlockVisitor {
+public:
+    // False stops the walk over the packet's blocks
+    virtual bool Visit(const NaluWindowBlock& block) = 0;
+
+protected:
+    ~NaluWindowBlockVisitor() = default;
+};
+
+// Decodes the board's event stream for NaluEventBuilder: the seam between a
+// wire format and everything after it. NaluSimulatorPacketDecoder
+// (nalu_packet_format.h) decodes the placeholder framing that
+// NaluBoardSimulator emits and is the default; a real board's format plugs
+// in here (NaluCapturePipeline::SetPacketDecoder). Called concurrently from
+// every receive thread, so implementations must not keep per-packet state.
+class NaluPacketDecoder {
+public:
+    virtual ~NaluPacketDecoder() = default;
+
+    // False when the datagram is not a packet of this format
+    virtual bool ParseHeader(const uint8_t* data, size_t size, NaluPacketHeader& header) const = 0;
+
+    // Hand the packet's window blocks, pointing into `data`, to `visitor`
+    // in order, without copying, until the visitor stops. False when a
+    // block runs past the end of the packet; the blocks before it have been
+    // visited.
+    virtual bool VisitBlocks(const uint8_t* data, size_t size, NaluWindowBlockVisitor& visitor) const = 0;
+};
+
+#endif // NALU_PACKET_DECODER_H
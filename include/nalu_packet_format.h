@@ -0,0 +1,155 @@
+#ifndef NALU_PACKET_FORMAT_H
+#define NALU_PACKET_FORMAT_H
+
+#include <cstddef>
+#include <cstdint>
+#include "nalu_packet_decoder.h"
+
+// PLACEHOLDER framing of the event stream, emitted only by
+// NaluBoardSimulator (and the benchmark streams). It is not the format of
+// real boards, which this library does not decode yet; a decoder for it
+// belongs behind NaluPacketDecoder, next to NaluSimulatorPacketDecoder
+// below. All fields are little-endian.
+//
+//   Packet header (24 bytes)
+//     u16 magic            kNaluPacketMagic
+//     u8  board_id
+//     u8  flags            kNaluPacketFirst / kNaluPacketLast
+//     u32 packet_seq       per-board counter, +1 for every packet sent
+//     u32 event_number     per-board counter, +1 for every event
+//     u16 block_count      window blocks in this packet
+//     u16 packet_index     position of this packet within its event
+//     u64 timestamp        board clock of the event's trigger
+//
+//   followed by block_count window blocks
+//     u8  channel
+//     u8  window
+//     u16 sample_count
+//     u16 samples[sample_count]
+//
+// An event is the packets with indexes 0..N-1, the last one flagged
+// kNaluPacketLast, so its size is only known once that packet arrives.
+constexpr uint16_t kNaluPacketMagic = 0x4E4C;  // "NL"
+constexpr size_t kNaluPacketHeaderBytes = 24;
+constexpr size_t kNaluWindowHeaderBytes = 4;
+
+inline uint16_t NaluLoadU16(const uint8_t* data) {
+    return static_cast<uint16_t>(data[0] | (data[1] << 8));
+}
+
+inline uint32_t NaluLoadU32(const uint8_t* data) {
+    return static_cast<uint32_t>(data[0]) | (static_cast<uint32_t>(data[1]) << 8) |
+           (static_cast<uint32_t>(data[2]) << 16) | (static_cast<uint32_t>(data[3]) << 24);
+}
+
+inline uint64_t NaluLoadU64(const uint8_t* data) {
+    return static_cast<uint64_t>(NaluLoadU32(data)) | (static_cast<uint64_t>(NaluLoadU32(data + 4)) << 32);
+}
+
+inline void NaluStoreU16(uint8_t* data, uint16_t value) {
+    data[0] = static_cast<uint8_t>(value);
+    data[1] = static_cast<uint8_t>(value >> 8);
+}
+
+inline void NaluStoreU32(uint8_t* data, uint32_t value) {
+    NaluStoreU16(data, static_cast<uint16_t>(value));
+    NaluStoreU16(data + 2, static_cast<uint16_t>(value >> 16));
+}
+
+inline void NaluStoreU64(uint8_t* data, uint64_t value) {
+    NaluStoreU32(data, static_cast<uint32_t>(value));
+    NaluStoreU32(data + 4, static_cast<uint32_t>(value >> 32));
+}
+
+// False when the datagram is too short or has the wrong magic
+inline bool NaluParsePacketHeader(const uint8_t* data, size_t size, NaluPacketHeader& header) {
+    if (size < kNaluPacketHeaderBytes || NaluLoadU16(data) != kNaluPacketMagic) {
+        return false;
+    }
+    header.board_id = data[2];
+    header.flags = data[3];
+    header.packet_seq = NaluLoadU32(data + 4);
+    header.event_number = NaluLoadU32(data + 8);
+    header.block_count = NaluLoadU16(data + 12);
+    header.packet_index = NaluLoadU16(data + 14);
+    header.timestamp = NaluLoadU64(data + 16);
+    return true;
+}
+
+inline void NaluWritePacketHeader(uint8_t* data, const NaluPacketHeader& header) {
+    NaluStoreU16(data, kNaluPacketMagic);
+    data[2] = header.board_id;
+    data[3] = header.flags;
+    NaluStoreU32(data + 4, header.packet_seq);
+    NaluStoreU32(data + 8, header.event_number);
+    NaluStoreU16(data + 12, header.block_count);
+    NaluStoreU16(data + 14, header.packet_index);
+    NaluStoreU64(data + 16, header.timestamp);
+}
+
+// Walks the window blocks of one packet without copying:
+//
+//   NaluWindowBlockReader reader(data, size);
+//   NaluWindowBlock block;
+//   while (reader.Next(block)) { ... }
+//   if (!reader.Ok()) { /* truncated packet */ }
+class NaluWindowBlockReader {
+public:
+    NaluWindowBlockReader(const uint8_t* packet, size_t size)
+        : cursor_(packet + kNaluPacketHeaderBytes),
+          end_(packet + size),
+          remaining_(size >= kNaluPacketHeaderBytes ? NaluLoadU16(packet + 12) : 0),
+          ok_(size >= kNaluPacketHeaderBytes) {}
+
+    bool Next(NaluWindowBlock& block) {
+        if (remaining_ == 0 || !ok_) {
+            return false;
+        }
+        if (static_cast<size_t>(end_ - cursor_) < kNaluWindowHeaderBytes) {
+            ok_ = false;
+            return false;
+        }
+        block.channel = cursor_[0];
+        block.window = cursor_[1];
+        block.sample_count = NaluLoadU16(cursor_ + 2);
+        size_t sample_bytes = static_cast<size_t>(block.sample_count) * sizeof(uint16_t);
+        if (static_cast<size_t>(end_ - cursor_) - kNaluWindowHeaderBytes < sample_bytes) {
+            ok_ = false;
+            return false;
+        }
+        block.samples = cursor_ + kNaluWindowHeaderBytes;
+        cursor_ += kNaluWindowHeaderBytes + sample_bytes;
+        remaining_--;
+        return true;
+    }
+
+    // False when a block ran past the end of the packet
+    bool Ok() const { return ok_; }
+
+private:
+    const uint8_t* cursor_;
+    const uint8_t* end_;
+    uint16_t remaining_;
+    bool ok_;
+};
+
+// NaluPacketDecoder for the placeholder framing above
+class NaluSimulatorPacketDecoder : public NaluPacketDecoder {
+public:
+    bool ParseHeader(const uint8_t* data, size_t size, NaluPacketHeader& header) const override {
+        return NaluParsePacketHeader(data, size, header);
+    }
+
+    bool VisitBlocks(const uint8_t* data, size_t size, NaluWindowBlockVisitor& visitor) const override {
+        NaluWindowBlockReader reader(data, size);
+        NaluWindowBlock block;
+        while (reader.Next(block)) {
+            if (!visitor.Visit(block)) {
+                return true;
+            }
+        }
+        return reader.Ok();
+    }
+};
+
+#endif // NALU_PACKET_FORMAT_H
@@ -0,0 +1,68 @@
+#ifndef NALU_PACKET_MMAP_RECEIVER_H
+#define NALU_PACKET_MMAP_RECEIVER_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "nalu_receiver.h"
+
+// AF_PACKET receiver reading a memory-mapped TPACKET_V3 ring. A BPF filter
+// keeps only UDP datagrams for the target address and the queue's port, and
+// the sink gets UDP payloads pointing straight into the ring blocks, which
+// are handed back to the kernel once every packet in them was delivered.
+// Several queues on one port form a PACKET_FANOUT group hashed by flow, the
+// packet-socket equivalent of SO_REUSEPORT. Needs CAP_NET_RAW.
+//
+// The ring is sized by socket_buffer_bytes and allocated by the queue's
+// thread after pinning, so it is local to that core's node (the kernel
+// allocates ring blocks itself, so huge_pages does not apply). IP fragments
+// are not reassembled: the link MTU must fit the board's datagrams. A UDP
+// socket with a drop-all filter is bound on each port so the kernel does not
+// answer the stream with ICMP port-unreachable messages.
+class NaluPacketMmapReceiver : public NaluReceiver {
+public:
+    NaluPacketMmapReceiver(const NaluReceiverParams& params, const std::string& target_ip_port,
+                           NaluCaptureCounters* counters);
+    ~NaluPacketMmapReceiver() override;
+
+    void Start(NaluPacketSink sink) override;
+    void Stop() override;
+    bool IsRunning() const override { return running_.load(); }
+
+    int QueueCount() const override { return static_cast<int>(queues_.size()); }
+    std::vector<NaluReceiverQueueStats> Stats() const override;
+
+private:
+    struct Queue {
+        int index = 0;
+        int port = 0;
+        int cpu = -1;
+        int fd = -1;
+        unsigned char* ring = nullptr;
+        size_t ring_bytes = 0;
+        NaluReceiverQueueCounters counters;
+        std::thread thread;
+    };
+
+    void OpenRing(Queue& queue, bool fanout) const;
+    void CloseQueue(Queue& queue) const;
+    void OpenPortGuards();
+    void CloseAll();
+    void ReceiveLoop(Queue& queue);
+
+    NaluReceiverParams params_;
+    std::string bind_ip_;
+    uint32_t bind_address_ = 0;   // network byte order, 0 for any
+    int interface_index_ = 0;     // 0 for all interfaces
+    int fanout_group_ = 0;
+    NaluCaptureCounters* capture_counters_;
+    NaluPacketSink sink_;
+
+    std::vector<std::unique_ptr<Queue>> queues_;
+    std::vector<int> port_guards_;
+    std::atomic<bool> running_{false};
+};
+
+#endif // NALU_PACKET_MMAP_RECEIVER_H
@@ -0,0 +1,26 @@
+#ifndef NALU_PARAMS_VALIDATOR_H
+#define NALU_PARAMS_VALIDATOR_H
+
+#include <string>
+#include <vector>
+#include "nalu_board_controller_params.h"
+#include "nalu_board_model.h"
+
+// Pure C++ checks of board and capture parameters, run before anything is
+// sent to naludaq so a bad configuration fails immediately instead of after
+// the board has been initialized.
+class NaluParamsValidator {
+public:
+    // Every problem found, as "field: message" strings (empty when valid)
+    static std::vector<std::string> CheckBoardParams(const NaluBoardParams& params);
+    static std::vector<std::string> CheckCaptureParams(const NaluCaptureParams& params);
+    // Also checks channels, windows and register values against the board model
+    static std::vector<std::string> CheckCaptureParams(const NaluCaptureParams& params, const NaluBoardModel& model);
+
+    // Throw std::invalid_argument listing every problem found
+    static void ValidateBoardParams(const NaluBoardParams& params);
+    static void ValidateCaptureParams(const NaluCaptureParams& params);
+    static void ValidateCaptureParams(const NaluCaptureParams& params, const NaluBoardModel& model);
+};
+
+#endif // NALU_PARAMS_VALIDATOR_H
@@ -0,0 +1,91 @@
+#ifndef NALU_RECEIVER_H
+#define NALU_RECEIVER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include "nalu_board_controller_params.h"
+#include "nalu_capture_counters.h"
+
+// Called on a receive thread for every datagram. `data` is only valid for the
+// duration of the call; `rx_ns` is CLOCK_MONOTONIC at reception (per batch).
+// Each queue calls from its own thread, so per-queue state needs no locking.
+// An idle queue calls it with size 0 (data nullptr) about every 100 ms so
+// per-queue state can still time out.
+using NaluPacketSink = std::function<void(int queue, const uint8_t* data, size_t size, uint64_t rx_ns)>;
+
+// Point-in-time statistics of one receive queue
+struct NaluReceiverQueueStats {
+    int queue = 0;
+    int port = 0;
+    int cpu = -1;                 // pinned core, -1 when unpinned
+    int numa_node = -1;           // node the queue's buffers were placed on
+    bool huge_pages = false;      // buffers backed by reserved huge pages
+    uint64_t packets = 0;         // delivered to the sink: truncated datagrams are not counted
+    uint64_t bytes = 0;
+    uint64_t batches = 0;         // receive calls that returned data
+    uint64_t max_batch = 0;       // most datagrams returned by one call
+    uint64_t truncated = 0;       // datagrams larger than max_packet_bytes, dropped
+    uint64_t kernel_drops = 0;    // dropped by the kernel before reception, where reported
+    uint64_t errors = 0;          // receive errors and sink exceptions
+
+    double PacketsPerBatch() const {
+        return batches > 0 ? static_cast<double>(packets) / batches : 0.0;
+    }
+};
+
+// Live counters behind NaluReceiverQueueStats. Only the queue's own thread
+// writes them (plain relaxed stores of thread-local totals), readers take
+// snapshots from any thread.
+struct alignas(64) NaluReceiverQueueCounters {
+    std::atomic<uint64_t> packets{0};
+    std::atomic<uint64_t> bytes{0};
+    std::atomic<uint64_t> batches{0};
+    std::atomic<uint64_t> max_batch{0};
+    std::atomic<uint64_t> truncated{0};
+    std::atomic<uint64_t> kernel_drops{0};
+    std::atomic<uint64_t> errors{0};
+    std::atomic<int> cpu{-1};
+    std::atomic<int> numa_node{-1};
+    std::atomic<bool> huge_pages{false};
+
+    void SnapshotInto(NaluReceiverQueueStats& stats) const;
+};
+
+// Receives the board's UDP stream on one or more queues, each served by its
+// own thread, and hands every datagram to the sink.
+class NaluReceiver {
+public:
+    virtual ~NaluReceiver() = default;
+
+    // Open the queues and start their threads. Throws std::runtime_error when
+    // a socket cannot be set up; nothing is left running in that case.
+    virtual void Start(NaluPacketSink sink) = 0;
+    virtual void Stop() = 0;
+    virtual bool IsRunning() const = 0;
+
+    virtual int QueueCount() const = 0;
+    virtual std::vector<NaluReceiverQueueStats> Stats() const = 0;
+
+    // Receiver for params.mode, nullptr for mode "none". Received packets and
+    // bytes are also recorded into `counters` when given.
+    static std::unique_ptr<NaluReceiver> Create(const NaluReceiverParams& params, const std::string& target_ip_port,
+                                                NaluCaptureCounters* counters);
+
+protected:
+    // Port of every queue: params.ports, or params.queues copies of the target port
+    static std::vector<int> QueuePorts(const NaluReceiverParams& params, int target_port);
+
+    // Pin the calling receive thread to `cpu` (when >= 0) and record the
+    // placement. Call before allocating the queue's buffers.
+    static void PlaceReceiveThread(int queue, int cpu, NaluReceiverQueueCounters& counters);
+};
+
+// CLOCK_MONOTONIC in nanoseconds
+uint64_t NaluMonotonicNs();
+
+#endif // NALU_RECEIVER_H
@@ -0,0 +1,70 @@
+#ifndef NALU_REPLAY_RECEIVER_H
+#define NALU_REPLAY_RECEIVER_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "nalu_capture_file.h"
+#include "nalu_receiver.h"
+
+// Plays a recording made by NaluCaptureRecorder back into the sink as if it
+// came off the wire: every datagram goes to the queue it was received on, in
+// the recorded order. One thread reads the file and serves all queues, so the
+// one-thread-per-queue promise of NaluPacketSink holds.
+//
+// At replay_speed > 0 datagrams are paced to their recorded spacing divided
+// by the speed, and rx_ns is the replay time. At speed 0 they go as fast as
+// the pipeline takes them and rx_ns is the recorded time moved to the start
+// of the replay, so event timeouts still see the original spacing. Either
+// way times count from the start of the recording. Once the last loop is
+// done, or a pass found nothing to play, the queues get idle ticks until
+// Stop().
+class NaluReplayReceiver : public NaluReceiver {
+public:
+    // Opens the file and reads its header; throws std::runtime_error
+    NaluReplayReceiver(const NaluReceiverParams& params, NaluCaptureCounters* counters);
+    ~NaluReplayReceiver() override;
+
+    void Start(NaluPacketSink sink) override;
+    void Stop() override;
+    bool IsRunning() const override { return running_.load(); }
+
+    int QueueCount() const override { return static_cast<int>(queues_.size()); }
+    std::vector<NaluReceiverQueueStats> Stats() const override;
+
+    // True once every loop has been played, or the replay ended early on a
+    // file it cannot read
+    bool Finished() const { return finished_.load(); }
+
+private:
+    struct Queue {
+        NaluReceiverQueueCounters counters;
+        uint64_t packets = 0;
+        uint64_t bytes = 0;
+        uint64_t errors = 0;
+    };
+
+    enum class PlayResult { END, STOPPED, CORRUPT };
+
+    void ReplayLoop();
+    uint64_t ReplayedPackets() const;   // replay thread only
+    // One pass over the file
+    PlayResult PlayOnce(std::FILE* file, bool& sink_error_logged);
+    void Dispatch(int queue, const uint8_t* data, size_t size, uint64_t rx_ns, bool& sink_error_logged);
+
+    NaluReceiverParams params_;
+    NaluCaptureCounters* capture_counters_;
+    NaluPacketSink sink_;
+    NaluCaptureFileHeader header_;
+
+    std::vector<std::unique_ptr<Queue>> queues_;
+    uint64_t last_rx_ns_ = 0;          // replay thread only
+    std::atomic<bool> running_{false};
+    std::atomic<bool> finished_{false};
+    std::thread thread_;
+};
+
+#endif // NALU_REPLAY_RECEIVER_H
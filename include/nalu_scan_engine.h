@@ -0,0 +1,84 @@
+#ifndef NALU_SCAN_ENGINE_H
+#define NALU_SCAN_ENGINE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <utility>
+#include <vector>
+#include "nalu_board_configurator.h"
+#include "nalu_board_controller_params.h"
+#include "nalu_board_state.h"
+#include "nalu_capture_counters.h"
+
+// One row of the scan result table
+struct NaluScanPoint {
+    int step = 0;
+    int channel = 0;
+    int value = 0;
+    uint64_t events = 0;         // all events during the step
+    uint64_t channel_hits = 0;   // events with data on this channel
+    double event_rate = 0.0;     // Hz
+    double channel_rate = 0.0;   // Hz
+    std::chrono::nanoseconds live_time{0};
+};
+
+struct NaluScanResult {
+    std::vector<NaluScanPoint> points;
+    int steps = 0;
+    bool cancelled = false;
+    std::chrono::nanoseconds total_time{0};
+    std::chrono::nanoseconds switch_time{0};  // counting stopped -> next step counting
+
+    double StepsPerSecond() const {
+        double seconds = std::chrono::duration<double>(total_time).count();
+        return seconds > 0.0 ? steps / seconds : 0.0;
+    }
+};
+
+// Runs threshold/DAC scans on a capture that is already running. Steps are
+// switched with hot updates (only changed registers are written, readout keeps
+// running), and the step after the current one is prepared, and the previous
+// one tallied, while the current step is counting, so the dead time between
+// steps is just the register writes plus settle_ms.
+class NaluScanEngine {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    NaluScanEngine(NaluBoardState* state, NaluBoardConfigurator* configurator,
+                   const NaluCaptureCounters* counters);
+
+    // `board_lock`, when given, is held by the caller around board access; it
+    // is released while a step counts and while settling, so other calls get
+    // through between the step switches. Returns with it held.
+    NaluScanResult Run(const NaluScanPlan& plan, std::unique_lock<std::mutex>* board_lock = nullptr);
+
+    // Stop a running scan; the step counting is cut short and still reported.
+    // Safe from any thread.
+    void Cancel() { cancel_requested_.store(true); }
+
+private:
+    // Channel/value pairs measured in one step
+    using StepValues = std::vector<std::pair<int, int>>;
+
+    void Validate(const NaluScanPlan& plan) const;
+    int StepCount(const NaluScanPlan& plan) const;
+    StepValues ValuesForStep(const NaluScanPlan& plan, int step) const;
+    NaluHotUpdate UpdateForStep(const NaluScanPlan& plan, const StepValues& values) const;
+    int CurrentValue(const NaluScanPlan& plan, int channel) const;
+    void Tally(const StepValues& values, int step,
+               const NaluCaptureCountersSnapshot& begin, const NaluCaptureCountersSnapshot& end,
+               std::chrono::nanoseconds live_time, NaluScanResult& result) const;
+    bool WaitUntil(Clock::time_point deadline, std::unique_lock<std::mutex>* board_lock);
+
+    NaluBoardState* state_;
+    NaluBoardConfigurator* configurator_;
+    const NaluCaptureCounters* counters_;
+    std::atomic<bool> cancel_requested_{false};
+
+    // Values of the scanned channels before the scan started
+    std::vector<std::pair<int, int>> original_values_;
+};
+
+#endif // NALU_SCAN_ENGINE_H
@@ -0,0 +1,80 @@
+#ifndef NALU_SEQUENCE_WINDOW_H
+#define NALU_SEQUENCE_WINDOW_H
+
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+
+// Classifies a stream of 32-bit sequence numbers (wrapping) against the
+// highest one seen so far, remembering the last kSpan numbers so a late
+// arrival that fills an earlier gap can be told apart from a duplicate.
+class NaluSequenceWindow {
+public:
+    static constexpr uint32_t kSpan = 1024;
+    // A jump this large is a counter reset (board restarted), not loss
+    static constexpr uint32_t kResyncDistance = 1u << 16;
+
+    enum class Result {
+        FIRST,      // first number seen (or after Reset)
+        IN_ORDER,   // highest + 1
+        GAP,        // ahead of highest + 1; Missed() numbers were skipped
+        LATE,       // behind highest and not seen before: fills an earlier gap
+        DUPLICATE,  // seen before, or too old to tell
+        RESYNC      // implausible jump; the window restarted from this number
+    };
+
+    Result Observe(uint32_t value) {
+        missed_ = 0;
+        if (!started_) {
+            Restart(value);
+            return Result::FIRST;
+        }
+        int64_t distance = static_cast<int32_t>(value - highest_);
+        if (distance > static_cast<int64_t>(kResyncDistance) || distance < -static_cast<int64_t>(kResyncDistance)) {
+            Restart(value);
+            return Result::RESYNC;
+        }
+        if (distance > 0) {
+            missed_ = static_cast<uint32_t>(distance - 1);
+            if (missed_ >= kSpan) {
+                seen_.reset();
+            } else {
+                for (uint32_t i = 1; i < static_cast<uint32_t>(distance); ++i) {
+                    seen_.reset((highest_ + i) % kSpan);
+                }
+            }
+            highest_ = value;
+            seen_.set(value % kSpan);
+            return missed_ == 0 ? Result::IN_ORDER : Result::GAP;
+        }
+        if (distance == 0 || -distance >= static_cast<int64_t>(kSpan) || seen_.test(value % kSpan)) {
+            return Result::DUPLICATE;
+        }
+        seen_.set(value % kSpan);
+        return Result::LATE;
+    }
+
+    // Numbers skipped by the last GAP
+    uint32_t Missed() const { return missed_; }
+    uint32_t Highest() const { return highest_; }
+
+    void Reset() {
+        started_ = false;
+        seen_.reset();
+    }
+
+private:
+    void Restart(uint32_t value) {
+        started_ = true;
+        seen_.reset();
+        highest_ = value;
+        seen_.set(value % kSpan);
+    }
+
+    std::bitset<kSpan> seen_;
+    uint32_t highest_ = 0;
+    uint32_t missed_ = 0;
+    bool started_ = false;
+};
+
+#endif // NALU_SEQUENCE_WINDOW_H
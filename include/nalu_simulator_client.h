@@ -0,0 +1,49 @@
+#ifndef NALU_SIMULATOR_CLIENT_H
+#define NALU_SIMULATOR_CLIENT_H
+
+#include <string>
+#include <vector>
+#include "nalu_board_backend.h"
+#include "nalu_board_simulator.h"
+
+// Board backend for a nalu_board_simulator process: every call is sent as a
+// command over the simulator's UDP text control protocol (see
+// tools/nalu_board_simulator.cpp) and waits for its reply. Lets a
+// NaluBoardController run against a simulator in another process, such as
+// the CTest fixture of cmake/NaluSimulatorFixture.cmake.
+class NaluSimulatorClient : public NaluBoardBackend {
+public:
+    // Throws std::runtime_error when no socket can be opened; the simulator
+    // is first contacted by the first call
+    explicit NaluSimulatorClient(const std::string& control_ip_port, int timeout_ms = 2000);
+    ~NaluSimulatorClient() override;
+
+    NaluSimulatorClient(const NaluSimulatorClient&) = delete;
+    NaluSimulatorClient& operator=(const NaluSimulatorClient&) = delete;
+
+    void InitializeBoard() override;
+    void StartCapture() override;
+    void StopCapture() override;
+
+    void WriteTriggerValues(const std::vector<int>& values) override;
+    void WriteTriggerReferences(int low_reference, int high_reference) override;
+    void WriteTriggerEdge(bool rising_edge) override;
+    void WriteDacValue(int channel, int value) override;
+    void WriteReadoutChannels(const std::vector<int>& channels) override;
+    void WriteReadWindow(int windows, int lookback, int write_after_trig) override;
+    void ConfigureEthernet(const IPAddressInfo& target) override;
+
+    // The simulator's counters ("status")
+    NaluSimulatorStats Status();
+
+    // Send one command and return what follows "ok" in the reply. Throws
+    // std::runtime_error for an "error" reply or when none arrives in time.
+    std::string Command(const std::string& command);
+
+private:
+    std::string control_;
+    int timeout_ms_;
+    int fd_ = -1;
+};
+
+#endif // NALU_SIMULATOR_CLIENT_H
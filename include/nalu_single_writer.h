@@ -0,0 +1,14 @@
+#ifndef NALU_SINGLE_WRITER_H
+#define NALU_SINGLE_WRITER_H
+
+#include <atomic>
+
+// Adds to a counter only one thread ever writes: a plain load and store, no
+// locked read-modify-write. Readers on other threads see a value that may be
+// an increment or two behind.
+template <typename T>
+inline void NaluBump(std::atomic<T>& counter, typename std::atomic<T>::value_type amount = 1) {
+    counter.store(counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+}
+
+#endif // NALU_SINGLE_WRITER_H
@@ -0,0 +1,54 @@
+#ifndef NALU_SOCKET_RECEIVER_H
+#define NALU_SOCKET_RECEIVER_H
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "nalu_cpu_placement.h"
+#include "nalu_receiver.h"
+
+// UDP socket receiver. Either `queues` sockets share the target port through
+// SO_REUSEPORT (the kernel spreads senders across them by address hash, so
+// one board always lands on the same queue) or there is one socket per
+// configured port, e.g. one per board. Each queue's thread pins itself to its
+// core, then allocates its packet buffers so they land on that core's NUMA
+// node (Start() waits for that and throws if it fails), and drains the socket
+// with recvmmsg in batches.
+class NaluSocketReceiver : public NaluReceiver {
+public:
+    NaluSocketReceiver(const NaluReceiverParams& params, const std::string& target_ip_port,
+                       NaluCaptureCounters* counters);
+    ~NaluSocketReceiver() override;
+
+    void Start(NaluPacketSink sink) override;
+    void Stop() override;
+    bool IsRunning() const override { return running_.load(); }
+
+    int QueueCount() const override { return static_cast<int>(queues_.size()); }
+    std::vector<NaluReceiverQueueStats> Stats() const override;
+
+private:
+    struct Queue {
+        int index = 0;
+        int port = 0;
+        int cpu = -1;
+        int fd = -1;
+        NaluReceiverQueueCounters counters;
+        std::thread thread;
+    };
+
+    int OpenSocket(int port, bool reuse_port) const;
+    void CloseSockets();
+    void ReceiveLoop(Queue& queue, NaluHostBuffer& packets);
+
+    NaluReceiverParams params_;
+    std::string bind_ip_;
+    NaluCaptureCounters* capture_counters_;
+    NaluPacketSink sink_;
+
+    std::vector<std::unique_ptr<Queue>> queues_;
+    std::atomic<bool> running_{false};
+};
+
+#endif // NALU_SOCKET_RECEIVER_H
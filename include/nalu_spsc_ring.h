@@ -0,0 +1,81 @@
+#ifndef NALU_SPSC_RING_H
+#define NALU_SPSC_RING_H
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+// Bounded lock-free queue for exactly one producer thread and one consumer
+// thread. Capacity is rounded up to a power of two. Each side keeps a cached
+// copy of the other side's index so the shared cache line is only read when
+// the ring looks full (producer) or empty (consumer). Values are exchanged
+// with their slot rather than assigned, so storage they own (a vector's
+// capacity, say) is handed across instead of freed: the producer gets back
+// what the consumer popped into, and neither side allocates once warm.
+template <typename T>
+class NaluSpscRing {
+public:
+    explicit NaluSpscRing(size_t capacity) {
+        capacity_ = 2;
+        while (capacity_ < capacity) {
+            capacity_ <<= 1;
+        }
+        mask_ = capacity_ - 1;
+        slots_ = std::make_unique<T[]>(capacity_);
+    }
+
+    NaluSpscRing(const NaluSpscRing&) = delete;
+    NaluSpscRing& operator=(const NaluSpscRing&) = delete;
+
+    // Producer side. False (and `value` untouched) when the ring is full;
+    // otherwise `value` is left with the slot's previous contents.
+    bool TryPush(T&& value) {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - head_cache_ == capacity_) {
+            head_cache_ = head_.load(std::memory_order_acquire);
+            if (tail - head_cache_ == capacity_) {
+                return false;
+            }
+        }
+        using std::swap;
+        swap(slots_[tail & mask_], value);
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side. False when the ring is empty; otherwise what `value` held
+    // stays in the slot for the producer to reuse.
+    bool TryPop(T& value) {
+        size_t head = head_.load(std::memory_order_relaxed);
+        if (head == tail_cache_) {
+            tail_cache_ = tail_.load(std::memory_order_acquire);
+            if (head == tail_cache_) {
+                return false;
+            }
+        }
+        using std::swap;
+        swap(value, slots_[head & mask_]);
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Approximate when called from a third thread
+    size_t Size() const {
+        return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire);
+    }
+
+    size_t Capacity() const { return capacity_; }
+
+private:
+    size_t capacity_;
+    size_t mask_;
+    std::unique_ptr<T[]> slots_;
+
+    alignas(64) std::atomic<size_t> head_{0};   // next slot to pop
+    size_t tail_cache_ = 0;                      // consumer's view of tail_
+    alignas(64) std::atomic<size_t> tail_{0};   // next slot to push
+    size_t head_cache_ = 0;                      // producer's view of head_
+};
+
+#endif // NALU_SPSC_RING_H
@@ -0,0 +1,77 @@
+#ifndef NALU_WAVEFORM_ASSEMBLER_H
+#define NALU_WAVEFORM_ASSEMBLER_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+#include "nalu_event.h"
+#include "nalu_event_builder.h"
+
+// Counters of one or more assemblers
+struct NaluWaveformStats {
+    uint64_t events = 0;
+    uint64_t reordered_events = 0;      // windows had to be moved (not already in time order)
+    uint64_t wrapped_events = 0;        // readout crossed the end of the circular buffer
+    uint64_t filled_windows = 0;        // missing windows zero-filled
+    uint64_t dropped_windows = 0;       // outside the readout window, or duplicated
+
+    void Add(const NaluWaveformStats& other);
+};
+
+// Rearranges an event's windows, which the board sends in circular-buffer
+// order, into one contiguous time-ordered waveform per channel:
+//
+//   samples = channel c0 [oldest window .. newest], c1 [...], ...
+//
+// in ascending channel order, layout.windows * samples_per_window samples
+// each, and the windows list in the same order with the new offsets. The
+// oldest window is the one after the widest gap of the event's window
+// numbers on the circular buffer (layout.buffer_windows), taken over all
+// channels, so a window lost on one channel does not shift the others.
+// Missing windows are zero-filled and left out of the windows list.
+//
+// One assembler per receive queue; Assemble() is called on that thread and
+// reuses its own buffers, swapping them with the event's. Stats() may be
+// called from any thread.
+class NaluWaveformAssembler {
+public:
+    // layout.buffer_windows must be set, and above layout.windows: a readout
+    // of the whole buffer has no gap to find its oldest window by. Throws
+    // std::invalid_argument otherwise.
+    explicit NaluWaveformAssembler(const NaluEventLayout& layout);
+
+    void Assemble(NaluEvent& event);
+
+    NaluWaveformStats Stats() const;
+
+private:
+    // Position in time of every window number for a readout starting at
+    // `oldest`, -1 outside the readout
+    const int16_t* TimeIndexFor(int oldest);
+    int OldestWindow(const NaluEvent& event);
+    // Copy the event's windows to their slots in samples_ and return how
+    // many were placed; kSamples fixes the window size at compile time (0:
+    // samples_per_window)
+    template <int kSamples>
+    size_t PlaceWindows(const NaluEvent& event, int samples_per_window, const int16_t* time_index);
+
+    NaluEventLayout layout_;
+    int buffer_windows_;
+
+    std::vector<uint16_t> samples_;            // swapped with the event's
+    std::vector<NaluEventWindow> windows_;
+    std::vector<uint8_t> filled_;              // per channel and time index
+    std::array<int, kNaluMaxChannels> channel_slot_{};
+    std::array<int16_t, 256> time_index_{};
+    int time_index_oldest_ = -1;
+
+    // Written by the assembling thread only
+    std::atomic<uint64_t> events_{0};
+    std::atomic<uint64_t> reordered_events_{0};
+    std::atomic<uint64_t> wrapped_events_{0};
+    std::atomic<uint64_t> filled_windows_{0};
+    std::atomic<uint64_t> dropped_windows_{0};
+};
+
+#endif // NALU_WAVEFORM_ASSEMBLER_H
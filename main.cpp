@@ -10,6 +10,7 @@
 
 #include "nalu_board_controller.h"
 #include "nalu_board_controller_logger.h"
+#include "nalu_config_file.h"
 
 std::atomic<bool> running(true);
 
@@ -18,7 +19,10 @@ void signal_handler(int signal) {
     running = false;
 }
 
-int main() {
+int main(int argc, char** argv) {
+    // Optional config file (JSON or YAML) with "board" and "capture" sections
+    std::string config_path = argc > 1 ? argv[1] : "";
+
     // Set up logger
     NaluBoardControllerLogger::set_level(NaluBoardControllerLogger::LogLevel::DEBUG);
 
@@ -36,6 +40,13 @@ int main() {
         board_params.host_ip_port = "192.168.1.1:4660";
         board_params.config_file = "";
         board_params.clock_file = "";
+        if (!config_path.empty()) {
+            NaluBoardControllerLogger::info("Loading board parameters from " + config_path);
+            board_params = NaluConfigFile::LoadBoardParams(config_path);
+            // Validate the capture section now so a bad file fails before the
+            // board is initialized; the load below is then served from the cache.
+            NaluConfigFile::LoadCaptureParams(config_path);
+        }
 
         NaluBoardController board_manager(board_params);
         NaluBoardControllerLogger::info("board_manager object created successfully.");
@@ -88,6 +99,11 @@ int main() {
             capture_params.channels[i] = channel_info;
         }
 
+        if (!config_path.empty()) {
+            NaluBoardControllerLogger::info("Loading capture parameters from " + config_path);
+            capture_params = NaluConfigFile::LoadCaptureParams(config_path);
+        }
+
         // Call the new start_capture method using capture_params
         NaluBoardControllerLogger::info("Starting board capture...");
         board_manager.start_capture(capture_params);
@@ -96,6 +112,7 @@ int main() {
         NaluBoardControllerLogger::info("Capture started, hit Control-C to end capture...");
         while (running) {
             std::this_thread::sleep_for(std::chrono::seconds(1));
+            board_manager.service_watchdog();
         }
 
         // Step 4: Stop capture when interrupted
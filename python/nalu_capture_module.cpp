@@ -0,0 +1,425 @@
+// nalu_capture: the host-side capture pipeline as a Python extension module.
+//
+//   capture = nalu_capture.Capture.from_file("capture.yaml")
+//   capture.start()
+//   for event in capture.next_events(64, timeout_ms=100):
+//       event.samples            # uint16 array over the pipeline's own buffer
+//   capture.stop()
+//
+// Built events wait in a NaluEventSlotQueue. An Event leases its slot: the
+// arrays it hands out point into the slot and keep the Event (and with it the
+// lease) alive, so nothing is copied and nothing is overwritten while Python
+// can still see it. The slot goes back to the pipeline when the last
+// reference is gone. Waiting for events, starting and stopping release the GIL,
+// so Capture serialises start, stop and the statistics with a mutex of its own.
+// A wait takes the GIL back every kSignalCheckMs to let Python handle
+// signals, so Ctrl-C interrupts it however long it was asked to be.
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <pybind11/numpy.h>
+#include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+#include "nalu_capture_pipeline.h"
+#include "nalu_config_file.h"
+#include "nalu_event_queue.h"
+
+namespace py = pybind11;
+
+namespace {
+
+constexpr int kSignalCheckMs = 50;
+
+// One leased slot; returned to the queue on destruction
+class EventLease {
+public:
+    EventLease(std::shared_ptr<NaluEventSlotQueue> queue, int index) : queue_(std::move(queue)), index_(index) {}
+    ~EventLease() { queue_->Release(index_); }
+
+    EventLease(const EventLease&) = delete;
+    EventLease& operator=(const EventLease&) = delete;
+
+    const NaluEvent& Event() const { return queue_->Slot(index_); }
+
+private:
+    std::shared_ptr<NaluEventSlotQueue> queue_;
+    int index_;
+};
+
+// Read-only array over `data`, kept valid by `owner`
+template <typename T>
+py::array ReadOnlyView(const T* data, std::vector<py::ssize_t> shape, py::handle owner) {
+    py::array view(py::dtype::of<T>(), std::move(shape), {}, data, owner);
+    view.attr("setflags")(py::arg("write") = false);
+    return view;
+}
+
+py::array WindowView(const EventLease& lease, const NaluEventWindow& window, py::handle owner) {
+    const NaluEvent& event = lease.Event();
+    return ReadOnlyView(event.samples.data() + window.offset, {static_cast<py::ssize_t>(window.sample_count)}, owner);
+}
+
+class Capture {
+public:
+    Capture(const NaluCaptureParams& params, size_t queue_slots)
+        : params_(params), queue_(std::make_shared<NaluEventSlotQueue>(queue_slots)), pipeline_(&counters_) {
+        NaluEventSlotQueue* queue = queue_.get();
+        pipeline_.SetEventSink([queue](NaluEvent&& event) { queue->Push(std::move(event)); });
+    }
+
+    ~Capture() {
+        py::gil_scoped_release release;
+        std::lock_guard<std::mutex> lock(mutex_);
+        pipeline_.Stop();
+        queue_->Close();
+    }
+
+    void Start() {
+        py::gil_scoped_release release;
+        std::lock_guard<std::mutex> lock(mutex_);
+        queue_->Reopen();
+        counters_.Reset();
+        pipeline_.Start(params_, NaluCapturePipeline::LayoutFor(params_));
+    }
+
+    // Events still in the pipeline are flushed into the queue and can be
+    // read after stop() returns
+    void Stop() {
+        py::gil_scoped_release release;
+        std::lock_guard<std::mutex> lock(mutex_);
+        pipeline_.Stop();
+        queue_->Close();
+    }
+
+    // Read one of the pipeline's statistics (a const getter such as
+    // NaluCapturePipeline::MergeStats) while no other thread starts or stops it
+    template <typename Stats>
+    Stats PipelineStats(Stats (NaluCapturePipeline::*read)() const) const {
+        py::gil_scoped_release release;
+        std::lock_guard<std::mutex> lock(mutex_);
+        return (pipeline_.*read)();
+    }
+
+    std::shared_ptr<EventLease> Next(int timeout_ms) {
+        int index = PopInterruptibly(timeout_ms);
+        if (index < 0) {
+            return nullptr;
+        }
+        return std::make_shared<EventLease>(queue_, index);
+    }
+
+    // Waits for the first event only, then takes what is already queued
+    std::vector<std::shared_ptr<EventLease>> NextBatch(size_t max_events, int timeout_ms) {
+        std::vector<std::shared_ptr<EventLease>> events;
+        int index = PopInterruptibly(timeout_ms);
+        if (index < 0) {
+            return events;
+        }
+        events.push_back(std::make_shared<EventLease>(queue_, index));
+        py::gil_scoped_release release;
+        while (events.size() < max_events && (index = queue_->Pop(0)) >= 0) {
+            events.push_back(std::make_shared<EventLease>(queue_, index));
+        }
+        return events;
+    }
+
+    const NaluCaptureParams& Params() const { return params_; }
+    NaluEventSlotQueue& Queue() { return *queue_; }
+
+private:
+    // Pop() in slices with the GIL released, raising KeyboardInterrupt (or
+    // whatever a signal handler raised) between them
+    int PopInterruptibly(int timeout_ms) {
+        using Clock = std::chrono::steady_clock;
+        const Clock::time_point deadline = Clock::now() + std::chrono::milliseconds(std::max(timeout_ms, 0));
+        while (true) {
+            int slice = kSignalCheckMs;
+            if (timeout_ms >= 0) {
+                auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now()).count();
+                slice = static_cast<int>(std::clamp<int64_t>(left, 0, kSignalCheckMs));
+            }
+            int index;
+            bool closed;
+            {
+                py::gil_scoped_release release;
+                index = queue_->Pop(slice);
+                closed = queue_->IsClosed();
+            }
+            if (index >= 0 || closed || (timeout_ms >= 0 && Clock::now() >= deadline)) {
+                return index;
+            }
+            if (PyErr_CheckSignals() != 0) {
+                throw py::error_already_set();
+            }
+        }
+    }
+
+    NaluCaptureParams params_;
+    NaluCaptureCounters counters_;
+    // Shared with every lease, so events may outlive the capture
+    std::shared_ptr<NaluEventSlotQueue> queue_;
+    NaluCapturePipeline pipeline_;
+    // Start(), Stop() and PipelineStats(); taken with the GIL released
+    mutable std::mutex mutex_;
+};
+
+py::dict BoardLossDict(const NaluBoardLossStats& stats) {
+    py::dict dict;
+    dict["packets"] = stats.packets;
+    dict["lost_packets"] = stats.lost_packets;
+    dict["duplicate_packets"] = stats.duplicate_packets;
+    dict["reordered_packets"] = stats.reordered_packets;
+    dict["late_packets"] = stats.late_packets;
+    dict["malformed_packets"] = stats.malformed_packets;
+    dict["resyncs"] = stats.resyncs;
+    dict["events_complete"] = stats.events_complete;
+    dict["events_partial"] = stats.events_partial;
+    dict["events_timed_out"] = stats.events_timed_out;
+    dict["events_evicted"] = stats.events_evicted;
+    dict["events_lost"] = stats.events_lost;
+    dict["packet_loss_rate"] = stats.PacketLossRate();
+    return dict;
+}
+
+py::dict LatencyDict(const NaluLatencySummary& summary) {
+    py::dict dict;
+    dict["count"] = summary.count;
+    dict["mean_ns"] = summary.mean_ns;
+    dict["min_ns"] = summary.min_ns;
+    dict["p50_ns"] = summary.p50_ns;
+    dict["p99_ns"] = summary.p99_ns;
+    dict["p999_ns"] = summary.p999_ns;
+    dict["max_ns"] = summary.max_ns;
+    return dict;
+}
+
+}  // namespace
+
+PYBIND11_NUMPY_DTYPE(NaluEventWindow, channel, window, sample_count, offset);
+
+PYBIND11_MODULE(nalu_capture, m) {
+    m.doc() = "Host-side capture pipeline of nalu_board_controller with zero-copy NumPy events";
+
+    py::class_<EventLease, std::shared_ptr<EventLease>>(m, "Event")
+        .def_property_readonly("board_id", [](const EventLease& e) { return e.Event().board_id; })
+        .def_property_readonly("event_number", [](const EventLease& e) { return e.Event().event_number; })
+        .def_property_readonly("timestamp", [](const EventLease& e) { return e.Event().timestamp; })
+        .def_property_readonly("first_rx_ns", [](const EventLease& e) { return e.Event().first_rx_ns; })
+        .def_property_readonly("last_rx_ns", [](const EventLease& e) { return e.Event().last_rx_ns; })
+        .def_property_readonly("built_ns", [](const EventLease& e) { return e.Event().built_ns; })
+        .def_property_readonly("processed_ns", [](const EventLease& e) { return e.Event().processed_ns; })
+        .def_property_readonly("complete", [](const EventLease& e) { return e.Event().complete; })
+        .def_property_readonly("packets_expected", [](const EventLease& e) { return e.Event().packets_expected; })
+        .def_property_readonly("packets_received", [](const EventLease& e) { return e.Event().packets_received; })
+        .def_property_readonly("channel_mask", [](const EventLease& e) { return e.Event().channel_mask; })
+        .def_property_readonly("waveform_samples", [](const EventLease& e) { return e.Event().waveform_samples; })
+        .def_property_readonly("channels", [](const EventLease& e) {
+            std::vector<int> channels;
+            for (uint64_t mask = e.Event().channel_mask; mask != 0; mask &= mask - 1) {
+                channels.push_back(__builtin_ctzll(mask));
+            }
+            return channels;
+        })
+        // Every window's samples back to back, in arrival order
+        .def_property_readonly("samples", [](py::object self) {
+            const NaluEvent& event = self.cast<const EventLease&>().Event();
+            return ReadOnlyView(event.samples.data(), {static_cast<py::ssize_t>(event.samples.size())}, self);
+        })
+        // Structured array (channel, window, sample_count, offset into samples)
+        .def_property_readonly("windows", [](py::object self) {
+            const NaluEvent& event = self.cast<const EventLease&>().Event();
+            return ReadOnlyView(event.windows.data(), {static_cast<py::ssize_t>(event.windows.size())}, self);
+        })
+        .def("window", [](py::object self, size_t index) {
+            const EventLease& lease = self.cast<const EventLease&>();
+            if (index >= lease.Event().windows.size()) {
+                throw py::index_error("window index " + std::to_string(index) + " out of range");
+            }
+            return WindowView(lease, lease.Event().windows[index], self);
+        }, py::arg("index"))
+        // The channel's windows in time order with waveform assembly, in
+        // readout-window order otherwise, one view each
+        .def("channel", [](py::object self, int channel) {
+            const EventLease& lease = self.cast<const EventLease&>();
+            std::vector<const NaluEventWindow*> windows;
+            for (const NaluEventWindow& window : lease.Event().windows) {
+                if (window.channel == channel) {
+                    windows.push_back(&window);
+                }
+            }
+            if (lease.Event().waveform_samples == 0) {
+                std::stable_sort(windows.begin(), windows.end(),
+                                 [](const NaluEventWindow* a, const NaluEventWindow* b) { return a->window < b->window; });
+            }
+            py::list views;
+            for (const NaluEventWindow* window : windows) {
+                views.append(WindowView(lease, *window, self));
+            }
+            return views;
+        }, py::arg("channel"))
+        // With waveform assembly (capture config `waveform`): every channel of
+        // `channels` as one time-ordered row, shape (channels, waveform_samples)
+        .def_property_readonly("waveforms", [](py::object self) {
+            const NaluEvent& event = self.cast<const EventLease&>().Event();
+            if (event.waveform_samples == 0) {
+                throw py::value_error("event is not time ordered; enable waveform in the capture config");
+            }
+            py::ssize_t rows = __builtin_popcountll(event.channel_mask);
+            return ReadOnlyView(event.samples.data(), {rows, static_cast<py::ssize_t>(event.waveform_samples)}, self);
+        })
+        .def("waveform", [](py::object self, int channel) {
+            const NaluEvent& event = self.cast<const EventLease&>().Event();
+            if (event.waveform_samples == 0) {
+                throw py::value_error("event is not time ordered; enable waveform in the capture config");
+            }
+            if (channel < 0 || channel >= kNaluMaxChannels || !((event.channel_mask >> channel) & 1ULL)) {
+                throw py::key_error("channel " + std::to_string(channel) + " not in the event");
+            }
+            size_t row = __builtin_popcountll(event.channel_mask & ((uint64_t{1} << channel) - 1));
+            return ReadOnlyView(event.samples.data() + row * event.waveform_samples,
+                                {static_cast<py::ssize_t>(event.waveform_samples)}, self);
+        }, py::arg("channel"))
+        .def("__repr__", [](const EventLease& e) {
+            const NaluEvent& event = e.Event();
+            return "<nalu_capture.Event board " + std::to_string(event.board_id) + " #" +
+                   std::to_string(event.event_number) + (event.complete ? "" : " partial") + ", " +
+                   std::to_string(event.windows.size()) + " windows>";
+        });
+
+    py::class_<Capture>(m, "Capture")
+        .def_static("from_file", [](const std::string& path, size_t queue_slots) {
+            return std::make_unique<Capture>(NaluConfigFile::LoadCaptureParams(path), queue_slots);
+        }, py::arg("path"), py::arg("queue_slots") = 1024)
+        .def_static("from_string", [](const std::string& text, const std::string& format, size_t queue_slots) {
+            NaluConfigFormat config_format;
+            if (format == "yaml") {
+                config_format = NaluConfigFormat::YAML;
+            } else if (format == "json") {
+                config_format = NaluConfigFormat::JSON;
+            } else {
+                throw std::invalid_argument("Unknown config format '" + format + "', expected yaml or json");
+            }
+            return std::make_unique<Capture>(NaluConfigFile::ParseCaptureParams(text, config_format), queue_slots);
+        }, py::arg("text"), py::arg("format") = "yaml", py::arg("queue_slots") = 1024)
+        .def("start", &Capture::Start)
+        .def("stop", &Capture::Stop)
+        .def_property_readonly("running", [](const Capture& c) {
+            return c.PipelineStats(&NaluCapturePipeline::IsRunning);
+        })
+        .def_property_readonly("config", [](Capture& c) {
+            return NaluConfigFile::ToString(c.Params(), NaluConfigFormat::YAML);
+        })
+        // None after timeout_ms (negative: wait until stop())
+        .def("next_event", &Capture::Next, py::arg("timeout_ms") = -1)
+        .def("next_events", &Capture::NextBatch, py::arg("max_events") = 256, py::arg("timeout_ms") = -1)
+        .def("queue_stats", [](Capture& c) {
+            NaluEventQueueStats stats = c.Queue().Stats();
+            py::dict dict;
+            dict["slots"] = c.Queue().SlotCount();
+            dict["pushed"] = stats.pushed;
+            dict["dropped"] = stats.dropped;
+            dict["popped"] = stats.popped;
+            dict["leased"] = stats.leased;
+            dict["queued"] = stats.queued;
+            return dict;
+        })
+        .def("receiver_stats", [](Capture& c) {
+            py::list queues;
+            for (const NaluReceiverQueueStats& stats : c.PipelineStats(&NaluCapturePipeline::ReceiverStats)) {
+                py::dict dict;
+                dict["queue"] = stats.queue;
+                dict["port"] = stats.port;
+                dict["cpu"] = stats.cpu;
+                dict["packets"] = stats.packets;
+                dict["bytes"] = stats.bytes;
+                dict["batches"] = stats.batches;
+                dict["truncated"] = stats.truncated;
+                dict["kernel_drops"] = stats.kernel_drops;
+                dict["errors"] = stats.errors;
+                queues.append(dict);
+            }
+            return queues;
+        })
+        .def("data_path_stats", [](Capture& c) {
+            NaluDataPathStats stats = c.PipelineStats(&NaluCapturePipeline::DataPathStats);
+            py::dict boards;
+            for (const auto& [board_id, board] : stats.boards) {
+                boards[py::int_(board_id)] = BoardLossDict(board);
+            }
+            py::dict dict;
+            dict["boards"] = boards;
+            py::dict pool;
+            pool["acquired"] = stats.event_pool.acquired;
+            pool["allocated"] = stats.event_pool.allocated;
+            pool["released"] = stats.event_pool.released;
+            pool["discarded"] = stats.event_pool.discarded;
+            pool["pooled"] = stats.event_pool.pooled;
+            pool["pooled_bytes"] = stats.event_pool.pooled_bytes;
+            dict["unparsed_packets"] = stats.unparsed_packets;
+            dict["open_events"] = stats.open_events;
+            dict["event_pool"] = pool;
+            return dict;
+        })
+        .def("merge_stats", [](Capture& c) {
+            NaluMergeStats stats = c.PipelineStats(&NaluCapturePipeline::MergeStats);
+            py::dict dict;
+            dict["events_in"] = stats.events_in;
+            dict["events_out"] = stats.events_out;
+            dict["dropped_full"] = stats.dropped_full;
+            dict["late_events"] = stats.late_events;
+            dict["watermark_releases"] = stats.watermark_releases;
+            dict["max_queue_depth"] = stats.max_queue_depth;
+            dict["boards"] = stats.boards;
+            return dict;
+        })
+        .def("filter_stats", [](Capture& c) {
+            NaluFilterStats stats = c.PipelineStats(&NaluCapturePipeline::FilterStats);
+            py::dict rules;
+            for (const NaluFilterRuleStats& rule : stats.rules) {
+                py::dict counts;
+                counts["accepted"] = rule.accepted;
+                counts["rejected"] = rule.rejected;
+                rules[py::str(rule.name)] = counts;
+            }
+            py::dict dict;
+            dict["events_in"] = stats.events_in;
+            dict["accepted"] = stats.accepted;
+            dict["rejected"] = stats.rejected;
+            dict["pending"] = stats.pending;
+            dict["rules"] = rules;
+            return dict;
+        })
+        .def("waveform_stats", [](Capture& c) {
+            NaluWaveformStats stats = c.PipelineStats(&NaluCapturePipeline::WaveformStats);
+            py::dict dict;
+            dict["events"] = stats.events;
+            dict["reordered_events"] = stats.reordered_events;
+            dict["wrapped_events"] = stats.wrapped_events;
+            dict["filled_windows"] = stats.filled_windows;
+            dict["dropped_windows"] = stats.dropped_windows;
+            return dict;
+        })
+        .def("recorder_stats", [](Capture& c) {
+            NaluRecorderStats stats = c.PipelineStats(&NaluCapturePipeline::RecorderStats);
+            py::dict dict;
+            dict["packets"] = stats.packets;
+            dict["bytes"] = stats.bytes;
+            dict["dropped_packets"] = stats.dropped_packets;
+            dict["chunks_written"] = stats.chunks_written;
+            dict["write_errors"] = stats.write_errors;
+            return dict;
+        })
+        // "sink" is the push into this module's event queue
+        .def("latency_stats", [](Capture& c) {
+            NaluLatencyStats stats = c.PipelineStats(&NaluCapturePipeline::LatencyStats);
+            py::dict dict;
+            dict["build"] = LatencyDict(stats.build);
+            dict["process"] = LatencyDict(stats.process);
+            dict["sink"] = LatencyDict(stats.sink);
+            dict["total"] = LatencyDict(stats.total);
+            return dict;
+        });
+}
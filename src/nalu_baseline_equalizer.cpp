@@ -0,0 +1,154 @@
+#include "nalu_baseline_equalizer.h"
+#include "nalu_board_controller_logger.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <thread>
+
+NaluBaselineEqualizer::NaluBaselineEqualizer(NaluBoardState* state, NaluBoardConfigurator* configurator,
+                                             NaluBaselineSource* source)
+    : state_(state), configurator_(configurator), source_(source) {}
+
+NaluEqualizerResult NaluBaselineEqualizer::Run(NaluCaptureParams& capture_params,
+                                               const NaluEqualizerParams& params) {
+    using Clock = std::chrono::steady_clock;
+
+    if (params.max_iterations < 1 || params.dac_min >= params.dac_max ||
+        params.tolerance <= 0.0 || params.initial_gain == 0.0 || params.settle_ms < 0) {
+        throw std::invalid_argument("Invalid baseline equalizer parameters.");
+    }
+
+    auto start = Clock::now();
+    NaluEqualizerResult result;
+
+    // One control loop per enabled channel
+    int channel_count = state_->ChannelCount();
+    std::map<int, ChannelLoop> loops;
+    for (const auto& [channel, channel_info] : capture_params.channels) {
+        if (!channel_info.enabled) {
+            continue;
+        }
+        if (channel < 0 || channel >= channel_count) {
+            throw std::invalid_argument("Channel " + std::to_string(channel) +
+                                        " is not part of the running capture configuration.");
+        }
+        ChannelLoop loop;
+        loop.status.channel = channel;
+        loop.status.dac_value = std::clamp(channel_info.dac_value, params.dac_min, params.dac_max);
+        loop.gain = params.initial_gain;
+        loops[channel] = loop;
+    }
+
+    if (loops.empty()) {
+        NaluBoardControllerLogger::info("Baseline equalization: no enabled channels.");
+        result.converged = true;
+        return result;
+    }
+
+    NaluBoardControllerLogger::info("Equalizing baselines of " + std::to_string(loops.size()) +
+                                    " channel(s) to " + std::to_string(params.target_baseline));
+
+    // The equalizer takes the DACs over; hot updates only write them while they are assigned
+    state_->SetAssignDacValues(true);
+
+    // Best measured point per channel, which is what gets written back
+    std::map<int, std::pair<int, double>> best;
+
+    for (int iteration = 1; iteration <= params.max_iterations; ++iteration) {
+        NaluHotUpdate update;
+        update.write_unchanged = iteration == 1;  // board DACs may not match the stored values yet
+        std::vector<int> active;
+        for (const auto& [channel, loop] : loops) {
+            if (!loop.done) {
+                update.channels[channel].dac_value = loop.status.dac_value;
+                active.push_back(channel);
+            }
+        }
+        if (active.empty()) {
+            break;
+        }
+
+        auto write_start = Clock::now();
+        configurator_->ApplyHotUpdate(update);
+        std::this_thread::sleep_for(std::chrono::milliseconds(params.settle_ms));
+        auto measure_start = Clock::now();
+        std::map<int, double> baselines = source_->MeasureBaselines(active);
+        auto measure_end = Clock::now();
+        result.write_time += std::chrono::duration_cast<std::chrono::nanoseconds>(measure_start - write_start);
+        result.measure_time += std::chrono::duration_cast<std::chrono::nanoseconds>(measure_end - measure_start);
+        result.iterations = iteration;
+
+        for (int channel : active) {
+            ChannelLoop& loop = loops[channel];
+            auto measured = baselines.find(channel);
+            if (measured == baselines.end()) {
+                throw std::runtime_error("No baseline measured for channel " + std::to_string(channel));
+            }
+
+            int dac = loop.status.dac_value;
+            double baseline = measured->second;
+            double error = params.target_baseline - baseline;
+            loop.status.iterations = iteration;
+
+            auto best_it = best.find(channel);
+            if (best_it == best.end() || std::abs(error) < std::abs(params.target_baseline - best_it->second.second)) {
+                best[channel] = {dac, baseline};
+            }
+
+            if (std::abs(error) <= params.tolerance) {
+                loop.status.converged = true;
+                loop.done = true;
+                continue;
+            }
+
+            // Secant update of this channel's slope once two points are known
+            if (loop.has_previous && dac != loop.previous_dac) {
+                double slope = (baseline - loop.previous_baseline) / (dac - loop.previous_dac);
+                if (std::abs(slope) > 1e-6) {
+                    loop.gain = slope;
+                }
+            }
+            loop.has_previous = true;
+            loop.previous_dac = dac;
+            loop.previous_baseline = baseline;
+
+            long target = std::lround(dac + error / loop.gain);
+            int next = static_cast<int>(std::clamp<long>(target, params.dac_min, params.dac_max));
+            if (next == dac) {
+                // Either pinned at a DAC limit or already at the DAC's resolution
+                loop.status.saturated = target != next;
+                loop.done = true;
+                continue;
+            }
+            loop.status.dac_value = next;
+        }
+    }
+
+    // Write the best measured setting back to the board and the capture params
+    NaluHotUpdate final_update;
+    result.converged = true;
+    for (auto& [channel, loop] : loops) {
+        loop.status.dac_value = best[channel].first;
+        loop.status.baseline = best[channel].second;
+        final_update.channels[channel].dac_value = loop.status.dac_value;
+        capture_params.channels[channel].dac_value = loop.status.dac_value;
+        result.converged = result.converged && loop.status.converged;
+        result.channels.push_back(loop.status);
+
+        if (!loop.status.converged) {
+            NaluBoardControllerLogger::warning(
+                "Channel " + std::to_string(channel) + " did not reach the target baseline" +
+                (loop.status.saturated ? " (DAC limit)" : "") + ": baseline " +
+                std::to_string(loop.status.baseline) + " at DAC " + std::to_string(loop.status.dac_value));
+        }
+    }
+    configurator_->ApplyHotUpdate(final_update);
+    capture_params.assign_dac_values = true;
+
+    result.total_time = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start);
+    NaluBoardControllerLogger::info(
+        "Baseline equalization " + std::string(result.converged ? "converged" : "finished") + " after " +
+        std::to_string(result.iterations) + " iteration(s) in " +
+        std::to_string(std::chrono::duration<double, std::milli>(result.total_time).count()) + " ms");
+    return result;
+}
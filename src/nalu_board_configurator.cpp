@@ -1,11 +1,13 @@
 #include "nalu_board_configurator.h"
 #include "nalu_board_controller_logger.h"
 #include <algorithm>  // for std::transform
+#include <array>
+#include <stdexcept>
 
 
 NaluBoardConfigurator::NaluBoardConfigurator(NaluBoardState* state, 
-                                           NaluBoardPythonWrapper* python_wrapper)
-    : state_(state), python_wrapper_(python_wrapper) {}
+                                           NaluBoardBackend* backend)
+    : state_(state), backend_(backend) {}
 
 void NaluBoardConfigurator::ConfigureForCapture() {
     NaluBoardControllerLogger::debug("Starting full capture configuration...");
@@ -25,41 +27,25 @@ void NaluBoardConfigurator::ConfigureTriggers() {
         return;
     }
 
-    if (state_->TriggerValues().empty()) {
-        NaluBoardControllerLogger::debug("No trigger values to configure");
-        return;
-    }
-
     try {
         NaluBoardControllerLogger::debug("Configuring triggers...");
 
-        py::object trigger_controller = python_wrapper_->TriggerController();
-
         // Log current trigger values
+        std::vector<int> trigger_values = TriggerValueList();
         std::string trigger_values_str = "[";
-        for (size_t i = 0; i < state_->TriggerValues().size(); ++i) {
-            trigger_values_str += std::to_string(state_->TriggerValues()[i]);
-            if (i < state_->TriggerValues().size() - 1) trigger_values_str += ", ";
+        for (size_t i = 0; i < trigger_values.size(); ++i) {
+            trigger_values_str += std::to_string(trigger_values[i]);
+            if (i < trigger_values.size() - 1) trigger_values_str += ", ";
         }
         trigger_values_str += "]";
         NaluBoardControllerLogger::debug("Trigger values to set: " + trigger_values_str);
 
         // Set trigger values
-        py::list py_trigger_values;
-        for (int val : state_->TriggerValues()) {
-            py_trigger_values.append(val);
-        }
-        trigger_controller.attr("values") = py_trigger_values;
-        NaluBoardControllerLogger::debug("Trigger values assigned to Python controller.");
-
-        trigger_controller.attr("write_triggers")();
-        NaluBoardControllerLogger::debug("write_triggers() called on trigger controller.");
+        backend_->WriteTriggerValues(trigger_values);
+        NaluBoardControllerLogger::debug("Trigger values written to board.");
 
         // Set reference values
-        py::dict references;
-        references["left"] = py::make_tuple(state_->LowReference(), state_->HighReference());
-        references["right"] = py::make_tuple(state_->LowReference(), state_->HighReference());
-        trigger_controller.attr("references") = references;
+        backend_->WriteTriggerReferences(state_->LowReference(), state_->HighReference());
 
         NaluBoardControllerLogger::debug(
             "Trigger references set to: left = (" + 
@@ -70,10 +56,7 @@ void NaluBoardConfigurator::ConfigureTriggers() {
         );
 
         // Set trigger edges
-        // True --> Rising Edge
-        // False --> Falling Edge
-        trigger_controller.attr("set_trigger_edge")(py::str("left"), state_->RisingEdge());
-        trigger_controller.attr("set_trigger_edge")(py::str("right"), state_->RisingEdge());
+        backend_->WriteTriggerEdge(state_->RisingEdge());
 
         NaluBoardControllerLogger::debug(
             "Trigger edges set to: left = " + std::string(state_->RisingEdge() ? "Rising" : "Falling") +
@@ -81,7 +64,7 @@ void NaluBoardConfigurator::ConfigureTriggers() {
         );
 
         NaluBoardControllerLogger::debug("Trigger configuration complete.");
-    } catch (const py::error_already_set& e) {
+    } catch (const std::exception& e) {
         NaluBoardControllerLogger::error(std::string("Trigger configuration error: ") + e.what());
         throw;
     }
@@ -92,7 +75,7 @@ void NaluBoardConfigurator::ConfigureDacValues() {
         NaluBoardControllerLogger::debug("DAC values assignment is disabled, skipping configuration.");
         return;
     }
-    if (state_->DacValues().empty()) {
+    if (state_->EnabledChannelMask() == 0) {
         NaluBoardControllerLogger::debug("No DAC values to configure");
         return;
     }
@@ -100,31 +83,28 @@ void NaluBoardConfigurator::ConfigureDacValues() {
     try {
         NaluBoardControllerLogger::debug("Configuring DAC values...");
 
+        std::vector<int> channels = state_->Channels();
         std::string dac_values_str = "DAC values for channels [";
         bool first = true;
 
-        for (size_t chan = 0; chan < state_->DacValues().size(); ++chan) {
-            if (std::find(state_->Channels().begin(), state_->Channels().end(), chan) != state_->Channels().end()) {
-                if (!first) {
-                    dac_values_str += ", ";
-                }
-                dac_values_str += "ch" + std::to_string(chan) + "=" + std::to_string(state_->DacValues()[chan]);
-                first = false;
+        for (int chan : channels) {
+            if (!first) {
+                dac_values_str += ", ";
             }
+            dac_values_str += "ch" + std::to_string(chan) + "=" + std::to_string(state_->DacValues()[chan]);
+            first = false;
         }
         dac_values_str += "]";
         NaluBoardControllerLogger::debug(dac_values_str);
 
-        for (size_t chan = 0; chan < state_->DacValues().size(); ++chan) {
-            if (std::find(state_->Channels().begin(), state_->Channels().end(), chan) != state_->Channels().end()) {
-                NaluBoardControllerLogger::debug(
-                    "Setting DAC for channel " + std::to_string(chan) + " to " + std::to_string(state_->DacValues()[chan])
-                );
-                python_wrapper_->DacController().attr("set_single_dac")(chan, state_->DacValues()[chan]);
-            }
+        for (int chan : channels) {
+            NaluBoardControllerLogger::debug(
+                "Setting DAC for channel " + std::to_string(chan) + " to " + std::to_string(state_->DacValues()[chan])
+            );
+            backend_->WriteDacValue(chan, state_->DacValues()[chan]);
         }
         NaluBoardControllerLogger::debug("DAC configuration complete.");
-    } catch (const py::error_already_set& e) {
+    } catch (const std::exception& e) {
         NaluBoardControllerLogger::error(std::string("DAC configuration error: ") + e.what());
         throw;
     }
@@ -134,7 +114,6 @@ void NaluBoardConfigurator::ConfigureReadoutController() {
     try {
         NaluBoardControllerLogger::debug("Configuring readout controller...");
 
-        py::object readout_controller = python_wrapper_->ReadoutController();
         auto [windows, lookback, write_after_trig] = state_->ReadoutWindow();
 
         NaluBoardControllerLogger::debug(
@@ -144,12 +123,11 @@ void NaluBoardConfigurator::ConfigureReadoutController() {
         );
 
         // Set readout channels
-        if (!state_->Channels().empty()) {
-            py::list py_channels;
+        std::vector<int> channels = state_->Channels();
+        if (!channels.empty()) {
             std::string channels_str = "Readout channels: [";
             bool first = true;
-            for (int channel : state_->Channels()) {
-                py_channels.append(channel);
+            for (int channel : channels) {
                 if (!first) {
                     channels_str += ", ";
                 }
@@ -159,17 +137,17 @@ void NaluBoardConfigurator::ConfigureReadoutController() {
             channels_str += "]";
             NaluBoardControllerLogger::debug(channels_str);
 
-            readout_controller.attr("set_readout_channels")(py_channels);
+            backend_->WriteReadoutChannels(channels);
             NaluBoardControllerLogger::debug("set_readout_channels() called.");
         } else {
             NaluBoardControllerLogger::debug("No readout channels set.");
         }
 
-        readout_controller.attr("set_read_window")(windows, lookback, write_after_trig);
+        backend_->WriteReadWindow(windows, lookback, write_after_trig);
         NaluBoardControllerLogger::debug("set_read_window() called with parameters.");
 
         NaluBoardControllerLogger::debug("Readout controller configuration complete.");
-    } catch (const py::error_already_set& e) {
+    } catch (const std::exception& e) {
         NaluBoardControllerLogger::error(std::string("Readout controller configuration error: ") + e.what());
         throw;
     }
@@ -179,12 +157,176 @@ void NaluBoardConfigurator::ConfigureConnection() {
     try {
         NaluBoardControllerLogger::debug("Configuring connection controller...");
 
-        py::object connection_controller = python_wrapper_->ConnectionController();
-        connection_controller.attr("_configure_ethernet")();
+        backend_->ConfigureEthernet(state_->TargetIp());
 
         NaluBoardControllerLogger::debug("Connection controller configured successfully.");
-    } catch (const py::error_already_set& e) {
+    } catch (const std::exception& e) {
         NaluBoardControllerLogger::error(std::string("Connection configuration error: ") + e.what());
         throw;
     }
 }
+
+NaluHotUpdateResult NaluBoardConfigurator::ApplyHotUpdate(const NaluHotUpdate& update) {
+    using Clock = std::chrono::steady_clock;
+    auto start = Clock::now();
+    NaluHotUpdateResult result;
+
+    // Validate everything before touching the state or the board so a bad update changes nothing
+    const NaluBoardModel& model = state_->BoardModel();
+    auto check_range = [](const std::string& what, int value, int max) {
+        if (value < 0 || value > max) {
+            throw std::invalid_argument("Hot update " + what + " " + std::to_string(value) + " is outside [0, " +
+                                        std::to_string(max) + "]");
+        }
+    };
+    for (const auto& [channel, channel_update] : update.channels) {
+        if (channel < 0 || channel >= model.channels) {
+            throw std::invalid_argument("Hot update for channel " + std::to_string(channel) + ", which the " +
+                                        std::string(model.name) + " does not have.");
+        }
+        if (channel_update.trigger_value) {
+            check_range("channel " + std::to_string(channel) + " trigger value", *channel_update.trigger_value,
+                        model.max_trigger_value);
+        }
+        if (channel_update.dac_value) {
+            // Only the DACs ConfigureDacValues() writes may change, or the next configure would not restore them
+            if (!state_->AssignDacValues()) {
+                throw std::invalid_argument("Hot update sets the DAC of channel " + std::to_string(channel) +
+                                            ", but assign_dac_values is off.");
+            }
+            if (!(state_->EnabledChannelMask() >> channel & 1)) {
+                throw std::invalid_argument("Hot update sets the DAC of channel " + std::to_string(channel) +
+                                            ", which is not enabled in the capture configuration.");
+            }
+            check_range("channel " + std::to_string(channel) + " DAC value", *channel_update.dac_value,
+                        model.max_dac_value);
+        }
+    }
+
+    int low_reference = update.low_reference.value_or(state_->LowReference());
+    int high_reference = update.high_reference.value_or(state_->HighReference());
+    check_range("low reference", low_reference, model.max_reference);
+    check_range("high reference", high_reference, model.max_reference);
+    if (low_reference > high_reference) {
+        throw std::invalid_argument("Hot update low reference " + std::to_string(low_reference) +
+                                    " is above the high reference " + std::to_string(high_reference));
+    }
+    bool references_changed = low_reference != state_->LowReference() || high_reference != state_->HighReference();
+
+    // Put back if a board write fails, so the state keeps describing the board
+    const std::array<int, kNaluMaxChannels> old_trigger_values = state_->TriggerValues();
+    const std::array<int, kNaluMaxChannels> old_dac_values = state_->DacValues();
+    const int old_low_reference = state_->LowReference();
+    const int old_high_reference = state_->HighReference();
+
+    std::vector<int> dac_channels;
+    for (const auto& [channel, channel_update] : update.channels) {
+        if (channel_update.trigger_value &&
+            (update.write_unchanged || *channel_update.trigger_value != state_->TriggerValues()[channel])) {
+            state_->SetTriggerValue(channel, *channel_update.trigger_value);
+            result.trigger_values_changed++;
+        }
+        if (channel_update.dac_value &&
+            (update.write_unchanged || *channel_update.dac_value != state_->DacValues()[channel])) {
+            state_->SetDacValue(channel, *channel_update.dac_value);
+            dac_channels.push_back(channel);
+        }
+    }
+
+    std::string trigger_mode = state_->TriggerMode();
+    std::transform(trigger_mode.begin(), trigger_mode.end(), trigger_mode.begin(), ::tolower);
+    bool self_trigger = trigger_mode == "self";
+    // Outside self-trigger mode thresholds and references are stored and written on the next configure
+    bool write_triggers = self_trigger && result.trigger_values_changed > 0;
+    bool write_references = self_trigger && references_changed;
+
+    state_->SetLowReference(low_reference);
+    state_->SetHighReference(high_reference);
+
+    bool pause = state_->IsCapturing() && (write_references || update.force_pause);
+    Clock::time_point pause_start;
+    bool readout_stopped = false;
+    bool triggers_written = false;
+
+    try {
+        if (pause) {
+            NaluBoardControllerLogger::debug("Pausing readout for hot update...");
+            pause_start = Clock::now();
+            backend_->StopCapture();
+            readout_stopped = true;
+            result.readout_paused = true;
+        }
+
+        if (write_triggers) {
+            backend_->WriteTriggerValues(TriggerValueList());
+            triggers_written = true;
+            NaluBoardControllerLogger::debug("Hot update: " + std::to_string(result.trigger_values_changed) +
+                                             " trigger value(s) written.");
+        }
+        if (write_references) {
+            backend_->WriteTriggerReferences(low_reference, high_reference);
+            result.references_written = true;
+            NaluBoardControllerLogger::debug("Hot update: trigger references set to (" + std::to_string(low_reference) +
+                                             ", " + std::to_string(high_reference) + ")");
+        }
+        for (int channel : dac_channels) {
+            backend_->WriteDacValue(channel, state_->DacValues()[channel]);
+            result.dac_values_written++;
+            NaluBoardControllerLogger::debug("Hot update: DAC for channel " + std::to_string(channel) +
+                                             " set to " + std::to_string(state_->DacValues()[channel]));
+        }
+
+        if (pause) {
+            backend_->StartCapture();
+            readout_stopped = false;
+            result.pause_time = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - pause_start);
+            NaluBoardControllerLogger::debug("Readout resumed after hot update.");
+        }
+    } catch (const std::exception& e) {
+        NaluBoardControllerLogger::error(std::string("Hot update error: ") + e.what() +
+                                         "; restoring the previous values");
+        for (const auto& [channel, channel_update] : update.channels) {
+            state_->SetTriggerValue(channel, old_trigger_values[channel]);
+            state_->SetDacValue(channel, old_dac_values[channel]);
+        }
+        state_->SetLowReference(old_low_reference);
+        state_->SetHighReference(old_high_reference);
+
+        // Undo the writes that did reach the board; best effort, the link may be what failed
+        try {
+            if (triggers_written) {
+                backend_->WriteTriggerValues(TriggerValueList());
+            }
+            if (result.references_written) {
+                backend_->WriteTriggerReferences(old_low_reference, old_high_reference);
+            }
+            for (int i = 0; i < result.dac_values_written; ++i) {
+                backend_->WriteDacValue(dac_channels[i], old_dac_values[dac_channels[i]]);
+            }
+        } catch (const std::exception& restore_error) {
+            NaluBoardControllerLogger::error(std::string("Restoring the previous values on the board failed: ") +
+                                             restore_error.what());
+        }
+
+        if (readout_stopped) {
+            try {
+                backend_->StartCapture();
+                NaluBoardControllerLogger::info("Readout resumed after the failed hot update.");
+            } catch (const std::exception& restart_error) {
+                // The board is not capturing any more; say so rather than pretend
+                state_->SetCapturing(false);
+                NaluBoardControllerLogger::error(std::string("Readout could not be resumed after the failed hot update: ") +
+                                                 restart_error.what());
+            }
+        }
+        throw;
+    }
+
+    result.total_time = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start);
+    return result;
+}
+
+std::vector<int> NaluBoardConfigurator::TriggerValueList() const {
+    const auto& values = state_->TriggerValues();
+    return std::vector<int>(values.begin(), values.begin() + state_->ChannelCount());
+}
@@ -1,26 +1,51 @@
 #include "nalu_board_controller.h"
 #include "nalu_board_controller_logger.h"
+#include "nalu_params_validator.h"
 
-NaluBoardController::NaluBoardController(const NaluBoardParams& params) {
+NaluBoardController::NaluBoardController(const NaluBoardParams& params) : pipeline_(&counters_) {
+    NaluParamsValidator::ValidateBoardParams(params);
     state_ = std::make_unique<NaluBoardState>(params);
-    python_wrapper_ = std::make_unique<NaluBoardPythonWrapper>(state_.get());
-    configurator_ = std::make_unique<NaluBoardConfigurator>(state_.get(), python_wrapper_.get());
+    auto python_wrapper = std::make_unique<NaluBoardPythonWrapper>(state_.get());
+    python_wrapper_ = python_wrapper.get();
+    backend_ = std::move(python_wrapper);
+    create_controllers();
+}
+
+NaluBoardController::NaluBoardController(const NaluBoardParams& params, std::unique_ptr<NaluBoardBackend> backend)
+    : backend_(std::move(backend)), pipeline_(&counters_) {
+    if (!backend_) {
+        throw std::invalid_argument("NaluBoardController needs a board backend");
+    }
+    NaluParamsValidator::ValidateBoardParams(params);
+    state_ = std::make_unique<NaluBoardState>(params);
+    create_controllers();
 }
 
 NaluBoardController::~NaluBoardController() = default;
 
+void NaluBoardController::create_controllers() {
+    configurator_ = std::make_unique<NaluBoardConfigurator>(state_.get(), backend_.get());
+    scan_engine_ = std::make_unique<NaluScanEngine>(state_.get(), configurator_.get(), &counters_);
+}
+
 void NaluBoardController::setup_logger(int level) {
+    std::lock_guard<std::mutex> lock(control_mutex_);
+    if (!python_wrapper_) {
+        NaluBoardControllerLogger::debug("Board backend has no Python logging to set up");
+        return;
+    }
     python_wrapper_->SetupLogger(level);
 }
 
 void NaluBoardController::initialize_board() {
-    python_wrapper_->InitializeBoard();
+    std::lock_guard<std::mutex> lock(control_mutex_);
+    backend_->InitializeBoard();
     state_->SetInitialized(true);
 }
 
 void NaluBoardController::start_capture(const NaluCaptureParams& params) {
-    init_capture(params);
-    python_wrapper_->StartCapture();
+    std::lock_guard<std::mutex> lock(control_mutex_);
+    begin_capture(params);
 }
 
 void NaluBoardController::start_capture(const std::string& target_ip_port,
@@ -44,23 +69,126 @@ void NaluBoardController::start_capture(const std::string& target_ip_port,
     params.high_reference = high_reference;
     params.rising_edge = rising_edge;
     
-    init_capture(params);
-    python_wrapper_->StartCapture();
+    std::lock_guard<std::mutex> lock(control_mutex_);
+    begin_capture(params);
 }
 
 void NaluBoardController::stop_capture() {
-    python_wrapper_->StopCapture();
+    std::lock_guard<std::mutex> lock(control_mutex_);
+    if (scan_running_) {
+        scan_engine_->Cancel();
+    }
+    if (watchdog_) {
+        watchdog_->Disarm();
+    }
+    backend_->StopCapture();
+    state_->SetCapturing(false);
+    stop_receiver();
+}
+
+NaluHotUpdateResult NaluBoardController::update_capture(const NaluHotUpdate& update) {
+    std::lock_guard<std::mutex> lock(control_mutex_);
+    if (!state_->IsInitialized()) {
+        NaluBoardControllerLogger::error("Board not initialized. Call initialize_board() first.");
+        throw std::runtime_error("Board not initialized");
+    }
+
+    NaluHotUpdateResult result = configurator_->ApplyHotUpdate(update);
+    NaluBoardControllerLogger::info(
+        "Capture updated in " + std::to_string(std::chrono::duration<double, std::milli>(result.total_time).count()) +
+        " ms" + (result.readout_paused
+            ? ", readout paused for " + std::to_string(std::chrono::duration<double, std::milli>(result.pause_time).count()) + " ms"
+            : ", readout not paused"));
+    return result;
+}
+
+NaluScanResult NaluBoardController::run_scan(const NaluScanPlan& plan) {
+    std::unique_lock<std::mutex> lock(control_mutex_);
+    if (!state_->IsCapturing()) {
+        NaluBoardControllerLogger::error("No capture running. Call start_capture() before run_scan().");
+        throw std::runtime_error("No capture running");
+    }
+    if (scan_running_) {
+        NaluBoardControllerLogger::error("A scan is already running.");
+        throw std::runtime_error("A scan is already running");
+    }
+
+    // Steps with high thresholds legitimately see no data
+    bool watchdog_armed = watchdog_ && watchdog_->IsArmed();
+    if (watchdog_armed) {
+        watchdog_->Disarm();
+    }
+    // The engine releases the lock while steps count, so other calls (and
+    // stop_capture(), which cancels the scan) get through; it is held again here
+    scan_running_ = true;
+    auto finish = [&] {
+        scan_running_ = false;
+        if (watchdog_armed && watchdog_ && state_->IsCapturing()) {
+            watchdog_->Arm();
+        }
+    };
+    try {
+        NaluScanResult result = scan_engine_->Run(plan, &lock);
+        finish();
+        return result;
+    } catch (...) {
+        finish();
+        throw;
+    }
+}
+
+void NaluBoardController::cancel_scan() {
+    scan_engine_->Cancel();
+}
+
+NaluEqualizerResult NaluBoardController::equalize_baselines(NaluCaptureParams& params, NaluBaselineSource& source,
+                                                            const NaluEqualizerParams& equalizer_params) {
+    std::lock_guard<std::mutex> lock(control_mutex_);
+    if (!state_->IsCapturing()) {
+        NaluBoardControllerLogger::error("No capture running. Call start_capture() before equalize_baselines().");
+        throw std::runtime_error("No capture running");
+    }
+
+    // Measurement captures are short and may be sparse
+    bool watchdog_armed = watchdog_ && watchdog_->IsArmed();
+    if (watchdog_armed) {
+        watchdog_->Disarm();
+    }
+    try {
+        NaluBaselineEqualizer equalizer(state_.get(), configurator_.get(), &source);
+        NaluEqualizerResult result = equalizer.Run(params, equalizer_params);
+        if (watchdog_armed) {
+            watchdog_->Arm();
+        }
+        return result;
+    } catch (...) {
+        if (watchdog_armed) {
+            watchdog_->Arm();
+        }
+        throw;
+    }
 }
 
 void NaluBoardController::enable_ethernet() {
+    std::lock_guard<std::mutex> lock(control_mutex_);
+    if (!python_wrapper_) {
+        backend_->ConfigureEthernet(state_->TargetIp());
+        return;
+    }
     python_wrapper_->EnableEthernet();
 }
 
 void NaluBoardController::enable_serial() {
+    std::lock_guard<std::mutex> lock(control_mutex_);
+    if (!python_wrapper_) {
+        NaluBoardControllerLogger::error("Serial readout needs a naludaq board.");
+        throw std::runtime_error("Serial readout not supported by this board backend");
+    }
     python_wrapper_->EnableSerial();
 }
 
 void NaluBoardController::init_capture(const NaluCaptureParams& params) {
+    NaluParamsValidator::ValidateCaptureParams(params, state_->BoardModel());
     if (!state_->IsInitialized()) {
         NaluBoardControllerLogger::error("Board not initialized. Call initialize_board() first.");
         throw std::runtime_error("Board not initialized");
@@ -68,4 +196,112 @@ void NaluBoardController::init_capture(const NaluCaptureParams& params) {
     
     state_->UpdateFromCaptureParams(params);
     configurator_->ConfigureForCapture();
+}
+
+void NaluBoardController::begin_capture(const NaluCaptureParams& params) {
+    init_capture(params);
+    // Listen before the board starts sending
+    start_receiver(params);
+    try {
+        backend_->StartCapture();
+    } catch (...) {
+        stop_receiver();
+        throw;
+    }
+    state_->SetCapturing(true);
+    arm_watchdog(params.watchdog);
+}
+
+void NaluBoardController::start_receiver(const NaluCaptureParams& params) {
+    NaluEventLayout layout;
+    layout.channel_mask = state_->EnabledChannelMask();
+    layout.windows = std::get<0>(state_->ReadoutWindow());
+    layout.samples_per_window = state_->BoardModel().samples_per_window;
+    layout.buffer_windows = params.waveform.buffer_windows > 0 ? params.waveform.buffer_windows
+                                                                : state_->BoardModel().windows;
+    pipeline_.Start(params, layout);
+}
+
+void NaluBoardController::stop_receiver() {
+    pipeline_.Stop();
+}
+
+void NaluBoardController::set_packet_sink(NaluPacketSink sink) {
+    std::lock_guard<std::mutex> lock(control_mutex_);
+    pipeline_.SetPacketSink(std::move(sink));
+}
+
+void NaluBoardController::set_event_sink(NaluEventSink sink) {
+    std::lock_guard<std::mutex> lock(control_mutex_);
+    pipeline_.SetEventSink(std::move(sink));
+}
+
+void NaluBoardController::set_packet_decoder(std::shared_ptr<const NaluPacketDecoder> decoder) {
+    std::lock_guard<std::mutex> lock(control_mutex_);
+    pipeline_.SetPacketDecoder(std::move(decoder));
+}
+
+NaluDataPathStats NaluBoardController::data_path_stats() const {
+    std::lock_guard<std::mutex> lock(control_mutex_);
+    return pipeline_.DataPathStats();
+}
+
+NaluMergeStats NaluBoardController::merge_stats() const {
+    std::lock_guard<std::mutex> lock(control_mutex_);
+    return pipeline_.MergeStats();
+}
+
+NaluFilterStats NaluBoardController::filter_stats() const {
+    std::lock_guard<std::mutex> lock(control_mutex_);
+    return pipeline_.FilterStats();
+}
+
+NaluMonitorSnapshot NaluBoardController::monitor_snapshot() const {
+    return pipeline_.MonitorSnapshot();
+}
+
+NaluWaveformStats NaluBoardController::waveform_stats() const {
+    std::lock_guard<std::mutex> lock(control_mutex_);
+    return pipeline_.WaveformStats();
+}
+
+NaluRecorderStats NaluBoardController::recorder_stats() const {
+    std::lock_guard<std::mutex> lock(control_mutex_);
+    return pipeline_.RecorderStats();
+}
+
+NaluLatencyStats NaluBoardController::latency_stats() const {
+    std::lock_guard<std::mutex> lock(control_mutex_);
+    return pipeline_.LatencyStats();
+}
+
+std::vector<NaluReceiverQueueStats> NaluBoardController::receiver_stats() const {
+    std::lock_guard<std::mutex> lock(control_mutex_);
+    return pipeline_.ReceiverStats();
+}
+
+void NaluBoardController::arm_watchdog(const NaluWatchdogParams& params) {
+    counters_.Reset();
+    if (!params.enabled) {
+        watchdog_.reset();
+        return;
+    }
+    watchdog_ = std::make_unique<NaluCaptureWatchdog>(params, &counters_, backend_.get(), configurator_.get());
+    watchdog_->Arm();
+}
+
+bool NaluBoardController::service_watchdog() {
+    std::lock_guard<std::mutex> lock(control_mutex_);
+    if (!watchdog_) {
+        return false;
+    }
+    return watchdog_->Poll();
+}
+
+NaluWatchdogStats NaluBoardController::watchdog_stats() const {
+    std::lock_guard<std::mutex> lock(control_mutex_);
+    if (!watchdog_) {
+        return NaluWatchdogStats();
+    }
+    return watchdog_->Stats();
 }
\ No newline at end of file
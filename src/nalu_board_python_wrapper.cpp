@@ -16,6 +16,9 @@ void NaluBoardPythonWrapper::InitializePythonInterpreter() {
     if (!Py_IsInitialized()) {
         NaluBoardControllerLogger::debug("Initializing Python interpreter...");
         py::initialize_interpreter();
+        // Hand the GIL back so any thread can call into the board; every
+        // method below acquires it for the duration of its Python calls.
+        gil_release_ = std::make_unique<py::gil_scoped_release>();
         NaluBoardControllerLogger::debug("Python interpreter initialized");
     } else {
         NaluBoardControllerLogger::debug("Python interpreter already initialized");
@@ -27,8 +30,10 @@ void NaluBoardPythonWrapper::FinalizePythonInterpreter() {
         if (Py_IsInitialized()) {
             NaluBoardControllerLogger::debug("Finalizing Python interpreter...");
             
-            // Clear Python objects first without acquiring GIL
-            ClearPythonObjects();
+            {
+                py::gil_scoped_acquire gil;
+                ClearPythonObjects();
+            }
             
             // Don't call py::finalize_interpreter() - let it clean up naturally
             // This avoids the threading issues with GIL state
@@ -62,6 +67,7 @@ void NaluBoardPythonWrapper::ClearPythonObjects() {
 }
 
 void NaluBoardPythonWrapper::InitializeBoard() {
+    py::gil_scoped_acquire gil;
     try {
         NaluBoardControllerLogger::debug("Initializing board and controllers...");
 
@@ -130,6 +136,7 @@ void NaluBoardPythonWrapper::InitializeBoard() {
 }
 
 void NaluBoardPythonWrapper::SetupLogger(int level) {
+    py::gil_scoped_acquire gil;
     try {
         NaluBoardControllerLogger::debug("Setting up Python logging with level " + std::to_string(level));
         py::module logging = py::module::import("logging");
@@ -152,6 +159,7 @@ void NaluBoardPythonWrapper::SetupLogger(int level) {
 }
 
 void NaluBoardPythonWrapper::StartCapture() {
+    py::gil_scoped_acquire gil;
     try {
         NaluBoardControllerLogger::debug("Starting capture...");
         if (!board_ || board_.is_none()) {
@@ -189,6 +197,7 @@ void NaluBoardPythonWrapper::StartCapture() {
 }
 
 void NaluBoardPythonWrapper::StopCapture() {
+    py::gil_scoped_acquire gil;
     try {
         NaluBoardControllerLogger::debug("Stopping capture...");
         if (board_controller_ && !board_controller_.is_none()) {
@@ -204,6 +213,7 @@ void NaluBoardPythonWrapper::StopCapture() {
 }
 
 void NaluBoardPythonWrapper::EnableEthernet() {
+    py::gil_scoped_acquire gil;
     try {
         NaluBoardControllerLogger::debug("Enabling Ethernet mode...");
         py::module naludaq_communication = py::module::import("naludaq.communication");
@@ -218,6 +228,7 @@ void NaluBoardPythonWrapper::EnableEthernet() {
 }
 
 void NaluBoardPythonWrapper::EnableSerial() {
+    py::gil_scoped_acquire gil;
     try {
         NaluBoardControllerLogger::debug("Enabling Serial mode...");
         py::module naludaq_communication = py::module::import("naludaq.communication");
@@ -230,3 +241,54 @@ void NaluBoardPythonWrapper::EnableSerial() {
         throw;
     }
 }
+
+void NaluBoardPythonWrapper::WriteTriggerValues(const std::vector<int>& values) {
+    py::gil_scoped_acquire gil;
+    py::list py_trigger_values;
+    for (int val : values) {
+        py_trigger_values.append(val);
+    }
+    trigger_controller_.attr("values") = py_trigger_values;
+    trigger_controller_.attr("write_triggers")();
+}
+
+void NaluBoardPythonWrapper::WriteTriggerReferences(int low_reference, int high_reference) {
+    py::gil_scoped_acquire gil;
+    py::dict references;
+    references["left"] = py::make_tuple(low_reference, high_reference);
+    references["right"] = py::make_tuple(low_reference, high_reference);
+    trigger_controller_.attr("references") = references;
+}
+
+void NaluBoardPythonWrapper::WriteTriggerEdge(bool rising_edge) {
+    py::gil_scoped_acquire gil;
+    // True --> Rising Edge
+    // False --> Falling Edge
+    trigger_controller_.attr("set_trigger_edge")(py::str("left"), rising_edge);
+    trigger_controller_.attr("set_trigger_edge")(py::str("right"), rising_edge);
+}
+
+void NaluBoardPythonWrapper::WriteDacValue(int channel, int value) {
+    py::gil_scoped_acquire gil;
+    dac_controller_.attr("set_single_dac")(channel, value);
+}
+
+void NaluBoardPythonWrapper::WriteReadoutChannels(const std::vector<int>& channels) {
+    py::gil_scoped_acquire gil;
+    py::list py_channels;
+    for (int channel : channels) {
+        py_channels.append(channel);
+    }
+    readout_controller_.attr("set_readout_channels")(py_channels);
+}
+
+void NaluBoardPythonWrapper::WriteReadWindow(int windows, int lookback, int write_after_trig) {
+    py::gil_scoped_acquire gil;
+    readout_controller_.attr("set_read_window")(windows, lookback, write_after_trig);
+}
+
+void NaluBoardPythonWrapper::ConfigureEthernet(const IPAddressInfo& target) {
+    py::gil_scoped_acquire gil;
+    board_.attr("connection_info").attr("__setitem__")("receiver_addr", py::make_tuple(target.getIp(), target.getPort()));
+    connection_controller_.attr("_configure_ethernet")();
+}
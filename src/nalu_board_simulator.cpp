@@ -0,0 +1,427 @@
+#include "nalu_board_simulator.h"
+#include "nalu_board_controller_logger.h"
+#include "nalu_packet_format.h"
+#include "nalu_receiver.h"
+#include "ip_address_info.h"
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <stdexcept>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+
+// Precomputed waveforms per kind (noise only, with pulse); events pick at random
+constexpr int kTemplates = 64;
+
+// Events built before the packets go out in one sendmmsg call
+constexpr int kEventsPerSend = 16;
+
+// Longest sleep between checks of running_, so StopCapture() is prompt
+constexpr uint64_t kMaxSleepNs = 1000000;
+
+// xorshift64*: the per-event choices need to be cheap, not good
+struct FastRng {
+    uint64_t state;
+
+    uint64_t Next() {
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+        return state * 0x2545F4914F6CDD1DULL;
+    }
+
+    double Uniform() {
+        return (Next() >> 11) * (1.0 / 9007199254740992.0);
+    }
+};
+
+std::string Errno() {
+    return std::strerror(errno);
+}
+
+}  // namespace
+
+NaluBoardSimulator::NaluBoardSimulator(const NaluSimulatorParams& params)
+    : params_(params),
+      model_(NaluFindBoardModel(params.model) ? *NaluFindBoardModel(params.model) : kNaluGenericBoardModel) {}
+
+NaluBoardSimulator::~NaluBoardSimulator() {
+    StopCapture();
+}
+
+void NaluBoardSimulator::InitializeBoard() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    registers_.initialized = true;
+    NaluBoardControllerLogger::debug("Simulated board " + std::to_string(params_.board_id) + " initialized as " +
+                                     std::string(model_.name));
+}
+
+void NaluBoardSimulator::StartCapture() {
+    if (running_.load()) {
+        throw std::runtime_error("Simulated board is already capturing");
+    }
+
+    std::vector<int> channels;
+    int windows = 1;
+    std::string target_ip_port;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (int channel : registers_.channels) {
+            if (channel >= 0 && channel < model_.channels) {
+                channels.push_back(channel);
+            }
+        }
+        if (registers_.channels.empty()) {
+            for (int channel = 0; channel < model_.channels; ++channel) {
+                channels.push_back(channel);
+            }
+        }
+        windows = std::clamp(registers_.windows, 1, model_.windows);
+        target_ip_port = params_.target_ip_port;
+    }
+
+    IPAddressInfo target(target_ip_port);
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(static_cast<uint16_t>(target.getPort()));
+    if (inet_pton(AF_INET, target.getIp().c_str(), &address.sin_addr) != 1) {
+        throw std::invalid_argument("Invalid simulator target address: " + target_ip_port);
+    }
+    int fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        throw std::runtime_error("Simulator socket failed: " + Errno());
+    }
+    if (connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+        std::string error = Errno();
+        close(fd);
+        throw std::runtime_error("Simulator cannot reach " + target_ip_port + ": " + error);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        registers_.capturing = true;
+    }
+    running_.store(true);
+    thread_ = std::thread([this, fd, channels, windows] { StreamLoop(fd, channels, windows); });
+    NaluBoardControllerLogger::info("Simulated board " + std::to_string(params_.board_id) + " streaming " +
+                                    std::to_string(channels.size()) + " channel(s) to " + target_ip_port + " at " +
+                                    std::to_string(params_.trigger_rate_hz) + " Hz");
+}
+
+void NaluBoardSimulator::StopCapture() {
+    if (running_.exchange(false) && thread_.joinable()) {
+        thread_.join();
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    registers_.capturing = false;
+}
+
+void NaluBoardSimulator::WriteTriggerValues(const std::vector<int>& values) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    registers_.trigger_values = values;
+}
+
+void NaluBoardSimulator::WriteTriggerReferences(int low_reference, int high_reference) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    registers_.low_reference = low_reference;
+    registers_.high_reference = high_reference;
+}
+
+void NaluBoardSimulator::WriteTriggerEdge(bool rising_edge) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    registers_.rising_edge = rising_edge;
+}
+
+void NaluBoardSimulator::WriteDacValue(int channel, int value) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (channel < 0 || channel >= model_.channels) {
+        throw std::invalid_argument("Simulated board has no channel " + std::to_string(channel));
+    }
+    if (registers_.dac_values.size() <= static_cast<size_t>(channel)) {
+        registers_.dac_values.resize(channel + 1, 0);
+    }
+    registers_.dac_values[channel] = value;
+}
+
+void NaluBoardSimulator::WriteReadoutChannels(const std::vector<int>& channels) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    registers_.channels = channels;
+}
+
+void NaluBoardSimulator::WriteReadWindow(int windows, int lookback, int write_after_trig) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    registers_.windows = windows;
+    registers_.lookback = lookback;
+    registers_.write_after_trig = write_after_trig;
+}
+
+void NaluBoardSimulator::ConfigureEthernet(const IPAddressInfo& target) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    registers_.ethernet = true;
+    params_.target_ip_port = target.getCombined();
+}
+
+void NaluBoardSimulator::SetTarget(const std::string& target_ip_port) {
+    IPAddressInfo target(target_ip_port);   // validates
+    std::lock_guard<std::mutex> lock(mutex_);
+    params_.target_ip_port = target.getCombined();
+}
+
+NaluBoardSimulator::Registers NaluBoardSimulator::CurrentRegisters() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return registers_;
+}
+
+NaluSimulatorStats NaluBoardSimulator::Stats() const {
+    NaluSimulatorStats stats;
+    stats.events = events_.load(std::memory_order_relaxed);
+    stats.packets = packets_.load(std::memory_order_relaxed);
+    stats.bytes = bytes_.load(std::memory_order_relaxed);
+    stats.dropped = dropped_.load(std::memory_order_relaxed);
+    stats.duplicated = duplicated_.load(std::memory_order_relaxed);
+    stats.reordered = reordered_.load(std::memory_order_relaxed);
+    stats.silenced = silenced_.load(std::memory_order_relaxed);
+    stats.send_errors = send_errors_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void NaluBoardSimulator::StreamLoop(int fd, std::vector<int> channels, int windows) {
+    const int samples_per_window = model_.samples_per_window;
+    const size_t samples = static_cast<size_t>(windows) * samples_per_window;
+    const int sample_max = (1 << std::min(model_.sample_bits, 16)) - 1;
+    bool rising_edge;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        rising_edge = registers_.rising_edge;
+    }
+
+    // Waveform templates: [kind][template][sample], kind 0 noise only, 1 with a pulse
+    std::mt19937 generator(params_.seed + static_cast<uint32_t>(params_.board_id));
+    std::normal_distribution<double> noise(0.0, params_.noise_rms);
+    std::uniform_real_distribution<double> position(0.1 * samples, 0.6 * samples);
+    double peak_shape = 0.0;
+    for (double t = 0.0; t < 20.0 * (params_.pulse_rise + params_.pulse_decay); t += 0.01) {
+        peak_shape = std::max(peak_shape, (1.0 - std::exp(-t / params_.pulse_rise)) * std::exp(-t / params_.pulse_decay));
+    }
+    std::vector<uint16_t> templates(2 * kTemplates * samples);
+    for (int kind = 0; kind < 2; ++kind) {
+        for (int index = 0; index < kTemplates; ++index) {
+            uint16_t* waveform = templates.data() + (kind * kTemplates + index) * samples;
+            double start = position(generator);
+            for (size_t i = 0; i < samples; ++i) {
+                double value = params_.baseline + noise(generator);
+                if (kind == 1 && i >= start && peak_shape > 0.0) {
+                    double t = i - start;
+                    double pulse = params_.pulse_amplitude / peak_shape *
+                                   (1.0 - std::exp(-t / params_.pulse_rise)) * std::exp(-t / params_.pulse_decay);
+                    value += rising_edge ? pulse : -pulse;
+                }
+                waveform[i] = static_cast<uint16_t>(std::clamp(std::lround(value), 0L, static_cast<long>(sample_max)));
+            }
+        }
+    }
+
+    uint64_t pulse_mask = 0;
+    for (int channel : params_.pulse_channels.empty() ? channels : params_.pulse_channels) {
+        if (channel >= 0 && channel < kNaluMaxChannels) {
+            pulse_mask |= 1ULL << channel;
+        }
+    }
+
+    const size_t block_bytes = kNaluWindowHeaderBytes + samples_per_window * sizeof(uint16_t);
+    const size_t max_packet = std::max<size_t>(params_.max_packet_bytes, kNaluPacketHeaderBytes + block_bytes);
+    const int blocks_per_packet = static_cast<int>((max_packet - kNaluPacketHeaderBytes) / block_bytes);
+    const int blocks_per_event = static_cast<int>(channels.size()) * windows;
+
+    FastRng rng{0x9E3779B97F4A7C15ULL ^ (static_cast<uint64_t>(params_.seed) << 8) ^ params_.board_id};
+    std::exponential_distribution<double> interval(std::max(params_.trigger_rate_hz, 1e-3) / 1e9);
+    const double period_ns = 1e9 / std::max(params_.trigger_rate_hz, 1e-3);
+    const uint64_t silence_period_ns = static_cast<uint64_t>(std::max(params_.silence_every_ms, 0)) * 1000000ULL;
+    const uint64_t silence_ns = static_cast<uint64_t>(std::max(params_.silence_ms, 0)) * 1000000ULL;
+    const double ticks_per_ns = params_.timestamp_hz / 1e9;
+
+    std::vector<uint8_t> arena;
+    std::vector<std::pair<size_t, size_t>> outgoing;   // offset, size into arena
+    std::vector<iovec> iovecs;
+    std::vector<mmsghdr> messages;
+
+    uint64_t start_ns = NaluMonotonicNs();
+    double next_event_ns = static_cast<double>(start_ns);
+    // Totals carry on across captures
+    uint64_t events = events_.load(), packets = packets_.load(), bytes = bytes_.load(), dropped = dropped_.load(),
+             duplicated = duplicated_.load(), reordered = reordered_.load(), silenced = silenced_.load(),
+             send_errors = send_errors_.load();
+
+    while (running_.load(std::memory_order_relaxed)) {
+        uint64_t now_ns = NaluMonotonicNs();
+        arena.clear();
+        outgoing.clear();
+
+        for (int built = 0; built < kEventsPerSend && next_event_ns <= static_cast<double>(now_ns); ++built) {
+            uint64_t event_ns = static_cast<uint64_t>(next_event_ns);
+            next_event_ns += params_.poisson ? interval(generator) : period_ns;
+            bool silent = silence_period_ns > 0 && (event_ns - start_ns) % silence_period_ns >= silence_period_ns - silence_ns;
+
+            NaluPacketHeader header;
+            header.board_id = static_cast<uint8_t>(params_.board_id);
+            header.event_number = event_number_++;
+            header.timestamp = static_cast<uint64_t>(event_ns * ticks_per_ns);
+            int first_window = static_cast<int>(rng.Next() % model_.windows);
+            // Windows past the end of the circular buffer; the board reads
+            // the buffer out in window order, so these come first
+            int wrapped = std::max(0, first_window + windows - model_.windows);
+
+            // Each channel picks its waveform once per event
+            uint64_t channel_template[kNaluMaxChannels];
+            for (int channel : channels) {
+                bool pulse = ((pulse_mask >> channel) & 1ULL) && rng.Uniform() < params_.pulse_probability;
+                channel_template[channel] = (pulse ? kTemplates : 0) + rng.Next() % kTemplates;
+            }
+
+            int packet_count = (blocks_per_event + blocks_per_packet - 1) / blocks_per_packet;
+            for (int packet = 0, block = 0; packet < packet_count; ++packet) {
+                int count = std::min(blocks_per_packet, blocks_per_event - block);
+                header.flags = (packet == 0 ? kNaluPacketFirst : 0) | (packet == packet_count - 1 ? kNaluPacketLast : 0);
+                header.packet_seq = packet_seq_++;
+                header.block_count = static_cast<uint16_t>(count);
+                header.packet_index = static_cast<uint16_t>(packet);
+
+                size_t size = kNaluPacketHeaderBytes + count * block_bytes;
+                if (silent) {
+                    silenced++;
+                    block += count;
+                    continue;
+                }
+                if (params_.drop_probability > 0.0 && rng.Uniform() < params_.drop_probability) {
+                    dropped++;
+                    block += count;
+                    continue;
+                }
+
+                size_t offset = arena.size();
+                arena.resize(offset + size);
+                uint8_t* out = arena.data() + offset;
+                NaluWritePacketHeader(out, header);
+                out += kNaluPacketHeaderBytes;
+                for (int i = 0; i < count; ++i, ++block) {
+                    int channel = channels[block / windows];
+                    int window = (block % windows + windows - wrapped) % windows;   // in time
+                    out[0] = static_cast<uint8_t>(channel);
+                    out[1] = static_cast<uint8_t>((first_window + window) % model_.windows);
+                    NaluStoreU16(out + 2, static_cast<uint16_t>(samples_per_window));
+                    const uint16_t* source = templates.data() + channel_template[channel] * samples +
+                                             static_cast<size_t>(window) * samples_per_window;
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+                    std::memcpy(out + kNaluWindowHeaderBytes, source, samples_per_window * sizeof(uint16_t));
+#else
+                    for (int s = 0; s < samples_per_window; ++s) {
+                        NaluStoreU16(out + kNaluWindowHeaderBytes + 2 * s, source[s]);
+                    }
+#endif
+                    out += block_bytes;
+                }
+                outgoing.emplace_back(offset, size);
+                if (params_.duplicate_probability > 0.0 && rng.Uniform() < params_.duplicate_probability) {
+                    outgoing.emplace_back(offset, size);
+                    duplicated++;
+                }
+            }
+            events++;
+        }
+
+        if (outgoing.empty()) {
+            uint64_t wait_ns = std::min<uint64_t>(kMaxSleepNs, static_cast<uint64_t>(std::max(0.0, next_event_ns - now_ns)));
+            if (wait_ns > 0) {
+                timespec pause{0, static_cast<long>(wait_ns)};
+                nanosleep(&pause, nullptr);
+            }
+        } else {
+            if (params_.reorder_probability > 0.0) {
+                for (size_t i = 0; i + 1 < outgoing.size(); ++i) {
+                    if (rng.Uniform() < params_.reorder_probability) {
+                        std::swap(outgoing[i], outgoing[i + 1]);
+                        reordered++;
+                        ++i;
+                    }
+                }
+            }
+
+            iovecs.resize(outgoing.size());
+            messages.assign(outgoing.size(), mmsghdr{});
+            for (size_t i = 0; i < outgoing.size(); ++i) {
+                iovecs[i].iov_base = arena.data() + outgoing[i].first;
+                iovecs[i].iov_len = outgoing[i].second;
+                messages[i].msg_hdr.msg_iov = &iovecs[i];
+                messages[i].msg_hdr.msg_iovlen = 1;
+            }
+            size_t sent = 0;
+            while (sent < messages.size()) {
+                int result = sendmmsg(fd, messages.data() + sent, static_cast<unsigned>(messages.size() - sent), 0);
+                if (result < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    // Nobody listening (ECONNREFUSED) or a full queue: lose the rest, like the wire would
+                    send_errors += messages.size() - sent;
+                    break;
+                }
+                for (int i = 0; i < result; ++i) {
+                    bytes += iovecs[sent + i].iov_len;
+                }
+                packets += result;
+                sent += result;
+            }
+        }
+
+        events_.store(events, std::memory_order_relaxed);
+        packets_.store(packets, std::memory_order_relaxed);
+        bytes_.store(bytes, std::memory_order_relaxed);
+        dropped_.store(dropped, std::memory_order_relaxed);
+        duplicated_.store(duplicated, std::memory_order_relaxed);
+        reordered_.store(reordered, std::memory_order_relaxed);
+        silenced_.store(silenced, std::memory_order_relaxed);
+        send_errors_.store(send_errors, std::memory_order_relaxed);
+    }
+    close(fd);
+}
+
+NaluSimulatedBaselineSource::NaluSimulatedBaselineSource(const NaluBoardSimulator* board,
+                                                         std::map<int, NaluSimulatedChannelResponse> responses,
+                                                         uint32_t seed)
+    : board_(board), responses_(std::move(responses)), generator_(seed) {}
+
+double NaluSimulatedBaselineSource::Response(int channel, int dac) const {
+    auto it = responses_.find(channel);
+    NaluSimulatedChannelResponse response = it == responses_.end() ? NaluSimulatedChannelResponse() : it->second;
+    double rise = response.gain * dac;
+    if (response.saturation > 0.0) {
+        rise = response.saturation * std::tanh(rise / response.saturation);
+    }
+    return response.offset + rise;
+}
+
+std::map<int, double> NaluSimulatedBaselineSource::MeasureBaselines(const std::vector<int>& channels) {
+    const NaluBoardSimulator::Registers registers = board_->CurrentRegisters();
+    const double sample_max = (1 << std::min(board_->Model().sample_bits, 16)) - 1;
+    measurements_++;
+
+    std::map<int, double> baselines;
+    for (int channel : channels) {
+        // Unwritten DACs read as 0, like the simulator's registers
+        int dac = static_cast<size_t>(channel) < registers.dac_values.size() ? registers.dac_values[channel] : 0;
+        auto it = responses_.find(channel);
+        double noise_rms = it == responses_.end() ? NaluSimulatedChannelResponse().noise_rms : it->second.noise_rms;
+        double baseline = Response(channel, dac);
+        if (noise_rms > 0.0) {
+            baseline += std::normal_distribution<double>(0.0, noise_rms)(generator_);
+        }
+        baselines[channel] = std::clamp(baseline, 0.0, sample_max);
+    }
+    return baselines;
+}
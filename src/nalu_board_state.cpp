@@ -1,5 +1,7 @@
 #include "nalu_board_state.h"
+#include "nalu_board_controller_logger.h"
 #include <algorithm> // for std::transform
+#include <stdexcept>
 
 NaluBoardState::NaluBoardState(const NaluBoardParams& params) 
     : model_(params.model),  // Initialize first
@@ -10,20 +12,46 @@ NaluBoardState::NaluBoardState(const NaluBoardParams& params)
     
     // Convert model_ to lowercase in-place
     std::transform(model_.begin(), model_.end(), model_.begin(), ::tolower);
+
+    board_model_ = NaluFindBoardModel(model_);
+    if (!board_model_) {
+        NaluBoardControllerLogger::warning("No board descriptor for model '" + model_ +
+                                           "', only generic parameter limits are checked.");
+        board_model_ = &kNaluGenericBoardModel;
+    }
+    dac_values_.fill(NaluChannelInfo().dac_value);
+}
+
+std::vector<int> NaluBoardState::Channels() const {
+    std::vector<int> channels;
+    channels.reserve(EnabledChannelCount());
+    for (uint64_t mask = enabled_mask_; mask; mask &= mask - 1) {
+        channels.push_back(__builtin_ctzll(mask));
+    }
+    return channels;
 }
 
 void NaluBoardState::UpdateFromCaptureParams(const NaluCaptureParams& params) {
+    // Check everything first so a bad channel leaves the state untouched
+    for (const auto& [channel_num, channel_info] : params.channels) {
+        if (channel_num < 0 || channel_num >= board_model_->channels) {
+            throw std::invalid_argument("Channel " + std::to_string(channel_num) + " does not exist on " +
+                                        std::string(board_model_->name) + " (" +
+                                        std::to_string(board_model_->channels) + " channels)");
+        }
+    }
+
     target_ip_ = IPAddressInfo(params.target_ip_port);
-    channels_.clear();
-    trigger_values_.clear();
-    dac_values_.clear();
 
+    // Channels missing from the map are disabled and keep default values
+    enabled_mask_ = 0;
+    trigger_values_.fill(NaluChannelInfo().trigger_value);
+    dac_values_.fill(NaluChannelInfo().dac_value);
     for (const auto& [channel_num, channel_info] : params.channels) {
-        trigger_values_.push_back(channel_info.trigger_value);
-        dac_values_.push_back(channel_info.dac_value);
-
+        trigger_values_[channel_num] = channel_info.trigger_value;
+        dac_values_[channel_num] = channel_info.dac_value;
         if (channel_info.enabled) {
-            channels_.push_back(channel_num);
+            enabled_mask_ |= uint64_t{1} << channel_num;
         }
     }
 
@@ -34,4 +62,18 @@ void NaluBoardState::UpdateFromCaptureParams(const NaluCaptureParams& params) {
     high_reference_ = params.high_reference;
     rising_edge_ = params.rising_edge;
     assign_dac_values_ = params.assign_dac_values;
-}
\ No newline at end of file
+}
+
+void NaluBoardState::SetTriggerValue(int channel, int value) {
+    if (channel < 0 || channel >= board_model_->channels) {
+        throw std::out_of_range("Channel " + std::to_string(channel) + " does not exist on this board.");
+    }
+    trigger_values_[channel] = value;
+}
+
+void NaluBoardState::SetDacValue(int channel, int value) {
+    if (channel < 0 || channel >= board_model_->channels) {
+        throw std::out_of_range("Channel " + std::to_string(channel) + " does not exist on this board.");
+    }
+    dac_values_[channel] = value;
+}
@@ -0,0 +1,246 @@
+#include "nalu_capture_pipeline.h"
+#include "nalu_board_controller_logger.h"
+#include <stdexcept>
+
+NaluCapturePipeline::NaluCapturePipeline(NaluCaptureCounters* counters) : counters_(counters) {}
+
+NaluCapturePipeline::~NaluCapturePipeline() {
+    Stop();
+}
+
+void NaluCapturePipeline::SetPacketSink(NaluPacketSink sink) {
+    if (IsRunning()) {
+        throw std::runtime_error("Cannot change the packet sink while the receiver is running");
+    }
+    packet_sink_ = std::move(sink);
+}
+
+void NaluCapturePipeline::SetEventSink(NaluEventSink sink) {
+    if (IsRunning()) {
+        throw std::runtime_error("Cannot change the event sink while the receiver is running");
+    }
+    event_sink_ = std::move(sink);
+}
+
+void NaluCapturePipeline::SetPacketDecoder(std::shared_ptr<const NaluPacketDecoder> decoder) {
+    if (IsRunning()) {
+        throw std::runtime_error("Cannot change the packet decoder while the receiver is running");
+    }
+    packet_decoder_ = std::move(decoder);
+}
+
+void NaluCapturePipeline::Reset() {
+    Stop();
+    receiver_.reset();
+    recorder_.reset();
+    event_builders_.clear();
+    merger_.reset();
+    filters_.clear();
+    latency_.reset();
+    assemblers_.clear();
+    std::lock_guard<std::mutex> lock(monitor_mutex_);
+    monitor_.reset();
+}
+
+void NaluCapturePipeline::Start(const NaluCaptureParams& params, const NaluEventLayout& layout) {
+    Reset();
+    try {
+        Build(params, layout);
+        // Threads start only once every stage exists, the receiver last
+        if (merger_) {
+            merger_->Start();
+        }
+        if (recorder_) {
+            recorder_->Start();
+        }
+        if (receiver_) {
+            receiver_->Start([this](int queue, const uint8_t* data, size_t size, uint64_t rx_ns) {
+                if (size > 0) {
+                    if (recorder_) {
+                        recorder_->Record(queue, data, size, rx_ns);
+                    }
+                    if (packet_sink_) {
+                        packet_sink_(queue, data, size, rx_ns);
+                    }
+                }
+                event_builders_[queue]->HandlePacket(data, size, rx_ns);
+            });
+        }
+    } catch (...) {
+        // A stage that could not be built or started takes the others down with it
+        Reset();
+        throw;
+    }
+}
+
+void NaluCapturePipeline::Build(const NaluCaptureParams& params, const NaluEventLayout& layout) {
+    receiver_ = NaluReceiver::Create(params.receiver, params.target_ip_port, counters_);
+    if (!receiver_) {
+        return;
+    }
+
+    // The event sink is called by the merge thread, or by each receive thread
+    // without the merger; each records the latency of what it hands over
+    latency_ = std::make_unique<NaluLatencyTracker>(params.merge.enabled ? 1 : receiver_->QueueCount());
+    auto terminal = [&](int producer) -> NaluEventSink {
+        return [latency = latency_.get(), producer, sink = event_sink_](NaluEvent&& event) {
+            event.processed_ns = NaluMonotonicNs();
+            const uint64_t first_rx_ns = event.first_rx_ns;
+            const uint64_t built_ns = event.built_ns;
+            const uint64_t processed_ns = event.processed_ns;
+            if (sink) {
+                sink(std::move(event));
+            }
+            latency->Record(producer, first_rx_ns, built_ns, processed_ns, NaluMonotonicNs());
+        };
+    };
+
+    // builders -> [merger] -> [filter] -> event sink; a filter is fed by one
+    // thread, so without the merger every queue gets its own
+    auto add_filter = [&](int producer) -> NaluEventSink {
+        filters_.push_back(
+            std::make_unique<NaluEventFilter>(params.filter, params.merge.clock_offsets, terminal(producer)));
+        return [filter = filters_.back().get()](NaluEvent&& event) { filter->HandleEvent(std::move(event)); };
+    };
+    if (params.merge.enabled) {
+        merger_ = std::make_unique<NaluEventMerger>(params.merge, params.filter.enabled ? add_filter(0) : terminal(0));
+    }
+
+    if (params.monitor.enabled) {
+        std::lock_guard<std::mutex> lock(monitor_mutex_);
+        monitor_ = std::make_unique<NaluMonitor>(params.monitor, receiver_->QueueCount());
+    }
+
+    for (int queue = 0; queue < receiver_->QueueCount(); ++queue) {
+        NaluEventSink builder_sink;
+        if (merger_) {
+            builder_sink = [merger = merger_.get()](NaluEvent&& event) { merger->Push(std::move(event)); };
+        } else if (params.filter.enabled) {
+            builder_sink = add_filter(queue);
+        } else {
+            builder_sink = terminal(queue);
+        }
+        if (monitor_) {
+            // The tap sees every built event, before any filtering
+            builder_sink = [monitor = monitor_.get(), queue, next = std::move(builder_sink)](NaluEvent&& event) {
+                monitor->Observe(queue, event);
+                if (next) {
+                    next(std::move(event));
+                }
+            };
+        }
+        if (params.waveform.enabled) {
+            assemblers_.push_back(std::make_unique<NaluWaveformAssembler>(layout));
+            builder_sink = [assembler = assemblers_.back().get(), next = std::move(builder_sink)](NaluEvent&& event) {
+                assembler->Assemble(event);
+                next(std::move(event));
+            };
+        }
+        event_builders_.push_back(
+            std::make_unique<NaluEventBuilder>(params.event_builder, layout, counters_, builder_sink, packet_decoder_));
+    }
+
+    if (!params.record.path.empty()) {
+        recorder_ = std::make_unique<NaluCaptureRecorder>(params.record, receiver_->QueueCount());
+    }
+}
+
+void NaluCapturePipeline::Stop() {
+    if (!IsRunning()) {
+        return;
+    }
+    receiver_->Stop();
+    if (recorder_) {
+        recorder_->Stop();
+    }
+    // Receive threads are gone: deliver what is still open as partial
+    for (auto& builder : event_builders_) {
+        builder->Flush();
+    }
+    if (merger_) {
+        merger_->Stop();
+    }
+    for (auto& filter : filters_) {
+        filter->Flush();
+    }
+
+    NaluLatencyStats latency = latency_->Stats();
+    if (latency.total.count > 0) {
+        NaluBoardControllerLogger::info("Event latency over " + std::to_string(latency.total.count) +
+                                        " events: first packet to built " + latency.build.ToString() +
+                                        "; built to sink " + latency.process.ToString() + "; in sink " +
+                                        latency.sink.ToString() + "; total " + latency.total.ToString());
+    }
+}
+
+std::vector<NaluReceiverQueueStats> NaluCapturePipeline::ReceiverStats() const {
+    if (!receiver_) {
+        return {};
+    }
+    return receiver_->Stats();
+}
+
+NaluDataPathStats NaluCapturePipeline::DataPathStats() const {
+    NaluDataPathStats stats;
+    for (const auto& builder : event_builders_) {
+        stats.Add(builder->Stats());
+    }
+    return stats;
+}
+
+NaluMergeStats NaluCapturePipeline::MergeStats() const {
+    if (!merger_) {
+        return {};
+    }
+    return merger_->Stats();
+}
+
+NaluFilterStats NaluCapturePipeline::FilterStats() const {
+    NaluFilterStats stats;
+    for (const auto& filter : filters_) {
+        stats.Add(filter->Stats());
+    }
+    return stats;
+}
+
+NaluWaveformStats NaluCapturePipeline::WaveformStats() const {
+    NaluWaveformStats stats;
+    for (const auto& assembler : assemblers_) {
+        stats.Add(assembler->Stats());
+    }
+    return stats;
+}
+
+NaluRecorderStats NaluCapturePipeline::RecorderStats() const {
+    if (!recorder_) {
+        return {};
+    }
+    return recorder_->Stats();
+}
+
+NaluLatencyStats NaluCapturePipeline::LatencyStats() const {
+    if (!latency_) {
+        return {};
+    }
+    return latency_->Stats();
+}
+
+NaluMonitorSnapshot NaluCapturePipeline::MonitorSnapshot() const {
+    std::lock_guard<std::mutex> lock(monitor_mutex_);
+    if (!monitor_) {
+        return {};
+    }
+    return monitor_->Snapshot();
+}
+
+NaluEventLayout NaluCapturePipeline::LayoutFor(const NaluCaptureParams& params) {
+    NaluEventLayout layout;
+    for (const auto& [channel, info] : params.channels) {
+        if (info.enabled && channel >= 0 && channel < kNaluMaxChannels) {
+            layout.channel_mask |= uint64_t{1} << channel;
+        }
+    }
+    layout.windows = params.windows;
+    layout.buffer_windows = params.waveform.buffer_windows;
+    return layout;
+}
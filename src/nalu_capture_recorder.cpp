@@ -0,0 +1,157 @@
+#include "nalu_capture_recorder.h"
+#include "nalu_board_controller_logger.h"
+#include "nalu_capture_file.h"
+#include "nalu_receiver.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+// Writer nap when no chunk is waiting
+constexpr auto kIdleSleep = std::chrono::milliseconds(1);
+
+}  // namespace
+
+NaluCaptureRecorder::NaluCaptureRecorder(const NaluRecordParams& params, int queues)
+    : params_(params), chunk_bytes_(static_cast<size_t>(std::max(params.chunk_bytes, 4096))) {
+    file_ = std::fopen(params_.path.c_str(), "wb");
+    if (!file_) {
+        throw std::runtime_error("Cannot create capture file " + params_.path + ": " + std::strerror(errno));
+    }
+
+    NaluCaptureFileHeader header;
+    header.queues = static_cast<uint32_t>(std::max(queues, 1));
+    header.start_ns = NaluMonotonicNs();
+    header.start_unix_ns = static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch())
+            .count());
+    uint8_t bytes[kNaluCaptureHeaderBytes];
+    NaluWriteCaptureHeader(bytes, header);
+    if (std::fwrite(bytes, 1, sizeof(bytes), file_) != sizeof(bytes)) {
+        std::fclose(file_);
+        throw std::runtime_error("Cannot write capture file " + params_.path);
+    }
+    bytes_.store(sizeof(bytes));
+
+    size_t chunks = static_cast<size_t>(std::max(params_.max_chunks, 2));
+    for (uint32_t i = 0; i < header.queues; ++i) {
+        auto queue = std::make_unique<Queue>(chunks);
+        queue->current.bytes.reserve(chunk_bytes_);
+        queues_.push_back(std::move(queue));
+    }
+}
+
+NaluCaptureRecorder::~NaluCaptureRecorder() {
+    Stop();
+    if (file_) {
+        std::fclose(file_);
+    }
+}
+
+void NaluCaptureRecorder::Start() {
+    if (running_.exchange(true)) {
+        return;
+    }
+    thread_ = std::thread([this] { WriteLoop(); });
+    NaluBoardControllerLogger::info("Recording received packets to " + params_.path);
+}
+
+void NaluCaptureRecorder::Stop() {
+    if (!running_.exchange(false)) {
+        return;
+    }
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    // The receive threads are gone: their partial chunks are ours now
+    for (auto& queue : queues_) {
+        Submit(*queue);
+    }
+    WriteAvailable();
+    std::fflush(file_);
+
+    NaluRecorderStats stats = Stats();
+    NaluBoardControllerLogger::info("Recorded " + std::to_string(stats.packets) + " packet(s), " +
+                                    std::to_string(stats.bytes) + " bytes to " + params_.path +
+                                    (stats.dropped_packets > 0
+                                         ? " (" + std::to_string(stats.dropped_packets) + " dropped)"
+                                         : ""));
+}
+
+void NaluCaptureRecorder::Record(int queue_index, const uint8_t* data, size_t size, uint64_t rx_ns) {
+    Queue& queue = *queues_[queue_index];
+    size_t record_bytes = kNaluCaptureRecordHeaderBytes + size;
+    if (!queue.current.bytes.empty() && queue.current.bytes.size() + record_bytes > chunk_bytes_) {
+        Submit(queue);
+    }
+
+    std::vector<uint8_t>& bytes = queue.current.bytes;
+    size_t offset = bytes.size();
+    bytes.resize(offset + record_bytes);
+    NaluWriteCaptureRecordHeader(bytes.data() + offset, rx_ns, static_cast<uint16_t>(queue_index),
+                                 static_cast<uint32_t>(size));
+    std::memcpy(bytes.data() + offset + kNaluCaptureRecordHeaderBytes, data, size);
+    queue.current.packets++;
+}
+
+NaluRecorderStats NaluCaptureRecorder::Stats() const {
+    NaluRecorderStats stats;
+    for (const auto& queue : queues_) {
+        stats.packets += queue->packets.load(std::memory_order_relaxed);
+        stats.dropped_packets += queue->dropped.load(std::memory_order_relaxed);
+    }
+    stats.bytes = bytes_.load(std::memory_order_relaxed);
+    stats.chunks_written = chunks_written_.load(std::memory_order_relaxed);
+    stats.write_errors = write_errors_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void NaluCaptureRecorder::Submit(Queue& queue) {
+    if (queue.current.packets == 0) {
+        return;
+    }
+    uint64_t packets = queue.current.packets;
+    if (queue.full.TryPush(std::move(queue.current))) {
+        queue.packets.fetch_add(packets, std::memory_order_relaxed);
+        // Reuse a written chunk when there is one; allocate only while warming up
+        if (!queue.empty.TryPop(queue.current)) {
+            queue.current.bytes.reserve(chunk_bytes_);
+        }
+    } else {
+        queue.dropped.fetch_add(packets, std::memory_order_relaxed);
+    }
+    queue.current.bytes.clear();
+    queue.current.packets = 0;
+}
+
+bool NaluCaptureRecorder::WriteAvailable() {
+    bool wrote = false;
+    Chunk chunk;
+    for (auto& queue : queues_) {
+        while (queue->full.TryPop(chunk)) {
+            size_t written = std::fwrite(chunk.bytes.data(), 1, chunk.bytes.size(), file_);
+            bytes_.fetch_add(written, std::memory_order_relaxed);
+            if (written != chunk.bytes.size()) {
+                write_errors_.fetch_add(1, std::memory_order_relaxed);
+            } else {
+                chunks_written_.fetch_add(1, std::memory_order_relaxed);
+            }
+            chunk.bytes.clear();
+            chunk.packets = 0;
+            queue->empty.TryPush(std::move(chunk));
+            wrote = true;
+        }
+    }
+    return wrote;
+}
+
+void NaluCaptureRecorder::WriteLoop() {
+    while (running_.load(std::memory_order_relaxed)) {
+        if (!WriteAvailable()) {
+            std::this_thread::sleep_for(kIdleSleep);
+        }
+    }
+}
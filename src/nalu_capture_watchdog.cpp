@@ -0,0 +1,207 @@
+#include "nalu_capture_watchdog.h"
+#include "nalu_board_controller_logger.h"
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+
+const char* LevelName(NaluRecoveryLevel level) {
+    switch (level) {
+        case NaluRecoveryLevel::RESTART_READOUT:
+            return "restart readout";
+        case NaluRecoveryLevel::RECONFIGURE:
+            return "reconfigure";
+        case NaluRecoveryLevel::REINITIALIZE:
+            return "re-initialize";
+        default:
+            return "none";
+    }
+}
+
+uint64_t CounterDelta(uint64_t now, uint64_t before) {
+    // Counters may have been reset underneath us
+    return now >= before ? now - before : now;
+}
+
+double ToMilliseconds(std::chrono::nanoseconds duration) {
+    return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+}  // namespace
+
+NaluCaptureWatchdog::NaluCaptureWatchdog(const NaluWatchdogParams& params,
+                                         const NaluCaptureCounters* counters,
+                                         NaluBoardBackend* backend,
+                                         NaluBoardConfigurator* configurator)
+    : params_(params), counters_(counters), backend_(backend), configurator_(configurator) {
+    if (params_.rate_window_ms <= 0 || params_.stall_timeout_ms < 0 || params_.recovery_grace_ms < 0) {
+        throw std::invalid_argument("Invalid watchdog timing parameters.");
+    }
+    if (params_.max_recovery_attempts < 1) {
+        throw std::invalid_argument("Watchdog max_recovery_attempts must be at least 1.");
+    }
+}
+
+void NaluCaptureWatchdog::Arm() {
+    Arm(Clock::now());
+}
+
+void NaluCaptureWatchdog::Arm(Clock::time_point now) {
+    armed_ = true;
+    gave_up_ = false;
+    attempts_at_last_level_ = 0;
+    stats_.stalled = false;
+    stats_.level = NaluRecoveryLevel::NONE;
+    last_activity_ = now;
+    ResetRateWindow(now);
+    NaluBoardControllerLogger::debug(
+        "Watchdog armed: min packet rate " + std::to_string(params_.min_packet_rate) +
+        "/s, min event rate " + std::to_string(params_.min_event_rate) +
+        "/s, stall timeout " + std::to_string(params_.stall_timeout_ms) + " ms");
+}
+
+void NaluCaptureWatchdog::Disarm() {
+    armed_ = false;
+    NaluBoardControllerLogger::debug("Watchdog disarmed");
+}
+
+bool NaluCaptureWatchdog::Poll() {
+    return Poll(Clock::now());
+}
+
+bool NaluCaptureWatchdog::Poll(Clock::time_point now) {
+    if (!armed_ || now - window_start_ < std::chrono::milliseconds(params_.rate_window_ms)) {
+        return false;
+    }
+
+    NaluCaptureCountersSnapshot snapshot = counters_->Snapshot();
+    bool healthy = RatesHealthy(snapshot, now);
+    window_start_ = now;
+    window_snapshot_ = snapshot;
+
+    if (healthy) {
+        if (stats_.stalled) {
+            OnRecovered(now);
+        }
+        last_activity_ = now;
+        return false;
+    }
+
+    if (!stats_.stalled) {
+        if (now - last_activity_ < std::chrono::milliseconds(params_.stall_timeout_ms)) {
+            return false;
+        }
+        stats_.stalled = true;
+        stats_.stalls_detected++;
+        stats_.level = NaluRecoveryLevel::NONE;
+        attempts_at_last_level_ = 0;
+        gave_up_ = false;
+        NaluBoardControllerLogger::warning(
+            "Data stall detected: rates below threshold for " +
+            std::to_string(ToMilliseconds(now - last_activity_)) + " ms");
+        RunRecoveryStep(NaluRecoveryLevel::RESTART_READOUT, now);
+        return true;
+    }
+
+    if (gave_up_ || now < grace_until_) {
+        return false;
+    }
+
+    NaluRecoveryLevel next = static_cast<NaluRecoveryLevel>(
+        std::min(static_cast<int>(stats_.level) + 1, static_cast<int>(NaluRecoveryLevel::REINITIALIZE)));
+    if (next == NaluRecoveryLevel::REINITIALIZE && attempts_at_last_level_ >= params_.max_recovery_attempts) {
+        gave_up_ = true;
+        stats_.gave_up++;
+        NaluBoardControllerLogger::error(
+            "Watchdog giving up after " + std::to_string(attempts_at_last_level_) +
+            " re-initialization attempts; data is still stalled");
+        return false;
+    }
+
+    RunRecoveryStep(next, now);
+    return true;
+}
+
+bool NaluCaptureWatchdog::RatesHealthy(const NaluCaptureCountersSnapshot& snapshot,
+                                       Clock::time_point now) const {
+    double elapsed = std::chrono::duration<double>(now - window_start_).count();
+    if (elapsed <= 0.0) {
+        return true;
+    }
+
+    double packet_rate = CounterDelta(snapshot.packets, window_snapshot_.packets) / elapsed;
+    double event_rate = CounterDelta(snapshot.events, window_snapshot_.events) / elapsed;
+
+    bool packets_ok = params_.min_packet_rate <= 0.0 || packet_rate >= params_.min_packet_rate;
+    bool events_ok = params_.min_event_rate <= 0.0 || event_rate >= params_.min_event_rate;
+    return packets_ok && events_ok;
+}
+
+void NaluCaptureWatchdog::ResetRateWindow(Clock::time_point now) {
+    window_start_ = now;
+    window_snapshot_ = counters_->Snapshot();
+}
+
+void NaluCaptureWatchdog::OnRecovered(Clock::time_point now) {
+    auto deadtime = std::chrono::duration_cast<std::chrono::nanoseconds>(now - last_activity_);
+    stats_.stalled = false;
+    stats_.recoveries++;
+    stats_.last_deadtime = deadtime;
+    stats_.total_deadtime += deadtime;
+    NaluBoardControllerLogger::info(
+        "Data flow recovered after " + std::string(LevelName(stats_.level)) +
+        ", deadtime " + std::to_string(ToMilliseconds(deadtime)) + " ms");
+    stats_.level = NaluRecoveryLevel::NONE;
+    attempts_at_last_level_ = 0;
+    gave_up_ = false;
+}
+
+void NaluCaptureWatchdog::RunRecoveryStep(NaluRecoveryLevel level, Clock::time_point now) {
+    NaluRecoveryStepStats& step = stats_.steps[static_cast<int>(level) - 1];
+    stats_.level = level;
+    step.attempts++;
+    if (level == NaluRecoveryLevel::REINITIALIZE) {
+        attempts_at_last_level_++;
+    }
+
+    NaluBoardControllerLogger::warning("Watchdog recovery step: " + std::string(LevelName(level)));
+    auto start = Clock::now();
+    try {
+        StopReadoutQuietly();
+        if (level == NaluRecoveryLevel::REINITIALIZE) {
+            backend_->InitializeBoard();
+        }
+        if (level >= NaluRecoveryLevel::RECONFIGURE) {
+            configurator_->ConfigureForCapture();
+        }
+        backend_->StartCapture();
+    } catch (const std::exception& e) {
+        step.failures++;
+        NaluBoardControllerLogger::error(
+            "Watchdog recovery step '" + std::string(LevelName(level)) + "' failed: " + e.what());
+    }
+    auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start);
+    step.last_time = duration;
+    step.total_time += duration;
+    NaluBoardControllerLogger::debug(
+        "Recovery step '" + std::string(LevelName(level)) + "' took " +
+        std::to_string(ToMilliseconds(duration)) + " ms");
+
+    // Data that arrives once the step is done counts towards recovery, so
+    // the next rate window starts when the step ended, not when it began; the
+    // next step only runs once the grace period after this one has passed.
+    // (`now` may be an explicit clock, so the end is now plus what the step took.)
+    Clock::time_point done = now + duration;
+    ResetRateWindow(done);
+    grace_until_ = done + std::chrono::milliseconds(params_.recovery_grace_ms);
+}
+
+void NaluCaptureWatchdog::StopReadoutQuietly() {
+    // Readout may already be dead (that is why we are here), so a failing stop
+    // must not prevent the rest of the step.
+    try {
+        backend_->StopCapture();
+    } catch (const std::exception& e) {
+        NaluBoardControllerLogger::warning(std::string("Stop readout during recovery failed: ") + e.what());
+    }
+}
@@ -0,0 +1,1323 @@
+#include "nalu_config_file.h"
+#include "nalu_params_validator.h"
+#include <sys/stat.h>
+#include <cctype>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// ---------------------------------------------------------------------------
+// Document tree shared by the JSON and YAML readers
+
+struct Value {
+    enum class Type { NUL, BOOL, INT, DOUBLE, STRING, ARRAY, OBJECT };
+
+    Type type = Type::NUL;
+    bool boolean = false;
+    long long integer = 0;
+    double number = 0.0;
+    std::string string;
+    std::vector<Value> array;
+    std::vector<std::pair<std::string, Value>> object;
+    int line = 0;
+};
+
+[[noreturn]] void Fail(int line, const std::string& message) {
+    throw std::invalid_argument("line " + std::to_string(line) + ": " + message);
+}
+
+// Nesting of mappings and lists the readers follow before giving up, so a
+// hostile document cannot run them out of stack
+constexpr int kMaxNesting = 64;
+
+[[noreturn]] void FailNesting(int line) {
+    Fail(line, "nested deeper than " + std::to_string(kMaxNesting) + " levels");
+}
+
+// YAML-style resolution of an unquoted scalar
+Value ResolvePlainScalar(std::string_view text, int line) {
+    Value value;
+    value.line = line;
+    if (text.empty() || text == "~" || text == "null" || text == "Null" || text == "NULL") {
+        return value;
+    }
+    if (text == "true" || text == "True" || text == "TRUE") {
+        value.type = Value::Type::BOOL;
+        value.boolean = true;
+        return value;
+    }
+    if (text == "false" || text == "False" || text == "FALSE") {
+        value.type = Value::Type::BOOL;
+        return value;
+    }
+
+    std::string buffer(text);
+    char* end = nullptr;
+    errno = 0;
+    long long integer = std::strtoll(buffer.c_str(), &end, 10);
+    if (end == buffer.c_str() + buffer.size() && errno == 0) {
+        value.type = Value::Type::INT;
+        value.integer = integer;
+        return value;
+    }
+    double number = std::strtod(buffer.c_str(), &end);
+    if (end == buffer.c_str() + buffer.size() && (std::isdigit(static_cast<unsigned char>(buffer.back())) || buffer.back() == '.')) {
+        value.type = Value::Type::DOUBLE;
+        value.number = number;
+        return value;
+    }
+
+    value.type = Value::Type::STRING;
+    value.string = std::move(buffer);
+    return value;
+}
+
+// ---------------------------------------------------------------------------
+// JSON reader. In relaxed mode it also reads YAML flow collections: single
+// quoted strings and unquoted scalars/keys.
+
+class JsonReader {
+public:
+    // `depth`: nesting the text is found at, for flow collections in YAML blocks
+    JsonReader(std::string_view text, bool relaxed, int first_line = 1, int depth = 0)
+        : text_(text), relaxed_(relaxed), line_(first_line), depth_(depth) {}
+
+    Value ParseDocument() {
+        SkipWhitespace();
+        Value value = ParseValue();
+        SkipWhitespace();
+        if (pos_ != text_.size()) {
+            Fail(line_, "unexpected trailing characters");
+        }
+        return value;
+    }
+
+private:
+    void SkipWhitespace() {
+        while (pos_ < text_.size()) {
+            char c = text_[pos_];
+            if (c == '\n') {
+                line_++;
+            } else if (c != ' ' && c != '\t' && c != '\r') {
+                return;
+            }
+            pos_++;
+        }
+    }
+
+    char Peek() const { return pos_ < text_.size() ? text_[pos_] : '\0'; }
+
+    void Expect(char c) {
+        if (Peek() != c) {
+            Fail(line_, std::string("expected '") + c + "'");
+        }
+        pos_++;
+    }
+
+    Value ParseValue() {
+        char c = Peek();
+        switch (c) {
+            case '{':
+            case '[': {
+                if (++depth_ > kMaxNesting) {
+                    FailNesting(line_);
+                }
+                Value value = c == '{' ? ParseObject() : ParseArray();
+                depth_--;
+                return value;
+            }
+            case '"':
+                return MakeString(ParseQuoted());
+            case '\'':
+                if (relaxed_) {
+                    return MakeString(ParseSingleQuoted());
+                }
+                break;
+            case '\0':
+                Fail(line_, "unexpected end of input");
+            default:
+                break;
+        }
+        if (relaxed_) {
+            return ResolvePlainScalar(ParseBare(), line_);
+        }
+        return ParseLiteral();
+    }
+
+    Value MakeString(std::string text) {
+        Value value;
+        value.type = Value::Type::STRING;
+        value.string = std::move(text);
+        value.line = line_;
+        return value;
+    }
+
+    Value ParseObject() {
+        Value value;
+        value.type = Value::Type::OBJECT;
+        value.line = line_;
+        Expect('{');
+        SkipWhitespace();
+        if (Peek() == '}') {
+            pos_++;
+            return value;
+        }
+        while (true) {
+            SkipWhitespace();
+            std::string key;
+            if (Peek() == '"') {
+                key = ParseQuoted();
+            } else if (relaxed_ && Peek() == '\'') {
+                key = ParseSingleQuoted();
+            } else if (relaxed_) {
+                key = std::string(ParseBare());
+            } else {
+                Fail(line_, "expected a quoted key");
+            }
+            SkipWhitespace();
+            Expect(':');
+            SkipWhitespace();
+            value.object.emplace_back(std::move(key), ParseValue());
+            SkipWhitespace();
+            if (Peek() == ',') {
+                pos_++;
+                continue;
+            }
+            Expect('}');
+            return value;
+        }
+    }
+
+    Value ParseArray() {
+        Value value;
+        value.type = Value::Type::ARRAY;
+        value.line = line_;
+        Expect('[');
+        SkipWhitespace();
+        if (Peek() == ']') {
+            pos_++;
+            return value;
+        }
+        while (true) {
+            SkipWhitespace();
+            value.array.push_back(ParseValue());
+            SkipWhitespace();
+            if (Peek() == ',') {
+                pos_++;
+                continue;
+            }
+            Expect(']');
+            return value;
+        }
+    }
+
+    std::string ParseQuoted() {
+        Expect('"');
+        std::string out;
+        while (true) {
+            if (pos_ >= text_.size()) {
+                Fail(line_, "unterminated string");
+            }
+            char c = text_[pos_++];
+            if (c == '"') {
+                return out;
+            }
+            if (c == '\n') {
+                Fail(line_, "newline in string");
+            }
+            if (c != '\\') {
+                out.push_back(c);
+                continue;
+            }
+            if (pos_ >= text_.size()) {
+                Fail(line_, "unterminated escape");
+            }
+            char escape = text_[pos_++];
+            switch (escape) {
+                case '"': out.push_back('"'); break;
+                case '\\': out.push_back('\\'); break;
+                case '/': out.push_back('/'); break;
+                case 'b': out.push_back('\b'); break;
+                case 'f': out.push_back('\f'); break;
+                case 'n': out.push_back('\n'); break;
+                case 'r': out.push_back('\r'); break;
+                case 't': out.push_back('\t'); break;
+                case 'u': AppendUtf8(ParseHex4(), out); break;
+                default: Fail(line_, std::string("invalid escape '\\") + escape + "'");
+            }
+        }
+    }
+
+    unsigned ParseHex4() {
+        if (pos_ + 4 > text_.size()) {
+            Fail(line_, "truncated \\u escape");
+        }
+        unsigned code = 0;
+        for (int i = 0; i < 4; ++i) {
+            char c = text_[pos_++];
+            code <<= 4;
+            if (c >= '0' && c <= '9') code |= c - '0';
+            else if (c >= 'a' && c <= 'f') code |= c - 'a' + 10;
+            else if (c >= 'A' && c <= 'F') code |= c - 'A' + 10;
+            else Fail(line_, "invalid \\u escape");
+        }
+        return code;
+    }
+
+    void AppendUtf8(unsigned code, std::string& out) {
+        // Combine surrogate pairs
+        if (code >= 0xD800 && code <= 0xDBFF && text_.substr(pos_, 2) == "\\u") {
+            pos_ += 2;
+            unsigned low = ParseHex4();
+            code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+        }
+        if (code < 0x80) {
+            out.push_back(static_cast<char>(code));
+        } else if (code < 0x800) {
+            out.push_back(static_cast<char>(0xC0 | (code >> 6)));
+            out.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+        } else if (code < 0x10000) {
+            out.push_back(static_cast<char>(0xE0 | (code >> 12)));
+            out.push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+            out.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+        } else {
+            out.push_back(static_cast<char>(0xF0 | (code >> 18)));
+            out.push_back(static_cast<char>(0x80 | ((code >> 12) & 0x3F)));
+            out.push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+            out.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+        }
+    }
+
+    std::string ParseSingleQuoted() {
+        Expect('\'');
+        std::string out;
+        while (true) {
+            if (pos_ >= text_.size() || text_[pos_] == '\n') {
+                Fail(line_, "unterminated string");
+            }
+            char c = text_[pos_++];
+            if (c == '\'') {
+                if (Peek() == '\'') {  // '' is an escaped quote
+                    out.push_back('\'');
+                    pos_++;
+                    continue;
+                }
+                return out;
+            }
+            out.push_back(c);
+        }
+    }
+
+    std::string_view ParseBare() {
+        size_t start = pos_;
+        while (pos_ < text_.size()) {
+            char c = text_[pos_];
+            if (c == ',' || c == ']' || c == '}' || c == '\n' || (c == ':' && IsSeparatorAt(pos_ + 1))) {
+                break;
+            }
+            pos_++;
+        }
+        std::string_view bare = text_.substr(start, pos_ - start);
+        while (!bare.empty() && (bare.back() == ' ' || bare.back() == '\t' || bare.back() == '\r')) {
+            bare.remove_suffix(1);
+        }
+        return bare;
+    }
+
+    bool IsSeparatorAt(size_t index) const {
+        return index >= text_.size() || text_[index] == ' ' || text_[index] == '\n' ||
+               text_[index] == ',' || text_[index] == '}' || text_[index] == ']';
+    }
+
+    Value ParseLiteral() {
+        size_t start = pos_;
+        while (pos_ < text_.size()) {
+            char c = text_[pos_];
+            if (c == ',' || c == ']' || c == '}' || c == ' ' || c == '\n' || c == '\t' || c == '\r') {
+                break;
+            }
+            pos_++;
+        }
+        std::string_view literal = text_.substr(start, pos_ - start);
+        Value value;
+        value.line = line_;
+        if (literal == "null") {
+            return value;
+        }
+        if (literal == "true" || literal == "false") {
+            value.type = Value::Type::BOOL;
+            value.boolean = literal == "true";
+            return value;
+        }
+        if (!literal.empty() && (literal[0] == '-' || std::isdigit(static_cast<unsigned char>(literal[0])))) {
+            Value number = ResolvePlainScalar(literal, line_);
+            if (number.type == Value::Type::INT || number.type == Value::Type::DOUBLE) {
+                return number;
+            }
+        }
+        Fail(line_, "invalid literal '" + std::string(literal) + "'");
+    }
+
+    std::string_view text_;
+    bool relaxed_;
+    int line_;
+    int depth_;
+    size_t pos_ = 0;
+};
+
+// ---------------------------------------------------------------------------
+// YAML block reader
+
+class YamlReader {
+public:
+    explicit YamlReader(const std::string& text) { SplitLines(text); }
+
+    Value ParseDocument() {
+        if (lines_.empty()) {
+            Value empty;
+            empty.type = Value::Type::OBJECT;
+            return empty;
+        }
+        size_t index = 0;
+        Value value = ParseBlock(index, lines_[0].indent);
+        if (index != lines_.size()) {
+            Fail(lines_[index].number, "unexpected indentation");
+        }
+        return value;
+    }
+
+private:
+    struct Line {
+        int indent = 0;
+        std::string content;
+        int number = 0;
+    };
+
+    void SplitLines(const std::string& text) {
+        std::istringstream stream(text);
+        std::string raw;
+        int number = 0;
+        while (std::getline(stream, raw)) {
+            number++;
+            if (!raw.empty() && raw.back() == '\r') {
+                raw.pop_back();
+            }
+            std::string content = StripComment(raw);
+            size_t first = content.find_first_not_of(' ');
+            if (first == std::string::npos) {
+                continue;
+            }
+            if (content.find('\t') < first) {
+                Fail(number, "tabs are not allowed for indentation");
+            }
+            content.erase(content.find_last_not_of(" \t") + 1);
+            std::string body = content.substr(first);
+            if (body == "---" || body == "...") {
+                continue;
+            }
+            if (body[0] == '&' || body[0] == '*' || body[0] == '!' || body[0] == '|' || body[0] == '>') {
+                Fail(number, "anchors, tags and block scalars are not supported");
+            }
+            lines_.push_back({static_cast<int>(first), body, number});
+        }
+    }
+
+    static std::string StripComment(const std::string& line) {
+        char quote = 0;
+        for (size_t i = 0; i < line.size(); ++i) {
+            char c = line[i];
+            if (quote) {
+                if (c == quote) quote = 0;
+            } else if (c == '"' || c == '\'') {
+                quote = c;
+            } else if (c == '#' && (i == 0 || line[i - 1] == ' ' || line[i - 1] == '\t')) {
+                return line.substr(0, i);
+            }
+        }
+        return line;
+    }
+
+    static bool IsSequenceItem(const std::string& content) {
+        return content == "-" || content.rfind("- ", 0) == 0;
+    }
+
+    // Position of the ':' separating key and value, or npos
+    static size_t FindKeySeparator(const std::string& content) {
+        char quote = 0;
+        int depth = 0;
+        for (size_t i = 0; i < content.size(); ++i) {
+            char c = content[i];
+            if (quote) {
+                if (c == quote) quote = 0;
+            } else if (c == '"' || c == '\'') {
+                quote = c;
+            } else if (c == '{' || c == '[') {
+                depth++;
+            } else if (c == '}' || c == ']') {
+                depth--;
+            } else if (c == ':' && depth == 0 && (i + 1 == content.size() || content[i + 1] == ' ')) {
+                return i;
+            }
+        }
+        return std::string::npos;
+    }
+
+    Value ParseBlock(size_t& index, int indent) {
+        if (++depth_ > kMaxNesting) {
+            FailNesting(lines_[index].number);
+        }
+        Value value = IsSequenceItem(lines_[index].content) ? ParseSequence(index, indent)
+                                                            : ParseMapping(index, indent);
+        depth_--;
+        return value;
+    }
+
+    Value ParseMapping(size_t& index, int indent) {
+        Value value;
+        value.type = Value::Type::OBJECT;
+        value.line = lines_[index].number;
+        while (index < lines_.size() && lines_[index].indent == indent && !IsSequenceItem(lines_[index].content)) {
+            const Line& line = lines_[index];
+            size_t separator = FindKeySeparator(line.content);
+            if (separator == std::string::npos) {
+                Fail(line.number, "expected 'key: value'");
+            }
+            std::string key = ParseKey(line.content.substr(0, separator), line.number, depth_);
+            std::string rest = line.content.substr(separator + 1);
+            rest.erase(0, rest.find_first_not_of(' '));
+            index++;
+
+            if (!rest.empty()) {
+                value.object.emplace_back(std::move(key), ParseInline(rest, line.number, depth_));
+            } else if (index < lines_.size() && lines_[index].indent > indent) {
+                value.object.emplace_back(std::move(key), ParseBlock(index, lines_[index].indent));
+            } else if (index < lines_.size() && lines_[index].indent == indent && IsSequenceItem(lines_[index].content)) {
+                value.object.emplace_back(std::move(key), ParseSequence(index, indent));
+            } else {
+                Value null_value;
+                null_value.line = line.number;
+                value.object.emplace_back(std::move(key), null_value);
+            }
+        }
+        if (index < lines_.size() && lines_[index].indent > indent) {
+            Fail(lines_[index].number, "unexpected indentation");
+        }
+        return value;
+    }
+
+    Value ParseSequence(size_t& index, int indent) {
+        Value value;
+        value.type = Value::Type::ARRAY;
+        value.line = lines_[index].number;
+        while (index < lines_.size() && lines_[index].indent == indent && IsSequenceItem(lines_[index].content)) {
+            Line& line = lines_[index];
+            std::string rest = line.content.size() > 1 ? line.content.substr(2) : std::string();
+            rest.erase(0, rest.find_first_not_of(' '));
+
+            if (rest.empty()) {
+                index++;
+                if (index < lines_.size() && lines_[index].indent > indent) {
+                    value.array.push_back(ParseBlock(index, lines_[index].indent));
+                } else {
+                    Value null_value;
+                    null_value.line = line.number;
+                    value.array.push_back(null_value);
+                }
+            } else if (FindKeySeparator(rest) != std::string::npos || IsSequenceItem(rest)) {
+                // "- key: value" starts a nested block at the item's content column
+                int item_indent = indent + static_cast<int>(line.content.size() - rest.size());
+                line.content = rest;
+                line.indent = item_indent;
+                value.array.push_back(ParseBlock(index, item_indent));
+            } else {
+                index++;
+                value.array.push_back(ParseInline(rest, line.number, depth_));
+            }
+        }
+        return value;
+    }
+
+    static std::string ParseKey(const std::string& text, int line, int depth) {
+        std::string key = text;
+        key.erase(key.find_last_not_of(' ') + 1);
+        if (key.size() >= 2 && (key.front() == '"' || key.front() == '\'')) {
+            Value quoted = JsonReader(key, true, line, depth).ParseDocument();
+            return quoted.string;
+        }
+        if (key.empty()) {
+            Fail(line, "empty key");
+        }
+        return key;
+    }
+
+    static Value ParseInline(const std::string& text, int line, int depth) {
+        return JsonReader(text, true, line, depth).ParseDocument();
+    }
+
+    std::vector<Line> lines_;
+    int depth_ = 0;
+};
+
+// ---------------------------------------------------------------------------
+// Document -> struct mapping
+
+const char* TypeName(Value::Type type) {
+    switch (type) {
+        case Value::Type::NUL: return "null";
+        case Value::Type::BOOL: return "boolean";
+        case Value::Type::INT: return "integer";
+        case Value::Type::DOUBLE: return "number";
+        case Value::Type::STRING: return "string";
+        case Value::Type::ARRAY: return "list";
+        case Value::Type::OBJECT: return "mapping";
+    }
+    return "value";
+}
+
+[[noreturn]] void FailType(const Value& value, const std::string& path, const char* expected) {
+    Fail(value.line, path + ": expected " + expected + ", got " + TypeName(value.type));
+}
+
+// Reads the fields of one mapping and rejects keys nobody asked for
+class ObjectReader {
+public:
+    ObjectReader(const Value& value, std::string path) : value_(value), path_(std::move(path)) {
+        if (value_.type != Value::Type::OBJECT) {
+            FailType(value_, path_.empty() ? "document" : path_, "mapping");
+        }
+        std::set<std::string> seen;
+        for (const auto& [key, child] : value_.object) {
+            if (!seen.insert(key).second) {
+                Fail(child.line, "duplicate key '" + FieldPath(key) + "'");
+            }
+        }
+    }
+
+    const Value* Find(const std::string& key) {
+        for (const auto& [name, child] : value_.object) {
+            if (name == key) {
+                used_.insert(key);
+                return &child;
+            }
+        }
+        return nullptr;
+    }
+
+    void Read(const std::string& key, std::string& out) {
+        if (const Value* child = Find(key)) {
+            if (child->type != Value::Type::STRING) FailType(*child, FieldPath(key), "string");
+            out = child->string;
+        }
+    }
+
+    void Read(const std::string& key, int& out) {
+        if (const Value* child = Find(key)) {
+            if (child->type != Value::Type::INT) FailType(*child, FieldPath(key), "integer");
+            if (child->integer < std::numeric_limits<int>::min() || child->integer > std::numeric_limits<int>::max()) {
+                Fail(child->line, FieldPath(key) + ": integer out of range");
+            }
+            out = static_cast<int>(child->integer);
+        }
+    }
+
+    void Read(const std::string& key, long long& out) {
+        if (const Value* child = Find(key)) {
+            if (child->type != Value::Type::INT) FailType(*child, FieldPath(key), "integer");
+            out = child->integer;
+        }
+    }
+
+    void Read(const std::string& key, double& out) {
+        if (const Value* child = Find(key)) {
+            if (child->type == Value::Type::INT) {
+                out = static_cast<double>(child->integer);
+            } else if (child->type == Value::Type::DOUBLE) {
+                out = child->number;
+            } else {
+                FailType(*child, FieldPath(key), "number");
+            }
+        }
+    }
+
+    void Read(const std::string& key, std::vector<int>& out) {
+        if (const Value* child = Find(key)) {
+            if (child->type == Value::Type::NUL) {
+                out.clear();
+                return;
+            }
+            if (child->type != Value::Type::ARRAY) FailType(*child, FieldPath(key), "list");
+            out.clear();
+            for (const Value& item : child->array) {
+                if (item.type != Value::Type::INT || item.integer < std::numeric_limits<int>::min() ||
+                    item.integer > std::numeric_limits<int>::max()) {
+                    Fail(item.line, FieldPath(key) + ": list entries must be integers");
+                }
+                out.push_back(static_cast<int>(item.integer));
+            }
+        }
+    }
+
+    void Read(const std::string& key, bool& out) {
+        if (const Value* child = Find(key)) {
+            if (child->type != Value::Type::BOOL) FailType(*child, FieldPath(key), "boolean");
+            out = child->boolean;
+        }
+    }
+
+    void Finish() const {
+        for (const auto& [key, child] : value_.object) {
+            if (!used_.count(key)) {
+                Fail(child.line, "unknown key '" + FieldPath(key) + "'");
+            }
+        }
+    }
+
+    std::string FieldPath(const std::string& key) const {
+        return path_.empty() ? key : path_ + "." + key;
+    }
+
+    const Value& Get() const { return value_; }
+
+private:
+    const Value& value_;
+    std::string path_;
+    std::set<std::string> used_;
+};
+
+NaluBoardParams ReadBoardParams(const Value& value, const std::string& path) {
+    NaluBoardParams params;
+    ObjectReader reader(value, path);
+    reader.Read("model", params.model);
+    reader.Read("board_ip_port", params.board_ip_port);
+    reader.Read("host_ip_port", params.host_ip_port);
+    reader.Read("config_file", params.config_file);
+    reader.Read("clock_file", params.clock_file);
+    reader.Finish();
+    return params;
+}
+
+// A key naming a channel or board: a non-negative integer written the way
+// std::to_string writes it, so "1", "01" and "+1" cannot name one entry twice
+// past the duplicate-key check
+int ReadIndexKey(const ObjectReader& reader, const std::string& key, const Value& child, const char* what) {
+    char* end = nullptr;
+    errno = 0;
+    long index = std::strtol(key.c_str(), &end, 10);
+    if (key.empty() || *end != '\0' || errno != 0 || index < 0 || index > std::numeric_limits<int>::max() ||
+        std::to_string(index) != key) {
+        Fail(child.line, reader.FieldPath(key) + ": " + what +
+                             " keys must be non-negative integers, without sign or leading zeros");
+    }
+    return static_cast<int>(index);
+}
+
+void ReadChannels(const Value& value, const std::string& path, std::map<int, NaluChannelInfo>& channels) {
+    if (value.type == Value::Type::NUL) {  // "channels:" with nothing under it
+        return;
+    }
+    ObjectReader reader(value, path);
+    for (const auto& [key, child] : value.object) {
+        int channel = ReadIndexKey(reader, key, child, "channel");
+        reader.Find(key);
+
+        NaluChannelInfo info;
+        if (child.type != Value::Type::NUL) {
+            ObjectReader channel_reader(child, reader.FieldPath(key));
+            channel_reader.Read("enabled", info.enabled);
+            channel_reader.Read("trigger_value", info.trigger_value);
+            channel_reader.Read("dac_value", info.dac_value);
+            channel_reader.Finish();
+        }
+        channels[channel] = info;
+    }
+}
+
+void ReadWatchdogParams(const Value& value, const std::string& path, NaluWatchdogParams& params) {
+    ObjectReader reader(value, path);
+    reader.Read("enabled", params.enabled);
+    reader.Read("min_packet_rate", params.min_packet_rate);
+    reader.Read("min_event_rate", params.min_event_rate);
+    reader.Read("rate_window_ms", params.rate_window_ms);
+    reader.Read("stall_timeout_ms", params.stall_timeout_ms);
+    reader.Read("recovery_grace_ms", params.recovery_grace_ms);
+    reader.Read("max_recovery_attempts", params.max_recovery_attempts);
+    reader.Finish();
+}
+
+void ReadReceiverParams(const Value& value, const std::string& path, NaluReceiverParams& params) {
+    ObjectReader reader(value, path);
+    reader.Read("mode", params.mode);
+    reader.Read("queues", params.queues);
+    reader.Read("ports", params.ports);
+    reader.Read("cpus", params.cpus);
+    reader.Read("batch_size", params.batch_size);
+    reader.Read("max_packet_bytes", params.max_packet_bytes);
+    reader.Read("socket_buffer_bytes", params.socket_buffer_bytes);
+    reader.Read("huge_pages", params.huge_pages);
+    reader.Read("replay_file", params.replay_file);
+    reader.Read("replay_speed", params.replay_speed);
+    reader.Read("replay_loops", params.replay_loops);
+    reader.Finish();
+}
+
+void ReadRecordParams(const Value& value, const std::string& path, NaluRecordParams& params) {
+    ObjectReader reader(value, path);
+    reader.Read("path", params.path);
+    reader.Read("chunk_bytes", params.chunk_bytes);
+    reader.Read("max_chunks", params.max_chunks);
+    reader.Finish();
+}
+
+void ReadEventBuilderParams(const Value& value, const std::string& path, NaluEventBuilderParams& params) {
+    ObjectReader reader(value, path);
+    reader.Read("event_timeout_ms", params.event_timeout_ms);
+    reader.Read("max_open_events", params.max_open_events);
+    reader.Finish();
+}
+
+void ReadClockOffsets(const Value& value, const std::string& path, std::map<int, long long>& offsets) {
+    if (value.type == Value::Type::NUL) {
+        return;
+    }
+    ObjectReader reader(value, path);
+    for (const auto& [key, child] : value.object) {
+        int board_id = ReadIndexKey(reader, key, child, "board");
+        reader.Find(key);
+        if (child.type != Value::Type::INT) {
+            FailType(child, reader.FieldPath(key), "integer");
+        }
+        offsets[board_id] = child.integer;
+    }
+}
+
+void ReadMergeParams(const Value& value, const std::string& path, NaluMergeParams& params) {
+    ObjectReader reader(value, path);
+    reader.Read("enabled", params.enabled);
+    reader.Read("max_latency_ms", params.max_latency_ms);
+    reader.Read("queue_capacity", params.queue_capacity);
+    reader.Read("drop_late", params.drop_late);
+    if (const Value* offsets = reader.Find("clock_offsets")) {
+        params.clock_offsets.clear();
+        ReadClockOffsets(*offsets, reader.FieldPath("clock_offsets"), params.clock_offsets);
+    }
+    reader.Finish();
+}
+
+void ReadFilterRules(const Value& value, const std::string& path, std::vector<NaluFilterRule>& rules) {
+    rules.clear();
+    if (value.type == Value::Type::NUL) {
+        return;
+    }
+    if (value.type != Value::Type::ARRAY) {
+        FailType(value, path, "list");
+    }
+    for (size_t i = 0; i < value.array.size(); ++i) {
+        NaluFilterRule rule;
+        ObjectReader reader(value.array[i], path + "." + std::to_string(i));
+        reader.Read("name", rule.name);
+        reader.Read("channels", rule.channels);
+        reader.Read("min_channels", rule.min_channels);
+        reader.Read("min_boards", rule.min_boards);
+        reader.Read("coincidence_window", rule.coincidence_window);
+        reader.Finish();
+        rules.push_back(rule);
+    }
+}
+
+void ReadFilterParams(const Value& value, const std::string& path, NaluFilterParams& params) {
+    ObjectReader reader(value, path);
+    reader.Read("enabled", params.enabled);
+    reader.Read("hit_threshold", params.hit_threshold);
+    reader.Read("baseline_samples", params.baseline_samples);
+    if (const Value* rules = reader.Find("rules")) {
+        ReadFilterRules(*rules, reader.FieldPath("rules"), params.rules);
+    }
+    reader.Finish();
+}
+
+void ReadMonitorParams(const Value& value, const std::string& path, NaluMonitorParams& params) {
+    ObjectReader reader(value, path);
+    reader.Read("enabled", params.enabled);
+    reader.Read("prescale", params.prescale);
+    reader.Read("max_events_per_second", params.max_events_per_second);
+    reader.Read("bins", params.bins);
+    reader.Read("amplitude_max", params.amplitude_max);
+    reader.Read("baseline_max", params.baseline_max);
+    reader.Read("hit_threshold", params.hit_threshold);
+    reader.Read("baseline_samples", params.baseline_samples);
+    reader.Finish();
+}
+
+void ReadWaveformParams(const Value& value, const std::string& path, NaluWaveformParams& params) {
+    ObjectReader reader(value, path);
+    reader.Read("enabled", params.enabled);
+    reader.Read("buffer_windows", params.buffer_windows);
+    reader.Finish();
+}
+
+NaluCaptureParams ReadCaptureParams(const Value& value, const std::string& path) {
+    NaluCaptureParams params;
+    ObjectReader reader(value, path);
+    reader.Read("target_ip_port", params.target_ip_port);
+    reader.Read("windows", params.windows);
+    reader.Read("lookback", params.lookback);
+    reader.Read("write_after_trig", params.write_after_trig);
+    reader.Read("assign_dac_values", params.assign_dac_values);
+    reader.Read("trigger_mode", params.trigger_mode);
+    reader.Read("lookback_mode", params.lookback_mode);
+    reader.Read("low_reference", params.low_reference);
+    reader.Read("high_reference", params.high_reference);
+    reader.Read("rising_edge", params.rising_edge);
+    if (const Value* channels = reader.Find("channels")) {
+        ReadChannels(*channels, reader.FieldPath("channels"), params.channels);
+    }
+    if (const Value* watchdog = reader.Find("watchdog")) {
+        ReadWatchdogParams(*watchdog, reader.FieldPath("watchdog"), params.watchdog);
+    }
+    if (const Value* receiver = reader.Find("receiver")) {
+        ReadReceiverParams(*receiver, reader.FieldPath("receiver"), params.receiver);
+    }
+    if (const Value* record = reader.Find("record")) {
+        ReadRecordParams(*record, reader.FieldPath("record"), params.record);
+    }
+    if (const Value* event_builder = reader.Find("event_builder")) {
+        ReadEventBuilderParams(*event_builder, reader.FieldPath("event_builder"), params.event_builder);
+    }
+    if (const Value* merge = reader.Find("merge")) {
+        ReadMergeParams(*merge, reader.FieldPath("merge"), params.merge);
+    }
+    if (const Value* filter = reader.Find("filter")) {
+        ReadFilterParams(*filter, reader.FieldPath("filter"), params.filter);
+    }
+    if (const Value* monitor = reader.Find("monitor")) {
+        ReadMonitorParams(*monitor, reader.FieldPath("monitor"), params.monitor);
+    }
+    if (const Value* waveform = reader.Find("waveform")) {
+        ReadWaveformParams(*waveform, reader.FieldPath("waveform"), params.waveform);
+    }
+    reader.Finish();
+    return params;
+}
+
+// The section of a combined {board: ..., capture: ...} file, or the whole document
+const Value& Section(const Value& document, const std::string& name, std::string& path) {
+    if (document.type != Value::Type::OBJECT) {
+        FailType(document, "document", "mapping");
+    }
+    bool combined = false;
+    const Value* section = nullptr;
+    for (const auto& [key, child] : document.object) {
+        if (key == "board" || key == "capture") {
+            combined = true;
+            if (key == name) section = &child;
+        }
+    }
+    if (!combined) {
+        path.clear();
+        return document;
+    }
+    ObjectReader reader(document, "");
+    reader.Find("board");
+    reader.Find("capture");
+    reader.Finish();
+    if (!section) {
+        Fail(document.line, "no '" + name + "' section");
+    }
+    path = name;
+    return *section;
+}
+
+NaluConfigFormat FormatFromPath(const std::string& path, NaluConfigFormat format) {
+    if (format != NaluConfigFormat::AUTO) {
+        return format;
+    }
+    auto ends_with = [&](const std::string& suffix) {
+        return path.size() >= suffix.size() && path.compare(path.size() - suffix.size(), suffix.size(), suffix) == 0;
+    };
+    if (ends_with(".json")) return NaluConfigFormat::JSON;
+    if (ends_with(".yaml") || ends_with(".yml")) return NaluConfigFormat::YAML;
+    throw std::invalid_argument("Cannot tell the config format of '" + path + "' (expected .json, .yaml or .yml)");
+}
+
+Value ParseDocument(const std::string& text, NaluConfigFormat format) {
+    if (format == NaluConfigFormat::YAML) {
+        return YamlReader(text).ParseDocument();
+    }
+    if (format == NaluConfigFormat::JSON) {
+        return JsonReader(text, false).ParseDocument();
+    }
+    throw std::invalid_argument("A config format must be given to parse text.");
+}
+
+// ---------------------------------------------------------------------------
+// Writers
+
+std::string Quote(const std::string& text) {
+    std::string out = "\"";
+    for (char c : text) {
+        switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    char buffer[8];
+                    std::snprintf(buffer, sizeof(buffer), "\\u%04x", c);
+                    out += buffer;
+                } else {
+                    out.push_back(c);
+                }
+        }
+    }
+    out.push_back('"');
+    return out;
+}
+
+std::string Number(double value) {
+    std::ostringstream stream;
+    stream << std::setprecision(std::numeric_limits<double>::max_digits10) << value;
+    return stream.str();
+}
+
+const char* Bool(bool value) {
+    return value ? "true" : "false";
+}
+
+std::string IntList(const std::vector<int>& values) {
+    std::string out = "[";
+    for (size_t i = 0; i < values.size(); ++i) {
+        if (i > 0) out += ", ";
+        out += std::to_string(values[i]);
+    }
+    return out + "]";
+}
+
+// Emits the same field sequence as JSON or YAML. Nested mappings open a block;
+// channel entries are written as one-line flow mappings in both formats.
+class Emitter {
+public:
+    explicit Emitter(NaluConfigFormat format) : yaml_(format == NaluConfigFormat::YAML) {
+        if (!yaml_) out_ << "{";
+    }
+
+    std::string Finish() {
+        if (!yaml_) {
+            out_ << "\n}";
+        }
+        out_ << "\n";
+        return out_.str();
+    }
+
+    void Field(const std::string& key, const std::string& raw_value) {
+        Separator();
+        Indent();
+        out_ << (yaml_ ? key : Quote(key)) << ": " << raw_value;
+    }
+
+    void Open(const std::string& key) {
+        Separator();
+        Indent();
+        out_ << (yaml_ ? key : Quote(key)) << ":";
+        if (!yaml_) out_ << " {";
+        depth_++;
+        first_ = true;
+    }
+
+    void Close() {
+        depth_--;
+        if (!yaml_) {
+            if (!first_) {
+                out_ << "\n";
+                Indent();
+            }
+            out_ << "}";
+        }
+        first_ = false;
+    }
+
+    bool Yaml() const { return yaml_; }
+
+private:
+    void Separator() {
+        if (!yaml_ && !first_) out_ << ",";
+        if (!(yaml_ && depth_ == 0 && first_ && out_.tellp() == 0)) out_ << "\n";
+        first_ = false;
+    }
+
+    void Indent() {
+        out_ << std::string((yaml_ ? depth_ : depth_ + 1) * 2, ' ');
+    }
+
+    bool yaml_;
+    std::ostringstream out_;
+    int depth_ = 0;
+    bool first_ = true;
+};
+
+void EmitBoardParams(Emitter& emitter, const NaluBoardParams& params) {
+    emitter.Field("model", Quote(params.model));
+    emitter.Field("board_ip_port", Quote(params.board_ip_port));
+    emitter.Field("host_ip_port", Quote(params.host_ip_port));
+    emitter.Field("config_file", Quote(params.config_file));
+    emitter.Field("clock_file", Quote(params.clock_file));
+}
+
+void EmitCaptureParams(Emitter& emitter, const NaluCaptureParams& params) {
+    emitter.Field("target_ip_port", Quote(params.target_ip_port));
+    emitter.Field("windows", std::to_string(params.windows));
+    emitter.Field("lookback", std::to_string(params.lookback));
+    emitter.Field("write_after_trig", std::to_string(params.write_after_trig));
+    emitter.Field("assign_dac_values", Bool(params.assign_dac_values));
+    emitter.Field("trigger_mode", Quote(params.trigger_mode));
+    emitter.Field("lookback_mode", Quote(params.lookback_mode));
+    emitter.Field("low_reference", std::to_string(params.low_reference));
+    emitter.Field("high_reference", std::to_string(params.high_reference));
+    emitter.Field("rising_edge", Bool(params.rising_edge));
+
+    emitter.Open("channels");
+    std::string quote = emitter.Yaml() ? "" : "\"";
+    for (const auto& [channel, info] : params.channels) {
+        emitter.Field(std::to_string(channel),
+                      "{" + quote + "enabled" + quote + ": " + Bool(info.enabled) + ", " +
+                      quote + "trigger_value" + quote + ": " + std::to_string(info.trigger_value) + ", " +
+                      quote + "dac_value" + quote + ": " + std::to_string(info.dac_value) + "}");
+    }
+    emitter.Close();
+
+    const NaluWatchdogParams& watchdog = params.watchdog;
+    emitter.Open("watchdog");
+    emitter.Field("enabled", Bool(watchdog.enabled));
+    emitter.Field("min_packet_rate", Number(watchdog.min_packet_rate));
+    emitter.Field("min_event_rate", Number(watchdog.min_event_rate));
+    emitter.Field("rate_window_ms", std::to_string(watchdog.rate_window_ms));
+    emitter.Field("stall_timeout_ms", std::to_string(watchdog.stall_timeout_ms));
+    emitter.Field("recovery_grace_ms", std::to_string(watchdog.recovery_grace_ms));
+    emitter.Field("max_recovery_attempts", std::to_string(watchdog.max_recovery_attempts));
+    emitter.Close();
+
+    const NaluReceiverParams& receiver = params.receiver;
+    emitter.Open("receiver");
+    emitter.Field("mode", Quote(receiver.mode));
+    emitter.Field("queues", std::to_string(receiver.queues));
+    emitter.Field("ports", IntList(receiver.ports));
+    emitter.Field("cpus", IntList(receiver.cpus));
+    emitter.Field("batch_size", std::to_string(receiver.batch_size));
+    emitter.Field("max_packet_bytes", std::to_string(receiver.max_packet_bytes));
+    emitter.Field("socket_buffer_bytes", std::to_string(receiver.socket_buffer_bytes));
+    emitter.Field("huge_pages", Bool(receiver.huge_pages));
+    emitter.Field("replay_file", Quote(receiver.replay_file));
+    emitter.Field("replay_speed", Number(receiver.replay_speed));
+    emitter.Field("replay_loops", std::to_string(receiver.replay_loops));
+    emitter.Close();
+
+    emitter.Open("record");
+    emitter.Field("path", Quote(params.record.path));
+    emitter.Field("chunk_bytes", std::to_string(params.record.chunk_bytes));
+    emitter.Field("max_chunks", std::to_string(params.record.max_chunks));
+    emitter.Close();
+
+    emitter.Open("event_builder");
+    emitter.Field("event_timeout_ms", std::to_string(params.event_builder.event_timeout_ms));
+    emitter.Field("max_open_events", std::to_string(params.event_builder.max_open_events));
+    emitter.Close();
+
+    const NaluMergeParams& merge = params.merge;
+    emitter.Open("merge");
+    emitter.Field("enabled", Bool(merge.enabled));
+    emitter.Field("max_latency_ms", std::to_string(merge.max_latency_ms));
+    emitter.Field("queue_capacity", std::to_string(merge.queue_capacity));
+    emitter.Field("drop_late", Bool(merge.drop_late));
+    emitter.Open("clock_offsets");
+    for (const auto& [board_id, offset] : merge.clock_offsets) {
+        emitter.Field(std::to_string(board_id), std::to_string(offset));
+    }
+    emitter.Close();
+    emitter.Close();
+
+    const NaluFilterParams& filter = params.filter;
+    emitter.Open("filter");
+    emitter.Field("enabled", Bool(filter.enabled));
+    emitter.Field("hit_threshold", std::to_string(filter.hit_threshold));
+    emitter.Field("baseline_samples", std::to_string(filter.baseline_samples));
+    std::string rules = "[";
+    for (size_t i = 0; i < filter.rules.size(); ++i) {
+        const NaluFilterRule& rule = filter.rules[i];
+        if (i > 0) rules += ", ";
+        rules += "{" + quote + "name" + quote + ": " + Quote(rule.name) + ", " +
+                 quote + "channels" + quote + ": " + IntList(rule.channels) + ", " +
+                 quote + "min_channels" + quote + ": " + std::to_string(rule.min_channels) + ", " +
+                 quote + "min_boards" + quote + ": " + std::to_string(rule.min_boards) + ", " +
+                 quote + "coincidence_window" + quote + ": " + std::to_string(rule.coincidence_window) + "}";
+    }
+    emitter.Field("rules", rules + "]");
+    emitter.Close();
+
+    const NaluMonitorParams& monitor = params.monitor;
+    emitter.Open("monitor");
+    emitter.Field("enabled", Bool(monitor.enabled));
+    emitter.Field("prescale", std::to_string(monitor.prescale));
+    emitter.Field("max_events_per_second", std::to_string(monitor.max_events_per_second));
+    emitter.Field("bins", std::to_string(monitor.bins));
+    emitter.Field("amplitude_max", std::to_string(monitor.amplitude_max));
+    emitter.Field("baseline_max", std::to_string(monitor.baseline_max));
+    emitter.Field("hit_threshold", std::to_string(monitor.hit_threshold));
+    emitter.Field("baseline_samples", std::to_string(monitor.baseline_samples));
+    emitter.Close();
+
+    const NaluWaveformParams& waveform = params.waveform;
+    emitter.Open("waveform");
+    emitter.Field("enabled", Bool(waveform.enabled));
+    emitter.Field("buffer_windows", std::to_string(waveform.buffer_windows));
+    emitter.Close();
+}
+
+// ---------------------------------------------------------------------------
+// File cache
+
+struct FileStamp {
+    long long mtime_ns = 0;
+    long long size = -1;
+
+    bool operator==(const FileStamp& other) const {
+        return mtime_ns == other.mtime_ns && size == other.size;
+    }
+};
+
+template <typename Params>
+struct CacheEntry {
+    FileStamp stamp;
+    NaluConfigFormat format;
+    Params params;
+};
+
+std::mutex cache_mutex;
+std::unordered_map<std::string, CacheEntry<NaluBoardParams>> board_cache;
+std::unordered_map<std::string, CacheEntry<NaluCaptureParams>> capture_cache;
+
+FileStamp StampFile(const std::string& path) {
+    struct stat info;
+    if (stat(path.c_str(), &info) != 0) {
+        throw std::runtime_error("Cannot open config file '" + path + "'");
+    }
+    FileStamp stamp;
+    stamp.mtime_ns = static_cast<long long>(info.st_mtim.tv_sec) * 1000000000LL + info.st_mtim.tv_nsec;
+    stamp.size = static_cast<long long>(info.st_size);
+    return stamp;
+}
+
+std::string ReadFile(const std::string& path) {
+    std::ifstream file(path, std::ios::in | std::ios::binary);
+    if (!file) {
+        throw std::runtime_error("Cannot open config file '" + path + "'");
+    }
+    std::ostringstream contents;
+    contents << file.rdbuf();
+    return contents.str();
+}
+
+template <typename Params, typename ParseFn>
+Params LoadCached(std::unordered_map<std::string, CacheEntry<Params>>& cache, const std::string& path,
+                  NaluConfigFormat format, ParseFn parse) {
+    format = FormatFromPath(path, format);
+    FileStamp stamp = StampFile(path);
+    {
+        std::lock_guard<std::mutex> lock(cache_mutex);
+        auto it = cache.find(path);
+        if (it != cache.end() && it->second.stamp == stamp && it->second.format == format) {
+            return it->second.params;
+        }
+    }
+
+    Params params;
+    try {
+        params = parse(ReadFile(path), format);
+    } catch (const std::invalid_argument& e) {
+        throw std::invalid_argument(path + ": " + e.what());
+    }
+
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    cache[path] = CacheEntry<Params>{stamp, format, params};
+    return params;
+}
+
+void WriteFile(const std::string& path, const std::string& contents) {
+    std::ofstream file(path, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!file || !(file << contents)) {
+        throw std::runtime_error("Cannot write config file '" + path + "'");
+    }
+}
+
+}  // namespace
+
+NaluBoardParams NaluConfigFile::LoadBoardParams(const std::string& path, NaluConfigFormat format) {
+    return LoadCached(board_cache, path, format, &NaluConfigFile::ParseBoardParams);
+}
+
+NaluCaptureParams NaluConfigFile::LoadCaptureParams(const std::string& path, NaluConfigFormat format) {
+    return LoadCached(capture_cache, path, format, &NaluConfigFile::ParseCaptureParams);
+}
+
+NaluBoardParams NaluConfigFile::ParseBoardParams(const std::string& text, NaluConfigFormat format) {
+    Value document = ParseDocument(text, format);
+    std::string path;
+    const Value& section = Section(document, "board", path);
+    NaluBoardParams params = ReadBoardParams(section, path);
+    NaluParamsValidator::ValidateBoardParams(params);
+    return params;
+}
+
+NaluCaptureParams NaluConfigFile::ParseCaptureParams(const std::string& text, NaluConfigFormat format) {
+    Value document = ParseDocument(text, format);
+    std::string path;
+    const Value& section = Section(document, "capture", path);
+    NaluCaptureParams params = ReadCaptureParams(section, path);
+    NaluParamsValidator::ValidateCaptureParams(params);
+    return params;
+}
+
+std::string NaluConfigFile::ToString(const NaluBoardParams& params, NaluConfigFormat format) {
+    if (format == NaluConfigFormat::AUTO) {
+        throw std::invalid_argument("A config format must be given to serialize parameters.");
+    }
+    Emitter emitter(format);
+    EmitBoardParams(emitter, params);
+    return emitter.Finish();
+}
+
+std::string NaluConfigFile::ToString(const NaluCaptureParams& params, NaluConfigFormat format) {
+    if (format == NaluConfigFormat::AUTO) {
+        throw std::invalid_argument("A config format must be given to serialize parameters.");
+    }
+    Emitter emitter(format);
+    EmitCaptureParams(emitter, params);
+    return emitter.Finish();
+}
+
+void NaluConfigFile::Save(const NaluBoardParams& params, const std::string& path, NaluConfigFormat format) {
+    WriteFile(path, ToString(params, FormatFromPath(path, format)));
+}
+
+void NaluConfigFile::Save(const NaluCaptureParams& params, const std::string& path, NaluConfigFormat format) {
+    WriteFile(path, ToString(params, FormatFromPath(path, format)));
+}
+
+void NaluConfigFile::ClearCache() {
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    board_cache.clear();
+    capture_cache.clear();
+}
@@ -0,0 +1,123 @@
+#include "nalu_cpu_placement.h"
+#include "nalu_board_controller_logger.h"
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr size_t kHugePageSize = 2 * 1024 * 1024;
+
+size_t RoundUp(size_t value, size_t multiple) {
+    return (value + multiple - 1) / multiple * multiple;
+}
+
+}  // namespace
+
+void NaluCpuPlacement::PinCurrentThread(int cpu) {
+    if (cpu < 0 || cpu >= CPU_SETSIZE) {
+        throw std::runtime_error("Cannot pin thread to invalid CPU " + std::to_string(cpu));
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    int rc = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    if (rc != 0) {
+        throw std::runtime_error("Cannot pin thread to CPU " + std::to_string(cpu) + ": " + std::strerror(rc));
+    }
+}
+
+int NaluCpuPlacement::NumaNodeOfCpu(int cpu) {
+    // /sys/devices/system/cpu/cpuN/nodeM links to the core's node
+    std::error_code error;
+    std::filesystem::path cpu_dir = "/sys/devices/system/cpu/cpu" + std::to_string(cpu);
+    for (const auto& entry : std::filesystem::directory_iterator(cpu_dir, error)) {
+        std::string name = entry.path().filename().string();
+        if (name.size() > 4 && name.compare(0, 4, "node") == 0) {
+            try {
+                return std::stoi(name.substr(4));
+            } catch (const std::exception&) {
+                return -1;
+            }
+        }
+    }
+    return -1;
+}
+
+int NaluCpuPlacement::CurrentCpu() {
+    return sched_getcpu();
+}
+
+int NaluCpuPlacement::CpuCount() {
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? static_cast<int>(count) : 1;
+}
+
+NaluHostBuffer::NaluHostBuffer(size_t bytes, bool huge_pages) : size_(bytes) {
+    if (bytes == 0) {
+        return;
+    }
+
+    void* data = MAP_FAILED;
+    if (huge_pages) {
+        mapped_size_ = RoundUp(bytes, kHugePageSize);
+        data = mmap(nullptr, mapped_size_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        huge_pages_ = data != MAP_FAILED;
+        if (!huge_pages_) {
+            NaluBoardControllerLogger::debug("No reserved huge pages for a " + std::to_string(bytes) +
+                                             " byte buffer, using transparent huge pages");
+        }
+    }
+    if (data == MAP_FAILED) {
+        mapped_size_ = RoundUp(bytes, static_cast<size_t>(sysconf(_SC_PAGESIZE)));
+        data = mmap(nullptr, mapped_size_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (data == MAP_FAILED) {
+            throw std::runtime_error("Cannot map " + std::to_string(bytes) + " byte buffer: " + std::strerror(errno));
+        }
+        if (huge_pages) {
+            madvise(data, mapped_size_, MADV_HUGEPAGE);
+        }
+    }
+    data_ = static_cast<unsigned char*>(data);
+}
+
+NaluHostBuffer::~NaluHostBuffer() {
+    Release();
+}
+
+NaluHostBuffer::NaluHostBuffer(NaluHostBuffer&& other) noexcept
+    : data_(std::exchange(other.data_, nullptr)),
+      size_(std::exchange(other.size_, 0)),
+      mapped_size_(std::exchange(other.mapped_size_, 0)),
+      huge_pages_(std::exchange(other.huge_pages_, false)) {}
+
+NaluHostBuffer& NaluHostBuffer::operator=(NaluHostBuffer&& other) noexcept {
+    if (this != &other) {
+        Release();
+        data_ = std::exchange(other.data_, nullptr);
+        size_ = std::exchange(other.size_, 0);
+        mapped_size_ = std::exchange(other.mapped_size_, 0);
+        huge_pages_ = std::exchange(other.huge_pages_, false);
+    }
+    return *this;
+}
+
+void NaluHostBuffer::Touch() {
+    size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    for (size_t offset = 0; offset < mapped_size_; offset += page) {
+        data_[offset] = 0;
+    }
+}
+
+void NaluHostBuffer::Release() {
+    if (data_) {
+        munmap(data_, mapped_size_);
+        data_ = nullptr;
+    }
+}
@@ -0,0 +1,322 @@
+#include "nalu_event_builder.h"
+#include "nalu_packet_format.h"
+#include "nalu_receiver.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+// How often the open-event table is checked for timeouts, and stats published
+constexpr uint64_t kMinScanIntervalNs = 1000000;  // 1 ms
+
+}  // namespace
+
+void NaluBoardLossStats::Add(const NaluBoardLossStats& other) {
+    packets += other.packets;
+    lost_packets += other.lost_packets;
+    duplicate_packets += other.duplicate_packets;
+    reordered_packets += other.reordered_packets;
+    late_packets += other.late_packets;
+    malformed_packets += other.malformed_packets;
+    resyncs += other.resyncs;
+    events_complete += other.events_complete;
+    events_partial += other.events_partial;
+    events_timed_out += other.events_timed_out;
+    events_evicted += other.events_evicted;
+    events_lost += other.events_lost;
+    for (int channel = 0; channel < kNaluMaxChannels; ++channel) {
+        channel_windows_lost[channel] += other.channel_windows_lost[channel];
+    }
+}
+
+double NaluBoardLossStats::PacketLossRate() const {
+    uint64_t expected = packets + lost_packets;
+    return expected > 0 ? static_cast<double>(lost_packets) / expected : 0.0;
+}
+
+void NaluDataPathStats::Add(const NaluDataPathStats& other) {
+    for (const auto& [board_id, board] : other.boards) {
+        boards[board_id].Add(board);
+    }
+    unparsed_packets += other.unparsed_packets;
+    open_events += other.open_events;
+    event_pool.Add(other.event_pool);
+}
+
+NaluEventBuilder::NaluEventBuilder(const NaluEventBuilderParams& params, const NaluEventLayout& layout,
+                                   NaluCaptureCounters* counters, NaluEventSink sink,
+                                   std::shared_ptr<const NaluPacketDecoder> decoder)
+    : params_(params),
+      layout_(layout),
+      counters_(counters),
+      sink_(std::move(sink)),
+      decoder_(decoder ? std::move(decoder) : std::make_shared<NaluSimulatorPacketDecoder>()),
+      timeout_ns_(static_cast<uint64_t>(std::max(params.event_timeout_ms, 1)) * 1000000ULL),
+      scan_interval_ns_(std::max(kMinScanIntervalNs, timeout_ns_ / 4)),
+      pool_(static_cast<size_t>(std::max(params.max_open_events, 1)),
+            static_cast<size_t>(__builtin_popcountll(layout.channel_mask)) * std::max(layout.windows, 0),
+            static_cast<size_t>(__builtin_popcountll(layout.channel_mask)) * std::max(layout.windows, 0) *
+                std::max(layout.samples_per_window, 0)),
+      slots_(std::max(params.max_open_events, 1)) {
+    for (OpenEvent& slot : slots_) {
+        slot.event = pool_.Acquire();
+    }
+}
+
+void NaluEventBuilder::HandlePacket(const uint8_t* data, size_t size, uint64_t rx_ns) {
+    now_ns_ = rx_ns;
+    if (size > 0) {
+        NaluPacketHeader header;
+        if (!decoder_->ParseHeader(data, size, header)) {
+            unparsed_packets_++;
+        } else {
+            BoardTrack& track = Track(header.board_id);
+            NaluBoardLossStats& stats = track.stats;
+
+            bool accept = true;
+            switch (track.packets.Observe(header.packet_seq)) {
+                case NaluSequenceWindow::Result::GAP:
+                    stats.lost_packets += track.packets.Missed();
+                    break;
+                case NaluSequenceWindow::Result::LATE:
+                    if (stats.lost_packets > 0) stats.lost_packets--;
+                    stats.reordered_packets++;
+                    break;
+                case NaluSequenceWindow::Result::DUPLICATE:
+                    stats.duplicate_packets++;
+                    accept = false;
+                    break;
+                case NaluSequenceWindow::Result::RESYNC:
+                    stats.resyncs++;
+                    track.events.Reset();
+                    break;
+                default:
+                    break;
+            }
+
+            OpenEvent* slot = nullptr;
+            if (accept) {
+                stats.packets++;
+                slot = FindEvent(header.board_id, header.event_number);
+            }
+            if (accept && !slot) {
+                switch (track.events.Observe(header.event_number)) {
+                    case NaluSequenceWindow::Result::GAP:
+                        stats.events_lost += track.events.Missed();
+                        break;
+                    case NaluSequenceWindow::Result::LATE:
+                        if (stats.events_lost > 0) stats.events_lost--;
+                        break;
+                    case NaluSequenceWindow::Result::DUPLICATE:
+                        // The event was already delivered (timed out or evicted)
+                        stats.late_packets++;
+                        accept = false;
+                        break;
+                    default:
+                        break;
+                }
+                if (accept) {
+                    slot = OpenSlot(rx_ns);
+                    slot->event.board_id = header.board_id;
+                    slot->event.event_number = header.event_number;
+                    slot->event.timestamp = header.timestamp;
+                    slot->event.first_rx_ns = rx_ns;
+                }
+            }
+
+            if (slot) {
+                if (header.packet_index >= kMaxPacketsPerEvent || slot->packets.test(header.packet_index)) {
+                    stats.malformed_packets++;
+                } else {
+                    slot->packets.set(header.packet_index);
+                    slot->event.packets_received++;
+                    slot->event.last_rx_ns = rx_ns;
+                    if (header.IsLast()) {
+                        slot->event.packets_expected = static_cast<uint16_t>(header.packet_index + 1);
+                    }
+                    AddBlocks(*slot, data, size, track);
+                    if (slot->event.packets_expected != 0 &&
+                        slot->event.packets_received >= slot->event.packets_expected) {
+                        Deliver(*slot, Reason::COMPLETE);
+                    }
+                }
+            }
+        }
+    }
+
+    if (rx_ns - last_scan_ns_ >= scan_interval_ns_) {
+        last_scan_ns_ = rx_ns;
+        ExpireEvents(rx_ns);
+        Publish();
+    }
+}
+
+void NaluEventBuilder::Flush() {
+    now_ns_ = NaluMonotonicNs();
+    for (OpenEvent& slot : slots_) {
+        if (slot.used) {
+            Deliver(slot, Reason::FLUSH);
+        }
+    }
+    Publish();
+}
+
+NaluDataPathStats NaluEventBuilder::Stats() const {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    return published_;
+}
+
+NaluEventBuilder::BoardTrack& NaluEventBuilder::Track(int board_id) {
+    std::unique_ptr<BoardTrack>& track = boards_[board_id];
+    if (!track) {
+        track = std::make_unique<BoardTrack>();
+    }
+    return *track;
+}
+
+NaluEventBuilder::OpenEvent* NaluEventBuilder::FindEvent(int board_id, uint32_t event_number) {
+    auto matches = [&](const OpenEvent* slot) {
+        return slot && slot->used && slot->event.board_id == board_id && slot->event.event_number == event_number;
+    };
+    if (matches(last_slot_)) {
+        return last_slot_;
+    }
+    if (open_count_ == 0) {
+        return nullptr;
+    }
+    for (OpenEvent& slot : slots_) {
+        if (matches(&slot)) {
+            last_slot_ = &slot;
+            return &slot;
+        }
+    }
+    return nullptr;
+}
+
+NaluEventBuilder::OpenEvent* NaluEventBuilder::OpenSlot(uint64_t rx_ns) {
+    OpenEvent* oldest = nullptr;
+    OpenEvent* free_slot = nullptr;
+    for (OpenEvent& slot : slots_) {
+        if (!slot.used) {
+            free_slot = &slot;
+            break;
+        }
+        if (!oldest || slot.opened_ns < oldest->opened_ns) {
+            oldest = &slot;
+        }
+    }
+    if (!free_slot) {
+        // Table full: the oldest event gives way, which bounds memory under loss
+        Deliver(*oldest, Reason::EVICTED);
+        free_slot = oldest;
+    }
+    free_slot->used = true;
+    free_slot->opened_ns = rx_ns;
+    free_slot->packets.reset();
+    free_slot->channel_windows.fill(0);
+    free_slot->event.Clear();
+    open_count_++;
+    last_slot_ = free_slot;
+    return free_slot;
+}
+
+void NaluEventBuilder::AddBlocks(OpenEvent& slot, const uint8_t* data, size_t size, BoardTrack& track) {
+    BlockAdder adder(slot, track);
+    if (!decoder_->VisitBlocks(data, size, adder)) {
+        track.stats.malformed_packets++;
+    }
+}
+
+bool NaluEventBuilder::BlockAdder::Visit(const NaluWindowBlock& block) {
+    if (block.channel >= kNaluMaxChannels) {
+        track_.stats.malformed_packets++;
+        return false;
+    }
+    NaluEvent& event = slot_.event;
+    NaluEventWindow window;
+    window.channel = block.channel;
+    window.window = block.window;
+    window.sample_count = block.sample_count;
+    window.offset = static_cast<uint32_t>(event.samples.size());
+    event.windows.push_back(window);
+
+    event.samples.resize(event.samples.size() + block.sample_count);
+    uint16_t* samples = event.samples.data() + window.offset;
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    std::memcpy(samples, block.samples, block.sample_count * sizeof(uint16_t));
+#else
+    for (uint16_t i = 0; i < block.sample_count; ++i) {
+        samples[i] = NaluLoadU16(block.samples + 2 * i);
+    }
+#endif
+    event.channel_mask |= 1ULL << block.channel;
+    slot_.channel_windows[block.channel]++;
+    return true;
+}
+
+void NaluEventBuilder::Deliver(OpenEvent& slot, Reason reason) {
+    NaluEvent& event = slot.event;
+    NaluBoardLossStats& stats = Track(event.board_id).stats;
+    event.complete = reason == Reason::COMPLETE;
+    event.built_ns = now_ns_;
+
+    if (event.complete) {
+        stats.events_complete++;
+    } else {
+        stats.events_partial++;
+        if (reason == Reason::TIMEOUT) stats.events_timed_out++;
+        if (reason == Reason::EVICTED) stats.events_evicted++;
+        // Charge the missing windows to their channels
+        for (int channel = 0; channel < kNaluMaxChannels; ++channel) {
+            if ((layout_.channel_mask >> channel) & 1ULL) {
+                int missing = layout_.windows - slot.channel_windows[channel];
+                if (missing > 0) {
+                    stats.channel_windows_lost[channel] += missing;
+                }
+            }
+        }
+    }
+
+    if (counters_) {
+        counters_->RecordEvents(1);
+        for (uint64_t mask = event.channel_mask; mask != 0; mask &= mask - 1) {
+            counters_->RecordChannelHits(__builtin_ctzll(mask));
+        }
+    }
+
+    // Free the slot first so a throwing sink cannot leave it half delivered
+    NaluEvent delivered = std::move(event);
+    event = pool_.Acquire();
+    slot.used = false;
+    open_count_--;
+    if (last_slot_ == &slot) {
+        last_slot_ = nullptr;
+    }
+    if (sink_) {
+        sink_(std::move(delivered));
+    }
+    pool_.Release(std::move(delivered));
+}
+
+void NaluEventBuilder::ExpireEvents(uint64_t now_ns) {
+    if (open_count_ == 0) {
+        return;
+    }
+    for (OpenEvent& slot : slots_) {
+        if (slot.used && now_ns - slot.opened_ns >= timeout_ns_) {
+            Deliver(slot, Reason::TIMEOUT);
+        }
+    }
+}
+
+void NaluEventBuilder::Publish() {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    for (size_t board_id = 0; board_id < boards_.size(); ++board_id) {
+        if (boards_[board_id]) {
+            published_.boards[static_cast<int>(board_id)] = boards_[board_id]->stats;
+        }
+    }
+    published_.unparsed_packets = unparsed_packets_;
+    published_.open_events = open_count_;
+    published_.event_pool = pool_.Stats();
+}
@@ -0,0 +1,184 @@
+#include "nalu_event_filter.h"
+#include "nalu_board_controller_logger.h"
+#include <algorithm>
+#include <bitset>
+
+namespace {
+
+// Bounds the hold queue should timestamps stop advancing
+constexpr size_t kMaxHeldEvents = 65536;
+constexpr size_t kInitialHeldEvents = 64;     // power of two, as every size after it
+
+}  // namespace
+
+void NaluFilterStats::Add(const NaluFilterStats& other) {
+    events_in += other.events_in;
+    accepted += other.accepted;
+    rejected += other.rejected;
+    pending += other.pending;
+    if (rules.size() < other.rules.size()) {
+        rules.resize(other.rules.size());
+    }
+    for (size_t i = 0; i < other.rules.size(); ++i) {
+        rules[i].name = other.rules[i].name;
+        rules[i].accepted += other.rules[i].accepted;
+        rules[i].rejected += other.rules[i].rejected;
+    }
+}
+
+NaluEventFilter::NaluEventFilter(const NaluFilterParams& params, const std::map<int, long long>& clock_offsets,
+                                 NaluEventSink sink)
+    : params_(params), sink_(std::move(sink)), counters_(params.rules.size()) {
+    for (const NaluFilterRule& source : params_.rules) {
+        Rule rule;
+        if (source.channels.empty()) {
+            rule.channel_mask = ~0ULL;
+        }
+        for (int channel : source.channels) {
+            if (channel >= 0 && channel < kNaluMaxChannels) {
+                rule.channel_mask |= 1ULL << channel;
+            }
+        }
+        rule.min_channels = source.min_channels;
+        rule.min_boards = source.min_boards;
+        rule.window = source.coincidence_window;
+        if (rule.min_boards > 1) {
+            cross_board_ = true;
+            max_window_ = std::max(max_window_, rule.window);
+        }
+        rules_.push_back(rule);
+    }
+    for (const auto& [board_id, offset] : clock_offsets) {
+        if (board_id >= 0 && board_id < static_cast<int>(offsets_.size())) {
+            offsets_[board_id] = offset;
+        }
+    }
+}
+
+void NaluEventFilter::HandleEvent(NaluEvent&& event) {
+    events_in_.fetch_add(1, std::memory_order_relaxed);
+
+    NaluExtractHitFeatures(event, params_.baseline_samples, params_.hit_threshold, features_);
+    if (cross_board_ && held_count_ == held_.size()) {
+        GrowHold();
+    }
+    Entry& entry = cross_board_ ? Held(held_count_) : current_;
+    entry.board_id = event.board_id & 0xff;
+    entry.time = static_cast<int64_t>(event.timestamp) + offsets_[entry.board_id];
+    entry.qualifies = 0;
+    entry.decided = false;
+    for (size_t r = 0; r < rules_.size(); ++r) {
+        if (__builtin_popcountll(features_.hit_mask & rules_[r].channel_mask) >= rules_[r].min_channels) {
+            entry.qualifies |= 1ULL << r;
+        }
+    }
+    // Swapped in: the caller gets back the storage of an event decided earlier
+    std::swap(entry.event, event);
+
+    if (!cross_board_) {
+        Decide(entry, 0);
+        return;
+    }
+
+    latest_time_ = held_count_ == 0 ? entry.time : std::max(latest_time_, entry.time);
+    held_count_++;
+
+    // No event still to come can reach back into these windows
+    while (first_undecided_ < held_count_ &&
+           (Held(first_undecided_).time + max_window_ < latest_time_ || held_count_ > kMaxHeldEvents)) {
+        Decide(Held(first_undecided_), first_undecided_);
+        first_undecided_++;
+    }
+    // Keep decided events only as long as an undecided one may pair with them
+    while (held_count_ > 0 && Held(0).decided &&
+           (first_undecided_ == held_count_ || Held(0).time + max_window_ < Held(first_undecided_).time)) {
+        held_head_ = (held_head_ + 1) & (held_.size() - 1);
+        held_count_--;
+        first_undecided_--;
+    }
+    pending_.store(held_count_ - first_undecided_, std::memory_order_relaxed);
+}
+
+void NaluEventFilter::Flush() {
+    while (first_undecided_ < held_count_) {
+        Decide(Held(first_undecided_), first_undecided_);
+        first_undecided_++;
+    }
+    held_count_ = 0;
+    first_undecided_ = 0;
+    pending_.store(0, std::memory_order_relaxed);
+}
+
+NaluFilterStats NaluEventFilter::Stats() const {
+    NaluFilterStats stats;
+    stats.events_in = events_in_.load(std::memory_order_relaxed);
+    stats.accepted = accepted_.load(std::memory_order_relaxed);
+    stats.rejected = rejected_.load(std::memory_order_relaxed);
+    stats.pending = pending_.load(std::memory_order_relaxed);
+    for (size_t r = 0; r < counters_.size(); ++r) {
+        NaluFilterRuleStats rule;
+        rule.name = params_.rules[r].name;
+        rule.accepted = counters_[r].accepted.load(std::memory_order_relaxed);
+        rule.rejected = counters_[r].rejected.load(std::memory_order_relaxed);
+        stats.rules.push_back(rule);
+    }
+    return stats;
+}
+
+void NaluEventFilter::Decide(Entry& entry, size_t index) {
+    entry.decided = true;
+
+    bool accept = false;
+    for (size_t r = 0; r < rules_.size(); ++r) {
+        bool rule_accepts = ((entry.qualifies >> r) & 1ULL) &&
+                            (rules_[r].min_boards <= 1 || Coincident(index, static_cast<int>(r)));
+        if (rule_accepts) {
+            counters_[r].accepted.fetch_add(1, std::memory_order_relaxed);
+            accept = true;
+        } else {
+            counters_[r].rejected.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    if (!accept) {
+        rejected_.fetch_add(1, std::memory_order_relaxed);
+        entry.event.Clear();         // the storage stays for the next event
+        return;
+    }
+    accepted_.fetch_add(1, std::memory_order_relaxed);
+    if (sink_) {
+        try {
+            sink_(std::move(entry.event));
+        } catch (const std::exception& e) {
+            NaluBoardControllerLogger::error(std::string("Filtered event handler failed: ") + e.what());
+        }
+    }
+}
+
+bool NaluEventFilter::Coincident(size_t index, int rule) const {
+    const Entry& entry = Held(index);
+    const Rule& condition = rules_[rule];
+    std::bitset<256> boards;
+    boards.set(entry.board_id);
+    // The hold queue is in time order, so scan outwards from the event
+    for (size_t i = index; i-- > 0 && entry.time - Held(i).time <= condition.window;) {
+        if ((Held(i).qualifies >> rule) & 1ULL) {
+            boards.set(Held(i).board_id);
+        }
+    }
+    for (size_t i = index + 1; i < held_count_ && Held(i).time - entry.time <= condition.window; ++i) {
+        if ((Held(i).qualifies >> rule) & 1ULL) {
+            boards.set(Held(i).board_id);
+        }
+    }
+    return static_cast<int>(boards.count()) >= condition.min_boards;
+}
+
+void NaluEventFilter::GrowHold() {
+    std::vector<Entry> grown(std::max<size_t>(held_.size() * 2, kInitialHeldEvents));
+    for (size_t i = 0; i < held_count_; ++i) {
+        std::swap(grown[i], Held(i));
+    }
+    held_ = std::move(grown);
+    held_head_ = 0;
+}
@@ -0,0 +1,205 @@
+#include "nalu_event_merger.h"
+#include "nalu_board_controller_logger.h"
+#include "nalu_receiver.h"
+#include <algorithm>
+#include <chrono>
+
+namespace {
+
+// Merge thread nap when nothing moved
+constexpr auto kIdleSleep = std::chrono::microseconds(50);
+
+}  // namespace
+
+NaluEventMerger::NaluEventMerger(const NaluMergeParams& params, NaluEventSink sink)
+    : params_(params),
+      sink_(std::move(sink)),
+      max_latency_ns_(static_cast<uint64_t>(std::max(params.max_latency_ms, 0)) * 1000000ULL) {
+    for (const auto& [board_id, offset] : params_.clock_offsets) {
+        if (board_id >= 0 && board_id < static_cast<int>(offsets_.size())) {
+            offsets_[board_id] = offset;
+        }
+    }
+}
+
+NaluEventMerger::~NaluEventMerger() {
+    Stop();
+    for (auto& input : inputs_) {
+        delete input.load();
+    }
+}
+
+void NaluEventMerger::Start() {
+    if (running_.exchange(true)) {
+        return;
+    }
+    warm_until_ns_ = NaluMonotonicNs() + max_latency_ns_;
+    thread_ = std::thread([this] { Run(); });
+}
+
+void NaluEventMerger::Stop() {
+    if (!running_.exchange(false)) {
+        return;
+    }
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    NaluMergeStats stats = Stats();
+    NaluBoardControllerLogger::debug("Event merger stopped: " + std::to_string(stats.events_out) + " event(s) from " +
+                                     std::to_string(stats.boards) + " board(s), " +
+                                     std::to_string(stats.watermark_releases) + " watermark release(s), " +
+                                     std::to_string(stats.late_events) + " late");
+}
+
+bool NaluEventMerger::Push(NaluEvent&& event) {
+    int board_id = event.board_id & 0xff;
+    Input* input = inputs_[board_id].load(std::memory_order_acquire);
+    if (!input) {
+        // Only this board's producer ever creates its input
+        input = new Input(static_cast<size_t>(std::max(params_.queue_capacity, 2)));
+        inputs_[board_id].store(input, std::memory_order_release);
+        input_count_.fetch_add(1, std::memory_order_release);
+    }
+    if (!input->ring.TryPush(std::move(event))) {
+        input->dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    input->pushed.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+NaluMergeStats NaluEventMerger::Stats() const {
+    NaluMergeStats stats;
+    for (const auto& slot : inputs_) {
+        const Input* input = slot.load(std::memory_order_acquire);
+        if (input) {
+            stats.boards++;
+            stats.events_in += input->pushed.load(std::memory_order_relaxed);
+            stats.dropped_full += input->dropped.load(std::memory_order_relaxed);
+        }
+    }
+    stats.events_out = events_out_.load(std::memory_order_relaxed);
+    stats.late_events = late_events_.load(std::memory_order_relaxed);
+    stats.watermark_releases = watermark_releases_.load(std::memory_order_relaxed);
+    stats.max_queue_depth = max_queue_depth_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void NaluEventMerger::Run() {
+    while (running_.load(std::memory_order_relaxed)) {
+        if (!Step(NaluMonotonicNs(), false)) {
+            std::this_thread::sleep_for(kIdleSleep);
+        }
+    }
+    // Producers are done: release the rest in order
+    while (Step(NaluMonotonicNs(), true)) {
+    }
+}
+
+bool NaluEventMerger::Step(uint64_t now_ns, bool draining) {
+    auto later = [](const Head& a, const Head& b) {
+        return a.time != b.time ? a.time > b.time : a.board_id > b.board_id;
+    };
+    bool moved = false;
+
+    int input_count = input_count_.load(std::memory_order_acquire);
+    if (input_count != known_inputs_) {
+        active_boards_.clear();
+        for (int board_id = 0; board_id < static_cast<int>(inputs_.size()); ++board_id) {
+            if (inputs_[board_id].load(std::memory_order_acquire)) {
+                active_boards_.push_back(board_id);
+                if (!has_head_[board_id] && empty_since_ns_[board_id] == 0) {
+                    empty_since_ns_[board_id] = now_ns;
+                }
+            }
+        }
+        known_inputs_ = input_count;
+    }
+
+    auto refill = [&](int board_id) {
+        Input* input = inputs_[board_id].load(std::memory_order_relaxed);
+        uint64_t depth = input->ring.Size();
+        if (depth > max_queue_depth_.load(std::memory_order_relaxed)) {
+            max_queue_depth_.store(depth, std::memory_order_relaxed);
+        }
+        if (!input->ring.TryPop(head_events_[board_id])) {
+            if (empty_since_ns_[board_id] == 0) {
+                empty_since_ns_[board_id] = now_ns;
+            }
+            return;
+        }
+        has_head_[board_id] = true;
+        empty_since_ns_[board_id] = 0;
+        heap_.push_back(Head{MergeTime(head_events_[board_id]), board_id});
+        std::push_heap(heap_.begin(), heap_.end(), later);
+        moved = true;
+    };
+
+    for (int board_id : active_boards_) {
+        if (!has_head_[board_id]) {
+            refill(board_id);
+        }
+    }
+
+    if (!draining && now_ns < warm_until_ns_) {
+        return moved;
+    }
+
+    uint64_t released = 0;
+    while (!heap_.empty()) {
+        // Every board must have a head, or have been empty past the watermark
+        bool all_present = true;
+        bool blocked = false;
+        for (int board_id : active_boards_) {
+            if (!has_head_[board_id]) {
+                all_present = false;
+                if (now_ns - empty_since_ns_[board_id] < max_latency_ns_) {
+                    blocked = true;
+                    break;
+                }
+            }
+        }
+        if (blocked && !draining) {
+            break;
+        }
+        if (!all_present && !draining) {
+            watermark_releases_.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        std::pop_heap(heap_.begin(), heap_.end(), later);
+        Head head = heap_.back();
+        heap_.pop_back();
+        // Swapped, not moved: what the sink leaves behind goes back through
+        // the board's ring to its builder
+        std::swap(released_, head_events_[head.board_id]);
+        has_head_[head.board_id] = false;
+
+        bool late = released_any_ && head.time < last_released_time_;
+        if (late) {
+            late_events_.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            last_released_time_ = head.time;
+            released_any_ = true;
+        }
+        if (!late || !params_.drop_late) {
+            released++;
+            if (sink_) {
+                try {
+                    sink_(std::move(released_));
+                } catch (const std::exception& e) {
+                    NaluBoardControllerLogger::error(std::string("Merged event handler failed: ") + e.what());
+                }
+            }
+        }
+        refill(head.board_id);
+        moved = true;
+    }
+    if (released > 0) {
+        events_out_.fetch_add(released, std::memory_order_relaxed);
+    }
+    return moved;
+}
+
+int64_t NaluEventMerger::MergeTime(const NaluEvent& event) const {
+    return static_cast<int64_t>(event.timestamp) + offsets_[event.board_id & 0xff];
+}
@@ -0,0 +1,59 @@
+#include "nalu_event_pool.h"
+#include <algorithm>
+
+namespace {
+
+size_t StorageBytes(const NaluEvent& event) {
+    return event.windows.capacity() * sizeof(NaluEventWindow) + event.samples.capacity() * sizeof(uint16_t);
+}
+
+}  // namespace
+
+void NaluEventPoolStats::Add(const NaluEventPoolStats& other) {
+    acquired += other.acquired;
+    allocated += other.allocated;
+    released += other.released;
+    discarded += other.discarded;
+    pooled += other.pooled;
+    pooled_bytes += other.pooled_bytes;
+}
+
+NaluEventPool::NaluEventPool(size_t max_pooled, size_t windows_per_event, size_t samples_per_event)
+    : max_pooled_(std::max<size_t>(max_pooled, 1)),
+      windows_per_event_(windows_per_event),
+      samples_per_event_(samples_per_event) {
+    pooled_.reserve(max_pooled_);
+}
+
+NaluEvent NaluEventPool::Acquire() {
+    stats_.acquired++;
+    if (pooled_.empty()) {
+        stats_.allocated++;
+        NaluEvent event;
+        event.windows.reserve(windows_per_event_);
+        event.samples.reserve(samples_per_event_);
+        return event;
+    }
+    NaluEvent event = std::move(pooled_.back());
+    pooled_.pop_back();
+    stats_.pooled_bytes -= StorageBytes(event);
+    return event;
+}
+
+void NaluEventPool::Release(NaluEvent&& event) {
+    stats_.released++;
+    if (pooled_.size() >= max_pooled_ || (event.windows.capacity() == 0 && event.samples.capacity() == 0)) {
+        stats_.discarded++;
+        return;
+    }
+    // Storage that grew past the layout is kept: the layout was too small
+    event.Clear();
+    stats_.pooled_bytes += StorageBytes(event);
+    pooled_.push_back(std::move(event));
+}
+
+NaluEventPoolStats NaluEventPool::Stats() const {
+    NaluEventPoolStats stats = stats_;
+    stats.pooled = pooled_.size();
+    return stats;
+}
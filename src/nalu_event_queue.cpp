@@ -0,0 +1,111 @@
+#include "nalu_event_queue.h"
+#include <chrono>
+#include <stdexcept>
+#include <string>
+
+NaluEventSlotQueue::NaluEventSlotQueue(size_t slots) : slots_(slots), queued_(slots) {
+    if (slots == 0 || slots > (1u << 20)) {
+        throw std::invalid_argument("Invalid event queue size " + std::to_string(slots));
+    }
+    free_.reserve(slots);
+    for (size_t i = slots; i > 0; --i) {
+        free_.push_back(static_cast<int>(i - 1));
+    }
+}
+
+bool NaluEventSlotQueue::Push(NaluEvent&& event) {
+    int index;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (closed_ || free_.empty()) {
+            stats_.dropped++;
+            return false;
+        }
+        index = free_.back();
+        free_.pop_back();
+        stats_.pushed++;
+    }
+    // Nobody else touches a slot between leaving free_ and entering queued_.
+    // Swapped in, so the producer gets back the storage of a released event.
+    // A slot used for the first time (the backlog is deeper than ever) has
+    // none: it takes a copy instead, and the producer keeps its storage
+    // rather than passing an empty event upstream to be allocated for there.
+    NaluEvent& slot = slots_[index];
+    if (slot.windows.capacity() == 0 && slot.samples.capacity() == 0) {
+        // As much room as the producer's storage, which fits its largest events
+        slot.windows.reserve(event.windows.capacity());
+        slot.samples.reserve(event.samples.capacity());
+        slot = event;
+        event.Clear();
+    } else {
+        std::swap(slot, event);
+    }
+    bool wake;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        queued_[(queued_head_ + queued_count_) % queued_.size()] = index;
+        queued_count_++;
+        wake = waiting_;
+    }
+    if (wake) {
+        ready_.notify_one();
+    }
+    return true;
+}
+
+int NaluEventSlotQueue::Pop(int timeout_ms) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto ready = [this] { return queued_count_ > 0 || closed_; };
+    if (!ready() && timeout_ms != 0) {
+        waiting_ = true;
+        if (timeout_ms < 0) {
+            ready_.wait(lock, ready);
+        } else {
+            ready_.wait_for(lock, std::chrono::milliseconds(timeout_ms), ready);
+        }
+        waiting_ = false;
+    }
+    if (queued_count_ == 0) {
+        return -1;
+    }
+    int index = queued_[queued_head_];
+    queued_head_ = (queued_head_ + 1) % queued_.size();
+    queued_count_--;
+    stats_.popped++;
+    stats_.leased++;
+    return index;
+}
+
+void NaluEventSlotQueue::Release(int index) {
+    if (index < 0 || static_cast<size_t>(index) >= slots_.size()) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    free_.push_back(index);
+    stats_.leased--;
+}
+
+void NaluEventSlotQueue::Close() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closed_ = true;
+    }
+    ready_.notify_all();
+}
+
+void NaluEventSlotQueue::Reopen() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    closed_ = false;
+}
+
+bool NaluEventSlotQueue::IsClosed() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return closed_;
+}
+
+NaluEventQueueStats NaluEventSlotQueue::Stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    NaluEventQueueStats stats = stats_;
+    stats.queued = queued_count_;
+    return stats;
+}
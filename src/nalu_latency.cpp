@@ -0,0 +1,145 @@
+#include "nalu_latency.h"
+#include "nalu_single_writer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+namespace {
+
+constexpr uint64_t kSubBuckets = 1u << NaluLatencyTracker::kSubBucketBits;
+
+std::string FormatNs(uint64_t ns) {
+    char text[32];
+    if (ns < 10000) {
+        std::snprintf(text, sizeof(text), "%llu ns", static_cast<unsigned long long>(ns));
+    } else if (ns < 10000000) {
+        std::snprintf(text, sizeof(text), "%.1f us", ns / 1e3);
+    } else {
+        std::snprintf(text, sizeof(text), "%.1f ms", ns / 1e6);
+    }
+    return text;
+}
+
+}  // namespace
+
+std::string NaluLatencySummary::ToString() const {
+    if (count == 0) {
+        return "no events";
+    }
+    return "p50 " + FormatNs(p50_ns) + ", p99 " + FormatNs(p99_ns) + ", p99.9 " + FormatNs(p999_ns) +
+           ", max " + FormatNs(max_ns);
+}
+
+NaluLatencyTracker::NaluLatencyTracker(int producers) {
+    for (int i = 0; i < std::max(producers, 1); ++i) {
+        producers_.push_back(std::make_unique<Producer>());
+    }
+}
+
+int NaluLatencyTracker::Bucket(uint64_t value_ns) {
+    if (value_ns < kSubBuckets) {
+        return static_cast<int>(value_ns);
+    }
+    int exponent = 63 - __builtin_clzll(value_ns);
+    if (exponent >= kMaxValueBits) {
+        return kBuckets - 1;
+    }
+    int shift = exponent - kSubBucketBits;
+    return static_cast<int>(((shift + 1) << kSubBucketBits) + ((value_ns >> shift) - kSubBuckets));
+}
+
+uint64_t NaluLatencyTracker::BucketValue(int bucket) {
+    if (bucket < static_cast<int>(2 * kSubBuckets)) {
+        return static_cast<uint64_t>(bucket);
+    }
+    int shift = (bucket >> kSubBucketBits) - 1;
+    uint64_t low = ((bucket & (kSubBuckets - 1)) + kSubBuckets) << shift;
+    return low + (uint64_t{1} << shift) / 2;
+}
+
+void NaluLatencyTracker::Histogram::Record(uint64_t value_ns) {
+    NaluBump(counts[Bucket(value_ns)]);
+    NaluBump(sum, value_ns);
+    if (value_ns < min.load(std::memory_order_relaxed)) {
+        min.store(value_ns, std::memory_order_relaxed);
+    }
+    if (value_ns > max.load(std::memory_order_relaxed)) {
+        max.store(value_ns, std::memory_order_relaxed);
+    }
+}
+
+void NaluLatencyTracker::Record(int producer, uint64_t first_rx_ns, uint64_t built_ns, uint64_t processed_ns,
+                                uint64_t done_ns) {
+    Producer& histograms = *producers_[producer];
+    // A time before the previous stage's (clock steps of replayed times) counts as zero
+    auto elapsed = [](uint64_t from, uint64_t to) { return to > from ? to - from : 0; };
+    if (first_rx_ns != 0 && built_ns != 0) {
+        histograms.build.Record(elapsed(first_rx_ns, built_ns));
+    }
+    if (built_ns != 0 && processed_ns != 0) {
+        histograms.process.Record(elapsed(built_ns, processed_ns));
+    }
+    if (processed_ns != 0 && done_ns != 0) {
+        histograms.sink.Record(elapsed(processed_ns, done_ns));
+    }
+    if (first_rx_ns != 0 && done_ns != 0) {
+        histograms.total.Record(elapsed(first_rx_ns, done_ns));
+    }
+}
+
+NaluLatencySummary NaluLatencyTracker::Summarize(const std::vector<const Histogram*>& histograms) {
+    NaluLatencySummary summary;
+    uint64_t sum = 0;
+    uint64_t min = UINT64_MAX;
+    std::vector<uint64_t> counts(kBuckets, 0);
+    for (const Histogram* histogram : histograms) {
+        sum += histogram->sum.load(std::memory_order_relaxed);
+        min = std::min(min, histogram->min.load(std::memory_order_relaxed));
+        summary.max_ns = std::max(summary.max_ns, histogram->max.load(std::memory_order_relaxed));
+        for (int bucket = 0; bucket < kBuckets; ++bucket) {
+            counts[bucket] += histogram->counts[bucket].load(std::memory_order_relaxed);
+        }
+    }
+    for (uint64_t count : counts) {
+        summary.count += count;
+    }
+    if (summary.count == 0) {
+        return summary;
+    }
+    // Read while producers write: the sum may be a value or two ahead
+    summary.mean_ns = static_cast<double>(sum) / summary.count;
+    summary.min_ns = std::min(min, summary.max_ns);
+
+    // Percentiles stay within the exact min and max
+    auto percentile = [&](double fraction) {
+        uint64_t rank = static_cast<uint64_t>(std::ceil(fraction * summary.count));
+        uint64_t seen = 0;
+        for (int bucket = 0; bucket < kBuckets; ++bucket) {
+            seen += counts[bucket];
+            if (seen >= std::max<uint64_t>(rank, 1)) {
+                return std::max(summary.min_ns, std::min(BucketValue(bucket), summary.max_ns));
+            }
+        }
+        return summary.max_ns;
+    };
+    summary.p50_ns = percentile(0.50);
+    summary.p99_ns = percentile(0.99);
+    summary.p999_ns = percentile(0.999);
+    return summary;
+}
+
+NaluLatencyStats NaluLatencyTracker::Stats() const {
+    std::vector<const Histogram*> build, process, sink, total;
+    for (const auto& producer : producers_) {
+        build.push_back(&producer->build);
+        process.push_back(&producer->process);
+        sink.push_back(&producer->sink);
+        total.push_back(&producer->total);
+    }
+    NaluLatencyStats stats;
+    stats.build = Summarize(build);
+    stats.process = Summarize(process);
+    stats.sink = Summarize(sink);
+    stats.total = Summarize(total);
+    return stats;
+}
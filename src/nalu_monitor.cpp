@@ -0,0 +1,155 @@
+#include "nalu_monitor.h"
+#include "nalu_receiver.h"
+#include "nalu_single_writer.h"
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+namespace {
+
+constexpr uint64_t kBudgetWindowNs = 1000000000ULL;
+constexpr auto kMeasurePoll = std::chrono::milliseconds(10);
+
+}  // namespace
+
+NaluMonitor::NaluMonitor(const NaluMonitorParams& params, int producers)
+    : params_(params), start_(std::chrono::steady_clock::now()) {
+    params_.prescale = std::max(params_.prescale, 1);
+    params_.bins = std::max(params_.bins, 1);
+    size_t cells = static_cast<size_t>(kNaluMaxChannels) * params_.bins;
+    for (int i = 0; i < std::max(producers, 1); ++i) {
+        auto accumulator = std::make_unique<Accumulator>();
+        accumulator->amplitude = std::make_unique<std::atomic<uint32_t>[]>(cells);
+        accumulator->baseline = std::make_unique<std::atomic<uint32_t>[]>(cells);
+        accumulators_.push_back(std::move(accumulator));
+    }
+}
+
+void NaluMonitor::Observe(int producer, const NaluEvent& event) {
+    Accumulator& acc = *accumulators_[producer];
+    NaluBump(acc.events_seen);
+    if (acc.countdown > 0) {
+        acc.countdown--;
+        return;
+    }
+    acc.countdown = params_.prescale - 1;
+
+    if (params_.max_events_per_second > 0) {
+        uint64_t now_ns = event.last_rx_ns != 0 ? event.last_rx_ns : NaluMonotonicNs();
+        if (now_ns - acc.budget_window_ns >= kBudgetWindowNs) {
+            acc.budget_window_ns = now_ns;
+            acc.budget_used = 0;
+        }
+        if (acc.budget_used >= params_.max_events_per_second) {
+            NaluBump(acc.events_over_budget);
+            return;
+        }
+        acc.budget_used++;
+    }
+
+    NaluBump(acc.events_sampled);
+    NaluExtractHitFeatures(event, params_.baseline_samples, params_.hit_threshold, acc.features);
+    for (uint64_t mask = acc.features.channel_mask; mask != 0; mask &= mask - 1) {
+        int channel = __builtin_ctzll(mask);
+        int amplitude = acc.features.amplitude[channel];
+        int baseline = acc.features.baseline[channel];
+        size_t row = static_cast<size_t>(channel) * params_.bins;
+        NaluBump(acc.channel_events[channel]);
+        NaluBump(acc.baseline_sum[channel], static_cast<uint64_t>(baseline));
+        if (amplitude >= params_.hit_threshold) {
+            NaluBump(acc.hits[channel]);
+        }
+        NaluBump(acc.amplitude[row + Bin(amplitude, params_.amplitude_max)]);
+        NaluBump(acc.baseline[row + Bin(baseline, params_.baseline_max)]);
+    }
+}
+
+NaluMonitorSnapshot NaluMonitor::Snapshot() const {
+    NaluMonitorSnapshot snapshot;
+    snapshot.bins = params_.bins;
+    snapshot.amplitude_max = params_.amplitude_max;
+    snapshot.baseline_max = params_.baseline_max;
+    snapshot.elapsed_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_).count();
+
+    for (const auto& accumulator : accumulators_) {
+        const Accumulator& acc = *accumulator;
+        snapshot.events_seen += acc.events_seen.load(std::memory_order_relaxed);
+        snapshot.events_sampled += acc.events_sampled.load(std::memory_order_relaxed);
+        snapshot.events_over_budget += acc.events_over_budget.load(std::memory_order_relaxed);
+        for (int channel = 0; channel < kNaluMaxChannels; ++channel) {
+            uint64_t events = acc.channel_events[channel].load(std::memory_order_relaxed);
+            if (events == 0) {
+                continue;
+            }
+            NaluChannelMonitor& out = snapshot.channels[channel];
+            if (out.amplitude.empty()) {
+                out.amplitude.assign(params_.bins, 0);
+                out.baseline.assign(params_.bins, 0);
+            }
+            out.events += events;
+            out.hits += acc.hits[channel].load(std::memory_order_relaxed);
+            out.baseline_sum += acc.baseline_sum[channel].load(std::memory_order_relaxed);
+            size_t row = static_cast<size_t>(channel) * params_.bins;
+            for (int bin = 0; bin < params_.bins; ++bin) {
+                out.amplitude[bin] += acc.amplitude[row + bin].load(std::memory_order_relaxed);
+                out.baseline[bin] += acc.baseline[row + bin].load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Sampled hits stand for events_seen / events_sampled events each
+    double scale = snapshot.events_sampled > 0
+                       ? static_cast<double>(snapshot.events_seen) / snapshot.events_sampled
+                       : 0.0;
+    for (auto& [channel, out] : snapshot.channels) {
+        out.baseline_mean = static_cast<double>(out.baseline_sum) / out.events;
+        out.hit_rate_hz = snapshot.elapsed_s > 0.0 ? out.hits * scale / snapshot.elapsed_s : 0.0;
+    }
+    return snapshot;
+}
+
+int NaluMonitor::Bin(int value, int max) const {
+    if (value <= 0 || max <= 0) {
+        return 0;
+    }
+    long bin = static_cast<long>(value) * params_.bins / max;
+    return static_cast<int>(std::min<long>(bin, params_.bins - 1));   // overflow goes to the last bin
+}
+
+NaluMonitorBaselineSource::NaluMonitorBaselineSource(std::function<NaluMonitorSnapshot()> snapshot, int min_events,
+                                                     std::chrono::milliseconds timeout)
+    : snapshot_(std::move(snapshot)), min_events_(std::max(min_events, 1)), timeout_(timeout) {}
+
+std::map<int, double> NaluMonitorBaselineSource::MeasureBaselines(const std::vector<int>& channels) {
+    // Only events sampled from now on reflect the DACs as currently written
+    NaluMonitorSnapshot before = snapshot_();
+    auto deadline = std::chrono::steady_clock::now() + timeout_;
+    while (true) {
+        NaluMonitorSnapshot now = snapshot_();
+        std::map<int, double> baselines;
+        std::string missing;
+        for (int channel : channels) {
+            const auto after_it = now.channels.find(channel);
+            const auto before_it = before.channels.find(channel);
+            uint64_t events = after_it == now.channels.end() ? 0 : after_it->second.events;
+            uint64_t sum = after_it == now.channels.end() ? 0 : after_it->second.baseline_sum;
+            if (before_it != before.channels.end()) {
+                events -= before_it->second.events;
+                sum -= before_it->second.baseline_sum;
+            }
+            if (events < static_cast<uint64_t>(min_events_)) {
+                missing += (missing.empty() ? "" : ", ") + std::to_string(channel);
+                continue;
+            }
+            baselines[channel] = static_cast<double>(sum) / events;
+        }
+        if (missing.empty()) {
+            return baselines;
+        }
+        if (std::chrono::steady_clock::now() >= deadline) {
+            throw std::runtime_error("Not enough monitored events for channel(s) " + missing);
+        }
+        std::this_thread::sleep_for(kMeasurePoll);
+    }
+}
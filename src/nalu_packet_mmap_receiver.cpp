@@ -0,0 +1,423 @@
+#include "nalu_packet_mmap_receiver.h"
+#include "nalu_board_controller_logger.h"
+#include "ip_address_info.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <future>
+#include <set>
+#include <stdexcept>
+#include <arpa/inet.h>
+#include <ifaddrs.h>
+#include <linux/filter.h>
+#include <linux/if_packet.h>
+#include <net/ethernet.h>
+#include <net/if.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr unsigned kBlockBytes = 1 << 20;
+constexpr unsigned kMinBlocks = 4;
+constexpr unsigned kFrameBytes = 2048;         // TPACKET_V3 only uses it for validation
+constexpr unsigned kBlockTimeoutMs = 10;       // kernel retires a partly filled block after this
+constexpr int kPollTimeoutMs = 100;
+constexpr unsigned kMaxHeaderBytes = 60 + 8;   // IPv4 with options, UDP
+
+std::string Errno() {
+    return std::strerror(errno);
+}
+
+// Classic BPF over the IP header (SOCK_DGRAM packet sockets start there):
+// unfragmented UDP to dst_address (host order, 0 for any) and dst_port,
+// captured up to snap_bytes.
+std::vector<sock_filter> UdpFilter(uint32_t dst_address, int dst_port, uint32_t snap_bytes) {
+    std::vector<sock_filter> program;
+    std::vector<size_t> drop_jumps;
+    auto jump_unless_equal = [&](uint32_t value) {
+        drop_jumps.push_back(program.size());
+        program.push_back(BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, value, 0, 0));
+    };
+
+    program.push_back(BPF_STMT(BPF_LD | BPF_B | BPF_ABS, 9));           // protocol
+    jump_unless_equal(IPPROTO_UDP);
+    program.push_back(BPF_STMT(BPF_LD | BPF_H | BPF_ABS, 6));           // flags, fragment offset
+    drop_jumps.push_back(program.size());
+    program.push_back(BPF_JUMP(BPF_JMP | BPF_JSET | BPF_K, 0x3fff, 0, 0));  // MF or offset: fragment
+    if (dst_address != 0) {
+        program.push_back(BPF_STMT(BPF_LD | BPF_W | BPF_ABS, 16));      // destination address
+        jump_unless_equal(dst_address);
+    }
+    program.push_back(BPF_STMT(BPF_LDX | BPF_B | BPF_MSH, 0));          // X = IP header length
+    program.push_back(BPF_STMT(BPF_LD | BPF_H | BPF_IND, 2));           // UDP destination port
+    jump_unless_equal(static_cast<uint32_t>(dst_port));
+    program.push_back(BPF_STMT(BPF_RET | BPF_K, snap_bytes));
+    size_t drop = program.size();
+    program.push_back(BPF_STMT(BPF_RET | BPF_K, 0));
+
+    for (size_t index : drop_jumps) {
+        uint8_t offset = static_cast<uint8_t>(drop - index - 1);
+        if (BPF_OP(program[index].code) == BPF_JSET) {
+            program[index].jt = offset;   // bits set: drop
+        } else {
+            program[index].jf = offset;   // not equal: drop
+        }
+    }
+    return program;
+}
+
+tpacket3_hdr* NextPacket(tpacket3_hdr* packet) {
+    return reinterpret_cast<tpacket3_hdr*>(reinterpret_cast<unsigned char*>(packet) + packet->tp_next_offset);
+}
+
+void AttachFilter(int fd, std::vector<sock_filter>& program) {
+    sock_fprog fprog{};
+    fprog.len = static_cast<unsigned short>(program.size());
+    fprog.filter = program.data();
+    if (setsockopt(fd, SOL_SOCKET, SO_ATTACH_FILTER, &fprog, sizeof(fprog)) != 0) {
+        throw std::runtime_error("Cannot attach BPF filter: " + Errno());
+    }
+}
+
+// Index of the interface holding `address` (network order), 0 for INADDR_ANY
+int InterfaceForAddress(uint32_t address, const std::string& ip) {
+    if (address == 0) {
+        return 0;
+    }
+    ifaddrs* interfaces = nullptr;
+    if (getifaddrs(&interfaces) != 0) {
+        throw std::runtime_error("Cannot list network interfaces: " + Errno());
+    }
+    int index = -1;
+    for (ifaddrs* entry = interfaces; entry && index < 0; entry = entry->ifa_next) {
+        if (entry->ifa_addr && entry->ifa_addr->sa_family == AF_INET &&
+            reinterpret_cast<sockaddr_in*>(entry->ifa_addr)->sin_addr.s_addr == address) {
+            index = static_cast<int>(if_nametoindex(entry->ifa_name));
+        }
+    }
+    freeifaddrs(interfaces);
+    if (index <= 0) {
+        throw std::runtime_error("No local interface has address " + ip);
+    }
+    return index;
+}
+
+}  // namespace
+
+NaluPacketMmapReceiver::NaluPacketMmapReceiver(const NaluReceiverParams& params, const std::string& target_ip_port,
+                                               NaluCaptureCounters* counters)
+    : params_(params), capture_counters_(counters) {
+    IPAddressInfo target(target_ip_port);
+    bind_ip_ = target.getIp();
+    in_addr address{};
+    if (inet_pton(AF_INET, bind_ip_.c_str(), &address) != 1) {
+        throw std::invalid_argument("Invalid receive address " + bind_ip_);
+    }
+    bind_address_ = address.s_addr;
+
+    std::vector<int> ports = QueuePorts(params_, target.getPort());
+    for (size_t i = 0; i < ports.size(); ++i) {
+        auto queue = std::make_unique<Queue>();
+        queue->index = static_cast<int>(i);
+        queue->port = ports[i];
+        queue->cpu = i < params_.cpus.size() ? params_.cpus[i] : -1;
+        queues_.push_back(std::move(queue));
+    }
+
+    static std::atomic<int> next_group{0};
+    fanout_group_ = (static_cast<int>(getpid()) * 31 + next_group.fetch_add(1)) & 0xffff;
+}
+
+NaluPacketMmapReceiver::~NaluPacketMmapReceiver() {
+    Stop();
+}
+
+void NaluPacketMmapReceiver::Start(NaluPacketSink sink) {
+    if (running_.load()) {
+        throw std::runtime_error("Receiver already running");
+    }
+    interface_index_ = InterfaceForAddress(bind_address_, bind_ip_);
+    OpenPortGuards();
+
+    // Rings are set up by the queue threads after pinning; wait for all of them
+    bool fanout = params_.ports.empty() && queues_.size() > 1;
+    sink_ = std::move(sink);
+    running_.store(true);
+    std::vector<std::future<void>> ready;
+    for (auto& queue : queues_) {
+        std::promise<void> opened;
+        ready.push_back(opened.get_future());
+        Queue* raw_queue = queue.get();
+        queue->thread = std::thread([this, raw_queue, fanout, opened = std::move(opened)]() mutable {
+            PlaceReceiveThread(raw_queue->index, raw_queue->cpu, raw_queue->counters);
+            try {
+                OpenRing(*raw_queue, fanout);
+                opened.set_value();
+            } catch (...) {
+                opened.set_exception(std::current_exception());
+                return;
+            }
+            ReceiveLoop(*raw_queue);
+        });
+    }
+
+    std::exception_ptr failure;
+    for (auto& future : ready) {
+        try {
+            future.get();
+        } catch (...) {
+            if (!failure) failure = std::current_exception();
+        }
+    }
+    if (failure) {
+        Stop();
+        std::rethrow_exception(failure);
+    }
+    NaluBoardControllerLogger::info("Receiving on " + bind_ip_ + " with " + std::to_string(queues_.size()) +
+                                    " TPACKET_V3 ring(s)" + (fanout ? " in a fanout group" : ""));
+}
+
+void NaluPacketMmapReceiver::Stop() {
+    if (!running_.exchange(false)) {
+        return;
+    }
+    for (auto& queue : queues_) {
+        if (queue->thread.joinable()) {
+            queue->thread.join();
+        }
+    }
+    CloseAll();
+    NaluBoardControllerLogger::debug("Packet ring receiver stopped");
+}
+
+std::vector<NaluReceiverQueueStats> NaluPacketMmapReceiver::Stats() const {
+    std::vector<NaluReceiverQueueStats> stats(queues_.size());
+    for (size_t i = 0; i < queues_.size(); ++i) {
+        stats[i].queue = queues_[i]->index;
+        stats[i].port = queues_[i]->port;
+        queues_[i]->counters.SnapshotInto(stats[i]);
+    }
+    return stats;
+}
+
+void NaluPacketMmapReceiver::OpenRing(Queue& queue, bool fanout) const {
+    // Protocol 0 receives nothing until bind, so no unfiltered packet gets in
+    queue.fd = socket(AF_PACKET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (queue.fd < 0) {
+        throw std::runtime_error("Cannot create packet socket (needs CAP_NET_RAW): " + Errno());
+    }
+
+    auto fail = [&](const std::string& what) {
+        std::string message = "Receive queue " + std::to_string(queue.index) + ": " + what + ": " + Errno();
+        CloseQueue(queue);
+        throw std::runtime_error(message);
+    };
+
+    std::vector<sock_filter> filter = UdpFilter(ntohl(bind_address_), queue.port,
+                                                params_.max_packet_bytes + kMaxHeaderBytes);
+    try {
+        AttachFilter(queue.fd, filter);
+    } catch (...) {
+        CloseQueue(queue);
+        throw;
+    }
+
+    int version = TPACKET_V3;
+    if (setsockopt(queue.fd, SOL_PACKET, PACKET_VERSION, &version, sizeof(version)) != 0) {
+        fail("TPACKET_V3 not supported");
+    }
+
+    unsigned blocks = std::max<unsigned>(kMinBlocks, static_cast<unsigned>(params_.socket_buffer_bytes) / kBlockBytes);
+    tpacket_req3 request{};
+    request.tp_block_size = kBlockBytes;
+    request.tp_block_nr = blocks;
+    request.tp_frame_size = kFrameBytes;
+    request.tp_frame_nr = kBlockBytes / kFrameBytes * blocks;
+    request.tp_retire_blk_tov = kBlockTimeoutMs;
+    if (setsockopt(queue.fd, SOL_PACKET, PACKET_RX_RING, &request, sizeof(request)) != 0) {
+        fail("cannot create receive ring");
+    }
+    queue.ring_bytes = static_cast<size_t>(kBlockBytes) * blocks;
+    void* ring = mmap(nullptr, queue.ring_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, queue.fd, 0);
+    if (ring == MAP_FAILED) {
+        fail("cannot map receive ring");
+    }
+    queue.ring = static_cast<unsigned char*>(ring);
+
+    sockaddr_ll address{};
+    address.sll_family = AF_PACKET;
+    address.sll_protocol = htons(ETH_P_IP);
+    address.sll_ifindex = interface_index_;
+    if (bind(queue.fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        fail("cannot bind packet socket");
+    }
+
+    if (fanout) {
+        int group = fanout_group_ | (PACKET_FANOUT_HASH << 16);
+        if (setsockopt(queue.fd, SOL_PACKET, PACKET_FANOUT, &group, sizeof(group)) != 0) {
+            fail("cannot join fanout group");
+        }
+    }
+}
+
+void NaluPacketMmapReceiver::CloseQueue(Queue& queue) const {
+    if (queue.ring) {
+        munmap(queue.ring, queue.ring_bytes);
+        queue.ring = nullptr;
+    }
+    if (queue.fd >= 0) {
+        close(queue.fd);
+        queue.fd = -1;
+    }
+}
+
+void NaluPacketMmapReceiver::OpenPortGuards() {
+    std::set<int> ports;
+    for (const auto& queue : queues_) {
+        ports.insert(queue->port);
+    }
+    for (int port : ports) {
+        int fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+        if (fd < 0) {
+            continue;
+        }
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(static_cast<uint16_t>(port));
+        address.sin_addr.s_addr = bind_address_;
+        std::vector<sock_filter> drop_all = {BPF_STMT(BPF_RET | BPF_K, 0)};
+        try {
+            AttachFilter(fd, drop_all);
+        } catch (const std::exception& e) {
+            NaluBoardControllerLogger::debug(std::string("Port guard: ") + e.what());
+        }
+        if (bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+            // Someone else owns the port, which also keeps ICMP quiet
+            NaluBoardControllerLogger::debug("Port " + std::to_string(port) + " already bound: " + Errno());
+            close(fd);
+            continue;
+        }
+        port_guards_.push_back(fd);
+    }
+}
+
+void NaluPacketMmapReceiver::CloseAll() {
+    for (auto& queue : queues_) {
+        CloseQueue(*queue);
+    }
+    for (int fd : port_guards_) {
+        close(fd);
+    }
+    port_guards_.clear();
+}
+
+void NaluPacketMmapReceiver::ReceiveLoop(Queue& queue) {
+    NaluReceiverQueueCounters& counters = queue.counters;
+    const unsigned blocks = static_cast<unsigned>(queue.ring_bytes / kBlockBytes);
+    unsigned block_index = 0;
+
+    uint64_t total_packets = 0, total_bytes = 0, total_blocks = 0, max_batch = 0;
+    uint64_t truncated = 0, errors = 0, kernel_drops = 0;
+    bool sink_error_logged = false;
+    pollfd poll_fd{queue.fd, POLLIN | POLLERR, 0};
+
+    while (running_.load(std::memory_order_relaxed)) {
+        auto* block = reinterpret_cast<tpacket_block_desc*>(queue.ring + static_cast<size_t>(block_index) * kBlockBytes);
+        if ((__atomic_load_n(&block->hdr.bh1.block_status, __ATOMIC_ACQUIRE) & TP_STATUS_USER) == 0) {
+            poll_fd.revents = 0;
+            int ready = poll(&poll_fd, 1, kPollTimeoutMs);
+            if (ready < 0 && errno != EINTR) {
+                counters.errors.store(++errors, std::memory_order_relaxed);
+            }
+            if (ready == 0 && sink_) {
+                try {
+                    sink_(queue.index, nullptr, 0, NaluMonotonicNs());  // idle tick
+                } catch (const std::exception& e) {
+                    counters.errors.store(++errors, std::memory_order_relaxed);
+                    if (!sink_error_logged) {
+                        NaluBoardControllerLogger::error("Receive queue " + std::to_string(queue.index) +
+                                                         ": idle tick failed: " + e.what());
+                        sink_error_logged = true;
+                    }
+                }
+            }
+            continue;
+        }
+
+        uint64_t rx_ns = NaluMonotonicNs();
+        uint32_t packet_count = block->hdr.bh1.num_pkts;
+        uint64_t block_bytes = 0;
+        uint64_t delivered = 0;
+        auto* packet = reinterpret_cast<tpacket3_hdr*>(reinterpret_cast<unsigned char*>(block) +
+                                                       block->hdr.bh1.offset_to_first_pkt);
+        for (uint32_t i = 0; i < packet_count; ++i, packet = NextPacket(packet)) {
+            // Our own transmissions show up on loopback too
+            const auto* link = reinterpret_cast<const sockaddr_ll*>(reinterpret_cast<const unsigned char*>(packet) +
+                                                                    TPACKET_ALIGN(sizeof(tpacket3_hdr)));
+            if (link->sll_pkttype == PACKET_OUTGOING) {
+                continue;
+            }
+
+            const unsigned char* ip = reinterpret_cast<const unsigned char*>(packet) + packet->tp_net;
+            size_t captured = packet->tp_snaplen;
+            size_t header_bytes = static_cast<size_t>(ip[0] & 0x0f) * 4;
+            uint16_t udp_bytes = 0;
+            if (captured >= header_bytes + 8) {
+                std::memcpy(&udp_bytes, ip + header_bytes + 4, sizeof(udp_bytes));
+                udp_bytes = ntohs(udp_bytes);
+            }
+
+            if (packet->tp_snaplen < packet->tp_len) {
+                truncated++;
+            } else if (udp_bytes < 8 || header_bytes + udp_bytes > captured) {
+                errors++;
+            } else {
+                size_t payload_bytes = udp_bytes - 8;
+                block_bytes += payload_bytes;
+                delivered++;
+                if (sink_) {
+                    try {
+                        sink_(queue.index, ip + header_bytes + 8, payload_bytes, rx_ns);
+                    } catch (const std::exception& e) {
+                        errors++;
+                        if (!sink_error_logged) {
+                            NaluBoardControllerLogger::error("Receive queue " + std::to_string(queue.index) +
+                                                             ": packet handler failed: " + e.what());
+                            sink_error_logged = true;
+                        }
+                    }
+                }
+            }
+        }
+
+        // Everything in the block has been delivered: give it back
+        __atomic_store_n(&block->hdr.bh1.block_status, TP_STATUS_KERNEL, __ATOMIC_RELEASE);
+        block_index = (block_index + 1) % blocks;
+
+        // Reading the statistics resets them, so accumulate
+        tpacket_stats_v3 ring_stats{};
+        socklen_t length = sizeof(ring_stats);
+        if (getsockopt(queue.fd, SOL_PACKET, PACKET_STATISTICS, &ring_stats, &length) == 0) {
+            kernel_drops += ring_stats.tp_drops;
+        }
+
+        total_packets += delivered;
+        total_bytes += block_bytes;
+        total_blocks++;
+        max_batch = std::max<uint64_t>(max_batch, packet_count);
+        counters.packets.store(total_packets, std::memory_order_relaxed);
+        counters.bytes.store(total_bytes, std::memory_order_relaxed);
+        counters.batches.store(total_blocks, std::memory_order_relaxed);
+        counters.max_batch.store(max_batch, std::memory_order_relaxed);
+        counters.truncated.store(truncated, std::memory_order_relaxed);
+        counters.kernel_drops.store(kernel_drops, std::memory_order_relaxed);
+        counters.errors.store(errors, std::memory_order_relaxed);
+        if (capture_counters_ && delivered > 0) {
+            capture_counters_->RecordPackets(delivered, block_bytes);
+        }
+    }
+}
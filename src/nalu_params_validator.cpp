@@ -0,0 +1,257 @@
+#include "nalu_params_validator.h"
+#include "ip_address_info.h"
+#include "nalu_event_filter.h"
+#include <algorithm>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+#include <sched.h>
+
+namespace {
+
+// Limits shared by all supported boards
+constexpr int kMaxWindows = 1024;
+constexpr int kMaxChannel = 255;
+constexpr int kMaxRegisterValue = 4095;  // 12-bit trigger and DAC registers
+constexpr int kMaxReference = 15;        // 4-bit trigger references
+constexpr int kMaxReceiveQueues = 64;
+constexpr int kMaxReceiveBatch = 1024;
+
+void CheckIpPort(const std::string& field, const std::string& value, std::vector<std::string>& errors) {
+    try {
+        IPAddressInfo info(value);
+    } catch (const std::exception&) {
+        errors.push_back(field + ": '" + value + "' is not a valid IP:PORT");
+    }
+}
+
+void CheckRange(const std::string& field, long value, long min, long max, std::vector<std::string>& errors) {
+    if (value < min || value > max) {
+        errors.push_back(field + ": " + std::to_string(value) + " is outside [" + std::to_string(min) + ", " +
+                         std::to_string(max) + "]");
+    }
+}
+
+void CheckReadableFile(const std::string& field, const std::string& path, std::vector<std::string>& errors) {
+    if (!path.empty() && !std::ifstream(path).good()) {
+        errors.push_back(field + ": cannot read '" + path + "'");
+    }
+}
+
+void ThrowIfErrors(const std::string& what, const std::vector<std::string>& errors) {
+    if (errors.empty()) {
+        return;
+    }
+    std::string message = "Invalid " + what + ":";
+    for (const auto& error : errors) {
+        message += "\n  " + error;
+    }
+    throw std::invalid_argument(message);
+}
+
+}  // namespace
+
+std::vector<std::string> NaluParamsValidator::CheckBoardParams(const NaluBoardParams& params) {
+    std::vector<std::string> errors;
+    if (params.model.empty()) {
+        errors.push_back("model: must not be empty");
+    }
+    CheckIpPort("board_ip_port", params.board_ip_port, errors);
+    CheckIpPort("host_ip_port", params.host_ip_port, errors);
+    CheckReadableFile("config_file", params.config_file, errors);
+    CheckReadableFile("clock_file", params.clock_file, errors);
+    return errors;
+}
+
+std::vector<std::string> NaluParamsValidator::CheckCaptureParams(const NaluCaptureParams& params) {
+    std::vector<std::string> errors;
+    CheckIpPort("target_ip_port", params.target_ip_port, errors);
+
+    CheckRange("windows", params.windows, 1, kMaxWindows, errors);
+    CheckRange("lookback", params.lookback, 0, kMaxWindows, errors);
+    CheckRange("write_after_trig", params.write_after_trig, 0, kMaxWindows, errors);
+
+    std::string trigger_mode = params.trigger_mode;
+    std::transform(trigger_mode.begin(), trigger_mode.end(), trigger_mode.begin(), ::tolower);
+    if (trigger_mode != "self" && trigger_mode != "ext" && trigger_mode != "imm") {
+        errors.push_back("trigger_mode: '" + params.trigger_mode + "' is not one of self, ext, imm");
+    }
+
+    CheckRange("low_reference", params.low_reference, 0, kMaxReference, errors);
+    CheckRange("high_reference", params.high_reference, 0, kMaxReference, errors);
+    if (params.low_reference > params.high_reference) {
+        errors.push_back("low_reference: must not be above high_reference");
+    }
+
+    for (const auto& [channel, info] : params.channels) {
+        std::string prefix = "channels." + std::to_string(channel);
+        CheckRange(prefix, channel, 0, kMaxChannel, errors);
+        CheckRange(prefix + ".trigger_value", info.trigger_value, 0, kMaxRegisterValue, errors);
+        CheckRange(prefix + ".dac_value", info.dac_value, 0, kMaxRegisterValue, errors);
+    }
+
+    const NaluWatchdogParams& watchdog = params.watchdog;
+    if (watchdog.enabled) {
+        if (watchdog.min_packet_rate < 0.0 || watchdog.min_event_rate < 0.0) {
+            errors.push_back("watchdog: rate thresholds must not be negative");
+        }
+        if (watchdog.rate_window_ms <= 0) {
+            errors.push_back("watchdog.rate_window_ms: must be positive");
+        }
+        if (watchdog.stall_timeout_ms < 0 || watchdog.recovery_grace_ms < 0) {
+            errors.push_back("watchdog: timeouts must not be negative");
+        }
+        if (watchdog.max_recovery_attempts < 1) {
+            errors.push_back("watchdog.max_recovery_attempts: must be at least 1");
+        }
+    }
+
+    const NaluReceiverParams& receiver = params.receiver;
+    std::string receive_mode = receiver.mode;
+    std::transform(receive_mode.begin(), receive_mode.end(), receive_mode.begin(), ::tolower);
+    if (receive_mode != "none" && receive_mode != "socket" && receive_mode != "packet_mmap" &&
+        receive_mode != "replay") {
+        errors.push_back("receiver.mode: '" + receiver.mode + "' is not one of none, socket, packet_mmap, replay");
+    }
+    if (receive_mode == "replay") {
+        if (receiver.replay_file.empty()) {
+            errors.push_back("receiver.replay_file: required for mode replay");
+        }
+        if (!(receiver.replay_speed >= 0.0)) {
+            errors.push_back("receiver.replay_speed: must be 0 (as fast as possible) or positive");
+        }
+        CheckRange("receiver.replay_loops", receiver.replay_loops, 0, std::numeric_limits<int>::max(), errors);
+    }
+    if (receive_mode != "none") {
+        CheckRange("receiver.queues", receiver.queues, 1, kMaxReceiveQueues, errors);
+        CheckRange("receiver.batch_size", receiver.batch_size, 1, kMaxReceiveBatch, errors);
+        CheckRange("receiver.max_packet_bytes", receiver.max_packet_bytes, 64, 65535, errors);
+        CheckRange("receiver.socket_buffer_bytes", receiver.socket_buffer_bytes, 0, std::numeric_limits<int>::max(),
+                   errors);
+        if (receiver.ports.size() > static_cast<size_t>(kMaxReceiveQueues)) {
+            errors.push_back("receiver.ports: more than " + std::to_string(kMaxReceiveQueues) + " ports");
+        }
+        for (size_t i = 0; i < receiver.ports.size(); ++i) {
+            CheckRange("receiver.ports." + std::to_string(i), receiver.ports[i], 1, 65535, errors);
+        }
+        for (size_t i = 0; i < receiver.cpus.size(); ++i) {
+            CheckRange("receiver.cpus." + std::to_string(i), receiver.cpus[i], -1, CPU_SETSIZE - 1, errors);
+        }
+    }
+
+    CheckRange("event_builder.event_timeout_ms", params.event_builder.event_timeout_ms, 1, 60000, errors);
+    CheckRange("event_builder.max_open_events", params.event_builder.max_open_events, 1, 65536, errors);
+
+    const NaluMergeParams& merge = params.merge;
+    if (merge.enabled) {
+        CheckRange("merge.max_latency_ms", merge.max_latency_ms, 0, 60000, errors);
+        CheckRange("merge.queue_capacity", merge.queue_capacity, 2, 1 << 20, errors);
+    }
+    for (const auto& [board_id, offset] : merge.clock_offsets) {
+        CheckRange("merge.clock_offsets", board_id, 0, 255, errors);
+    }
+
+    const NaluFilterParams& filter = params.filter;
+    if (filter.enabled) {
+        CheckRange("filter.hit_threshold", filter.hit_threshold, 0, 65535, errors);
+        CheckRange("filter.baseline_samples", filter.baseline_samples, 1, 65535, errors);
+        if (filter.rules.empty()) {
+            errors.push_back("filter.rules: at least one rule is required when the filter is enabled");
+        }
+        if (filter.rules.size() > static_cast<size_t>(NaluEventFilter::kMaxRules)) {
+            errors.push_back("filter.rules: more than " + std::to_string(NaluEventFilter::kMaxRules) + " rules");
+        }
+        for (size_t i = 0; i < filter.rules.size(); ++i) {
+            const NaluFilterRule& rule = filter.rules[i];
+            std::string field = "filter.rules." + std::to_string(i);
+            for (int channel : rule.channels) {
+                CheckRange(field + ".channels", channel, 0, kNaluMaxChannels - 1, errors);
+            }
+            CheckRange(field + ".min_channels", rule.min_channels, 0, kNaluMaxChannels, errors);
+            CheckRange(field + ".min_boards", rule.min_boards, 1, 256, errors);
+            if (rule.coincidence_window < 0) {
+                errors.push_back(field + ".coincidence_window: must not be negative");
+            }
+            if (rule.min_boards > 1 && !merge.enabled) {
+                errors.push_back(field + ".min_boards: coincidences across boards need merge.enabled");
+            }
+        }
+    }
+
+    const NaluMonitorParams& monitor = params.monitor;
+    if (monitor.enabled) {
+        CheckRange("monitor.prescale", monitor.prescale, 1, std::numeric_limits<int>::max(), errors);
+        CheckRange("monitor.max_events_per_second", monitor.max_events_per_second, 0,
+                   std::numeric_limits<int>::max(), errors);
+        CheckRange("monitor.bins", monitor.bins, 1, 65536, errors);
+        CheckRange("monitor.amplitude_max", monitor.amplitude_max, 1, 65536, errors);
+        CheckRange("monitor.baseline_max", monitor.baseline_max, 1, 65536, errors);
+        CheckRange("monitor.hit_threshold", monitor.hit_threshold, 0, 65535, errors);
+        CheckRange("monitor.baseline_samples", monitor.baseline_samples, 1, 65535, errors);
+    }
+
+    const NaluWaveformParams& waveform = params.waveform;
+    if (waveform.enabled) {
+        CheckRange("waveform.buffer_windows", waveform.buffer_windows, 0, 256, errors);
+        // A readout of the whole buffer has no gap to tell its oldest window by
+        if (waveform.buffer_windows > 0 && params.windows >= waveform.buffer_windows) {
+            errors.push_back("windows: waveform assembly needs fewer than waveform.buffer_windows (" +
+                             std::to_string(waveform.buffer_windows) + ")");
+        }
+    }
+
+    const NaluRecordParams& record = params.record;
+    if (!record.path.empty()) {
+        if (receive_mode == "none") {
+            errors.push_back("record.path: recording needs a receiver.mode other than none");
+        }
+        CheckRange("record.chunk_bytes", record.chunk_bytes, 4096, 1 << 30, errors);
+        CheckRange("record.max_chunks", record.max_chunks, 2, 1 << 16, errors);
+    }
+    return errors;
+}
+
+std::vector<std::string> NaluParamsValidator::CheckCaptureParams(const NaluCaptureParams& params,
+                                                                const NaluBoardModel& model) {
+    std::vector<std::string> errors = CheckCaptureParams(params);
+    std::string on_model = " for " + std::string(model.name);
+
+    auto check_model_range = [&](const std::string& field, long value, long min, long max) {
+        std::vector<std::string> range_errors;
+        CheckRange(field, value, min, max, range_errors);
+        for (const auto& error : range_errors) {
+            errors.push_back(error + on_model);
+        }
+    };
+
+    check_model_range("windows", params.windows, 1, model.windows);
+    check_model_range("lookback", params.lookback, 0, model.windows);
+    check_model_range("write_after_trig", params.write_after_trig, 0, model.windows);
+    check_model_range("waveform.buffer_windows", params.waveform.buffer_windows, 0, model.windows);
+    if (params.waveform.enabled && params.waveform.buffer_windows == 0 && params.windows >= model.windows) {
+        errors.push_back("windows: waveform assembly needs fewer than the " + std::to_string(model.windows) +
+                         " buffer windows" + on_model);
+    }
+    check_model_range("low_reference", params.low_reference, 0, model.max_reference);
+    check_model_range("high_reference", params.high_reference, 0, model.max_reference);
+
+    for (const auto& [channel, info] : params.channels) {
+        std::string prefix = "channels." + std::to_string(channel);
+        check_model_range(prefix, channel, 0, model.channels - 1);
+        check_model_range(prefix + ".trigger_value", info.trigger_value, 0, model.max_trigger_value);
+        check_model_range(prefix + ".dac_value", info.dac_value, 0, model.max_dac_value);
+    }
+    return errors;
+}
+
+void NaluParamsValidator::ValidateBoardParams(const NaluBoardParams& params) {
+    ThrowIfErrors("board parameters", CheckBoardParams(params));
+}
+
+void NaluParamsValidator::ValidateCaptureParams(const NaluCaptureParams& params) {
+    ThrowIfErrors("capture parameters", CheckCaptureParams(params));
+}
+
+void NaluParamsValidator::ValidateCaptureParams(const NaluCaptureParams& params, const NaluBoardModel& model) {
+    ThrowIfErrors("capture parameters", CheckCaptureParams(params, model));
+}
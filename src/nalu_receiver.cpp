@@ -0,0 +1,68 @@
+#include "nalu_receiver.h"
+#include "nalu_socket_receiver.h"
+#include "nalu_packet_mmap_receiver.h"
+#include "nalu_replay_receiver.h"
+#include "nalu_board_controller_logger.h"
+#include "nalu_cpu_placement.h"
+#include <algorithm>
+#include <stdexcept>
+#include <time.h>
+
+void NaluReceiverQueueCounters::SnapshotInto(NaluReceiverQueueStats& stats) const {
+    stats.cpu = cpu.load(std::memory_order_relaxed);
+    stats.numa_node = numa_node.load(std::memory_order_relaxed);
+    stats.huge_pages = huge_pages.load(std::memory_order_relaxed);
+    stats.packets = packets.load(std::memory_order_relaxed);
+    stats.bytes = bytes.load(std::memory_order_relaxed);
+    stats.batches = batches.load(std::memory_order_relaxed);
+    stats.max_batch = max_batch.load(std::memory_order_relaxed);
+    stats.truncated = truncated.load(std::memory_order_relaxed);
+    stats.kernel_drops = kernel_drops.load(std::memory_order_relaxed);
+    stats.errors = errors.load(std::memory_order_relaxed);
+}
+
+std::unique_ptr<NaluReceiver> NaluReceiver::Create(const NaluReceiverParams& params,
+                                                   const std::string& target_ip_port,
+                                                   NaluCaptureCounters* counters) {
+    std::string mode = params.mode;
+    std::transform(mode.begin(), mode.end(), mode.begin(), ::tolower);
+    if (mode == "none") {
+        return nullptr;
+    }
+    if (mode == "socket") {
+        return std::make_unique<NaluSocketReceiver>(params, target_ip_port, counters);
+    }
+    if (mode == "packet_mmap") {
+        return std::make_unique<NaluPacketMmapReceiver>(params, target_ip_port, counters);
+    }
+    if (mode == "replay") {
+        return std::make_unique<NaluReplayReceiver>(params, counters);
+    }
+    throw std::invalid_argument("Unknown receiver mode '" + params.mode + "'");
+}
+
+std::vector<int> NaluReceiver::QueuePorts(const NaluReceiverParams& params, int target_port) {
+    if (!params.ports.empty()) {
+        return params.ports;
+    }
+    return std::vector<int>(std::max(params.queues, 1), target_port);
+}
+
+void NaluReceiver::PlaceReceiveThread(int queue, int cpu, NaluReceiverQueueCounters& counters) {
+    if (cpu >= 0) {
+        try {
+            NaluCpuPlacement::PinCurrentThread(cpu);
+        } catch (const std::exception& e) {
+            NaluBoardControllerLogger::warning("Receive queue " + std::to_string(queue) + ": " + e.what());
+        }
+    }
+    counters.cpu.store(cpu, std::memory_order_relaxed);
+    counters.numa_node.store(NaluCpuPlacement::NumaNodeOfCpu(NaluCpuPlacement::CurrentCpu()),
+                             std::memory_order_relaxed);
+}
+
+uint64_t NaluMonotonicNs() {
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return static_cast<uint64_t>(now.tv_sec) * 1000000000ULL + static_cast<uint64_t>(now.tv_nsec);
+}
@@ -0,0 +1,228 @@
+#include "nalu_replay_receiver.h"
+#include "nalu_board_controller_logger.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+constexpr size_t kReadBytes = 4 << 20;
+// Sleep instead of spinning when the next datagram is this far ahead
+constexpr uint64_t kSleepAheadNs = 200000;
+constexpr auto kIdleTick = std::chrono::milliseconds(100);
+
+std::FILE* OpenCapture(const std::string& path, NaluCaptureFileHeader& header) {
+    std::FILE* file = std::fopen(path.c_str(), "rb");
+    if (!file) {
+        throw std::runtime_error("Cannot open capture file " + path + ": " + std::strerror(errno));
+    }
+    uint8_t bytes[kNaluCaptureHeaderBytes];
+    if (std::fread(bytes, 1, sizeof(bytes), file) != sizeof(bytes) ||
+        !NaluParseCaptureHeader(bytes, sizeof(bytes), header)) {
+        std::fclose(file);
+        throw std::runtime_error("Not a capture file: " + path);
+    }
+    return file;
+}
+
+}  // namespace
+
+NaluReplayReceiver::NaluReplayReceiver(const NaluReceiverParams& params, NaluCaptureCounters* counters)
+    : params_(params), capture_counters_(counters) {
+    std::fclose(OpenCapture(params_.replay_file, header_));
+    for (uint32_t i = 0; i < header_.queues; ++i) {
+        queues_.push_back(std::make_unique<Queue>());
+    }
+}
+
+NaluReplayReceiver::~NaluReplayReceiver() {
+    Stop();
+}
+
+void NaluReplayReceiver::Start(NaluPacketSink sink) {
+    if (running_.load()) {
+        return;
+    }
+    sink_ = std::move(sink);
+    finished_.store(false);
+    running_.store(true);
+    thread_ = std::thread([this] { ReplayLoop(); });
+    NaluBoardControllerLogger::info("Replaying " + params_.replay_file + " (" + std::to_string(header_.queues) +
+                                    " queue(s), speed " + std::to_string(params_.replay_speed) + ")");
+}
+
+void NaluReplayReceiver::Stop() {
+    if (!running_.exchange(false)) {
+        return;
+    }
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    NaluBoardControllerLogger::debug("Replay receiver stopped");
+}
+
+std::vector<NaluReceiverQueueStats> NaluReplayReceiver::Stats() const {
+    std::vector<NaluReceiverQueueStats> stats(queues_.size());
+    for (size_t i = 0; i < queues_.size(); ++i) {
+        stats[i].queue = static_cast<int>(i);
+        queues_[i]->counters.SnapshotInto(stats[i]);
+    }
+    return stats;
+}
+
+void NaluReplayReceiver::ReplayLoop() {
+    bool sink_error_logged = false;
+    for (int loop = 0; params_.replay_loops == 0 || loop < params_.replay_loops; ++loop) {
+        std::FILE* file = nullptr;
+        try {
+            NaluCaptureFileHeader header;
+            file = OpenCapture(params_.replay_file, header);
+        } catch (const std::exception& e) {
+            NaluBoardControllerLogger::error(std::string("Replay: ") + e.what());
+            break;
+        }
+        const uint64_t packets_before = ReplayedPackets();
+        PlayResult result = PlayOnce(file, sink_error_logged);
+        std::fclose(file);
+        if (result == PlayResult::STOPPED) {
+            return;
+        }
+        if (result == PlayResult::CORRUPT) {
+            break;
+        }
+        if (ReplayedPackets() == packets_before) {
+            // Another pass would deliver nothing either, however many are left
+            NaluBoardControllerLogger::warning("Replay: " + params_.replay_file + " holds no datagrams");
+            break;
+        }
+    }
+
+    NaluBoardControllerLogger::info("Replay finished: " + std::to_string(ReplayedPackets()) + " packet(s)");
+    finished_.store(true);
+
+    // Keep per-queue timeouts going, as an idle receiver would. A fast replay
+    // may have run ahead of the clock; tick on from where it stopped.
+    uint64_t finished_ns = NaluMonotonicNs();
+    uint64_t ahead_ns = last_rx_ns_ > finished_ns ? last_rx_ns_ - finished_ns : 0;
+    while (running_.load(std::memory_order_relaxed)) {
+        std::this_thread::sleep_for(kIdleTick);
+        for (size_t i = 0; i < queues_.size() && sink_; ++i) {
+            Dispatch(static_cast<int>(i), nullptr, 0, NaluMonotonicNs() + ahead_ns, sink_error_logged);
+        }
+    }
+}
+
+uint64_t NaluReplayReceiver::ReplayedPackets() const {
+    uint64_t packets = 0;
+    for (const auto& queue : queues_) {
+        packets += queue->packets;
+    }
+    return packets;
+}
+
+NaluReplayReceiver::PlayResult NaluReplayReceiver::PlayOnce(std::FILE* file, bool& sink_error_logged) {
+    const double speed = params_.replay_speed;
+    // A loop never starts before the previous one's last datagram
+    const uint64_t start_ns = std::max(NaluMonotonicNs(), last_rx_ns_);
+    // Times count from the start of the recording, when the header has it:
+    // the file's first record need not be its earliest, as queues are
+    // written in blocks
+    bool have_first = header_.start_ns != 0;
+    uint64_t first_rx_ns = header_.start_ns;
+
+    std::vector<uint8_t> buffer(kReadBytes);
+    size_t begin = 0, end = 0;
+    bool eof = false;
+
+    while (running_.load(std::memory_order_relaxed)) {
+        size_t available = end - begin;
+        uint32_t size = 0;
+        if (available >= kNaluCaptureRecordHeaderBytes) {
+            size = NaluLoadU32(buffer.data() + begin + 12);
+            if (size > kNaluCaptureMaxRecordBytes) {
+                NaluBoardControllerLogger::error("Replay: record of " + std::to_string(size) + " bytes in " +
+                                                 params_.replay_file + " is larger than any datagram; stopping");
+                return PlayResult::CORRUPT;
+            }
+        }
+        if (available < kNaluCaptureRecordHeaderBytes || available < kNaluCaptureRecordHeaderBytes + size) {
+            if (eof) {
+                if (available > 0) {
+                    NaluBoardControllerLogger::warning("Replay: ignoring truncated record at the end of " +
+                                                       params_.replay_file);
+                }
+                return PlayResult::END;
+            }
+            // Move the partial record to the front and refill behind it
+            std::memmove(buffer.data(), buffer.data() + begin, available);
+            begin = 0;
+            end = available;
+            if (kNaluCaptureRecordHeaderBytes + size > buffer.size()) {
+                buffer.resize(kNaluCaptureRecordHeaderBytes + size);
+            }
+            size_t read = std::fread(buffer.data() + end, 1, buffer.size() - end, file);
+            end += read;
+            eof = read == 0;
+            continue;
+        }
+
+        const uint8_t* record = buffer.data() + begin;
+        uint64_t recorded_ns = NaluLoadU64(record);
+        int queue = NaluLoadU16(record + 8) % static_cast<int>(queues_.size());
+        begin += kNaluCaptureRecordHeaderBytes + size;
+
+        if (!have_first) {
+            first_rx_ns = recorded_ns;
+            have_first = true;
+        }
+        uint64_t offset_ns = recorded_ns > first_rx_ns ? recorded_ns - first_rx_ns : 0;
+        uint64_t rx_ns;
+        if (speed > 0.0) {
+            rx_ns = start_ns + static_cast<uint64_t>(offset_ns / speed);
+            uint64_t now_ns = NaluMonotonicNs();
+            while (now_ns < rx_ns && running_.load(std::memory_order_relaxed)) {
+                if (rx_ns - now_ns > kSleepAheadNs) {
+                    std::this_thread::sleep_for(std::chrono::nanoseconds(rx_ns - now_ns - kSleepAheadNs / 2));
+                }
+                now_ns = NaluMonotonicNs();
+            }
+        } else {
+            rx_ns = start_ns + offset_ns;
+        }
+        last_rx_ns_ = rx_ns;
+        Dispatch(queue, record + kNaluCaptureRecordHeaderBytes, size, rx_ns, sink_error_logged);
+    }
+    return PlayResult::STOPPED;
+}
+
+void NaluReplayReceiver::Dispatch(int queue_index, const uint8_t* data, size_t size, uint64_t rx_ns,
+                                  bool& sink_error_logged) {
+    Queue& queue = *queues_[queue_index];
+    if (sink_) {
+        try {
+            sink_(queue_index, data, size, rx_ns);
+        } catch (const std::exception& e) {
+            queue.counters.errors.store(++queue.errors, std::memory_order_relaxed);
+            if (!sink_error_logged) {
+                NaluBoardControllerLogger::error("Replay queue " + std::to_string(queue_index) +
+                                                 ": packet handler failed: " + e.what());
+                sink_error_logged = true;
+            }
+        }
+    }
+    if (size == 0) {
+        return;
+    }
+    queue.packets++;
+    queue.bytes += size;
+    queue.counters.packets.store(queue.packets, std::memory_order_relaxed);
+    queue.counters.bytes.store(queue.bytes, std::memory_order_relaxed);
+    queue.counters.batches.store(queue.packets, std::memory_order_relaxed);
+    queue.counters.max_batch.store(1, std::memory_order_relaxed);
+    if (capture_counters_) {
+        capture_counters_->RecordPackets(1, size);
+    }
+}
@@ -0,0 +1,249 @@
+#include "nalu_scan_engine.h"
+#include "nalu_board_controller_logger.h"
+#include <algorithm>
+#include <set>
+#include <stdexcept>
+#include <thread>
+
+NaluScanEngine::NaluScanEngine(NaluBoardState* state, NaluBoardConfigurator* configurator,
+                               const NaluCaptureCounters* counters)
+    : state_(state), configurator_(configurator), counters_(counters) {}
+
+NaluScanResult NaluScanEngine::Run(const NaluScanPlan& plan, std::unique_lock<std::mutex>* board_lock) {
+    Validate(plan);
+    cancel_requested_.store(false);
+
+    original_values_.clear();
+    for (int channel : plan.channels) {
+        original_values_.emplace_back(channel, CurrentValue(plan, channel));
+    }
+
+    const int steps = StepCount(plan);
+    const auto dwell = std::chrono::milliseconds(plan.dwell_ms);
+    const auto settle = std::chrono::milliseconds(plan.settle_ms);
+    NaluBoardControllerLogger::info("Starting scan: " + std::to_string(plan.channels.size()) + " channel(s), " +
+                                    std::to_string(steps) + " step(s), " + std::to_string(plan.dwell_ms) + " ms dwell");
+
+    NaluScanResult result;
+    auto scan_start = Clock::now();
+
+    // Previous step, tallied while the current one is counting
+    StepValues pending_values;
+    int pending_step = 0;
+    NaluCaptureCountersSnapshot pending_begin;
+    NaluCaptureCountersSnapshot pending_end;
+    std::chrono::nanoseconds pending_live_time{0};
+    bool have_pending = false;
+
+    try {
+        StepValues current = ValuesForStep(plan, 0);
+        configurator_->ApplyHotUpdate(UpdateForStep(plan, current));
+        bool running = WaitUntil(Clock::now() + settle, board_lock);
+        auto begin_time = Clock::now();
+        NaluCaptureCountersSnapshot begin = counters_->Snapshot();
+
+        for (int step = 0; running && step < steps; ++step) {
+            if (have_pending) {
+                Tally(pending_values, pending_step, pending_begin, pending_end, pending_live_time, result);
+                have_pending = false;
+            }
+
+            bool has_next = step + 1 < steps;
+            StepValues next;
+            NaluHotUpdate next_update;
+            if (has_next) {
+                next = ValuesForStep(plan, step + 1);
+                next_update = UpdateForStep(plan, next);
+            }
+
+            running = WaitUntil(begin_time + dwell, board_lock);
+            auto end_time = Clock::now();
+            pending_end = counters_->Snapshot();
+            pending_begin = begin;
+            pending_values = current;
+            pending_step = step;
+            pending_live_time = std::chrono::duration_cast<std::chrono::nanoseconds>(end_time - begin_time);
+            have_pending = true;
+            result.steps++;
+
+            if (!running || !has_next) {
+                break;
+            }
+
+            configurator_->ApplyHotUpdate(next_update);
+            running = WaitUntil(Clock::now() + settle, board_lock);
+            begin_time = Clock::now();
+            begin = counters_->Snapshot();
+            result.switch_time += std::chrono::duration_cast<std::chrono::nanoseconds>(begin_time - end_time);
+            current = std::move(next);
+        }
+        result.cancelled = !running;
+    } catch (const std::exception& e) {
+        NaluBoardControllerLogger::error(std::string("Scan failed: ") + e.what());
+        if (plan.restore_values) {
+            try {
+                configurator_->ApplyHotUpdate(UpdateForStep(plan, original_values_));
+            } catch (const std::exception& restore_error) {
+                NaluBoardControllerLogger::error(std::string("Restoring values after failed scan: ") + restore_error.what());
+            }
+        }
+        throw;
+    }
+
+    if (have_pending) {
+        Tally(pending_values, pending_step, pending_begin, pending_end, pending_live_time, result);
+    }
+    if (plan.restore_values) {
+        configurator_->ApplyHotUpdate(UpdateForStep(plan, original_values_));
+    }
+
+    result.total_time = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - scan_start);
+    NaluBoardControllerLogger::info(
+        std::string(result.cancelled ? "Scan cancelled after " : "Scan finished: ") + std::to_string(result.steps) +
+        " step(s) in " + std::to_string(std::chrono::duration<double>(result.total_time).count()) + " s (" +
+        std::to_string(result.StepsPerSecond()) + " steps/s, " +
+        std::to_string(std::chrono::duration<double, std::milli>(result.switch_time).count()) + " ms switching)");
+    return result;
+}
+
+void NaluScanEngine::Validate(const NaluScanPlan& plan) const {
+    if (plan.channels.empty()) {
+        throw std::invalid_argument("Scan plan has no channels.");
+    }
+    int channel_count = state_->ChannelCount();
+    std::set<int> seen;
+    for (int channel : plan.channels) {
+        if (channel < 0 || channel >= channel_count || channel >= kNaluMaxChannels) {
+            throw std::invalid_argument("Scan channel " + std::to_string(channel) + ", which the " +
+                                        std::string(state_->BoardModel().name) + " does not have.");
+        }
+        if (plan.parameter == NaluScanParameter::DAC_VALUE && !(state_->EnabledChannelMask() >> channel & 1)) {
+            throw std::invalid_argument("DAC scan channel " + std::to_string(channel) +
+                                        " is not enabled in the capture configuration.");
+        }
+        if (!seen.insert(channel).second) {
+            throw std::invalid_argument("Scan channel " + std::to_string(channel) + " listed twice.");
+        }
+    }
+    if (plan.step == 0 || (plan.stop != plan.start && (plan.stop > plan.start) != (plan.step > 0))) {
+        throw std::invalid_argument("Scan step must be non-zero and move from start towards stop.");
+    }
+    const NaluBoardModel& model = state_->BoardModel();
+    int max_value = plan.parameter == NaluScanParameter::TRIGGER_VALUE ? model.max_trigger_value : model.max_dac_value;
+    if (plan.start < 0 || plan.start > max_value || plan.stop < 0 || plan.stop > max_value) {
+        throw std::invalid_argument("Scan range " + std::to_string(plan.start) + ".." + std::to_string(plan.stop) +
+                                    " is outside [0, " + std::to_string(max_value) + "].");
+    }
+    if (plan.dwell_ms < 0 || plan.settle_ms < 0) {
+        throw std::invalid_argument("Scan dwell and settle times must not be negative.");
+    }
+    if (plan.parameter == NaluScanParameter::DAC_VALUE && !state_->AssignDacValues()) {
+        throw std::invalid_argument("DAC scans need assign_dac_values.");
+    }
+    if (plan.parameter == NaluScanParameter::TRIGGER_VALUE) {
+        std::string trigger_mode = state_->TriggerMode();
+        std::transform(trigger_mode.begin(), trigger_mode.end(), trigger_mode.begin(), ::tolower);
+        if (trigger_mode != "self") {
+            throw std::invalid_argument("Trigger value scans need trigger_mode 'self'.");
+        }
+    }
+}
+
+int NaluScanEngine::StepCount(const NaluScanPlan& plan) const {
+    int values = (plan.stop - plan.start) / plan.step + 1;
+    if (plan.mode == NaluScanMode::SEQUENTIAL) {
+        return values * static_cast<int>(plan.channels.size());
+    }
+    return values;
+}
+
+NaluScanEngine::StepValues NaluScanEngine::ValuesForStep(const NaluScanPlan& plan, int step) const {
+    StepValues values;
+    if (plan.mode == NaluScanMode::SEQUENTIAL) {
+        int values_per_channel = (plan.stop - plan.start) / plan.step + 1;
+        int channel = plan.channels[step / values_per_channel];
+        values.emplace_back(channel, plan.start + plan.step * (step % values_per_channel));
+    } else {
+        int value = plan.start + plan.step * step;
+        for (int channel : plan.channels) {
+            values.emplace_back(channel, value);
+        }
+    }
+    return values;
+}
+
+NaluHotUpdate NaluScanEngine::UpdateForStep(const NaluScanPlan& plan, const StepValues& values) const {
+    NaluHotUpdate update;
+    auto set_value = [&](int channel, int value) {
+        if (value == CurrentValue(plan, channel)) {
+            update.channels.erase(channel);
+            return;
+        }
+        if (plan.parameter == NaluScanParameter::TRIGGER_VALUE) {
+            update.channels[channel].trigger_value = value;
+        } else {
+            update.channels[channel].dac_value = value;
+        }
+    };
+
+    // In sequential mode the channels not being measured sit at their original values
+    if (plan.mode == NaluScanMode::SEQUENTIAL) {
+        for (const auto& [channel, value] : original_values_) {
+            set_value(channel, value);
+        }
+    }
+    for (const auto& [channel, value] : values) {
+        set_value(channel, value);
+    }
+    return update;
+}
+
+int NaluScanEngine::CurrentValue(const NaluScanPlan& plan, int channel) const {
+    if (plan.parameter == NaluScanParameter::TRIGGER_VALUE) {
+        return state_->TriggerValues()[channel];
+    }
+    return state_->DacValues()[channel];
+}
+
+void NaluScanEngine::Tally(const StepValues& values, int step,
+                           const NaluCaptureCountersSnapshot& begin, const NaluCaptureCountersSnapshot& end,
+                           std::chrono::nanoseconds live_time, NaluScanResult& result) const {
+    double seconds = std::chrono::duration<double>(live_time).count();
+    uint64_t events = end.events - begin.events;
+    for (const auto& [channel, value] : values) {
+        NaluScanPoint point;
+        point.step = step;
+        point.channel = channel;
+        point.value = value;
+        point.events = events;
+        point.channel_hits = end.channel_hits[channel] - begin.channel_hits[channel];
+        point.live_time = live_time;
+        if (seconds > 0.0) {
+            point.event_rate = events / seconds;
+            point.channel_rate = point.channel_hits / seconds;
+        }
+        result.points.push_back(point);
+    }
+}
+
+bool NaluScanEngine::WaitUntil(Clock::time_point deadline, std::unique_lock<std::mutex>* board_lock) {
+    if (board_lock) {
+        board_lock->unlock();
+    }
+    // Sleep in short slices so Cancel() takes effect promptly
+    const auto slice = std::chrono::milliseconds(20);
+    bool reached = false;
+    while (!cancel_requested_.load()) {
+        auto now = Clock::now();
+        if (now >= deadline) {
+            reached = true;
+            break;
+        }
+        std::this_thread::sleep_for(std::min<Clock::duration>(deadline - now, slice));
+    }
+    if (board_lock) {
+        board_lock->lock();
+    }
+    // Cancelled while the lock was released (stop_capture() does so)
+    return reached && !cancel_requested_.load();
+}
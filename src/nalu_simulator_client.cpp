@@ -0,0 +1,150 @@
+#include "nalu_simulator_client.h"
+#include "nalu_board_controller_logger.h"
+#include <cerrno>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+
+std::string Errno() {
+    return std::strerror(errno);
+}
+
+std::string JoinList(const std::vector<int>& values) {
+    std::string text;
+    for (size_t i = 0; i < values.size(); ++i) {
+        if (i > 0) {
+            text += ",";
+        }
+        text += std::to_string(values[i]);
+    }
+    return text;
+}
+
+}  // namespace
+
+NaluSimulatorClient::NaluSimulatorClient(const std::string& control_ip_port, int timeout_ms)
+    : control_(control_ip_port), timeout_ms_(timeout_ms) {
+    IPAddressInfo control(control_ip_port);
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(static_cast<uint16_t>(control.getPort()));
+    if (inet_pton(AF_INET, control.getIp().c_str(), &address.sin_addr) != 1) {
+        throw std::invalid_argument("Invalid simulator control address: " + control_ip_port);
+    }
+    fd_ = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (fd_ < 0) {
+        throw std::runtime_error("Simulator client socket failed: " + Errno());
+    }
+    // Connected, so only the simulator's replies are received
+    if (connect(fd_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+        std::string error = Errno();
+        close(fd_);
+        throw std::runtime_error("Simulator client cannot reach " + control_ip_port + ": " + error);
+    }
+}
+
+NaluSimulatorClient::~NaluSimulatorClient() {
+    if (fd_ >= 0) {
+        close(fd_);
+    }
+}
+
+std::string NaluSimulatorClient::Command(const std::string& command) {
+    char buffer[2048];
+    // A reply that came after an earlier command timed out must not be taken for this one's
+    while (recv(fd_, buffer, sizeof(buffer), MSG_DONTWAIT) >= 0) {
+    }
+
+    if (send(fd_, command.data(), command.size(), 0) < 0) {
+        throw std::runtime_error("Simulator " + control_ + " '" + command + "': send failed: " + Errno());
+    }
+    pollfd poll_fd{fd_, POLLIN, 0};
+    int ready = poll(&poll_fd, 1, timeout_ms_);
+    if (ready <= 0) {
+        throw std::runtime_error("Simulator " + control_ + " did not answer '" + command + "' within " +
+                                 std::to_string(timeout_ms_) + " ms");
+    }
+    ssize_t size = recv(fd_, buffer, sizeof(buffer), 0);
+    if (size < 0) {
+        // ECONNREFUSED: nothing listens on the control port
+        throw std::runtime_error("Simulator " + control_ + " '" + command + "': " + Errno());
+    }
+
+    std::string reply(buffer, static_cast<size_t>(size));
+    if (reply.compare(0, 2, "ok") != 0) {
+        NaluBoardControllerLogger::error("Simulator " + control_ + " rejected '" + command + "': " + reply);
+        throw std::runtime_error("Simulator " + control_ + " '" + command + "': " + reply);
+    }
+    return reply.size() > 3 ? reply.substr(3) : std::string();
+}
+
+void NaluSimulatorClient::InitializeBoard() {
+    Command("init");
+}
+
+void NaluSimulatorClient::StartCapture() {
+    Command("start");
+}
+
+void NaluSimulatorClient::StopCapture() {
+    Command("stop");
+}
+
+void NaluSimulatorClient::WriteTriggerValues(const std::vector<int>& values) {
+    Command("trigger " + JoinList(values));
+}
+
+void NaluSimulatorClient::WriteTriggerReferences(int low_reference, int high_reference) {
+    Command("references " + std::to_string(low_reference) + " " + std::to_string(high_reference));
+}
+
+void NaluSimulatorClient::WriteTriggerEdge(bool rising_edge) {
+    Command(std::string("edge ") + (rising_edge ? "rising" : "falling"));
+}
+
+void NaluSimulatorClient::WriteDacValue(int channel, int value) {
+    Command("dac " + std::to_string(channel) + " " + std::to_string(value));
+}
+
+void NaluSimulatorClient::WriteReadoutChannels(const std::vector<int>& channels) {
+    Command("channels " + JoinList(channels));
+}
+
+void NaluSimulatorClient::WriteReadWindow(int windows, int lookback, int write_after_trig) {
+    Command("window " + std::to_string(windows) + " " + std::to_string(lookback) + " " +
+            std::to_string(write_after_trig));
+}
+
+void NaluSimulatorClient::ConfigureEthernet(const IPAddressInfo& target) {
+    Command("ethernet " + target.getCombined());
+}
+
+NaluSimulatorStats NaluSimulatorClient::Status() {
+    NaluSimulatorStats stats;
+    std::istringstream in(Command("status"));
+    std::string item;
+    while (in >> item) {
+        size_t equals = item.find('=');
+        if (equals == std::string::npos) {
+            continue;
+        }
+        std::string key = item.substr(0, equals);
+        uint64_t value = std::stoull(item.substr(equals + 1));
+        if (key == "events") stats.events = value;
+        else if (key == "packets") stats.packets = value;
+        else if (key == "bytes") stats.bytes = value;
+        else if (key == "dropped") stats.dropped = value;
+        else if (key == "duplicated") stats.duplicated = value;
+        else if (key == "reordered") stats.reordered = value;
+        else if (key == "silenced") stats.silenced = value;
+        else if (key == "send_errors") stats.send_errors = value;
+    }
+    return stats;
+}
@@ -0,0 +1,300 @@
+#include "nalu_socket_receiver.h"
+#include "nalu_board_controller_logger.h"
+#include "nalu_cpu_placement.h"
+#include "ip_address_info.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <future>
+#include <stdexcept>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+
+// How often an idle queue checks whether it should stop
+constexpr int kPollTimeoutMs = 100;
+
+// Room for the SO_RXQ_OVFL drop counter of one datagram
+constexpr size_t kControlBytes = CMSG_SPACE(sizeof(uint32_t));
+
+std::string Errno() {
+    return std::strerror(errno);
+}
+
+}  // namespace
+
+NaluSocketReceiver::NaluSocketReceiver(const NaluReceiverParams& params, const std::string& target_ip_port,
+                                       NaluCaptureCounters* counters)
+    : params_(params), capture_counters_(counters) {
+    IPAddressInfo target(target_ip_port);
+    bind_ip_ = target.getIp();
+
+    std::vector<int> ports = QueuePorts(params_, target.getPort());
+    for (size_t i = 0; i < ports.size(); ++i) {
+        auto queue = std::make_unique<Queue>();
+        queue->index = static_cast<int>(i);
+        queue->port = ports[i];
+        queue->cpu = i < params_.cpus.size() ? params_.cpus[i] : -1;
+        queues_.push_back(std::move(queue));
+    }
+}
+
+NaluSocketReceiver::~NaluSocketReceiver() {
+    Stop();
+}
+
+void NaluSocketReceiver::Start(NaluPacketSink sink) {
+    if (running_.load()) {
+        throw std::runtime_error("Receiver already running");
+    }
+
+    // Several queues on one port share it through SO_REUSEPORT
+    bool reuse_port = params_.ports.empty() && queues_.size() > 1;
+    try {
+        for (auto& queue : queues_) {
+            queue->fd = OpenSocket(queue->port, reuse_port);
+        }
+    } catch (...) {
+        CloseSockets();
+        throw;
+    }
+
+    // Packet buffers are allocated by the queue threads after pinning; wait
+    // for all of them, so a failed allocation reaches the caller
+    sink_ = std::move(sink);
+    running_.store(true);
+    std::vector<std::future<void>> ready;
+    for (auto& queue : queues_) {
+        std::promise<void> allocated;
+        ready.push_back(allocated.get_future());
+        Queue* raw_queue = queue.get();
+        queue->thread = std::thread([this, raw_queue, allocated = std::move(allocated)]() mutable {
+            // Pin first so the buffers are faulted in on the queue's own node
+            PlaceReceiveThread(raw_queue->index, raw_queue->cpu, raw_queue->counters);
+            NaluHostBuffer packets;
+            try {
+                packets = NaluHostBuffer(static_cast<size_t>(params_.max_packet_bytes) * params_.batch_size,
+                                         params_.huge_pages);
+                packets.Touch();
+                allocated.set_value();
+            } catch (...) {
+                allocated.set_exception(std::current_exception());
+                return;
+            }
+            ReceiveLoop(*raw_queue, packets);
+        });
+    }
+
+    std::exception_ptr failure;
+    for (auto& future : ready) {
+        try {
+            future.get();
+        } catch (...) {
+            if (!failure) failure = std::current_exception();
+        }
+    }
+    if (failure) {
+        Stop();
+        std::rethrow_exception(failure);
+    }
+    NaluBoardControllerLogger::info("Receiving on " + bind_ip_ + " with " + std::to_string(queues_.size()) +
+                                    " socket queue(s)" + (reuse_port ? " sharing the port" : ""));
+}
+
+void NaluSocketReceiver::Stop() {
+    if (!running_.exchange(false)) {
+        return;
+    }
+    for (auto& queue : queues_) {
+        if (queue->thread.joinable()) {
+            queue->thread.join();
+        }
+    }
+    CloseSockets();
+    NaluBoardControllerLogger::debug("Socket receiver stopped");
+}
+
+std::vector<NaluReceiverQueueStats> NaluSocketReceiver::Stats() const {
+    std::vector<NaluReceiverQueueStats> stats(queues_.size());
+    for (size_t i = 0; i < queues_.size(); ++i) {
+        stats[i].queue = queues_[i]->index;
+        stats[i].port = queues_[i]->port;
+        queues_[i]->counters.SnapshotInto(stats[i]);
+    }
+    return stats;
+}
+
+int NaluSocketReceiver::OpenSocket(int port, bool reuse_port) const {
+    int fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot create UDP socket: " + Errno());
+    }
+
+    auto fail = [&](const std::string& what) {
+        std::string message = what + " (" + bind_ip_ + ":" + std::to_string(port) + "): " + Errno();
+        close(fd);
+        throw std::runtime_error(message);
+    };
+
+    int one = 1;
+    if (reuse_port && setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)) != 0) {
+        fail("Cannot enable SO_REUSEPORT");
+    }
+    setsockopt(fd, SOL_SOCKET, SO_RXQ_OVFL, &one, sizeof(one));  // kernel drop counter, best effort
+
+    if (params_.socket_buffer_bytes > 0) {
+        int requested = params_.socket_buffer_bytes;
+        // SO_RCVBUFFORCE ignores net.core.rmem_max but needs CAP_NET_ADMIN
+        if (setsockopt(fd, SOL_SOCKET, SO_RCVBUFFORCE, &requested, sizeof(requested)) != 0) {
+            setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &requested, sizeof(requested));
+        }
+        int actual = 0;
+        socklen_t length = sizeof(actual);
+        getsockopt(fd, SOL_SOCKET, SO_RCVBUF, &actual, &length);
+        if (actual < requested) {  // the kernel reports twice the usable size
+            NaluBoardControllerLogger::warning("Socket receive buffer limited to " + std::to_string(actual) +
+                                               " bytes (requested " + std::to_string(requested) +
+                                               "); raise net.core.rmem_max");
+        }
+    }
+
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(static_cast<uint16_t>(port));
+    if (inet_pton(AF_INET, bind_ip_.c_str(), &address.sin_addr) != 1) {
+        errno = EINVAL;
+        fail("Invalid receive address");
+    }
+    if (bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        fail("Cannot bind UDP socket");
+    }
+    return fd;
+}
+
+void NaluSocketReceiver::CloseSockets() {
+    for (auto& queue : queues_) {
+        if (queue->fd >= 0) {
+            close(queue->fd);
+            queue->fd = -1;
+        }
+    }
+}
+
+void NaluSocketReceiver::ReceiveLoop(Queue& queue, NaluHostBuffer& packets) {
+    NaluReceiverQueueCounters& counters = queue.counters;
+    const int batch = params_.batch_size;
+    const size_t slot = static_cast<size_t>(params_.max_packet_bytes);
+    counters.huge_pages.store(packets.HugePages(), std::memory_order_relaxed);
+
+    std::vector<mmsghdr> messages(batch);
+    std::vector<iovec> iovecs(batch);
+    std::vector<cmsghdr> control((kControlBytes * batch + sizeof(cmsghdr) - 1) / sizeof(cmsghdr));
+    unsigned char* control_bytes = reinterpret_cast<unsigned char*>(control.data());
+    for (int i = 0; i < batch; ++i) {
+        iovecs[i].iov_base = packets.Data() + slot * i;
+        iovecs[i].iov_len = slot;
+        messages[i].msg_hdr = msghdr{};
+        messages[i].msg_hdr.msg_iov = &iovecs[i];
+        messages[i].msg_hdr.msg_iovlen = 1;
+        messages[i].msg_hdr.msg_control = control_bytes + kControlBytes * i;
+    }
+
+    // Thread-local totals, published with plain stores after every batch
+    uint64_t total_packets = 0, total_bytes = 0, total_batches = 0, max_batch = 0;
+    uint64_t truncated = 0, errors = 0;
+    bool sink_error_logged = false;
+    pollfd poll_fd{queue.fd, POLLIN, 0};
+
+    while (running_.load(std::memory_order_relaxed)) {
+        int ready = poll(&poll_fd, 1, kPollTimeoutMs);
+        if (ready <= 0) {
+            if (ready < 0 && errno != EINTR) {
+                counters.errors.store(++errors, std::memory_order_relaxed);
+            }
+            if (ready == 0 && sink_) {
+                try {
+                    sink_(queue.index, nullptr, 0, NaluMonotonicNs());  // idle tick
+                } catch (const std::exception& e) {
+                    counters.errors.store(++errors, std::memory_order_relaxed);
+                    if (!sink_error_logged) {
+                        NaluBoardControllerLogger::error("Receive queue " + std::to_string(queue.index) +
+                                                         ": idle tick failed: " + e.what());
+                        sink_error_logged = true;
+                    }
+                }
+            }
+            continue;
+        }
+
+        // Drain the socket before polling again
+        while (running_.load(std::memory_order_relaxed)) {
+            for (int i = 0; i < batch; ++i) {
+                messages[i].msg_hdr.msg_controllen = kControlBytes;
+                messages[i].msg_hdr.msg_flags = 0;
+            }
+            int received = recvmmsg(queue.fd, messages.data(), batch, MSG_DONTWAIT, nullptr);
+            if (received <= 0) {
+                if (received < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                    counters.errors.store(++errors, std::memory_order_relaxed);
+                }
+                break;
+            }
+
+            // Truncated datagrams are dropped and not counted as packets, as
+            // the packet_mmap receiver does, so the watchdog sees what is built
+            uint64_t rx_ns = NaluMonotonicNs();
+            uint64_t delivered = 0;
+            uint64_t batch_bytes = 0;
+            for (int i = 0; i < received; ++i) {
+                const mmsghdr& message = messages[i];
+                if (message.msg_hdr.msg_flags & MSG_TRUNC) {
+                    truncated++;
+                    continue;
+                }
+                delivered++;
+                batch_bytes += message.msg_len;
+                if (!sink_) {
+                    continue;
+                }
+                try {
+                    sink_(queue.index, packets.Data() + slot * i, message.msg_len, rx_ns);
+                } catch (const std::exception& e) {
+                    errors++;
+                    if (!sink_error_logged) {
+                        NaluBoardControllerLogger::error("Receive queue " + std::to_string(queue.index) +
+                                                         ": packet handler failed: " + e.what());
+                        sink_error_logged = true;
+                    }
+                }
+            }
+
+            // The kernel's running drop count for this socket rides on each datagram
+            msghdr& last = messages[received - 1].msg_hdr;
+            for (cmsghdr* cmsg = CMSG_FIRSTHDR(&last); cmsg; cmsg = CMSG_NXTHDR(&last, cmsg)) {
+                if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SO_RXQ_OVFL) {
+                    uint32_t dropped;
+                    std::memcpy(&dropped, CMSG_DATA(cmsg), sizeof(dropped));
+                    counters.kernel_drops.store(dropped, std::memory_order_relaxed);
+                }
+            }
+
+            total_packets += delivered;
+            total_bytes += batch_bytes;
+            total_batches++;
+            max_batch = std::max<uint64_t>(max_batch, received);
+            counters.packets.store(total_packets, std::memory_order_relaxed);
+            counters.bytes.store(total_bytes, std::memory_order_relaxed);
+            counters.batches.store(total_batches, std::memory_order_relaxed);
+            counters.max_batch.store(max_batch, std::memory_order_relaxed);
+            counters.truncated.store(truncated, std::memory_order_relaxed);
+            counters.errors.store(errors, std::memory_order_relaxed);
+            if (capture_counters_) {
+                capture_counters_->RecordPackets(delivered, batch_bytes);
+            }
+        }
+    }
+}
@@ -0,0 +1,233 @@
+#include "nalu_waveform_assembler.h"
+#include "nalu_single_writer.h"
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+// Windows of channels outside the event's mask have no waveform to go to
+inline bool HasChannel(uint64_t channel_mask, int channel) {
+    return channel < kNaluMaxChannels && ((channel_mask >> channel) & 1ULL);
+}
+
+}  // namespace
+
+void NaluWaveformStats::Add(const NaluWaveformStats& other) {
+    events += other.events;
+    reordered_events += other.reordered_events;
+    wrapped_events += other.wrapped_events;
+    filled_windows += other.filled_windows;
+    dropped_windows += other.dropped_windows;
+}
+
+NaluWaveformAssembler::NaluWaveformAssembler(const NaluEventLayout& layout)
+    : layout_(layout), buffer_windows_(layout.buffer_windows) {
+    // Window numbers are 8 bits in the packets
+    if (buffer_windows_ < 2 || buffer_windows_ > 256) {
+        throw std::invalid_argument("Waveform assembly needs the circular buffer's window count "
+                                    "(waveform.buffer_windows, 2-256), got " + std::to_string(buffer_windows_));
+    }
+    // A readout of the whole buffer leaves no gap to find its oldest window by
+    if (layout_.windows < 1 || layout_.windows >= buffer_windows_) {
+        throw std::invalid_argument("Waveform assembly needs 1-" + std::to_string(buffer_windows_ - 1) +
+                                    " readout windows, fewer than the buffer's, got " +
+                                    std::to_string(layout_.windows));
+    }
+    int channels = __builtin_popcountll(layout_.channel_mask);
+    if (layout_.samples_per_window > 0) {
+        samples_.reserve(static_cast<size_t>(channels) * layout_.windows * layout_.samples_per_window);
+    }
+    windows_.reserve(static_cast<size_t>(channels) * layout_.windows);
+    filled_.reserve(static_cast<size_t>(channels) * layout_.windows);
+}
+
+const int16_t* NaluWaveformAssembler::TimeIndexFor(int oldest) {
+    // Events of one trigger position share the table: rebuilt when it moves
+    if (oldest != time_index_oldest_) {
+        time_index_.fill(-1);
+        for (int index = 0, window = oldest; index < layout_.windows; ++index) {
+            time_index_[window] = static_cast<int16_t>(index);
+            if (++window == buffer_windows_) {
+                window = 0;
+            }
+        }
+        time_index_oldest_ = oldest;
+    }
+    return time_index_.data();
+}
+
+int NaluWaveformAssembler::OldestWindow(const NaluEvent& event) {
+    // Every channel reads out the same windows: a complete event has shown
+    // them all after its first channel
+    std::array<uint64_t, 4> present{};
+    int distinct = 0;
+    for (const NaluEventWindow& window : event.windows) {
+        uint64_t& word = present[window.window >> 6];
+        const uint64_t bit = uint64_t{1} << (window.window & 63);
+        if (window.window < buffer_windows_ && !(word & bit)) {
+            word |= bit;
+            if (++distinct == layout_.windows) {
+                break;
+            }
+        }
+    }
+    // The readout is one run of windows on the circle: it starts after the
+    // widest gap. Ties keep buffer order.
+    int first = -1, previous = -1, oldest = 0, widest = 0;
+    for (int word = 0; word < 4; ++word) {
+        for (uint64_t bits = present[word]; bits != 0; bits &= bits - 1) {
+            int window = word * 64 + __builtin_ctzll(bits);
+            if (first < 0) {
+                first = window;
+            } else if (window - previous > widest) {
+                widest = window - previous;
+                oldest = window;
+            }
+            previous = window;
+        }
+    }
+    if (first < 0 || first + buffer_windows_ - previous >= widest) {
+        return std::max(first, 0);
+    }
+    return oldest;
+}
+
+void NaluWaveformAssembler::Assemble(NaluEvent& event) {
+    NaluBump(events_);
+    const int windows = layout_.windows;
+    int samples_per_window = layout_.samples_per_window;
+    if (samples_per_window <= 0) {
+        for (const NaluEventWindow& window : event.windows) {
+            samples_per_window = std::max<int>(samples_per_window, window.sample_count);
+        }
+    }
+    const size_t channel_samples = static_cast<size_t>(windows) * samples_per_window;
+    // Each channel's first slot: its position among the event's channels
+    const uint64_t channel_mask = event.channel_mask;
+    int channels = 0;
+    for (uint64_t mask = channel_mask; mask != 0; mask &= mask - 1) {
+        channel_slot_[__builtin_ctzll(mask)] = channels++ * windows;
+    }
+    event.waveform_samples = static_cast<uint32_t>(channel_samples);
+    if (event.windows.empty()) {
+        return;
+    }
+
+    const int oldest = OldestWindow(event);
+    if (oldest + windows > buffer_windows_) {
+        NaluBump(wrapped_events_);
+    }
+
+    const int16_t* time_index = TimeIndexFor(oldest);
+
+    // Events whose windows arrived complete and in time order need nothing
+    bool in_place = event.windows.size() == static_cast<size_t>(channels) * windows &&
+                    event.samples.size() == channels * channel_samples;
+    for (size_t i = 0; in_place && i < event.windows.size(); ++i) {
+        const NaluEventWindow& window = event.windows[i];
+        int index = time_index[window.window];
+        in_place = index >= 0 && HasChannel(channel_mask, window.channel) &&
+                   window.sample_count == samples_per_window &&
+                   window.offset == static_cast<size_t>(channel_slot_[window.channel] + index) * samples_per_window;
+    }
+    if (in_place) {
+        return;
+    }
+    NaluBump(reordered_events_);
+
+    const size_t slots = static_cast<size_t>(channels) * windows;
+    samples_.resize(slots * samples_per_window);
+    filled_.assign(slots, 0);
+    size_t placed;
+    switch (samples_per_window) {
+        case 32:
+            placed = PlaceWindows<32>(event, samples_per_window, time_index);
+            break;
+        case 64:
+            placed = PlaceWindows<64>(event, samples_per_window, time_index);
+            break;
+        default:
+            placed = PlaceWindows<0>(event, samples_per_window, time_index);
+            break;
+    }
+
+    // The windows list in output order, then without the missing windows,
+    // whose samples are zeroed
+    windows_.resize(slots);
+    NaluEventWindow* list = windows_.data();
+    size_t slot = 0;
+    for (uint64_t mask = channel_mask; mask != 0; mask &= mask - 1) {
+        const uint8_t channel = static_cast<uint8_t>(__builtin_ctzll(mask));
+        int number = oldest;
+        for (int index = 0; index < windows; ++index, ++slot) {
+            list[slot] = NaluEventWindow{channel, static_cast<uint8_t>(number),
+                                         static_cast<uint16_t>(samples_per_window),
+                                         static_cast<uint32_t>(slot * samples_per_window)};
+            if (++number == buffer_windows_) {
+                number = 0;
+            }
+        }
+    }
+    if (placed < slots) {
+        size_t kept = 0;
+        for (slot = 0; slot < slots; ++slot) {
+            if (filled_[slot]) {
+                list[kept++] = list[slot];
+            } else {
+                std::fill_n(samples_.data() + slot * samples_per_window, samples_per_window, uint16_t{0});
+            }
+        }
+        windows_.resize(kept);
+        NaluBump(filled_windows_, slots - placed);
+    }
+    if (placed < event.windows.size()) {
+        NaluBump(dropped_windows_, event.windows.size() - placed);
+    }
+    event.samples.swap(samples_);
+    event.windows.swap(windows_);
+}
+
+template <int kSamples>
+size_t NaluWaveformAssembler::PlaceWindows(const NaluEvent& event, int samples_per_window, const int16_t* time_index) {
+    // Locals: the byte-sized stores to `filled` may alias any member
+    const size_t window_samples = kSamples > 0 ? kSamples : samples_per_window;
+    const uint16_t* in = event.samples.data();
+    uint16_t* out = samples_.data();
+    uint8_t* filled = filled_.data();
+    const int* channel_slot = channel_slot_.data();
+    size_t placed = 0;
+    for (const NaluEventWindow& window : event.windows) {
+        int index = time_index[window.window];
+        if (index < 0 || !HasChannel(event.channel_mask, window.channel)) {
+            continue;
+        }
+        size_t slot = static_cast<size_t>(channel_slot[window.channel] + index);
+        if (filled[slot]) {
+            continue;
+        }
+        filled[slot] = 1;
+        placed++;
+        uint16_t* destination = out + slot * window_samples;
+        if (window.sample_count >= window_samples) {
+            // A fixed size compiles to a few vector loads and stores
+            std::memcpy(destination, in + window.offset, window_samples * sizeof(uint16_t));
+        } else {
+            std::memcpy(destination, in + window.offset, window.sample_count * sizeof(uint16_t));
+            std::fill(destination + window.sample_count, destination + window_samples, uint16_t{0});
+        }
+    }
+    return placed;
+}
+
+NaluWaveformStats NaluWaveformAssembler::Stats() const {
+    NaluWaveformStats stats;
+    stats.events = events_.load(std::memory_order_relaxed);
+    stats.reordered_events = reordered_events_.load(std::memory_order_relaxed);
+    stats.wrapped_events = wrapped_events_.load(std::memory_order_relaxed);
+    stats.filled_windows = filled_windows_.load(std::memory_order_relaxed);
+    stats.dropped_windows = dropped_windows_.load(std::memory_order_relaxed);
+    return stats;
+}
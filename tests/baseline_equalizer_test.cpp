@@ -0,0 +1,123 @@
+// NaluBaselineEqualizer on a NaluBoardSimulator whose channels respond to
+// their DACs through NaluSimulatedBaselineSource: channels with different
+// linear and saturating responses converge within tolerance together, and
+// channels that cannot reach the target (no response, saturating below it)
+// are reported as such without holding the others back.
+
+#include <cmath>
+#include <map>
+#include "nalu_baseline_equalizer.h"
+#include "nalu_board_configurator.h"
+#include "nalu_board_simulator.h"
+#include "nalu_board_state.h"
+#include "nalu_test.h"
+
+namespace {
+
+struct Rig {
+    explicit Rig(int channels) : state(NaluBoardParams()), board(NaluSimulatorParams()), configurator(&state, &board) {
+        capture.target_ip_port = "127.0.0.1:12345";
+        for (int channel = 0; channel < channels; ++channel) {
+            capture.channels[channel] = NaluChannelInfo{};
+        }
+        state.UpdateFromCaptureParams(capture);
+        state.SetCapturing(true);
+
+        params.target_baseline = 2048.0;
+        params.tolerance = 2.0;
+        params.max_iterations = 12;
+        params.settle_ms = 0;
+    }
+
+    NaluBoardState state;
+    NaluBoardSimulator board;
+    NaluBoardConfigurator configurator;
+    NaluCaptureParams capture;
+    NaluEqualizerParams params;
+};
+
+// Offsets and gains spread over the channels, one of them saturating
+std::map<int, NaluSimulatedChannelResponse> SpreadResponses(int channels) {
+    std::map<int, NaluSimulatedChannelResponse> responses;
+    for (int channel = 0; channel < channels; ++channel) {
+        responses[channel] = NaluSimulatedChannelResponse{300.0 + 40.0 * channel, 0.45 + 0.1 * channel, 0.0, 0.5};
+    }
+    responses[channels - 1] = NaluSimulatedChannelResponse{200.0, 0.8, 2500.0, 0.5};
+    return responses;
+}
+
+void TestChannelsConverge() {
+    const int channels = 8;
+    Rig rig(channels);
+    NaluSimulatedBaselineSource source(&rig.board, SpreadResponses(channels));
+    NaluBaselineEqualizer equalizer(&rig.state, &rig.configurator, &source);
+
+    NaluEqualizerResult result = equalizer.Run(rig.capture, rig.params);
+    NALU_CHECK(result.converged);
+    NALU_CHECK(result.iterations <= 8);
+    // All channels are measured together, one measurement per iteration
+    NALU_CHECK_EQ(source.Measurements(), result.iterations);
+    NALU_CHECK_EQ(result.channels.size(), size_t{channels});
+
+    NaluBoardSimulator::Registers registers = rig.board.CurrentRegisters();
+    for (const NaluChannelEqualization& channel : result.channels) {
+        NALU_CHECK(channel.converged);
+        NALU_CHECK(!channel.saturated);
+        NALU_CHECK(std::abs(channel.baseline - rig.params.target_baseline) <= rig.params.tolerance);
+        // The true baseline is off by no more than the measurement noise
+        NALU_CHECK(std::abs(source.Response(channel.channel, channel.dac_value) - rig.params.target_baseline) <=
+                   rig.params.tolerance + 2.5);
+        NALU_CHECK_EQ(rig.capture.channels[channel.channel].dac_value, channel.dac_value);
+        NALU_CHECK_EQ(rig.state.DacValues()[channel.channel], channel.dac_value);
+        NALU_CHECK_EQ(registers.dac_values.at(channel.channel), channel.dac_value);
+    }
+    NALU_CHECK(rig.capture.assign_dac_values);
+}
+
+void TestUnreachableChannelsAreReported() {
+    const int channels = 6;
+    Rig rig(channels);
+    std::map<int, NaluSimulatedChannelResponse> responses = SpreadResponses(channels);
+    responses[2] = NaluSimulatedChannelResponse{500.0, 0.0, 0.0, 0.5};       // does not respond
+    responses[3] = NaluSimulatedChannelResponse{200.0, 0.8, 1000.0, 0.5};    // levels off at 1200
+    NaluSimulatedBaselineSource source(&rig.board, responses);
+    NaluBaselineEqualizer equalizer(&rig.state, &rig.configurator, &source);
+
+    NaluEqualizerResult result = equalizer.Run(rig.capture, rig.params);
+    NALU_CHECK(!result.converged);
+    NALU_CHECK(result.iterations <= rig.params.max_iterations);
+    for (const NaluChannelEqualization& channel : result.channels) {
+        bool unreachable = channel.channel == 2 || channel.channel == 3;
+        NALU_CHECK_EQ(channel.converged, !unreachable);
+        if (unreachable) {
+            NALU_CHECK(channel.saturated);
+            NALU_CHECK(std::abs(channel.baseline - rig.params.target_baseline) > 500.0);
+        } else {
+            NALU_CHECK(std::abs(channel.baseline - rig.params.target_baseline) <= rig.params.tolerance);
+        }
+        // What is kept is the best setting measured
+        NALU_CHECK_EQ(rig.capture.channels[channel.channel].dac_value, channel.dac_value);
+    }
+}
+
+void TestDisabledChannelsAreLeftAlone() {
+    Rig rig(4);
+    rig.capture.channels[1].enabled = false;
+    rig.capture.channels[1].dac_value = 1234;
+    NaluSimulatedBaselineSource source(&rig.board, SpreadResponses(4));
+    NaluBaselineEqualizer equalizer(&rig.state, &rig.configurator, &source);
+
+    NaluEqualizerResult result = equalizer.Run(rig.capture, rig.params);
+    NALU_CHECK(result.converged);
+    NALU_CHECK_EQ(result.channels.size(), size_t{3});
+    NALU_CHECK_EQ(rig.capture.channels[1].dac_value, 1234);
+}
+
+}  // namespace
+
+int main() {
+    TestChannelsConverge();
+    TestUnreachableChannelsAreReported();
+    TestDisabledChannelsAreLeftAlone();
+    return NaluTestExitCode();
+}
@@ -0,0 +1,203 @@
+// NaluBoardConfigurator::ApplyHotUpdate against a stand-in board that records
+// its calls and fails on request: updates refused before anything is written,
+// DAC updates held to what a full configuration writes, and the rollback of a
+// write that fails partway, including a readout that does not come back.
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "nalu_board_configurator.h"
+#include "nalu_board_state.h"
+#include "nalu_test.h"
+
+namespace {
+
+struct BoardCall {
+    std::string name;
+    int first = 0;
+    int second = 0;
+    std::vector<int> values;
+};
+
+// Records every call with its arguments; the fail_* counters make the n-th
+// call of their kind throw (1 = the next one)
+class StandInBoard : public NaluBoardBackend {
+public:
+    void InitializeBoard() override { Call("init"); }
+    void StartCapture() override {
+        Call("start");
+        Fail(fail_start);
+    }
+    void StopCapture() override { Call("stop"); }
+    void WriteTriggerValues(const std::vector<int>& values) override { Call("trigger", 0, 0, values); }
+    void WriteTriggerReferences(int low, int high) override { Call("references", low, high); }
+    void WriteTriggerEdge(bool rising) override { Call("edge", rising); }
+    void WriteDacValue(int channel, int value) override {
+        Call("dac", channel, value);
+        Fail(fail_dac);
+    }
+    void WriteReadoutChannels(const std::vector<int>& channels) override { Call("channels", 0, 0, channels); }
+    void WriteReadWindow(int windows, int lookback, int) override { Call("window", windows, lookback); }
+    void ConfigureEthernet(const IPAddressInfo&) override { Call("ethernet"); }
+
+    std::vector<std::string> Names() const {
+        std::vector<std::string> names;
+        for (const BoardCall& call : calls) {
+            names.push_back(call.name);
+        }
+        return names;
+    }
+
+    int fail_dac = 0;
+    int fail_start = 0;
+    std::vector<BoardCall> calls;
+
+private:
+    void Call(const std::string& name, int first = 0, int second = 0, const std::vector<int>& values = {}) {
+        calls.push_back(BoardCall{name, first, second, values});
+    }
+    static void Fail(int& countdown) {
+        if (countdown > 0 && --countdown == 0) {
+            throw std::runtime_error("board write failed");
+        }
+    }
+};
+
+// A self-triggered capture of channels 0-3 out of the model's 32, DACs assigned
+struct Rig {
+    explicit Rig(bool assign_dac_values = true) : state(NaluBoardParams()), configurator(&state, &board) {
+        NaluCaptureParams capture;
+        capture.target_ip_port = "127.0.0.1:12345";
+        capture.trigger_mode = "self";
+        capture.assign_dac_values = assign_dac_values;
+        capture.low_reference = 2;
+        capture.high_reference = 8;
+        for (int channel = 0; channel < 4; ++channel) {
+            capture.channels[channel] = NaluChannelInfo{true, 100 + channel, 1800 + channel};
+        }
+        state.UpdateFromCaptureParams(capture);
+        state.SetCapturing(true);
+    }
+
+    NaluBoardState state;
+    StandInBoard board;
+    NaluBoardConfigurator configurator;
+};
+
+NaluHotUpdate UpdateEverything() {
+    NaluHotUpdate update;
+    update.channels[0] = NaluChannelUpdate{200, 2000};
+    update.channels[1] = NaluChannelUpdate{201, 2001};
+    update.channels[2].dac_value = 2002;
+    update.low_reference = 3;
+    update.high_reference = 9;
+    return update;
+}
+
+void TestRefusedUpdatesChangeNothing() {
+    Rig rig;
+    NaluHotUpdate no_such_channel;
+    no_such_channel.channels[32].trigger_value = 100;
+    NALU_CHECK_THROWS(rig.configurator.ApplyHotUpdate(no_such_channel), std::invalid_argument);
+
+    // A full configuration writes no DAC of a disabled channel, so neither does a hot update
+    NaluHotUpdate disabled_dac = UpdateEverything();
+    disabled_dac.channels[7].dac_value = 1500;
+    NALU_CHECK_THROWS(rig.configurator.ApplyHotUpdate(disabled_dac), std::invalid_argument);
+
+    NaluHotUpdate out_of_range = UpdateEverything();
+    out_of_range.channels[1].trigger_value = 4096;
+    NALU_CHECK_THROWS(rig.configurator.ApplyHotUpdate(out_of_range), std::invalid_argument);
+
+    NALU_CHECK(rig.board.calls.empty());
+    NALU_CHECK_EQ(rig.state.TriggerValues()[0], 100);
+    NALU_CHECK_EQ(rig.state.DacValues()[0], 1800);
+    NALU_CHECK_EQ(rig.state.LowReference(), 2);
+
+    // Nor any DAC at all while they are not assigned; thresholds still go out
+    Rig unassigned(false);
+    NALU_CHECK_THROWS(unassigned.configurator.ApplyHotUpdate(UpdateEverything()), std::invalid_argument);
+    NALU_CHECK(unassigned.board.calls.empty());
+    NaluHotUpdate thresholds;
+    thresholds.channels[5].trigger_value = 300;   // disabled channels have thresholds too
+    NALU_CHECK_EQ(unassigned.configurator.ApplyHotUpdate(thresholds).trigger_values_changed, 1);
+    NALU_CHECK(unassigned.board.Names() == std::vector<std::string>{"trigger"});
+}
+
+void TestHotDacsMatchFullConfiguration() {
+    Rig rig;
+    NaluHotUpdateResult result = rig.configurator.ApplyHotUpdate(UpdateEverything());
+    NALU_CHECK(result.readout_paused);
+    NALU_CHECK(result.references_written);
+    NALU_CHECK_EQ(result.trigger_values_changed, 2);
+    NALU_CHECK_EQ(result.dac_values_written, 3);
+    NALU_CHECK(rig.board.Names() ==
+               (std::vector<std::string>{"stop", "trigger", "references", "dac", "dac", "dac", "start"}));
+
+    // Configuring afresh writes the DACs the hot update left, and no others
+    std::vector<BoardCall> hot_dacs;
+    for (const BoardCall& call : rig.board.calls) {
+        if (call.name == "dac") hot_dacs.push_back(call);
+    }
+    rig.board.calls.clear();
+    rig.configurator.ConfigureForCapture();
+    std::vector<BoardCall> configured_dacs;
+    for (const BoardCall& call : rig.board.calls) {
+        if (call.name == "dac") configured_dacs.push_back(call);
+    }
+    NALU_CHECK_EQ(configured_dacs.size(), size_t{4});
+    for (const BoardCall& hot : hot_dacs) {
+        NALU_CHECK_EQ(configured_dacs.at(hot.first).second, hot.second);
+    }
+}
+
+void TestFailedWriteIsRolledBack() {
+    Rig rig;
+    rig.board.fail_dac = 2;
+    NALU_CHECK_THROWS(rig.configurator.ApplyHotUpdate(UpdateEverything()), std::runtime_error);
+
+    // The state describes the board as it was
+    NALU_CHECK_EQ(rig.state.TriggerValues()[0], 100);
+    NALU_CHECK_EQ(rig.state.TriggerValues()[1], 101);
+    NALU_CHECK_EQ(rig.state.DacValues()[0], 1800);
+    NALU_CHECK_EQ(rig.state.DacValues()[1], 1801);
+    NALU_CHECK_EQ(rig.state.DacValues()[2], 1802);
+    NALU_CHECK_EQ(rig.state.LowReference(), 2);
+    NALU_CHECK_EQ(rig.state.HighReference(), 8);
+    NALU_CHECK(rig.state.IsCapturing());
+
+    // What reached the board is written back and readout restarts; the DAC
+    // write that failed is not repeated
+    const std::vector<BoardCall>& calls = rig.board.calls;
+    NALU_CHECK(rig.board.Names() == (std::vector<std::string>{"stop", "trigger", "references", "dac", "dac",
+                                                               "trigger", "references", "dac", "start"}));
+    NALU_CHECK_EQ(calls[1].values.at(0), 200);
+    NALU_CHECK_EQ(calls[5].values.at(0), 100);
+    NALU_CHECK_EQ(calls[5].values.at(1), 101);
+    NALU_CHECK_EQ(calls[6].first, 2);
+    NALU_CHECK_EQ(calls[6].second, 8);
+    NALU_CHECK_EQ(calls[7].first, 0);
+    NALU_CHECK_EQ(calls[7].second, 1800);
+}
+
+void TestFailedRestartStopsCapturing() {
+    Rig rig;
+    rig.board.fail_dac = 1;
+    rig.board.fail_start = 1;
+    NALU_CHECK_THROWS(rig.configurator.ApplyHotUpdate(UpdateEverything()), std::runtime_error);
+    NALU_CHECK(!rig.state.IsCapturing());
+    NALU_CHECK(rig.board.Names() ==
+               (std::vector<std::string>{"stop", "trigger", "references", "dac", "trigger", "references", "start"}));
+    NALU_CHECK_EQ(rig.state.DacValues()[0], 1800);
+    NALU_CHECK_EQ(rig.state.LowReference(), 2);
+}
+
+}  // namespace
+
+int main() {
+    TestRefusedUpdatesChangeNothing();
+    TestHotDacsMatchFullConfiguration();
+    TestFailedWriteIsRolledBack();
+    TestFailedRestartStopsCapturing();
+    return NaluTestExitCode();
+}
@@ -0,0 +1,242 @@
+// NaluCaptureWatchdog against a stand-in board that can be told to go
+// silent, on an explicit clock: stall detection, each step of the recovery
+// ladder with the board calls it makes, giving up, recovery and the stats.
+
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "nalu_board_configurator.h"
+#include "nalu_board_state.h"
+#include "nalu_capture_counters.h"
+#include "nalu_capture_watchdog.h"
+#include "nalu_test.h"
+
+namespace {
+
+using Clock = NaluCaptureWatchdog::Clock;
+using std::chrono::milliseconds;
+
+// Records the calls it gets; streams (bumps the counters on Advance()) while
+// capturing and not silent
+class StandInBoard : public NaluBoardBackend {
+public:
+    void InitializeBoard() override { Call("init"); }
+    void StartCapture() override {
+        Call("start");
+        if (fail_starts > 0) {
+            fail_starts--;
+            throw std::runtime_error("readout did not start");
+        }
+        capturing = true;
+        if (wake_on_start) {
+            silent = false;
+        }
+    }
+    void StopCapture() override {
+        Call("stop");
+        capturing = false;
+    }
+    void WriteTriggerValues(const std::vector<int>&) override { Call("trigger"); }
+    void WriteTriggerReferences(int, int) override { Call("references"); }
+    void WriteTriggerEdge(bool) override { Call("edge"); }
+    void WriteDacValue(int, int) override { Call("dac"); }
+    void WriteReadoutChannels(const std::vector<int>&) override { Call("channels"); }
+    void WriteReadWindow(int, int, int) override {
+        Call("window");
+        if (wake_on_configure) {
+            silent = false;
+        }
+    }
+    void ConfigureEthernet(const IPAddressInfo&) override { Call("ethernet"); }
+
+    void Advance(NaluCaptureCounters& counters, milliseconds elapsed) {
+        if (capturing && !silent) {
+            counters.RecordPackets(elapsed.count());   // 1000 packets/s
+            counters.RecordEvents(elapsed.count() / 10);
+        }
+    }
+
+    int Count(const std::string& call) const {
+        int count = 0;
+        for (const std::string& c : calls) {
+            count += c == call;
+        }
+        return count;
+    }
+
+    bool capturing = false;
+    bool silent = false;
+    bool wake_on_start = false;        // a restart brings the data back
+    bool wake_on_configure = false;    // a reconfiguration does
+    int fail_starts = 0;
+    std::vector<std::string> calls;
+
+private:
+    void Call(const std::string& call) { calls.push_back(call); }
+};
+
+struct Rig {
+    Rig() : state(NaluBoardParams()), configurator(&state, &board) {
+        NaluCaptureParams capture;
+        capture.target_ip_port = "127.0.0.1:12345";
+        capture.trigger_mode = "self";
+        capture.channels[0] = NaluChannelInfo{};
+        capture.channels[1] = NaluChannelInfo{};
+        state.UpdateFromCaptureParams(capture);
+
+        params.enabled = true;
+        params.min_packet_rate = 100.0;
+        params.min_event_rate = 10.0;
+        params.rate_window_ms = 100;
+        params.stall_timeout_ms = 300;
+        params.recovery_grace_ms = 200;
+        params.max_recovery_attempts = 2;
+    }
+
+    // Step the clock in rate windows, feeding the counters and polling;
+    // returns the number of recovery steps that ran
+    int Run(NaluCaptureWatchdog& watchdog, milliseconds duration) {
+        int steps = 0;
+        for (milliseconds t{0}; t < duration; t += tick) {
+            now += tick;
+            board.Advance(counters, tick);
+            steps += watchdog.Poll(now);
+        }
+        return steps;
+    }
+
+    NaluBoardState state;
+    StandInBoard board;
+    NaluBoardConfigurator configurator;
+    NaluCaptureCounters counters;
+    NaluWatchdogParams params;
+    Clock::time_point now = Clock::time_point() + std::chrono::hours(1);
+    milliseconds tick{50};
+};
+
+void TestHealthyStreamRunsNoStep() {
+    Rig rig;
+    NaluCaptureWatchdog watchdog(rig.params, &rig.counters, &rig.board, &rig.configurator);
+    rig.board.StartCapture();
+    watchdog.Arm(rig.now);
+    NALU_CHECK_EQ(rig.Run(watchdog, milliseconds(2000)), 0);
+    NALU_CHECK_EQ(watchdog.Stats().stalls_detected, uint64_t{0});
+    NALU_CHECK(!watchdog.Stats().stalled);
+}
+
+void TestLadderEscalatesThenGivesUp() {
+    Rig rig;
+    NaluCaptureWatchdog watchdog(rig.params, &rig.counters, &rig.board, &rig.configurator);
+    rig.board.StartCapture();
+    watchdog.Arm(rig.now);
+    rig.Run(watchdog, milliseconds(500));
+    rig.board.calls.clear();
+
+    // Silent: the stall is declared only after stall_timeout_ms of low rates
+    rig.board.silent = true;
+    NALU_CHECK_EQ(rig.Run(watchdog, milliseconds(250)), 0);
+    NALU_CHECK_EQ(rig.Run(watchdog, milliseconds(100)), 1);
+    NaluWatchdogStats stats = watchdog.Stats();
+    NALU_CHECK(stats.stalled);
+    NALU_CHECK_EQ(stats.stalls_detected, uint64_t{1});
+    NALU_CHECK(stats.level == NaluRecoveryLevel::RESTART_READOUT);
+    NALU_CHECK_EQ(rig.board.calls.size(), size_t{2});   // stop, start
+    NALU_CHECK_EQ(rig.board.Count("stop"), 1);
+    NALU_CHECK_EQ(rig.board.Count("start"), 1);
+
+    // No further step within the grace period
+    NALU_CHECK_EQ(rig.Run(watchdog, milliseconds(150)), 0);
+
+    // Reconfigure: stop, the capture configuration, start
+    rig.board.calls.clear();
+    NALU_CHECK_EQ(rig.Run(watchdog, milliseconds(100)), 1);
+    NALU_CHECK(watchdog.Stats().level == NaluRecoveryLevel::RECONFIGURE);
+    NALU_CHECK_EQ(rig.board.Count("init"), 0);
+    NALU_CHECK_EQ(rig.board.Count("window"), 1);
+    NALU_CHECK_EQ(rig.board.Count("ethernet"), 1);
+    NALU_CHECK_EQ(rig.board.calls.front(), std::string("stop"));
+    NALU_CHECK_EQ(rig.board.calls.back(), std::string("start"));
+
+    // Re-initialize max_recovery_attempts times, then give up
+    rig.board.calls.clear();
+    NALU_CHECK_EQ(rig.Run(watchdog, milliseconds(1000)), 2);
+    NALU_CHECK_EQ(rig.board.Count("init"), 2);
+    NALU_CHECK_EQ(rig.board.Count("window"), 2);
+    stats = watchdog.Stats();
+    NALU_CHECK(stats.level == NaluRecoveryLevel::REINITIALIZE);
+    NALU_CHECK_EQ(stats.gave_up, uint64_t{1});
+    NALU_CHECK_EQ(stats.Step(NaluRecoveryLevel::RESTART_READOUT).attempts, uint64_t{1});
+    NALU_CHECK_EQ(stats.Step(NaluRecoveryLevel::RECONFIGURE).attempts, uint64_t{1});
+    NALU_CHECK_EQ(stats.Step(NaluRecoveryLevel::REINITIALIZE).attempts, uint64_t{2});
+    NALU_CHECK_EQ(stats.Step(NaluRecoveryLevel::REINITIALIZE).failures, uint64_t{0});
+    NALU_CHECK_EQ(rig.Run(watchdog, milliseconds(1000)), 0);
+
+    // Data coming back ends the stall even after giving up
+    Clock::time_point silent_since = rig.now - milliseconds(2700);
+    rig.board.silent = false;
+    rig.Run(watchdog, milliseconds(200));
+    stats = watchdog.Stats();
+    NALU_CHECK(!stats.stalled);
+    NALU_CHECK_EQ(stats.recoveries, uint64_t{1});
+    NALU_CHECK(stats.level == NaluRecoveryLevel::NONE);
+    NALU_CHECK(stats.last_deadtime >= rig.now - silent_since - milliseconds(300));
+    NALU_CHECK(stats.last_deadtime <= rig.now - silent_since);
+    NALU_CHECK(stats.total_deadtime == stats.last_deadtime);
+}
+
+void TestReconfigureRecovers() {
+    Rig rig;
+    NaluCaptureWatchdog watchdog(rig.params, &rig.counters, &rig.board, &rig.configurator);
+    rig.board.StartCapture();
+    watchdog.Arm(rig.now);
+    rig.Run(watchdog, milliseconds(500));
+
+    // A restart does not help (and fails once), a reconfiguration does
+    rig.board.silent = true;
+    rig.board.wake_on_configure = true;
+    rig.board.fail_starts = 1;
+    rig.Run(watchdog, milliseconds(2000));
+    NaluWatchdogStats stats = watchdog.Stats();
+    NALU_CHECK(!stats.stalled);
+    NALU_CHECK_EQ(stats.stalls_detected, uint64_t{1});
+    NALU_CHECK_EQ(stats.recoveries, uint64_t{1});
+    NALU_CHECK_EQ(stats.gave_up, uint64_t{0});
+    NALU_CHECK_EQ(stats.Step(NaluRecoveryLevel::RESTART_READOUT).attempts, uint64_t{1});
+    NALU_CHECK_EQ(stats.Step(NaluRecoveryLevel::RESTART_READOUT).failures, uint64_t{1});
+    NALU_CHECK_EQ(stats.Step(NaluRecoveryLevel::RECONFIGURE).attempts, uint64_t{1});
+    NALU_CHECK_EQ(stats.Step(NaluRecoveryLevel::REINITIALIZE).attempts, uint64_t{0});
+    NALU_CHECK(rig.board.capturing);
+
+    // A second stall starts from the bottom of the ladder again
+    rig.board.silent = true;
+    rig.board.wake_on_configure = false;
+    rig.board.wake_on_start = true;
+    rig.Run(watchdog, milliseconds(2000));
+    stats = watchdog.Stats();
+    NALU_CHECK_EQ(stats.stalls_detected, uint64_t{2});
+    NALU_CHECK_EQ(stats.recoveries, uint64_t{2});
+    NALU_CHECK_EQ(stats.Step(NaluRecoveryLevel::RESTART_READOUT).attempts, uint64_t{2});
+    NALU_CHECK_EQ(stats.Step(NaluRecoveryLevel::RECONFIGURE).attempts, uint64_t{1});
+}
+
+void TestDisarmedWatchdogIgnoresSilence() {
+    Rig rig;
+    NaluCaptureWatchdog watchdog(rig.params, &rig.counters, &rig.board, &rig.configurator);
+    rig.board.StartCapture();
+    watchdog.Arm(rig.now);
+    watchdog.Disarm();
+    rig.board.silent = true;
+    NALU_CHECK_EQ(rig.Run(watchdog, milliseconds(2000)), 0);
+    NALU_CHECK_EQ(watchdog.Stats().stalls_detected, uint64_t{0});
+}
+
+}  // namespace
+
+int main() {
+    TestHealthyStreamRunsNoStep();
+    TestLadderEscalatesThenGivesUp();
+    TestReconfigureRecovers();
+    TestDisarmedWatchdogIgnoresSilence();
+    return NaluTestExitCode();
+}
@@ -0,0 +1,216 @@
+// NaluConfigFile: board and capture parameters saved and loaded again in
+// JSON and YAML, the rejection of unknown keys, type mismatches, duplicate
+// keys and runaway nesting with the line they are on, and the file cache.
+
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "nalu_config_file.h"
+#include "nalu_test.h"
+
+namespace {
+
+std::string TempPath(const std::string& name) {
+    return "/tmp/nalu_config_test_" + std::to_string(getpid()) + "_" + name;
+}
+
+void WriteText(const std::string& path, const std::string& text) {
+    std::ofstream(path, std::ios::binary | std::ios::trunc) << text;
+}
+
+// What ParseCaptureParams throws for `text`, or "" when it accepts it
+std::string CaptureError(const std::string& text, NaluConfigFormat format) {
+    try {
+        NaluConfigFile::ParseCaptureParams(text, format);
+    } catch (const std::invalid_argument& e) {
+        return e.what();
+    }
+    return "";
+}
+
+bool Contains(const std::string& text, const std::string& part) {
+    return text.find(part) != std::string::npos;
+}
+
+NaluBoardParams SomeBoardParams() {
+    NaluBoardParams params;
+    params.model = "aardvarcv3";
+    params.board_ip_port = "10.0.0.7:4660";
+    params.host_ip_port = "10.0.0.1:4661";
+    params.config_file = TempPath("aardvarc \"lab\".yml");   // must exist
+    return params;
+}
+
+// Every section away from its defaults
+NaluCaptureParams SomeCaptureParams() {
+    NaluCaptureParams params;
+    params.target_ip_port = "10.0.0.1:12345";
+    params.windows = 4;
+    params.lookback = 6;
+    params.write_after_trig = 3;
+    params.trigger_mode = "self";
+    params.rising_edge = false;
+    params.channels[0] = NaluChannelInfo{true, 120, 1700};
+    params.channels[3] = NaluChannelInfo{false, 0, 1804};
+    params.channels[12] = NaluChannelInfo{true, 95, 2100};
+    params.watchdog.enabled = true;
+    params.watchdog.min_packet_rate = 12.5;
+    params.receiver.mode = "socket";
+    params.receiver.queues = 2;
+    params.receiver.ports = {5000, 5001};
+    params.receiver.cpus = {2, 3};
+    params.receiver.replay_speed = 0.25;
+    params.record.path = "/data/run 7.nalurec";
+    params.event_builder.max_open_events = 32;
+    params.merge.enabled = true;
+    params.merge.drop_late = true;
+    params.merge.clock_offsets = {{0, 0}, {1, -1500}, {4, 123456789012LL}};
+    params.filter.enabled = true;
+    params.filter.rules = {NaluFilterRule{"pair", {0, 12}, 2, 2, 4000}, NaluFilterRule{"any", {}, 1, 1, 0}};
+    params.monitor.enabled = true;
+    params.monitor.prescale = 10;
+    params.waveform.enabled = true;
+    return params;
+}
+
+void TestRoundTrips() {
+    const NaluBoardParams board = SomeBoardParams();
+    const NaluCaptureParams capture = SomeCaptureParams();
+    WriteText(board.config_file, "");
+    for (NaluConfigFormat format : {NaluConfigFormat::JSON, NaluConfigFormat::YAML}) {
+        const char* extension = format == NaluConfigFormat::JSON ? ".json" : ".yaml";
+        std::string board_path = TempPath(std::string("board") + extension);
+        std::string capture_path = TempPath(std::string("capture") + extension);
+        NaluConfigFile::Save(board, board_path);
+        NaluConfigFile::Save(capture, capture_path);
+
+        NaluBoardParams board_loaded = NaluConfigFile::LoadBoardParams(board_path);
+        NaluCaptureParams capture_loaded = NaluConfigFile::LoadCaptureParams(capture_path);
+        std::remove(board_path.c_str());
+        std::remove(capture_path.c_str());
+
+        // Serialised again, in both formats, nothing was lost or changed
+        for (NaluConfigFormat out : {NaluConfigFormat::JSON, NaluConfigFormat::YAML}) {
+            NALU_CHECK_EQ(NaluConfigFile::ToString(board_loaded, out), NaluConfigFile::ToString(board, out));
+            NALU_CHECK_EQ(NaluConfigFile::ToString(capture_loaded, out), NaluConfigFile::ToString(capture, out));
+        }
+        NALU_CHECK_EQ(board_loaded.config_file, board.config_file);
+        NALU_CHECK_EQ(capture_loaded.channels.size(), size_t{3});
+        NALU_CHECK_EQ(capture_loaded.channels.at(12).dac_value, 2100);
+        NALU_CHECK(!capture_loaded.channels.at(3).enabled);
+        NALU_CHECK_EQ(capture_loaded.merge.clock_offsets.at(4), 123456789012LL);
+        NALU_CHECK_EQ(capture_loaded.filter.rules.size(), size_t{2});
+        NALU_CHECK_EQ(capture_loaded.filter.rules[0].coincidence_window, 4000LL);
+        NALU_CHECK_EQ(capture_loaded.receiver.replay_speed, 0.25);
+        NALU_CHECK_EQ(capture_loaded.record.path, capture.record.path);
+    }
+
+    std::remove(board.config_file.c_str());
+
+    // Both structs in one file, under their sections
+    std::string combined = "board:\n  model: \"aardvarcv3\"\ncapture:\n  windows: 2\n  channels:\n    5: {}\n";
+    NALU_CHECK_EQ(NaluConfigFile::ParseBoardParams(combined, NaluConfigFormat::YAML).model, std::string("aardvarcv3"));
+    NaluCaptureParams capture_section = NaluConfigFile::ParseCaptureParams(combined, NaluConfigFormat::YAML);
+    NALU_CHECK_EQ(capture_section.windows, 2);
+    NALU_CHECK_EQ(capture_section.channels.count(5), size_t{1});
+}
+
+void TestRejections() {
+    std::string error = CaptureError("{\n  \"windows\": 2,\n  \"widnows\": 3\n}", NaluConfigFormat::JSON);
+    NALU_CHECK(Contains(error, "line 3"));
+    NALU_CHECK(Contains(error, "unknown key 'widnows'"));
+
+    error = CaptureError("windows: 2\nreceiver:\n  mode: socket\n  queues: two\n", NaluConfigFormat::YAML);
+    NALU_CHECK(Contains(error, "line 4"));
+    NALU_CHECK(Contains(error, "receiver.queues: expected integer, got string"));
+
+    error = CaptureError("{\"merge\": {\"drop_late\": 1}}", NaluConfigFormat::JSON);
+    NALU_CHECK(Contains(error, "line 1"));
+    NALU_CHECK(Contains(error, "merge.drop_late: expected boolean, got integer"));
+
+    error = CaptureError("{\n  \"windows\": 2,\n  \"lookback\": 2,\n  \"windows\": 3\n}", NaluConfigFormat::JSON);
+    NALU_CHECK(Contains(error, "line 4"));
+    NALU_CHECK(Contains(error, "duplicate key 'windows'"));
+
+    // One channel under two spellings is not let through as two keys
+    error = CaptureError("channels:\n  1: {dac_value: 100}\n  01: {dac_value: 200}\n", NaluConfigFormat::YAML);
+    NALU_CHECK(Contains(error, "line 3"));
+    NALU_CHECK(Contains(error, "channels.01"));
+    for (const char* key : {"+1", " 1", "1.0", "-1"}) {
+        error = CaptureError(std::string("{\"channels\": {\"") + key + "\": {}}}", NaluConfigFormat::JSON);
+        NALU_CHECK(Contains(error, "channel keys must be non-negative integers"));
+    }
+    error = CaptureError("merge:\n  clock_offsets:\n    00: 5\n", NaluConfigFormat::YAML);
+    NALU_CHECK(Contains(error, "line 3"));
+    NALU_CHECK(Contains(error, "board keys"));
+
+    // Runaway nesting fails with its line instead of exhausting the stack
+    std::string deep_json = "{\n\"windows\": " + std::string(100000, '[') + std::string(100000, ']') + "}";
+    error = CaptureError(deep_json, NaluConfigFormat::JSON);
+    NALU_CHECK(Contains(error, "line 2"));
+    NALU_CHECK(Contains(error, "nested deeper than 64 levels"));
+    error = CaptureError("windows: 2\nrules: " + std::string(100000, '['), NaluConfigFormat::YAML);
+    NALU_CHECK(Contains(error, "line 2"));
+    NALU_CHECK(Contains(error, "nested deeper"));
+    std::string deep_yaml;
+    for (int level = 0; level < 200; ++level) {
+        deep_yaml += std::string(level, ' ') + "k:\n";
+    }
+    error = CaptureError(deep_yaml, NaluConfigFormat::YAML);
+    NALU_CHECK(Contains(error, "line 65"));
+    NALU_CHECK(Contains(error, "nested deeper"));
+
+    // Values the validator refuses, after a clean parse
+    NALU_CHECK(Contains(CaptureError("{\"target_ip_port\": \"nowhere\"}", NaluConfigFormat::JSON), "target_ip_port"));
+}
+
+void TestCacheFollowsTheFile() {
+    std::string path = TempPath("cached.yaml");
+    WriteText(path, "windows: 2\n");
+    NALU_CHECK_EQ(NaluConfigFile::LoadCaptureParams(path).windows, 2);
+    struct stat before;
+    stat(path.c_str(), &before);
+
+    // Same size and modification time: the cached parameters are returned
+    WriteText(path, "windows: 3\n");
+    timespec times[2] = {before.st_atim, before.st_mtim};
+    utimensat(AT_FDCWD, path.c_str(), times, 0);
+    NALU_CHECK_EQ(NaluConfigFile::LoadCaptureParams(path).windows, 2);
+
+    // A changed file is parsed again, and so is everything after ClearCache()
+    WriteText(path, "windows: 4\nlookback: 4\n");
+    NALU_CHECK_EQ(NaluConfigFile::LoadCaptureParams(path).windows, 4);
+    struct stat changed;
+    stat(path.c_str(), &changed);
+    WriteText(path, "windows: 5\nlookback: 4\n");
+    timespec changed_times[2] = {changed.st_atim, changed.st_mtim};
+    utimensat(AT_FDCWD, path.c_str(), changed_times, 0);
+    NALU_CHECK_EQ(NaluConfigFile::LoadCaptureParams(path).windows, 4);
+    NaluConfigFile::ClearCache();
+    NALU_CHECK_EQ(NaluConfigFile::LoadCaptureParams(path).windows, 5);
+
+    // A file that turns bad is reported, with its path, rather than served from the cache
+    WriteText(path, "windows: 5\nlookback: four\n");
+    bool rejected = false;
+    try {
+        NaluConfigFile::LoadCaptureParams(path);
+    } catch (const std::invalid_argument& e) {
+        rejected = Contains(e.what(), path) && Contains(e.what(), "line 2");
+    }
+    NALU_CHECK(rejected);
+    std::remove(path.c_str());
+    NALU_CHECK_THROWS(NaluConfigFile::LoadCaptureParams(path), std::runtime_error);
+}
+
+}  // namespace
+
+int main() {
+    TestRoundTrips();
+    TestRejections();
+    TestCacheFollowsTheFile();
+    return NaluTestExitCode();
+}
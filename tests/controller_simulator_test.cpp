@@ -0,0 +1,73 @@
+// NaluBoardController driving a nalu_board_simulator process (the
+// `simulated_board` fixture) through NaluSimulatorClient: the controller's
+// register writes reach the simulator, and every event it sends is built.
+//
+//   nalu_controller_simulator_test <control ip:port> <target ip:port>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include "nalu_board_controller.h"
+#include "nalu_simulator_client.h"
+#include "nalu_test.h"
+
+int main(int argc, char** argv) {
+    std::string control = argc > 1 ? argv[1] : "127.0.0.1:46600";
+    std::string target = argc > 2 ? argv[2] : "127.0.0.1:46610";
+
+    NaluBoardParams board_params;
+    board_params.model = "hdsocv1_evalr2";
+    auto client = std::make_unique<NaluSimulatorClient>(control);
+    NaluSimulatorClient* simulator = client.get();
+    NaluBoardController controller(board_params, std::move(client));
+
+    std::atomic<uint64_t> events{0};
+    std::atomic<uint64_t> complete_events{0};
+    std::atomic<uint64_t> wrong_channels{0};
+    const uint64_t channel_mask = 0x0F;
+    controller.set_event_sink([&](NaluEvent&& event) {
+        events.fetch_add(1, std::memory_order_relaxed);
+        if (event.complete) {
+            complete_events.fetch_add(1, std::memory_order_relaxed);
+        }
+        if (event.channel_mask != channel_mask) {
+            wrong_channels.fetch_add(1, std::memory_order_relaxed);
+        }
+    });
+
+    NaluCaptureParams params;
+    params.target_ip_port = target;
+    params.windows = 2;
+    params.lookback = 2;
+    params.trigger_mode = "self";
+    params.assign_dac_values = true;
+    for (int channel = 0; channel < 4; ++channel) {
+        params.channels[channel] = NaluChannelInfo{true, 100 + channel, 1800 + channel};
+    }
+    params.channels[4] = NaluChannelInfo{false, 0, 0};
+    params.receiver.mode = "socket";
+
+    controller.initialize_board();
+    controller.start_capture(params);
+    std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+    controller.stop_capture();
+
+    NaluSimulatorStats sent = simulator->Status();
+    NaluDataPathStats data_path = controller.data_path_stats();
+
+    NALU_CHECK(sent.events > 100);
+    NALU_CHECK_EQ(events.load(), sent.events);
+    NALU_CHECK_EQ(complete_events.load(), events.load());
+    NALU_CHECK_EQ(wrong_channels.load(), uint64_t{0});
+    NALU_CHECK_EQ(data_path.unparsed_packets, uint64_t{0});
+    NALU_CHECK_EQ(data_path.boards.size(), size_t{1});
+    for (const auto& [board_id, board] : data_path.boards) {
+        NALU_CHECK_EQ(board.lost_packets, uint64_t{0});
+        NALU_CHECK_EQ(board.events_complete, sent.events);
+    }
+
+    // Capture parameters the simulator cannot take are reported as errors
+    NALU_CHECK_THROWS(simulator->WriteDacValue(99, 0), std::runtime_error);
+    return NaluTestExitCode();
+}
@@ -0,0 +1,185 @@
+// NaluSequenceWindow and NaluEventBuilder on hand-made packets of one board:
+// a gap, a duplicate, a reordered pair, an incomplete event that times out
+// and its packet arriving late, each in the loss counters; and a stream of
+// events that never complete, which the fixed open-event table bounds.
+
+#include <cstdint>
+#include <vector>
+#include "nalu_event_builder.h"
+#include "nalu_packet_format.h"
+#include "nalu_test.h"
+
+namespace {
+
+using Result = NaluSequenceWindow::Result;
+
+constexpr uint64_t kMs = 1000000;
+constexpr uint16_t kSamples = 4;
+
+// Every event is two packets, channel 0's window then channel 1's
+NaluEventLayout TwoChannelLayout() {
+    NaluEventLayout layout;
+    layout.channel_mask = 0x3;
+    layout.windows = 1;
+    layout.samples_per_window = kSamples;
+    return layout;
+}
+
+std::vector<uint8_t> Packet(uint32_t packet_seq, uint32_t event_number, uint16_t packet_index) {
+    std::vector<uint8_t> packet(kNaluPacketHeaderBytes + kNaluWindowHeaderBytes + kSamples * sizeof(uint16_t));
+    NaluPacketHeader header;
+    header.board_id = 3;
+    header.flags = packet_index == 0 ? kNaluPacketFirst : kNaluPacketLast;
+    header.packet_seq = packet_seq;
+    header.event_number = event_number;
+    header.block_count = 1;
+    header.packet_index = packet_index;
+    header.timestamp = 1000 * event_number;
+    NaluWritePacketHeader(packet.data(), header);
+    uint8_t* block = packet.data() + kNaluPacketHeaderBytes;
+    block[0] = static_cast<uint8_t>(packet_index);   // channel
+    block[1] = 0;                                    // window
+    NaluStoreU16(block + 2, kSamples);
+    for (uint16_t i = 0; i < kSamples; ++i) {
+        NaluStoreU16(block + kNaluWindowHeaderBytes + 2 * i, static_cast<uint16_t>(event_number * 10 + i));
+    }
+    return packet;
+}
+
+void TestSequenceWindow() {
+    NaluSequenceWindow window;
+    NALU_CHECK(window.Observe(10) == Result::FIRST);
+    NALU_CHECK(window.Observe(11) == Result::IN_ORDER);
+    NALU_CHECK(window.Observe(14) == Result::GAP);
+    NALU_CHECK_EQ(window.Missed(), 2u);
+    NALU_CHECK(window.Observe(12) == Result::LATE);
+    NALU_CHECK(window.Observe(12) == Result::DUPLICATE);
+    NALU_CHECK(window.Observe(14) == Result::DUPLICATE);
+    NALU_CHECK(window.Observe(13) == Result::LATE);
+    NALU_CHECK_EQ(window.Highest(), 14u);
+
+    // Older than the window remembers: cannot be told from a duplicate
+    NALU_CHECK(window.Observe(14 + NaluSequenceWindow::kSpan) == Result::GAP);
+    NALU_CHECK(window.Observe(14) == Result::DUPLICATE);
+
+    // The counter wraps without a gap; a huge jump is a restart
+    NaluSequenceWindow wrapping;
+    wrapping.Observe(0xFFFFFFFEu);
+    NALU_CHECK(wrapping.Observe(0xFFFFFFFFu) == Result::IN_ORDER);
+    NALU_CHECK(wrapping.Observe(0) == Result::IN_ORDER);
+    NALU_CHECK(wrapping.Observe(NaluSequenceWindow::kResyncDistance + 5) == Result::RESYNC);
+    NALU_CHECK(wrapping.Observe(NaluSequenceWindow::kResyncDistance + 6) == Result::IN_ORDER);
+}
+
+void TestLossAccounting() {
+    NaluEventBuilderParams params;
+    params.event_timeout_ms = 100;
+    std::vector<NaluEvent> events;
+    NaluEventBuilder builder(params, TwoChannelLayout(), nullptr,
+                             [&](NaluEvent&& event) { events.push_back(std::move(event)); });
+
+    uint64_t rx_ns = 1000 * kMs;
+    auto feed = [&](uint32_t packet_seq, uint32_t event_number, uint16_t packet_index) {
+        std::vector<uint8_t> packet = Packet(packet_seq, event_number, packet_index);
+        builder.HandlePacket(packet.data(), packet.size(), rx_ns);
+        rx_ns += 10000;
+    };
+
+    feed(0, 0, 0);
+    feed(1, 0, 1);          // event 0 complete
+    feed(2, 1, 0);
+    feed(3, 1, 1);          // event 1 complete
+    feed(3, 1, 1);          // duplicate
+    feed(5, 2, 1);          // reordered pair: gap of one packet ...
+    feed(4, 2, 0);          // ... filled late; event 2 complete
+                            // packets 6, 7 (event 3) lost
+    feed(8, 4, 0);
+    feed(9, 4, 1);          // event 4 complete
+    feed(10, 5, 0);         // packet 11, the rest of event 5, lost for now
+    feed(12, 6, 0);
+    feed(13, 6, 1);         // event 6 complete
+    NALU_CHECK_EQ(events.size(), size_t{5});
+
+    // Event 5 times out on an idle tick, then its last packet arrives late
+    rx_ns += params.event_timeout_ms * kMs;
+    builder.HandlePacket(nullptr, 0, rx_ns);
+    NALU_CHECK_EQ(events.size(), size_t{6});
+    feed(11, 5, 1);
+    builder.Flush();
+    NALU_CHECK_EQ(events.size(), size_t{6});
+
+    for (size_t i = 0; i < events.size(); ++i) {
+        const NaluEvent& event = events[i];
+        NALU_CHECK_EQ(static_cast<int>(event.board_id), 3);
+        if (event.event_number == 5) {
+            NALU_CHECK(!event.complete);
+            NALU_CHECK_EQ(event.channel_mask, uint64_t{0x1});
+            NALU_CHECK_EQ(event.windows.size(), size_t{1});
+        } else {
+            NALU_CHECK(event.complete);
+            NALU_CHECK_EQ(event.channel_mask, uint64_t{0x3});
+            NALU_CHECK_EQ(event.samples.size(), size_t{2 * kSamples});
+            NALU_CHECK_EQ(event.samples[0], static_cast<uint16_t>(event.event_number * 10));
+        }
+    }
+    // The reordered event holds its windows in arrival order, channel 1 first
+    NALU_CHECK_EQ(static_cast<int>(events[2].windows.at(0).channel), 1);
+
+    NaluDataPathStats stats = builder.Stats();
+    NALU_CHECK_EQ(stats.open_events, uint64_t{0});
+    NALU_CHECK_EQ(stats.unparsed_packets, uint64_t{0});
+    const NaluBoardLossStats& board = stats.boards.at(3);
+    NALU_CHECK_EQ(board.packets, uint64_t{12});             // 13 fed, one duplicate
+    NALU_CHECK_EQ(board.lost_packets, uint64_t{2});         // packets 6 and 7
+    NALU_CHECK_EQ(board.duplicate_packets, uint64_t{1});
+    NALU_CHECK_EQ(board.reordered_packets, uint64_t{2});    // packets 4 and 11
+    NALU_CHECK_EQ(board.late_packets, uint64_t{1});         // packet 11
+    NALU_CHECK_EQ(board.malformed_packets, uint64_t{0});
+    NALU_CHECK_EQ(board.events_complete, uint64_t{5});
+    NALU_CHECK_EQ(board.events_partial, uint64_t{1});
+    NALU_CHECK_EQ(board.events_timed_out, uint64_t{1});
+    NALU_CHECK_EQ(board.events_evicted, uint64_t{0});
+    NALU_CHECK_EQ(board.events_lost, uint64_t{1});          // event 3
+    NALU_CHECK_EQ(board.channel_windows_lost[0], uint64_t{0});
+    NALU_CHECK_EQ(board.channel_windows_lost[1], uint64_t{1});
+}
+
+void TestOpenEventsStayBounded() {
+    NaluEventBuilderParams params;
+    params.max_open_events = 4;
+    uint64_t delivered = 0;
+    NaluEventBuilder builder(params, TwoChannelLayout(), nullptr, [&](NaluEvent&&) { delivered++; });
+
+    // Only the first packet of every event arrives
+    uint64_t rx_ns = 1000 * kMs;
+    for (uint32_t event = 0; event < 100; ++event) {
+        std::vector<uint8_t> packet = Packet(2 * event, event, 0);
+        builder.HandlePacket(packet.data(), packet.size(), rx_ns);
+        rx_ns += 1000;
+    }
+    NALU_CHECK_EQ(delivered, uint64_t{96});
+
+    // An idle tick within the timeout publishes the table as it is
+    builder.HandlePacket(nullptr, 0, rx_ns + 30 * kMs);
+    NaluDataPathStats stats = builder.Stats();
+    NALU_CHECK_EQ(stats.open_events, uint64_t{4});
+    NALU_CHECK_EQ(stats.boards.at(3).events_evicted, uint64_t{96});
+    NALU_CHECK_EQ(stats.boards.at(3).lost_packets, uint64_t{99});
+
+    builder.Flush();
+    stats = builder.Stats();
+    NALU_CHECK_EQ(delivered, uint64_t{100});
+    NALU_CHECK_EQ(stats.open_events, uint64_t{0});
+    NALU_CHECK_EQ(stats.boards.at(3).events_partial, uint64_t{100});
+    NALU_CHECK_EQ(stats.boards.at(3).events_timed_out, uint64_t{0});
+    NALU_CHECK_EQ(stats.boards.at(3).channel_windows_lost[1], uint64_t{100});
+}
+
+}  // namespace
+
+int main() {
+    TestSequenceWindow();
+    TestLossAccounting();
+    TestOpenEventsStayBounded();
+    return NaluTestExitCode();
+}
@@ -0,0 +1,157 @@
+// NaluEventFilter on hand-made events whose channels either carry a pulse or
+// stay on their baseline: min_channels counted over a rule's channel subset,
+// two boards inside and outside the coincidence window (with a clock
+// offset), events held until Flush() decides them, and the per-rule counters.
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "nalu_event_filter.h"
+#include "nalu_test.h"
+
+namespace {
+
+constexpr uint16_t kBaseline = 1000;
+
+// One 8-sample window per channel; the `hit` channels peak 200 counts above
+// their baseline, the `quiet` ones stay flat
+NaluEvent Event(int board_id, uint32_t event_number, uint64_t timestamp, const std::vector<int>& hit,
+                const std::vector<int>& quiet = {}) {
+    NaluEvent event;
+    event.board_id = board_id;
+    event.event_number = event_number;
+    event.timestamp = timestamp;
+    event.complete = true;
+    auto add = [&](int channel, bool pulse) {
+        event.windows.push_back(NaluEventWindow{static_cast<uint8_t>(channel), 0, 8,
+                                                static_cast<uint32_t>(event.samples.size())});
+        for (int i = 0; i < 8; ++i) {
+            event.samples.push_back(pulse && i == 5 ? kBaseline + 200 : kBaseline);
+        }
+        event.channel_mask |= uint64_t{1} << channel;
+    };
+    for (int channel : hit) {
+        add(channel, true);
+    }
+    for (int channel : quiet) {
+        add(channel, false);
+    }
+    return event;
+}
+
+NaluFilterParams Params(const std::vector<NaluFilterRule>& rules) {
+    NaluFilterParams params;
+    params.enabled = true;
+    params.rules = rules;
+    return params;
+}
+
+void TestMinChannelsOverSubset() {
+    std::vector<uint32_t> accepted;
+    NaluEventFilter filter(Params({NaluFilterRule{"pair", {0, 1, 2}, 2, 1, 0}, NaluFilterRule{"any", {}, 1, 1, 0}}),
+                           {}, [&](NaluEvent&& event) { accepted.push_back(event.event_number); });
+
+    filter.HandleEvent(Event(0, 1, 100, {0, 1}));          // both rules
+    filter.HandleEvent(Event(0, 2, 200, {0, 5}));          // one hit of the subset: "any" only
+    filter.HandleEvent(Event(0, 3, 300, {5, 6}, {0, 1}));  // subset present but quiet
+    filter.HandleEvent(Event(0, 4, 400, {}, {0, 1, 2}));   // nothing hit
+    filter.HandleEvent(Event(0, 5, 500, {0, 1, 2, 3}));
+
+    // Single-board rules decide at once, without Flush()
+    NALU_CHECK(accepted == (std::vector<uint32_t>{1, 2, 3, 5}));
+    NaluFilterStats stats = filter.Stats();
+    NALU_CHECK_EQ(stats.events_in, uint64_t{5});
+    NALU_CHECK_EQ(stats.accepted, uint64_t{4});
+    NALU_CHECK_EQ(stats.rejected, uint64_t{1});
+    NALU_CHECK_EQ(stats.pending, uint64_t{0});
+    NALU_CHECK_EQ(stats.rules.size(), size_t{2});
+    NALU_CHECK_EQ(stats.rules[0].name, std::string("pair"));
+    NALU_CHECK_EQ(stats.rules[0].accepted, uint64_t{2});
+    NALU_CHECK_EQ(stats.rules[0].rejected, uint64_t{3});
+    NALU_CHECK_EQ(stats.rules[1].accepted, uint64_t{4});
+    NALU_CHECK_EQ(stats.rules[1].rejected, uint64_t{1});
+}
+
+void TestTwoBoardCoincidence() {
+    std::vector<NaluEvent> accepted;
+    // Board 1's clock runs 1000 ticks ahead
+    NaluEventFilter filter(Params({NaluFilterRule{"two boards", {}, 1, 2, 100}}), {{1, -1000}},
+                           [&](NaluEvent&& event) { accepted.push_back(std::move(event)); });
+    auto numbers = [&] {
+        std::vector<uint32_t> result;
+        for (const NaluEvent& event : accepted) {
+            result.push_back(event.event_number);
+        }
+        return result;
+    };
+
+    // In time order once offsets are applied, as the merger hands them over
+    filter.HandleEvent(Event(0, 1, 1000, {3}));
+    filter.HandleEvent(Event(1, 2, 2050, {3}));    // 50 after event 1
+    filter.HandleEvent(Event(0, 3, 5000, {3}));
+    filter.HandleEvent(Event(1, 4, 6200, {3}));    // 200 after event 3: outside
+    NALU_CHECK(numbers() == (std::vector<uint32_t>{1, 2}));
+    filter.HandleEvent(Event(0, 5, 9000, {3}));
+    filter.HandleEvent(Event(0, 6, 9010, {3}));    // one board twice is not two boards
+    filter.HandleEvent(Event(0, 7, 20000, {3}));
+    filter.HandleEvent(Event(1, 8, 21100, {3}));   // exactly the window apart
+    filter.HandleEvent(Event(0, 9, 30000, {3}));
+    filter.HandleEvent(Event(1, 10, 31050, {}, {3}));   // in the window, but no hit
+
+    // Events 7 and 8 were decided once event 9 left their window behind;
+    // 9 and 10 wait for what may still come
+    NALU_CHECK(numbers() == (std::vector<uint32_t>{1, 2, 7, 8}));
+    NALU_CHECK_EQ(filter.Stats().pending, uint64_t{2});
+    filter.Flush();
+    NALU_CHECK(numbers() == (std::vector<uint32_t>{1, 2, 7, 8}));
+
+    NaluFilterStats stats = filter.Stats();
+    NALU_CHECK_EQ(stats.pending, uint64_t{0});
+    NALU_CHECK_EQ(stats.events_in, uint64_t{10});
+    NALU_CHECK_EQ(stats.accepted, uint64_t{4});
+    NALU_CHECK_EQ(stats.rejected, uint64_t{6});
+    NALU_CHECK_EQ(stats.rules.at(0).accepted, uint64_t{4});
+    NALU_CHECK_EQ(stats.rules.at(0).rejected, uint64_t{6});
+
+    // Accepted events arrive whole
+    NALU_CHECK_EQ(accepted.at(1).board_id, 1);
+    NALU_CHECK_EQ(accepted.at(1).timestamp, uint64_t{2050});
+    NALU_CHECK_EQ(accepted.at(1).samples.size(), size_t{8});
+}
+
+void TestFlushDecidesHeldEvents() {
+    std::vector<uint32_t> accepted;
+    NaluEventFilter filter(Params({NaluFilterRule{"two boards", {}, 1, 2, 1000}, NaluFilterRule{"ch7", {7}, 1, 1, 0}}),
+                           {}, [&](NaluEvent&& event) { accepted.push_back(event.event_number); });
+
+    filter.HandleEvent(Event(0, 1, 100, {7}));
+    filter.HandleEvent(Event(1, 2, 600, {2}));
+    filter.HandleEvent(Event(2, 3, 900, {}, {2}));
+    // Within the widest window of the last event: nothing decided yet, even
+    // the single-board rule waits with the event
+    NALU_CHECK(accepted.empty());
+    NALU_CHECK_EQ(filter.Stats().pending, uint64_t{3});
+
+    filter.Flush();
+    NALU_CHECK(accepted == (std::vector<uint32_t>{1, 2}));
+    NaluFilterStats stats = filter.Stats();
+    NALU_CHECK_EQ(stats.pending, uint64_t{0});
+    NALU_CHECK_EQ(stats.rules[0].accepted, uint64_t{2});   // boards 0 and 1
+    NALU_CHECK_EQ(stats.rules[0].rejected, uint64_t{1});
+    NALU_CHECK_EQ(stats.rules[1].accepted, uint64_t{1});
+    NALU_CHECK_EQ(stats.rules[1].rejected, uint64_t{2});
+
+    // A later event starts a fresh hold
+    filter.HandleEvent(Event(0, 4, 5000, {7}));
+    filter.Flush();
+    NALU_CHECK(accepted == (std::vector<uint32_t>{1, 2, 4}));
+}
+
+}  // namespace
+
+int main() {
+    TestMinChannelsOverSubset();
+    TestTwoBoardCoincidence();
+    TestFlushDecidesHeldEvents();
+    return NaluTestExitCode();
+}
@@ -0,0 +1,189 @@
+// NaluEventMerger on hand-made events of three boards pushed with
+// interleaved timestamps: the merged stream in corrected-timestamp order with
+// clock offsets applied, a board that goes quiet no longer waited for once
+// the watermark has passed, and an event arriving after newer ones were
+// released, counted as late and passed on or dropped.
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "nalu_event_merger.h"
+#include "nalu_test.h"
+
+namespace {
+
+struct Merged {
+    int board_id;
+    int64_t time;   // timestamp plus the board's clock offset
+};
+
+// Collects what the merge thread releases
+class Collector {
+public:
+    explicit Collector(const std::map<int, long long>& offsets = {}) : offsets_(offsets) {}
+
+    NaluEventSink Sink() {
+        return [this](NaluEvent&& event) {
+            auto offset = offsets_.find(event.board_id);
+            int64_t time = static_cast<int64_t>(event.timestamp) + (offset == offsets_.end() ? 0 : offset->second);
+            std::lock_guard<std::mutex> lock(mutex_);
+            merged_.push_back(Merged{event.board_id, time});
+        };
+    }
+
+    std::vector<Merged> Events() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return merged_;
+    }
+
+    std::vector<int64_t> Times() const {
+        std::vector<int64_t> times;
+        for (const Merged& merged : Events()) {
+            times.push_back(merged.time);
+        }
+        return times;
+    }
+
+private:
+    std::map<int, long long> offsets_;
+    mutable std::mutex mutex_;
+    std::vector<Merged> merged_;
+};
+
+NaluMergeParams Params(int max_latency_ms, const std::map<int, long long>& offsets = {}) {
+    NaluMergeParams params;
+    params.enabled = true;
+    params.max_latency_ms = max_latency_ms;
+    params.queue_capacity = 1024;
+    params.clock_offsets = offsets;
+    return params;
+}
+
+void Push(NaluEventMerger& merger, int board_id, uint64_t timestamp) {
+    NaluEvent event;
+    event.board_id = board_id;
+    event.timestamp = timestamp;
+    event.complete = true;
+    NALU_CHECK(merger.Push(std::move(event)));
+}
+
+// Waits for the merge thread to have released `count` events, or gives up
+bool WaitForReleased(const NaluEventMerger& merger, uint64_t count) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (merger.Stats().events_out < count) {
+        if (std::chrono::steady_clock::now() > deadline) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+bool Sorted(const std::vector<int64_t>& times) {
+    for (size_t i = 1; i < times.size(); ++i) {
+        if (times[i] < times[i - 1]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void TestOrderAcrossBoards() {
+    // Board 1's clock runs 1000 ticks ahead, board 2's 500 behind
+    const std::map<int, long long> offsets = {{1, -1000}, {2, 500}};
+    Collector collector(offsets);
+    NaluEventMerger merger(Params(200, offsets), collector.Sink());
+    merger.Start();
+
+    // Raw timestamps that only interleave once corrected: every board sends
+    // an event every 30 ticks, each starting at corrected time 10000 + 10 * board
+    for (int i = 0; i < 100; ++i) {
+        Push(merger, 0, 10000 + 30 * i);
+        Push(merger, 1, 11000 + 10 + 30 * i);
+        Push(merger, 2, 9500 + 20 + 30 * i);
+    }
+    merger.Stop();
+
+    std::vector<Merged> merged = collector.Events();
+    NALU_CHECK_EQ(merged.size(), size_t{300});
+    NALU_CHECK(Sorted(collector.Times()));
+    for (size_t i = 0; i < merged.size(); ++i) {
+        NALU_CHECK_EQ(merged[i].board_id, static_cast<int>(i % 3));
+        NALU_CHECK_EQ(merged[i].time, static_cast<int64_t>(10000 + 10 * i));
+    }
+    NaluMergeStats stats = merger.Stats();
+    NALU_CHECK_EQ(stats.boards, 3);
+    NALU_CHECK_EQ(stats.events_in, uint64_t{300});
+    NALU_CHECK_EQ(stats.events_out, uint64_t{300});
+    NALU_CHECK_EQ(stats.late_events, uint64_t{0});
+    NALU_CHECK_EQ(stats.dropped_full, uint64_t{0});
+}
+
+void TestQuietBoardIsWatermarked() {
+    Collector collector;
+    NaluEventMerger merger(Params(20), collector.Sink());
+    merger.Start();
+
+    // Board 2 sends once and goes quiet; boards 0 and 1 carry on
+    Push(merger, 2, 50);
+    for (int i = 0; i < 20; ++i) {
+        Push(merger, 0, 100 + 20 * i);
+        Push(merger, 1, 110 + 20 * i);
+    }
+
+    // Released while the merger runs, without waiting for board 2 any longer
+    NALU_CHECK(WaitForReleased(merger, 41));
+    NaluMergeStats stats = merger.Stats();
+    NALU_CHECK(stats.watermark_releases > 0);
+    NALU_CHECK_EQ(stats.late_events, uint64_t{0});
+    std::vector<Merged> merged = collector.Events();
+    NALU_CHECK_EQ(merged.size(), size_t{41});
+    NALU_CHECK(Sorted(collector.Times()));
+    NALU_CHECK_EQ(merged.at(0).board_id, 2);
+    merger.Stop();
+    NALU_CHECK_EQ(merger.Stats().events_out, uint64_t{41});
+}
+
+void TestLateEvents(bool drop_late) {
+    Collector collector;
+    NaluMergeParams params = Params(20);
+    params.drop_late = drop_late;
+    NaluEventMerger merger(params, collector.Sink());
+    merger.Start();
+
+    Push(merger, 0, 100);
+    Push(merger, 0, 200);
+    Push(merger, 1, 150);
+    Push(merger, 1, 250);
+    Push(merger, 2, 50);
+    NALU_CHECK(WaitForReleased(merger, 5));
+
+    // Board 2 comes back with an event older than ones already released
+    Push(merger, 2, 120);
+    Push(merger, 2, 300);
+    merger.Stop();
+
+    NaluMergeStats stats = merger.Stats();
+    NALU_CHECK_EQ(stats.events_in, uint64_t{7});
+    NALU_CHECK_EQ(stats.late_events, uint64_t{1});
+    if (drop_late) {
+        NALU_CHECK_EQ(stats.events_out, uint64_t{6});
+        NALU_CHECK(collector.Times() == (std::vector<int64_t>{50, 100, 150, 200, 250, 300}));
+    } else {
+        NALU_CHECK_EQ(stats.events_out, uint64_t{7});
+        NALU_CHECK(collector.Times() == (std::vector<int64_t>{50, 100, 150, 200, 250, 120, 300}));
+    }
+}
+
+}  // namespace
+
+int main() {
+    TestOrderAcrossBoards();
+    TestQuietBoardIsWatermarked();
+    TestLateEvents(false);
+    TestLateEvents(true);
+    return NaluTestExitCode();
+}
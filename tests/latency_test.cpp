@@ -0,0 +1,143 @@
+// NaluLatencyTracker: the log-linear buckets at the edges of the exact range
+// and of every power of two up to the clamp at 2^40 ns, values resolved to
+// within 2 %, and the summary of a known distribution recorded by two
+// producers, with percentiles held inside the exact minimum and maximum.
+
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include "nalu_latency.h"
+#include "nalu_test.h"
+
+namespace {
+
+using Tracker = NaluLatencyTracker;
+
+bool Near(double value, double expected, double fraction) {
+    return std::fabs(value - expected) <= fraction * expected;
+}
+
+// Records `value_ns` as a build latency only
+void RecordBuild(Tracker& tracker, int producer, uint64_t value_ns) {
+    tracker.Record(producer, 1000, 1000 + value_ns, 0, 0);
+}
+
+void TestBucketBoundaries() {
+    // Below 64 every value has a bucket of its own
+    NALU_CHECK_EQ(Tracker::Bucket(0), 0);
+    NALU_CHECK_EQ(Tracker::Bucket(31), 31);
+    NALU_CHECK_EQ(Tracker::Bucket(32), 32);
+    NALU_CHECK_EQ(Tracker::Bucket(63), 63);
+    NALU_CHECK_EQ(Tracker::BucketValue(31), uint64_t{31});
+    NALU_CHECK_EQ(Tracker::BucketValue(32), uint64_t{32});
+    NALU_CHECK_EQ(Tracker::BucketValue(63), uint64_t{63});
+
+    // From 64 on, 32 buckets per power of two, reported at their midpoint
+    NALU_CHECK_EQ(Tracker::Bucket(64), 64);
+    NALU_CHECK_EQ(Tracker::Bucket(65), 64);
+    NALU_CHECK_EQ(Tracker::Bucket(66), 65);
+    NALU_CHECK_EQ(Tracker::Bucket(127), 95);
+    NALU_CHECK_EQ(Tracker::Bucket(128), 96);
+    NALU_CHECK_EQ(Tracker::BucketValue(64), uint64_t{65});
+    NALU_CHECK_EQ(Tracker::BucketValue(96), uint64_t{130});
+
+    // The last bucket ends at 2^40; longer values are clamped into it
+    const uint64_t top = uint64_t{1} << Tracker::kMaxValueBits;
+    NALU_CHECK_EQ(Tracker::Bucket(top - 1), Tracker::kBuckets - 1);
+    NALU_CHECK_EQ(Tracker::Bucket(top), Tracker::kBuckets - 1);
+    NALU_CHECK_EQ(Tracker::Bucket(UINT64_MAX), Tracker::kBuckets - 1);
+    NALU_CHECK(Tracker::Bucket(top - 1 - (top >> 6)) < Tracker::kBuckets - 1);
+    NALU_CHECK(Tracker::BucketValue(Tracker::kBuckets - 1) < top);
+
+    // Every bucket reports a value of its own, in order
+    for (int bucket = 0; bucket < Tracker::kBuckets; ++bucket) {
+        NALU_CHECK_EQ(Tracker::Bucket(Tracker::BucketValue(bucket)), bucket);
+        if (bucket > 0) {
+            NALU_CHECK(Tracker::BucketValue(bucket) > Tracker::BucketValue(bucket - 1));
+        }
+    }
+
+    // Values land in order and are reported to within 2 %, both sides of
+    // every power of two
+    int previous = 0;
+    for (int bits = 2; bits < Tracker::kMaxValueBits; ++bits) {
+        const uint64_t power = uint64_t{1} << bits;
+        for (uint64_t value : {power - 1, power, power + 1, power + power / 3}) {
+            int bucket = Tracker::Bucket(value);
+            NALU_CHECK(bucket >= previous);
+            previous = bucket;
+            NALU_CHECK(Near(static_cast<double>(Tracker::BucketValue(bucket)), static_cast<double>(value), 0.02));
+        }
+    }
+}
+
+void TestKnownDistribution() {
+    Tracker tracker(2);
+    NALU_CHECK_EQ(tracker.Stats().build.count, uint64_t{0});
+    NALU_CHECK_EQ(tracker.Stats().build.ToString(), std::string("no events"));
+
+    // 1 us to 10 ms in 1 us steps, split between the producers
+    for (uint64_t i = 1; i <= 10000; ++i) {
+        RecordBuild(tracker, static_cast<int>(i % 2), i * 1000);
+    }
+    NaluLatencyStats stats = tracker.Stats();
+    const NaluLatencySummary& build = stats.build;
+    NALU_CHECK_EQ(build.count, uint64_t{10000});
+    NALU_CHECK_EQ(build.min_ns, uint64_t{1000});
+    NALU_CHECK_EQ(build.max_ns, uint64_t{10000000});
+    NALU_CHECK(Near(build.mean_ns, 5000500.0, 1e-9));
+    NALU_CHECK(Near(static_cast<double>(build.p50_ns), 5000000.0, 0.02));
+    NALU_CHECK(Near(static_cast<double>(build.p99_ns), 9900000.0, 0.02));
+    NALU_CHECK(Near(static_cast<double>(build.p999_ns), 9990000.0, 0.02));
+    NALU_CHECK(build.p50_ns <= build.p99_ns && build.p99_ns <= build.p999_ns && build.p999_ns <= build.max_ns);
+    // Only the build stage had both its times
+    NALU_CHECK_EQ(stats.process.count, uint64_t{0});
+    NALU_CHECK_EQ(stats.sink.count, uint64_t{0});
+    NALU_CHECK_EQ(stats.total.count, uint64_t{0});
+
+    // One slow event in a thousand moves p99.9, not p99
+    Tracker tail(1);
+    for (int i = 0; i < 999; ++i) {
+        RecordBuild(tail, 0, 2000);
+    }
+    RecordBuild(tail, 0, 5000000);
+    NALU_CHECK(Near(static_cast<double>(tail.Stats().build.p99_ns), 2000.0, 0.02));
+    NALU_CHECK(Near(static_cast<double>(tail.Stats().build.p999_ns), 2000.0, 0.02));
+    RecordBuild(tail, 0, 5000000);
+    NALU_CHECK(Near(static_cast<double>(tail.Stats().build.p999_ns), 5000000.0, 0.02));
+    NALU_CHECK(Near(static_cast<double>(tail.Stats().build.p99_ns), 2000.0, 0.02));
+}
+
+void TestPercentilesStayWithinMinAndMax() {
+    // A bucket's midpoint may lie outside the values it holds
+    Tracker tracker(1);
+    RecordBuild(tracker, 0, 1001);
+    NaluLatencySummary one = tracker.Stats().build;
+    NALU_CHECK(Tracker::BucketValue(Tracker::Bucket(1001)) != 1001);
+    NALU_CHECK_EQ(one.p50_ns, uint64_t{1001});
+    NALU_CHECK_EQ(one.p999_ns, uint64_t{1001});
+
+    // Past the clamp the exact maximum is still reported
+    const uint64_t long_ns = uint64_t{1} << 42;
+    RecordBuild(tracker, 0, long_ns);
+    NaluLatencySummary two = tracker.Stats().build;
+    NALU_CHECK_EQ(two.max_ns, long_ns);
+    NALU_CHECK_EQ(two.min_ns, uint64_t{1001});
+    NALU_CHECK_EQ(two.p50_ns, uint64_t{1001});
+    NALU_CHECK(two.p999_ns < long_ns);   // the clamped bucket's value
+
+    // A stage whose later time comes first counts as zero
+    Tracker replayed(1);
+    replayed.Record(0, 5000, 4000, 0, 0);
+    NALU_CHECK_EQ(replayed.Stats().build.count, uint64_t{1});
+    NALU_CHECK_EQ(replayed.Stats().build.max_ns, uint64_t{0});
+}
+
+}  // namespace
+
+int main() {
+    TestBucketBoundaries();
+    TestKnownDistribution();
+    TestPercentilesStayWithinMinAndMax();
+    return NaluTestExitCode();
+}
@@ -0,0 +1,119 @@
+// The monitoring tap against a fast nalu_board_simulator process (the
+// `fast_board` fixture): the same capture is run without the tap, with its
+// default prescale and with every event offered to the sampling budget. The
+// simulator sends at a fixed rate the receiver keeps up with, so the build
+// rate only shows that no events were lost; what the tap costs is the CPU
+// time this process spends per built event, which it may raise only a little.
+//
+//   nalu_monitor_tap_rate_test <control ip:port> <target ip:port>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <time.h>
+#include "nalu_board_controller.h"
+#include "nalu_board_controller_logger.h"
+#include "nalu_simulator_client.h"
+#include "nalu_test.h"
+
+namespace {
+
+// Events built per second, the tap lowering it by no more than this
+constexpr double kMinRateFraction = 0.9;
+// CPU time per built event, the tap raising it by no more than this
+constexpr double kMaxCpuFactor = 1.25;
+constexpr int kCaptureMs = 1500;
+
+// CPU time of every thread of this process; the receive thread does nearly
+// all the work, the simulator runs in a process of its own
+uint64_t ProcessCpuNs() {
+    timespec now;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &now);
+    return static_cast<uint64_t>(now.tv_sec) * 1000000000ULL + static_cast<uint64_t>(now.tv_nsec);
+}
+
+struct Run {
+    double events_per_second = 0.0;
+    double cpu_ns_per_event = 0.0;
+    uint64_t events = 0;
+    NaluMonitorSnapshot monitor;
+};
+
+Run Capture(NaluBoardController& controller, NaluCaptureParams params) {
+    std::atomic<uint64_t> events{0};
+    controller.set_event_sink([&](NaluEvent&&) { events.fetch_add(1, std::memory_order_relaxed); });
+
+    auto start = std::chrono::steady_clock::now();
+    uint64_t cpu_start = ProcessCpuNs();
+    controller.start_capture(params);
+    std::this_thread::sleep_for(std::chrono::milliseconds(kCaptureMs));
+    controller.stop_capture();
+    uint64_t cpu_ns = ProcessCpuNs() - cpu_start;
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    Run run;
+    run.events = events.load();
+    run.events_per_second = run.events / seconds;
+    run.cpu_ns_per_event = run.events ? static_cast<double>(cpu_ns) / run.events : 0.0;
+    run.monitor = controller.monitor_snapshot();
+    return run;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    std::string control = argc > 1 ? argv[1] : "127.0.0.1:46620";
+    std::string target = argc > 2 ? argv[2] : "127.0.0.1:46630";
+
+    NaluBoardParams board_params;
+    board_params.model = "hdsocv1_evalr2";
+    NaluBoardController controller(board_params, std::make_unique<NaluSimulatorClient>(control));
+
+    NaluCaptureParams params;
+    params.target_ip_port = target;
+    params.windows = 4;
+    params.lookback = 4;
+    params.trigger_mode = "self";
+    for (int channel = 0; channel < 16; ++channel) {
+        params.channels[channel] = NaluChannelInfo{true, 100, 1800};
+    }
+    params.receiver.mode = "socket";
+    params.receiver.socket_buffer_bytes = 8 << 20;
+
+    controller.initialize_board();
+    Run baseline = Capture(controller, params);
+
+    params.monitor.enabled = true;
+    Run prescaled = Capture(controller, params);
+
+    params.monitor.prescale = 1;
+    Run budgeted = Capture(controller, params);
+
+    for (const auto& [name, run] : {std::pair<std::string, const Run&>{"no tap", baseline},
+                                    {"prescale 100", prescaled},
+                                    {"prescale 1 within budget", budgeted}}) {
+        NaluBoardControllerLogger::info("Monitor tap rate, " + name + ": " +
+                                        std::to_string(static_cast<uint64_t>(run.events_per_second)) +
+                                        " events/s, " + std::to_string(static_cast<uint64_t>(run.cpu_ns_per_event)) +
+                                        " CPU ns/event, " + std::to_string(run.monitor.events_sampled) + " sampled");
+    }
+
+    NALU_CHECK(baseline.events > 1000);
+    NALU_CHECK(prescaled.events_per_second >= kMinRateFraction * baseline.events_per_second);
+    NALU_CHECK(budgeted.events_per_second >= kMinRateFraction * baseline.events_per_second);
+    NALU_CHECK(prescaled.cpu_ns_per_event <= kMaxCpuFactor * baseline.cpu_ns_per_event);
+    NALU_CHECK(budgeted.cpu_ns_per_event <= kMaxCpuFactor * baseline.cpu_ns_per_event);
+
+    // The tap did see every event and sampled within its prescale and budget
+    const uint64_t budget = static_cast<uint64_t>(params.monitor.max_events_per_second) * (kCaptureMs / 1000 + 1);
+    for (const Run* run : {&prescaled, &budgeted}) {
+        NALU_CHECK_EQ(run->monitor.events_seen, run->events);
+        NALU_CHECK(run->monitor.events_sampled > 0);
+        NALU_CHECK(run->monitor.events_sampled <= budget);
+    }
+    NALU_CHECK(prescaled.monitor.events_sampled <= prescaled.events / 100 + 1);
+    NALU_CHECK(budgeted.monitor.events_over_budget > 0);
+    return NaluTestExitCode();
+}
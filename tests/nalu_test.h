@@ -0,0 +1,64 @@
+#ifndef NALU_TEST_H
+#define NALU_TEST_H
+
+#include <iostream>
+#include <sstream>
+#include <string>
+
+// Minimal checks behind the CTest executables in tests/. Every test is a
+// program whose main() runs its cases and returns NaluTestExitCode(). A failed
+// check prints its location and fails the test, and the remaining checks
+// still run.
+
+inline int& NaluTestFailures() {
+    static int failures = 0;
+    return failures;
+}
+
+inline void NaluTestFail(const char* file, int line, const std::string& message) {
+    NaluTestFailures()++;
+    std::cerr << file << ":" << line << ": check failed: " << message << std::endl;
+}
+
+inline int NaluTestExitCode() {
+    if (NaluTestFailures() > 0) {
+        std::cerr << NaluTestFailures() << " check(s) failed" << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+#define NALU_CHECK(condition)                                  \
+    do {                                                       \
+        if (!(condition)) {                                    \
+            NaluTestFail(__FILE__, __LINE__, #condition);      \
+        }                                                      \
+    } while (0)
+
+// Prints both values on failure; they must be streamable
+#define NALU_CHECK_EQ(actual, expected)                                                          \
+    do {                                                                                         \
+        auto nalu_actual_ = (actual);                                                            \
+        auto nalu_expected_ = (expected);                                                        \
+        if (!(nalu_actual_ == nalu_expected_)) {                                                 \
+            std::ostringstream nalu_message_;                                                    \
+            nalu_message_ << #actual << " == " << #expected << " (" << nalu_actual_ << " vs "    \
+                          << nalu_expected_ << ")";                                              \
+            NaluTestFail(__FILE__, __LINE__, nalu_message_.str());                               \
+        }                                                                                        \
+    } while (0)
+
+#define NALU_CHECK_THROWS(statement, exception_type)                                  \
+    do {                                                                              \
+        bool nalu_thrown_ = false;                                                    \
+        try {                                                                         \
+            statement;                                                                \
+        } catch (const exception_type&) {                                             \
+            nalu_thrown_ = true;                                                      \
+        }                                                                             \
+        if (!nalu_thrown_) {                                                          \
+            NaluTestFail(__FILE__, __LINE__, #statement " throws " #exception_type);  \
+        }                                                                             \
+    } while (0)
+
+#endif // NALU_TEST_H
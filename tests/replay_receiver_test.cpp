@@ -0,0 +1,187 @@
+// NaluReplayReceiver on what NaluCaptureRecorder wrote, at full speed and at
+// the original pace: the same payloads on the same queues at the same
+// relative times. On a damaged recording: a record claiming more bytes than
+// any datagram ends the replay after the records before it, instead of
+// sizing a read buffer from it. And a recording without datagrams ends the
+// replay rather than being reopened over and over.
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include "nalu_capture_file.h"
+#include "nalu_capture_recorder.h"
+#include "nalu_replay_receiver.h"
+#include "nalu_test.h"
+
+namespace {
+
+struct Datagram {
+    int queue = 0;
+    std::vector<uint8_t> payload;
+    uint64_t rx_ns = 0;
+};
+
+std::string TempPath(const std::string& name) {
+    return "/tmp/nalu_replay_test_" + std::to_string(getpid()) + "_" + name + ".nalurec";
+}
+
+// Plays `path` once, returning every datagram the sink got
+std::vector<Datagram> Replay(const std::string& path, double speed, int loops = 1) {
+    NaluReceiverParams params;
+    params.mode = "replay";
+    params.replay_file = path;
+    params.replay_speed = speed;
+    params.replay_loops = loops;
+    NaluReplayReceiver receiver(params, nullptr);
+
+    std::vector<Datagram> datagrams;
+    receiver.Start([&](int queue, const uint8_t* data, size_t size, uint64_t rx_ns) {
+        if (size > 0) {
+            datagrams.push_back(Datagram{queue, std::vector<uint8_t>(data, data + size), rx_ns});
+        }
+    });
+    for (int i = 0; i < 500 && !receiver.Finished(); ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    NALU_CHECK(receiver.Finished());
+    receiver.Stop();   // joins the replay thread, so `datagrams` is ours again
+    return datagrams;
+}
+
+void TestRecordingReplaysAsRecorded() {
+    const std::string path = TempPath("round_trip");
+    NaluRecordParams record_params;
+    record_params.path = path;
+    NaluCaptureRecorder recorder(record_params, 2);
+    recorder.Start();
+
+    // Interleaved over two queues, queue 1 first, 1 ms apart; the file holds
+    // them in per-queue blocks
+    std::vector<Datagram> recorded;
+    const uint64_t base_ns = NaluMonotonicNs();
+    for (int i = 0; i < 24; ++i) {
+        Datagram datagram;
+        datagram.queue = i % 3 == 0 ? 1 : 0;
+        datagram.rx_ns = base_ns + 1000000 * static_cast<uint64_t>(i + 1);
+        for (int byte = 0; byte < 20 + i; ++byte) {
+            datagram.payload.push_back(static_cast<uint8_t>(i * 31 + byte));
+        }
+        recorder.Record(datagram.queue, datagram.payload.data(), datagram.payload.size(), datagram.rx_ns);
+        recorded.push_back(datagram);
+    }
+    recorder.Stop();
+    NALU_CHECK_EQ(recorder.Stats().packets, uint64_t{24});
+
+    for (double speed : {0.0, 1.0}) {
+        auto start = std::chrono::steady_clock::now();
+        std::vector<Datagram> replayed = Replay(path, speed);
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        NALU_CHECK_EQ(replayed.size(), recorded.size());
+        if (replayed.size() != recorded.size()) {
+            continue;
+        }
+        if (speed > 0.0) {
+            NALU_CHECK(elapsed >= std::chrono::milliseconds(24));   // paced, not dumped
+        }
+
+        // Each queue in its recorded order, and every rx_ns shifted by the
+        // same amount: the recorded spacing, across queues too
+        std::vector<size_t> next(2, 0);
+        bool have_shift = false;
+        uint64_t shift_ns = 0;
+        for (const Datagram& datagram : replayed) {
+            size_t& at = next.at(datagram.queue);
+            while (at < recorded.size() && recorded[at].queue != datagram.queue) {
+                ++at;
+            }
+            if (at == recorded.size()) {
+                NALU_CHECK(false);
+                break;
+            }
+            const Datagram& original = recorded[at++];
+            NALU_CHECK(datagram.payload == original.payload);
+            if (!have_shift) {
+                shift_ns = datagram.rx_ns - original.rx_ns;
+                have_shift = true;
+            }
+            NALU_CHECK_EQ(datagram.rx_ns - original.rx_ns, shift_ns);
+        }
+    }
+    std::remove(path.c_str());
+}
+
+void AppendRecord(std::vector<uint8_t>& file, uint64_t rx_ns, uint32_t size, size_t payload_bytes) {
+    size_t at = file.size();
+    file.resize(at + kNaluCaptureRecordHeaderBytes + payload_bytes, 0xAB);
+    NaluWriteCaptureRecordHeader(file.data() + at, rx_ns, 0, size);
+}
+
+std::string WriteCapture(const std::vector<uint8_t>& records) {
+    std::string path = "/tmp/nalu_replay_test_" + std::to_string(getpid()) + ".nalurec";
+    std::vector<uint8_t> header(kNaluCaptureHeaderBytes);
+    NaluWriteCaptureHeader(header.data(), NaluCaptureFileHeader{});
+    std::FILE* file = std::fopen(path.c_str(), "wb");
+    std::fwrite(header.data(), 1, header.size(), file);
+    std::fwrite(records.data(), 1, records.size(), file);
+    std::fclose(file);
+    return path;
+}
+
+void TestOversizedRecordStopsReplay() {
+    std::vector<uint8_t> records;
+    AppendRecord(records, 1000, 100, 100);
+    AppendRecord(records, 2000, 200, 200);
+    AppendRecord(records, 3000, 0xFFFFFFF0u, 64);   // damaged size field
+    AppendRecord(records, 4000, 100, 100);
+    std::string path = WriteCapture(records);
+
+    NaluReceiverParams params;
+    params.mode = "replay";
+    params.replay_file = path;
+    params.replay_speed = 0.0;
+    params.replay_loops = 3;
+    NaluReplayReceiver receiver(params, nullptr);
+
+    std::atomic<int> packets{0};
+    receiver.Start([&](int, const uint8_t*, size_t size, uint64_t) {
+        if (size > 0) {
+            packets++;
+        }
+    });
+    for (int i = 0; i < 200 && !receiver.Finished(); ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    NALU_CHECK(receiver.Finished());
+    receiver.Stop();
+    std::remove(path.c_str());
+
+    // The records before the damaged one, once: no further loop is played
+    NALU_CHECK_EQ(packets.load(), 2);
+    NALU_CHECK_EQ(receiver.Stats().at(0).packets, uint64_t{2});
+}
+
+}  // namespace
+
+void TestEmptyRecordingEndsReplay() {
+    const std::string path = TempPath("empty");
+    NaluRecordParams record_params;
+    record_params.path = path;
+    NaluCaptureRecorder recorder(record_params, 1);
+    recorder.Start();
+    recorder.Stop();
+
+    // Looping until stopped, but there is nothing to loop over
+    NALU_CHECK(Replay(path, 0.0, 0).empty());
+    std::remove(path.c_str());
+}
+
+int main() {
+    TestRecordingReplaysAsRecorded();
+    TestEmptyRecordingEndsReplay();
+    TestOversizedRecordStopsReplay();
+    return NaluTestExitCode();
+}
@@ -0,0 +1,229 @@
+// NaluScanEngine against a stand-in board that records its calls: plans
+// refused before anything is written, the hot update each step of a parallel
+// threshold scan and a sequential DAC scan issues, the original values put
+// back afterwards, and a scan cancelled from another thread while a step
+// counts with the board lock released.
+
+#include <chrono>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include "nalu_board_configurator.h"
+#include "nalu_board_state.h"
+#include "nalu_scan_engine.h"
+#include "nalu_test.h"
+
+namespace {
+
+struct BoardCall {
+    std::string name;
+    int first = 0;
+    int second = 0;
+    std::vector<int> values;
+};
+
+class StandInBoard : public NaluBoardBackend {
+public:
+    void InitializeBoard() override { Call("init"); }
+    void StartCapture() override { Call("start"); }
+    void StopCapture() override { Call("stop"); }
+    void WriteTriggerValues(const std::vector<int>& values) override { Call("trigger", 0, 0, values); }
+    void WriteTriggerReferences(int low, int high) override { Call("references", low, high); }
+    void WriteTriggerEdge(bool rising) override { Call("edge", rising); }
+    void WriteDacValue(int channel, int value) override { Call("dac", channel, value); }
+    void WriteReadoutChannels(const std::vector<int>& channels) override { Call("channels", 0, 0, channels); }
+    void WriteReadWindow(int windows, int lookback, int) override { Call("window", windows, lookback); }
+    void ConfigureEthernet(const IPAddressInfo&) override { Call("ethernet"); }
+
+    std::vector<BoardCall> Calls(const std::string& name) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::vector<BoardCall> matching;
+        for (const BoardCall& call : calls_) {
+            if (call.name == name) matching.push_back(call);
+        }
+        return matching;
+    }
+
+    size_t CallCount() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return calls_.size();
+    }
+
+private:
+    void Call(const std::string& name, int first = 0, int second = 0, const std::vector<int>& values = {}) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        calls_.push_back(BoardCall{name, first, second, values});
+    }
+
+    mutable std::mutex mutex_;
+    std::vector<BoardCall> calls_;
+};
+
+// A self-triggered capture of channels 0-3, DACs assigned: thresholds
+// 100 + channel, DACs 1800 + channel
+struct Rig {
+    Rig() : state(NaluBoardParams()), configurator(&state, &board), engine(&state, &configurator, &counters) {
+        NaluCaptureParams capture;
+        capture.target_ip_port = "127.0.0.1:12345";
+        capture.trigger_mode = "self";
+        capture.assign_dac_values = true;
+        for (int channel = 0; channel < 4; ++channel) {
+            capture.channels[channel] = NaluChannelInfo{true, 100 + channel, 1800 + channel};
+        }
+        state.UpdateFromCaptureParams(capture);
+        state.SetCapturing(true);
+    }
+
+    NaluBoardState state;
+    StandInBoard board;
+    NaluBoardConfigurator configurator;
+    NaluCaptureCounters counters;
+    NaluScanEngine engine;
+};
+
+NaluScanPlan Plan(const std::vector<int>& channels, int start, int stop, int step) {
+    NaluScanPlan plan;
+    plan.channels = channels;
+    plan.start = start;
+    plan.stop = stop;
+    plan.step = step;
+    plan.dwell_ms = 2;
+    plan.settle_ms = 0;
+    return plan;
+}
+
+void TestRejectedPlans() {
+    Rig rig;
+    // Stepping away from stop would never get there
+    NALU_CHECK_THROWS(rig.engine.Run(Plan({0, 1}, 100, 300, -10)), std::invalid_argument);
+    NALU_CHECK_THROWS(rig.engine.Run(Plan({0, 1}, 300, 100, 10)), std::invalid_argument);
+    NALU_CHECK_THROWS(rig.engine.Run(Plan({0, 1}, 100, 300, 0)), std::invalid_argument);
+
+    NALU_CHECK_THROWS(rig.engine.Run(Plan({}, 100, 300, 10)), std::invalid_argument);
+    NALU_CHECK_THROWS(rig.engine.Run(Plan({0, 0}, 100, 300, 10)), std::invalid_argument);
+    NALU_CHECK_THROWS(rig.engine.Run(Plan({32}, 100, 300, 10)), std::invalid_argument);
+    NALU_CHECK_THROWS(rig.engine.Run(Plan({0}, 100, 4096, 10)), std::invalid_argument);
+
+    // DAC scans only on channels whose DACs a full configuration writes
+    NaluScanPlan disabled_dac = Plan({0, 7}, 1000, 2000, 500);
+    disabled_dac.parameter = NaluScanParameter::DAC_VALUE;
+    NALU_CHECK_THROWS(rig.engine.Run(disabled_dac), std::invalid_argument);
+
+    NALU_CHECK_EQ(rig.board.CallCount(), size_t{0});
+    NALU_CHECK_EQ(rig.state.TriggerValues()[0], 100);
+    NALU_CHECK_EQ(rig.state.DacValues()[0], 1800);
+
+    // A plan of a single value may leave step pointing either way
+    NaluScanResult single = rig.engine.Run(Plan({2}, 150, 150, -5));
+    NALU_CHECK_EQ(single.steps, 1);
+}
+
+void TestParallelThresholdSteps() {
+    Rig rig;
+    NaluScanResult result = rig.engine.Run(Plan({0, 1}, 100, 300, 100));
+    NALU_CHECK(!result.cancelled);
+    NALU_CHECK_EQ(result.steps, 3);
+
+    // Thresholds only: one write per step and one to restore, readout never paused
+    NALU_CHECK(rig.board.Calls("stop").empty());
+    std::vector<BoardCall> writes = rig.board.Calls("trigger");
+    NALU_CHECK_EQ(writes.size(), size_t{4});
+    const int expected[][2] = {{100, 100}, {200, 200}, {300, 300}, {100, 101}};
+    for (size_t i = 0; i < writes.size() && i < 4; ++i) {
+        NALU_CHECK_EQ(writes[i].values.at(0), expected[i][0]);
+        NALU_CHECK_EQ(writes[i].values.at(1), expected[i][1]);
+        NALU_CHECK_EQ(writes[i].values.at(2), 102);   // not scanned
+    }
+    NALU_CHECK_EQ(rig.state.TriggerValues()[1], 101);
+
+    NALU_CHECK_EQ(result.points.size(), size_t{6});
+    for (size_t i = 0; i < result.points.size(); ++i) {
+        const NaluScanPoint& point = result.points[i];
+        NALU_CHECK_EQ(point.step, static_cast<int>(i / 2));
+        NALU_CHECK_EQ(point.channel, static_cast<int>(i % 2));
+        NALU_CHECK_EQ(point.value, 100 + 100 * point.step);
+        NALU_CHECK(point.live_time >= std::chrono::milliseconds(2));
+    }
+}
+
+void TestSequentialDacSteps() {
+    Rig rig;
+    NaluScanPlan plan = Plan({0, 1}, 1000, 1500, 500);
+    plan.parameter = NaluScanParameter::DAC_VALUE;
+    plan.mode = NaluScanMode::SEQUENTIAL;
+    NaluScanResult result = rig.engine.Run(plan);
+    NALU_CHECK_EQ(result.steps, 4);
+
+    // Only the DACs that change are written; the channel measured before
+    // goes back to its own value when the next one starts
+    std::vector<BoardCall> writes = rig.board.Calls("dac");
+    const int expected[][2] = {{0, 1000}, {0, 1500}, {0, 1800}, {1, 1000}, {1, 1500}, {1, 1801}};
+    NALU_CHECK_EQ(writes.size(), size_t{6});
+    for (size_t i = 0; i < writes.size() && i < 6; ++i) {
+        NALU_CHECK_EQ(writes[i].first, expected[i][0]);
+        NALU_CHECK_EQ(writes[i].second, expected[i][1]);
+    }
+    // DACs go out with readout running, and no threshold is touched
+    NALU_CHECK(rig.board.Calls("stop").empty());
+    NALU_CHECK(rig.board.Calls("trigger").empty());
+    NALU_CHECK_EQ(rig.state.DacValues()[0], 1800);
+    NALU_CHECK_EQ(rig.state.DacValues()[1], 1801);
+
+    NALU_CHECK_EQ(result.points.size(), size_t{4});
+    NALU_CHECK_EQ(result.points[2].channel, 1);
+    NALU_CHECK_EQ(result.points[2].value, 1000);
+}
+
+void TestCancelDuringStep() {
+    Rig rig;
+    NaluScanPlan plan = Plan({0}, 0, 4000, 10);
+    plan.dwell_ms = 10000;
+    std::mutex board_mutex;
+    std::unique_lock<std::mutex> board_lock(board_mutex);
+
+    // Takes the board lock the engine releases while a step counts, as
+    // stop_capture() does, and cancels
+    bool got_lock = false;
+    std::thread canceller([&] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        std::lock_guard<std::mutex> lock(board_mutex);
+        got_lock = true;
+        rig.engine.Cancel();
+    });
+    auto start = std::chrono::steady_clock::now();
+    NaluScanResult result = rig.engine.Run(plan, &board_lock);
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    canceller.join();
+
+    NALU_CHECK(got_lock);
+    NALU_CHECK(board_lock.owns_lock());
+    NALU_CHECK(result.cancelled);
+    NALU_CHECK(elapsed < std::chrono::seconds(2));
+    // The step cut short is still reported, and the threshold put back
+    NALU_CHECK_EQ(result.steps, 1);
+    NALU_CHECK_EQ(result.points.size(), size_t{1});
+    NALU_CHECK(result.points[0].live_time < std::chrono::seconds(2));
+    std::vector<BoardCall> writes = rig.board.Calls("trigger");
+    NALU_CHECK_EQ(writes.size(), size_t{2});
+    NALU_CHECK_EQ(writes.at(0).values.at(0), 0);
+    NALU_CHECK_EQ(writes.at(1).values.at(0), 100);
+    NALU_CHECK_EQ(rig.state.TriggerValues()[0], 100);
+
+    // A cancel left over from the last scan does not stop the next one
+    board_lock.unlock();
+    NaluScanResult next = rig.engine.Run(Plan({0}, 200, 220, 10));
+    NALU_CHECK(!next.cancelled);
+    NALU_CHECK_EQ(next.steps, 3);
+}
+
+}  // namespace
+
+int main() {
+    TestRejectedPlans();
+    TestParallelThresholdSteps();
+    TestSequentialDacSteps();
+    TestCancelDuringStep();
+    return NaluTestExitCode();
+}
@@ -0,0 +1,125 @@
+// Heap allocations of steady capture, counted by the benchmarks' replacement
+// of global operator new: two boards through builder -> monitor -> [merger]
+// -> cross-board filter -> slot queue, drained by a consumer that keeps its
+// last events leased. Once the deepest backlog has been reached and every
+// merger ring slot has been through once, neither path allocates.
+
+#include <array>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "nalu_benchmark.h"
+#include "nalu_benchmark_stream.h"
+#include "nalu_event_builder.h"
+#include "nalu_event_filter.h"
+#include "nalu_event_merger.h"
+#include "nalu_event_queue.h"
+#include "nalu_monitor.h"
+#include "nalu_receiver.h"
+#include "nalu_test.h"
+
+namespace {
+
+constexpr int kBoards = 2;
+constexpr int kHeld = 16;
+constexpr uint64_t kInFlight = 64;      // merger backlog the producer allows
+constexpr uint64_t kFillSteps = 256;    // warm-up steps with nobody consuming
+
+void TestSteadyCaptureAllocatesNothing(bool merged) {
+    NaluEventLayout layout;
+    layout.channel_mask = (uint64_t{1} << 8) - 1;
+    layout.windows = 4;
+    layout.samples_per_window = 32;
+
+    NaluEventSlotQueue queue(1024);
+    NaluFilterParams filter_params;
+    filter_params.enabled = true;
+    filter_params.rules = {NaluFilterRule{"pair", {}, 1, kBoards, 2000}};
+    NaluEventFilter filter(filter_params, {}, [&queue](NaluEvent&& event) { queue.Push(std::move(event)); });
+    NaluMergeParams merge_params;
+    merge_params.enabled = true;
+    merge_params.queue_capacity = 256;
+    NaluEventMerger merger(merge_params, [&filter](NaluEvent&& event) { filter.HandleEvent(std::move(event)); });
+    NaluMonitorParams monitor_params;
+    monitor_params.enabled = true;
+    NaluMonitor monitor(monitor_params, kBoards);
+
+    std::vector<std::unique_ptr<NaluBenchmarkStream>> streams;
+    std::vector<std::unique_ptr<NaluEventBuilder>> builders;
+    for (int board = 0; board < kBoards; ++board) {
+        streams.push_back(std::make_unique<NaluBenchmarkStream>(board, 8, 4));
+        builders.push_back(std::make_unique<NaluEventBuilder>(
+            NaluEventBuilderParams{}, layout, nullptr, [&, board, merged](NaluEvent&& event) {
+                monitor.Observe(board, event);
+                if (merged) {
+                    merger.Push(std::move(event));
+                } else {
+                    filter.HandleEvent(std::move(event));
+                }
+            }));
+    }
+    if (merged) {
+        merger.Start();
+    }
+
+    std::array<int, kHeld> held;
+    held.fill(-1);
+    size_t next_held = 0;
+    auto consume = [&] {
+        for (int index = queue.Pop(0); index >= 0; index = queue.Pop(0)) {
+            queue.Release(held[next_held]);
+            held[next_held] = index;
+            next_held = (next_held + 1) % kHeld;
+        }
+    };
+    uint64_t rx_ns = NaluMonotonicNs();
+    auto feed = [&](uint64_t count, bool drain) {
+        for (uint64_t i = 0; i < count; ++i) {
+            for (int board = 0; board < kBoards; ++board) {
+                for (const auto& packet : streams[board]->Next()) {
+                    builders[board]->HandlePacket(packet.data(), packet.size(), rx_ns);
+                }
+            }
+            rx_ns += 1000;
+            while (merged && merger.Stats().events_in - merger.Stats().events_out > kInFlight) {
+                std::this_thread::yield();
+                if (drain) {
+                    consume();
+                }
+            }
+            if (drain) {
+                consume();
+            }
+        }
+    };
+
+    feed(kFillSteps, false);
+    feed(static_cast<uint64_t>(merge_params.queue_capacity) + 500, true);
+    uint64_t pushed_before = queue.Stats().pushed;
+    uint64_t before = NaluAllocationCount();
+    feed(20000, true);
+    uint64_t allocations = NaluAllocationCount() - before;
+
+    for (auto& builder : builders) {
+        builder->Flush();
+    }
+    if (merged) {
+        merger.Stop();
+    }
+    filter.Flush();
+    consume();
+
+    NALU_CHECK_EQ(allocations, uint64_t{0});
+    // The events did flow: nothing was dropped on the way
+    NALU_CHECK(queue.Stats().pushed - pushed_before >= uint64_t{20000 * kBoards});
+    NALU_CHECK_EQ(queue.Stats().dropped, uint64_t{0});
+    NALU_CHECK_EQ(merger.Stats().dropped_full, uint64_t{0});
+}
+
+}  // namespace
+
+int main() {
+    TestSteadyCaptureAllocatesNothing(false);
+    TestSteadyCaptureAllocatesNothing(true);
+    return NaluTestExitCode();
+}
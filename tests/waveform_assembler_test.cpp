@@ -0,0 +1,190 @@
+// NaluWaveformAssembler on hand-made events of channels 0 and 2, three
+// windows each, on an 8-window circular buffer: a readout already in time
+// order, one wrapping around the end of the buffer, a missing window, a
+// duplicated window and a window of a channel outside the event's mask; and
+// the refusal of a readout as long as the buffer.
+
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+#include "nalu_params_validator.h"
+#include "nalu_waveform_assembler.h"
+#include "nalu_test.h"
+
+namespace {
+
+constexpr int kBufferWindows = 8;
+constexpr int kSamples = 4;
+
+NaluEventLayout Layout() {
+    NaluEventLayout layout;
+    layout.channel_mask = 0x5;
+    layout.windows = 3;
+    layout.samples_per_window = kSamples;
+    layout.buffer_windows = kBufferWindows;
+    return layout;
+}
+
+uint16_t Sample(int channel, int window, int i) {
+    return static_cast<uint16_t>(1000 * channel + 10 * window + i);
+}
+
+// Windows appended in the order given, as the builder would
+void AddWindow(NaluEvent& event, int channel, int window, uint16_t tag = 0) {
+    event.windows.push_back(NaluEventWindow{static_cast<uint8_t>(channel), static_cast<uint8_t>(window),
+                                            kSamples, static_cast<uint32_t>(event.samples.size())});
+    for (int i = 0; i < kSamples; ++i) {
+        event.samples.push_back(static_cast<uint16_t>(Sample(channel, window, i) + tag));
+    }
+    event.channel_mask |= uint64_t{1} << channel;
+}
+
+NaluEvent Readout(const std::vector<int>& windows) {
+    NaluEvent event;
+    for (int channel : {0, 2}) {
+        for (int window : windows) {
+            AddWindow(event, channel, window);
+        }
+    }
+    return event;
+}
+
+// Channel `slot` (0 or 1) of the assembled event holds `windows` in this
+// order; a window number of -1 is expected zero-filled
+void CheckWaveform(const NaluEvent& event, int slot, int channel, const std::vector<int>& windows) {
+    NALU_CHECK_EQ(event.waveform_samples, uint32_t{3 * kSamples});
+    for (size_t index = 0; index < windows.size(); ++index) {
+        for (int i = 0; i < kSamples; ++i) {
+            size_t at = slot * event.waveform_samples + index * kSamples + i;
+            uint16_t expected = windows[index] < 0 ? 0 : Sample(channel, windows[index], i);
+            NALU_CHECK_EQ(event.samples.at(at), expected);
+        }
+    }
+}
+
+void TestInOrderReadoutIsLeftAlone() {
+    NaluWaveformAssembler assembler(Layout());
+    NaluEvent event = Readout({2, 3, 4});
+    const std::vector<uint16_t> samples = event.samples;
+    assembler.Assemble(event);
+
+    NALU_CHECK(event.samples == samples);
+    CheckWaveform(event, 0, 0, {2, 3, 4});
+    CheckWaveform(event, 1, 2, {2, 3, 4});
+    NaluWaveformStats stats = assembler.Stats();
+    NALU_CHECK_EQ(stats.events, uint64_t{1});
+    NALU_CHECK_EQ(stats.reordered_events, uint64_t{0});
+    NALU_CHECK_EQ(stats.wrapped_events, uint64_t{0});
+}
+
+void TestWrappedReadoutIsTimeOrdered() {
+    NaluWaveformAssembler assembler(Layout());
+    NaluEvent event = Readout({0, 1, 7});   // buffer order; 7 is the oldest
+    assembler.Assemble(event);
+
+    CheckWaveform(event, 0, 0, {7, 0, 1});
+    CheckWaveform(event, 1, 2, {7, 0, 1});
+    NALU_CHECK_EQ(event.windows.size(), size_t{6});
+    const int numbers[] = {7, 0, 1, 7, 0, 1};
+    for (size_t i = 0; i < event.windows.size(); ++i) {
+        NALU_CHECK_EQ(static_cast<int>(event.windows[i].window), numbers[i]);
+        NALU_CHECK_EQ(static_cast<int>(event.windows[i].channel), i < 3 ? 0 : 2);
+        NALU_CHECK_EQ(event.windows[i].offset, static_cast<uint32_t>(i * kSamples));
+    }
+    NaluWaveformStats stats = assembler.Stats();
+    NALU_CHECK_EQ(stats.reordered_events, uint64_t{1});
+    NALU_CHECK_EQ(stats.wrapped_events, uint64_t{1});
+    NALU_CHECK_EQ(stats.filled_windows, uint64_t{0});
+    NALU_CHECK_EQ(stats.dropped_windows, uint64_t{0});
+}
+
+void TestMissingWindowIsZeroFilled() {
+    NaluWaveformAssembler assembler(Layout());
+    NaluEvent event;
+    for (int window : {0, 1, 7}) {
+        AddWindow(event, 0, window);
+    }
+    for (int window : {1, 7}) {   // channel 2 lost window 0
+        AddWindow(event, 2, window);
+    }
+    assembler.Assemble(event);
+
+    // The other channel still places the readout, so nothing shifts
+    CheckWaveform(event, 0, 0, {7, 0, 1});
+    CheckWaveform(event, 1, 2, {7, -1, 1});
+    NALU_CHECK_EQ(event.windows.size(), size_t{5});
+    NALU_CHECK_EQ(static_cast<int>(event.windows[4].window), 1);
+    NALU_CHECK_EQ(event.windows[4].offset, uint32_t{5 * kSamples});
+    NALU_CHECK_EQ(assembler.Stats().filled_windows, uint64_t{1});
+    NALU_CHECK_EQ(assembler.Stats().dropped_windows, uint64_t{0});
+}
+
+void TestDuplicateWindowIsDropped() {
+    NaluWaveformAssembler assembler(Layout());
+    NaluEvent event = Readout({2, 3, 4});
+    AddWindow(event, 0, 3, 500);   // a second copy, different samples
+    assembler.Assemble(event);
+
+    CheckWaveform(event, 0, 0, {2, 3, 4});   // the first copy is kept
+    CheckWaveform(event, 1, 2, {2, 3, 4});
+    NALU_CHECK_EQ(event.windows.size(), size_t{6});
+    NALU_CHECK_EQ(event.samples.size(), size_t{6 * kSamples});
+    NALU_CHECK_EQ(assembler.Stats().reordered_events, uint64_t{1});
+    NALU_CHECK_EQ(assembler.Stats().dropped_windows, uint64_t{1});
+}
+
+void TestChannelOutsideMaskIsDropped() {
+    NaluWaveformAssembler assembler(Layout());
+    NaluEvent event = Readout({0, 1, 7});
+    AddWindow(event, 1, 0);
+    event.channel_mask = 0x5;   // the window's channel is not the event's
+    assembler.Assemble(event);
+
+    CheckWaveform(event, 0, 0, {7, 0, 1});
+    CheckWaveform(event, 1, 2, {7, 0, 1});
+    NALU_CHECK_EQ(event.samples.size(), size_t{6 * kSamples});
+    for (const NaluEventWindow& window : event.windows) {
+        NALU_CHECK(window.channel != 1);
+    }
+    NALU_CHECK_EQ(assembler.Stats().dropped_windows, uint64_t{1});
+}
+
+void TestWholeBufferReadoutIsRefused() {
+    NaluEventLayout layout = Layout();
+    layout.windows = kBufferWindows;
+    NALU_CHECK_THROWS(NaluWaveformAssembler assembler(layout), std::invalid_argument);
+    layout.windows = kBufferWindows - 1;
+    NaluWaveformAssembler longest(layout);   // one short of the buffer will do
+    layout.buffer_windows = 0;
+    NALU_CHECK_THROWS(NaluWaveformAssembler assembler(layout), std::invalid_argument);
+
+    NaluCaptureParams params;
+    params.waveform.enabled = true;
+    params.waveform.buffer_windows = kBufferWindows;
+    params.windows = kBufferWindows;
+    params.lookback = kBufferWindows;
+    NALU_CHECK(!NaluParamsValidator::CheckCaptureParams(params).empty());
+    params.windows = kBufferWindows - 1;
+    NALU_CHECK(NaluParamsValidator::CheckCaptureParams(params).empty());
+
+    // With the board model's buffer
+    const NaluBoardModel& model = *NaluFindBoardModel("aardvarcv3");
+    params.waveform.buffer_windows = 0;
+    params.windows = model.windows;
+    params.lookback = model.windows;
+    NALU_CHECK(!NaluParamsValidator::CheckCaptureParams(params, model).empty());
+    params.windows = model.windows - 1;
+    NALU_CHECK(NaluParamsValidator::CheckCaptureParams(params, model).empty());
+}
+
+}  // namespace
+
+int main() {
+    TestInOrderReadoutIsLeftAlone();
+    TestWrappedReadoutIsTimeOrdered();
+    TestMissingWindowIsZeroFilled();
+    TestDuplicateWindowIsDropped();
+    TestChannelOutsideMaskIsDropped();
+    TestWholeBufferReadoutIsRefused();
+    return NaluTestExitCode();
+}
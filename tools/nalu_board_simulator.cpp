@@ -0,0 +1,320 @@
+// Stand-alone simulated board on loopback, for load and regression tests
+// without hardware. Streams the placeholder nalu_packet_format.h framing (not
+// a real board's format) to --target and takes commands as UDP text
+// datagrams on --control, one per datagram:
+//
+//   init | channels 0,1,2 | window <windows> <lookback> <write_after_trig>
+//   trigger 100,100,... | references <low> <high> | edge rising|falling
+//   dac <channel> <value> | ethernet <ip:port> | target <ip:port>
+//   start | stop | status | quit
+//
+// and answers each with "ok [...]" or "error <message>". These are the
+// NaluBoardBackend calls; NaluSimulatorClient sends them, so a
+// NaluBoardController can drive the simulator like a board. With --daemon it
+// forks once the control socket is bound, writing the child's pid to
+// --pid-file; --stop --pid-file <file> terminates such a daemon. See
+// cmake/NaluSimulatorFixture.cmake for using it as a CTest fixture.
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "ip_address_info.h"
+#include "nalu_board_controller_logger.h"
+#include "nalu_board_simulator.h"
+
+namespace {
+
+std::atomic<bool> g_stop{false};
+
+void HandleSignal(int) {
+    g_stop.store(true);
+}
+
+void Usage() {
+    std::cerr << "usage: nalu_board_simulator [options]\n"
+                 "  --control ip:port           control socket (127.0.0.1:4660)\n"
+                 "  --target ip:port            where to stream (127.0.0.1:12345)\n"
+                 "  --model name                board model (hdsocv1_evalr2)\n"
+                 "  --board-id n                board id in the packet headers\n"
+                 "  --rate hz                   trigger rate (1000)\n"
+                 "  --fixed-rate                evenly spaced triggers instead of Poisson\n"
+                 "  --channels 0,1,...          readout channels until the controller writes them\n"
+                 "  --windows n                 readout windows until the controller writes them\n"
+                 "  --pulse-channels 0,1,...    channels that may pulse (all)\n"
+                 "  --pulse-probability p       chance of a pulse per channel and event (0.3)\n"
+                 "  --amplitude adc --noise adc --baseline adc\n"
+                 "  --drop p --duplicate p --reorder p   per-packet fault probabilities\n"
+                 "  --silence-every-ms ms --silence-ms ms   periodic silence\n"
+                 "  --max-packet-bytes n --seed n\n"
+                 "  --start                     stream right away\n"
+                 "  --duration-s s              exit after s seconds\n"
+                 "  --daemon --pid-file file    run in the background\n"
+                 "  --stop --pid-file file      stop a background simulator\n";
+}
+
+std::vector<int> ParseList(const std::string& text) {
+    std::vector<int> values;
+    std::stringstream stream(text);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        if (!item.empty()) {
+            values.push_back(std::stoi(item));
+        }
+    }
+    return values;
+}
+
+int StopDaemon(const std::string& pid_file) {
+    std::ifstream in(pid_file);
+    pid_t pid = 0;
+    if (!(in >> pid) || pid <= 0) {
+        std::cerr << "No pid in " << pid_file << "\n";
+        return 1;
+    }
+    if (kill(pid, SIGTERM) < 0 && errno != ESRCH) {
+        std::cerr << "Cannot stop " << pid << ": " << std::strerror(errno) << "\n";
+        return 1;
+    }
+    std::remove(pid_file.c_str());
+    return 0;
+}
+
+std::string HandleCommand(const std::string& line, NaluBoardSimulator& board, bool& quit) {
+    std::istringstream in(line);
+    std::string command;
+    in >> command;
+    if (command == "init") {
+        board.InitializeBoard();
+    } else if (command == "channels") {
+        std::string list;
+        in >> list;
+        board.WriteReadoutChannels(ParseList(list));
+    } else if (command == "window") {
+        int windows = 1, lookback = 1, write_after_trig = 1;
+        if (!(in >> windows >> lookback >> write_after_trig)) {
+            return "error window needs <windows> <lookback> <write_after_trig>";
+        }
+        board.WriteReadWindow(windows, lookback, write_after_trig);
+    } else if (command == "trigger") {
+        std::string list;
+        in >> list;
+        board.WriteTriggerValues(ParseList(list));
+    } else if (command == "references") {
+        int low_reference = 0, high_reference = 0;
+        if (!(in >> low_reference >> high_reference)) {
+            return "error references needs <low> <high>";
+        }
+        board.WriteTriggerReferences(low_reference, high_reference);
+    } else if (command == "edge") {
+        std::string edge;
+        in >> edge;
+        if (edge != "rising" && edge != "falling") {
+            return "error edge must be rising or falling";
+        }
+        board.WriteTriggerEdge(edge == "rising");
+    } else if (command == "dac") {
+        int channel = 0, value = 0;
+        if (!(in >> channel >> value)) {
+            return "error dac needs <channel> <value>";
+        }
+        board.WriteDacValue(channel, value);
+    } else if (command == "ethernet") {
+        std::string target;
+        in >> target;
+        board.ConfigureEthernet(IPAddressInfo(target));
+    } else if (command == "target") {
+        std::string target;
+        in >> target;
+        board.SetTarget(target);
+    } else if (command == "start") {
+        board.StartCapture();
+    } else if (command == "stop") {
+        board.StopCapture();
+    } else if (command == "status") {
+        NaluSimulatorStats stats = board.Stats();
+        return "ok capturing=" + std::to_string(board.IsCapturing()) + " events=" + std::to_string(stats.events) +
+               " packets=" + std::to_string(stats.packets) + " bytes=" + std::to_string(stats.bytes) +
+               " dropped=" + std::to_string(stats.dropped) + " duplicated=" + std::to_string(stats.duplicated) +
+               " reordered=" + std::to_string(stats.reordered) + " silenced=" + std::to_string(stats.silenced) +
+               " send_errors=" + std::to_string(stats.send_errors);
+    } else if (command == "quit") {
+        quit = true;
+    } else {
+        return "error unknown command '" + command + "'";
+    }
+    return "ok";
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    NaluSimulatorParams params;
+    std::string control = "127.0.0.1:4660";
+    std::string pid_file;
+    std::vector<int> channels;
+    int windows = 0;
+    bool start = false, daemon = false, stop = false;
+    double duration_s = 0.0;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto value = [&]() -> std::string {
+            if (i + 1 >= argc) {
+                throw std::invalid_argument(arg + " needs a value");
+            }
+            return argv[++i];
+        };
+        try {
+            if (arg == "--control") control = value();
+            else if (arg == "--target") params.target_ip_port = value();
+            else if (arg == "--model") params.model = value();
+            else if (arg == "--board-id") params.board_id = std::stoi(value());
+            else if (arg == "--rate") params.trigger_rate_hz = std::stod(value());
+            else if (arg == "--fixed-rate") params.poisson = false;
+            else if (arg == "--channels") channels = ParseList(value());
+            else if (arg == "--windows") windows = std::stoi(value());
+            else if (arg == "--pulse-channels") params.pulse_channels = ParseList(value());
+            else if (arg == "--pulse-probability") params.pulse_probability = std::stod(value());
+            else if (arg == "--amplitude") params.pulse_amplitude = std::stoi(value());
+            else if (arg == "--noise") params.noise_rms = std::stod(value());
+            else if (arg == "--baseline") params.baseline = std::stoi(value());
+            else if (arg == "--drop") params.drop_probability = std::stod(value());
+            else if (arg == "--duplicate") params.duplicate_probability = std::stod(value());
+            else if (arg == "--reorder") params.reorder_probability = std::stod(value());
+            else if (arg == "--silence-every-ms") params.silence_every_ms = std::stoi(value());
+            else if (arg == "--silence-ms") params.silence_ms = std::stoi(value());
+            else if (arg == "--max-packet-bytes") params.max_packet_bytes = std::stoi(value());
+            else if (arg == "--seed") params.seed = static_cast<uint32_t>(std::stoul(value()));
+            else if (arg == "--start") start = true;
+            else if (arg == "--duration-s") duration_s = std::stod(value());
+            else if (arg == "--daemon") daemon = true;
+            else if (arg == "--pid-file") pid_file = value();
+            else if (arg == "--stop") stop = true;
+            else {
+                Usage();
+                return 2;
+            }
+        } catch (const std::exception& e) {
+            std::cerr << arg << ": " << e.what() << "\n";
+            return 2;
+        }
+    }
+
+    if (stop) {
+        if (pid_file.empty()) {
+            std::cerr << "--stop needs --pid-file\n";
+            return 2;
+        }
+        return StopDaemon(pid_file);
+    }
+
+    try {
+        IPAddressInfo control_address(control);
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(static_cast<uint16_t>(control_address.getPort()));
+        if (inet_pton(AF_INET, control_address.getIp().c_str(), &address.sin_addr) != 1) {
+            throw std::invalid_argument("Invalid control address " + control);
+        }
+        int fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+        if (fd < 0 || bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+            throw std::runtime_error("Cannot bind control socket " + control + ": " + std::strerror(errno));
+        }
+
+        // Fork only now, so a fixture's setup step returns once commands are accepted
+        if (daemon) {
+            pid_t pid = fork();
+            if (pid < 0) {
+                throw std::runtime_error(std::string("fork failed: ") + std::strerror(errno));
+            }
+            if (pid > 0) {
+                if (!pid_file.empty()) {
+                    std::ofstream(pid_file) << pid << "\n";
+                }
+                return 0;
+            }
+            // Let go of the caller's pipes, or whoever waits for them (ctest) hangs
+            setsid();
+            int null_fd = open("/dev/null", O_RDWR | O_CLOEXEC);
+            if (null_fd >= 0) {
+                dup2(null_fd, STDIN_FILENO);
+                dup2(null_fd, STDOUT_FILENO);
+                dup2(null_fd, STDERR_FILENO);
+                close(null_fd);
+            }
+        }
+
+        std::signal(SIGINT, HandleSignal);
+        std::signal(SIGTERM, HandleSignal);
+
+        NaluBoardSimulator board(params);
+        if (!channels.empty()) {
+            board.WriteReadoutChannels(channels);
+        }
+        if (windows > 0) {
+            board.WriteReadWindow(windows, windows, 1);
+        }
+        if (start) {
+            board.InitializeBoard();
+            board.StartCapture();
+        }
+        NaluBoardControllerLogger::info("Board simulator listening for commands on " + control);
+
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::duration<double>(duration_s);
+        bool quit = false;
+        char buffer[2048];
+        while (!quit && !g_stop.load()) {
+            if (duration_s > 0.0 && std::chrono::steady_clock::now() >= deadline) {
+                break;
+            }
+            pollfd poll_fd{fd, POLLIN, 0};
+            if (poll(&poll_fd, 1, 100) <= 0) {
+                continue;
+            }
+            sockaddr_in peer{};
+            socklen_t peer_size = sizeof(peer);
+            ssize_t size = recvfrom(fd, buffer, sizeof(buffer) - 1, 0, reinterpret_cast<sockaddr*>(&peer), &peer_size);
+            if (size < 0) {
+                continue;
+            }
+            std::string line(buffer, static_cast<size_t>(size));
+            while (!line.empty() && (line.back() == '\n' || line.back() == '\r')) {
+                line.pop_back();
+            }
+            std::string reply;
+            try {
+                reply = HandleCommand(line, board, quit);
+            } catch (const std::exception& e) {
+                reply = std::string("error ") + e.what();
+            }
+            sendto(fd, reply.data(), reply.size(), 0, reinterpret_cast<sockaddr*>(&peer), peer_size);
+        }
+
+        board.StopCapture();
+        NaluSimulatorStats stats = board.Stats();
+        NaluBoardControllerLogger::info("Board simulator sent " + std::to_string(stats.events) + " event(s) in " +
+                                        std::to_string(stats.packets) + " packet(s)");
+        close(fd);
+        if (daemon && !pid_file.empty()) {
+            std::remove(pid_file.c_str());
+        }
+    } catch (const std::exception& e) {
+        NaluBoardControllerLogger::error(std::string("Board simulator: ") + e.what());
+        return 1;
+    }
+    return 0;
+}